@@ -87,16 +87,20 @@ static const std::array<std::array<int, CHANNELS_MAX + 1>,
         // CHANNEL_LAYOUT_2_2
         {0, 1, -1, -1, -1, -1, -1, -1, -1, 2, 3},
 
-        // CHANNEL_LAYOUT_5_1
-        {0, 1, 2, 3, -1, -1, -1, -1, -1, 4, 5},
-
-        // FL | FR | FC | LFE | BL | BR | FLofC | FRofC | BC | SL | SR //
         // CHANNEL_LAYOUT_QUAD
         {0, 1, -1, -1, 2, 3, -1, -1, -1, -1, -1},
 
         // CHANNEL_LAYOUT_5_0
         {0, 1, 2, -1, -1, -1, -1, -1, -1, 3, 4},
 
+        // CHANNEL_LAYOUT_5_1
+        {0, 1, 2, 3, -1, -1, -1, -1, -1, 4, 5},
+
+        // FL | FR | FC | LFE | BL | BR | FLofC | FRofC | BC | SL | SR
+
+        // CHANNEL_LAYOUT_5_0_BACK
+        {0, 1, 2, -1, 3, 4, -1, -1, -1, -1, -1},
+
         // CHANNEL_LAYOUT_5_1_BACK
         {0, 1, 2, 3, 4, 5, -1, -1, -1, -1, -1},
 
@@ -15,6 +15,7 @@
 #include "base/task_util/task_runner.h"
 #include "base/task_util/task_runner_stdlib.h"
 #include "media/audio/linux/alsa_symbol_table.h"
+#include "media/audio/sample_conversion.h"
 
 #define LATE(sym) LATESYM_GET(AlsaSymbolTable, symbol_table_, sym)
 
@@ -326,15 +327,12 @@ ssize_t AlsaAudioTrack::Write(const void* buffer, size_t size, bool blocking) {
 
   // Convert float32 input to S16_LE if needed (ALSA is opened as S16_LE)
   if (config_.format == AUDIO_FORMAT_PCM_FLOAT) {
-    size_t num_samples = size / sizeof(float);
-    size_t frames = num_samples / channels;
-    std::vector<int16_t> s16_buf(num_samples);
-    const auto* float_src = static_cast<const float*>(buffer);
-    for (size_t i = 0; i < num_samples; i++) {
-      float f = std::max(-1.0f, std::min(1.0f, float_src[i]));
-      s16_buf[i] = static_cast<int16_t>(f * 32767.0f);
-    }
-    const auto* data = s16_buf.data();
+    size_t frames = size / (sizeof(float) * channels);
+    size_t num_samples = frames * channels;
+    s16_buffer_.resize(num_samples);
+    ConvertPcmSamples(buffer, AUDIO_FORMAT_PCM_FLOAT, s16_buffer_.data(),
+                      AUDIO_FORMAT_PCM_16_BIT, num_samples, &dither_);
+    const auto* data = s16_buffer_.data();
     size_t remaining = frames;
     ssize_t written = 0;
     while (remaining > 0) {
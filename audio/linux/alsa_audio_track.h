@@ -14,6 +14,7 @@
 
 #include <atomic>
 #include <memory>
+#include <vector>
 
 #include "base/task_util/repeating_task.h"
 #include "base/task_util/task_runner.h"
@@ -22,6 +23,7 @@
 #include "media/audio/audio_track.h"
 #include "media/audio/linux/alsa_audio_device.h"
 #include "media/audio/linux/alsa_symbol_table.h"
+#include "media/audio/sample_conversion.h"
 
 namespace ave {
 namespace media {
@@ -71,6 +73,10 @@ class AlsaAudioTrack : public AudioTrack {
   snd_pcm_uframes_t period_size_;
   snd_pcm_uframes_t buffer_size_;
 
+  // float input is converted to the S16_LE the device is opened with
+  std::vector<int16_t> s16_buffer_;
+  AudioDither dither_;
+
   // Callback mode support
   std::unique_ptr<uint8_t[]> callback_buffer_;
   std::unique_ptr<base::TaskRunner> task_runner_;
@@ -13,6 +13,7 @@
 #include "base/logging.h"
 #include "media/audio/channel_layout.h"
 #include "media/audio/linux/pulse_symbol_table.h"
+#include "media/audio/sample_conversion.h"
 
 #define LATE(sym)                                             \
   LATESYM_GET(ave::media::linux_audio::PulseAudioSymbolTable, \
@@ -268,7 +269,26 @@ ssize_t PulseAudioTrack::Write(const void* buffer, size_t size, bool blocking) {
   }
 
   size_t write_size = std::min(size, writable);
-  int err = LATE(pa_stream_write)(stream_, buffer, write_size, nullptr, 0,
+  size_t consumed = write_size;
+  const void* data = buffer;
+  // The stream is S16LE, convert float input to it.
+  if (config_.format == AUDIO_FORMAT_PCM_FLOAT) {
+    const auto channels = static_cast<size_t>(channelCount());
+    const size_t frames =
+        std::min(size / (sizeof(float) * channels),
+                 writable / static_cast<size_t>(frameSize()));
+    if (frames == 0) {
+      LATE(pa_threaded_mainloop_unlock)(mainloop_);
+      return 0;
+    }
+    s16_buffer_.resize(frames * channels);
+    ConvertPcmSamples(buffer, AUDIO_FORMAT_PCM_FLOAT, s16_buffer_.data(),
+                      AUDIO_FORMAT_PCM_16_BIT, s16_buffer_.size(), &dither_);
+    data = s16_buffer_.data();
+    write_size = s16_buffer_.size() * sizeof(int16_t);
+    consumed = s16_buffer_.size() * sizeof(float);
+  }
+  int err = LATE(pa_stream_write)(stream_, data, write_size, nullptr, 0,
                                   PA_SEEK_RELATIVE);
 
   LATE(pa_threaded_mainloop_unlock)(mainloop_);
@@ -279,7 +299,8 @@ ssize_t PulseAudioTrack::Write(const void* buffer, size_t size, bool blocking) {
     return err;
   }
 
-  return static_cast<ssize_t>(write_size);
+  // In bytes of the caller's format.
+  return static_cast<ssize_t>(consumed);
 }
 
 status_t PulseAudioTrack::Start() {
@@ -10,9 +10,11 @@
 
 #include <pulse/pulseaudio.h>
 #include <memory>
+#include <vector>
 
 #include "base/types.h"
 #include "media/audio/audio_track.h"
+#include "media/audio/sample_conversion.h"
 
 namespace ave {
 namespace media {
@@ -67,6 +69,10 @@ class PulseAudioTrack : public AudioTrack {
   size_t buffer_size_;
   std::unique_ptr<uint8_t[]> temp_buffer_;
   size_t temp_buffer_size_;
+
+  // float input is converted to the S16LE stream format
+  std::vector<int16_t> s16_buffer_;
+  AudioDither dither_;
 };
 
 }  // namespace linux_audio
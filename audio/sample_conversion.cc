@@ -0,0 +1,667 @@
+/*
+ * sample_conversion.cc
+ * Copyright (C) 2025 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#include "sample_conversion.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
+namespace ave {
+namespace media {
+
+namespace {
+
+constexpr float kS16Scale = 32768.0f;
+constexpr float kS32Scale = 2147483648.0f;
+// Samples converted per step when going through an intermediate format.
+constexpr size_t kChunkSamples = 256;
+
+// Fixed size copies for the common sample sizes, so the compiler turns the
+// per-sample memcpy into a single move.
+template <size_t kSize>
+void InterleaveFixed(const uint8_t* const* planes,
+                     int channels,
+                     size_t frames,
+                     uint8_t* dst) {
+  for (size_t i = 0; i < frames; ++i) {
+    for (int ch = 0; ch < channels; ++ch) {
+      std::memcpy(dst, planes[ch] + i * kSize, kSize);
+      dst += kSize;
+    }
+  }
+}
+
+template <size_t kSize>
+void DeinterleaveFixed(const uint8_t* src,
+                       int channels,
+                       size_t frames,
+                       uint8_t* const* planes) {
+  for (size_t i = 0; i < frames; ++i) {
+    for (int ch = 0; ch < channels; ++ch) {
+      std::memcpy(planes[ch] + i * kSize, src, kSize);
+      src += kSize;
+    }
+  }
+}
+
+// Stereo is by far the most common layout, interleave it two vectors at a
+// time. Returns the frames handled.
+size_t InterleaveStereo(const uint8_t* left,
+                        const uint8_t* right,
+                        size_t frames,
+                        size_t sample_size,
+                        uint8_t* dst) {
+  size_t i = 0;
+#if defined(__SSE2__)
+  if (sample_size == 2) {
+    for (; i + 8 <= frames; i += 8) {
+      const __m128i l =
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(left + 2 * i));
+      const __m128i r =
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(right + 2 * i));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 4 * i),
+                       _mm_unpacklo_epi16(l, r));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 4 * i + 16),
+                       _mm_unpackhi_epi16(l, r));
+    }
+  } else if (sample_size == 4) {
+    for (; i + 4 <= frames; i += 4) {
+      const __m128i l =
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(left + 4 * i));
+      const __m128i r =
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(right + 4 * i));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 8 * i),
+                       _mm_unpacklo_epi32(l, r));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 8 * i + 16),
+                       _mm_unpackhi_epi32(l, r));
+    }
+  }
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+  if (sample_size == 2) {
+    for (; i + 8 <= frames; i += 8) {
+      uint16x8x2_t pairs;
+      pairs.val[0] = vreinterpretq_u16_u8(vld1q_u8(left + 2 * i));
+      pairs.val[1] = vreinterpretq_u16_u8(vld1q_u8(right + 2 * i));
+      vst2q_u16(reinterpret_cast<uint16_t*>(dst + 4 * i), pairs);
+    }
+  } else if (sample_size == 4) {
+    for (; i + 4 <= frames; i += 4) {
+      uint32x4x2_t pairs;
+      pairs.val[0] = vreinterpretq_u32_u8(vld1q_u8(left + 4 * i));
+      pairs.val[1] = vreinterpretq_u32_u8(vld1q_u8(right + 4 * i));
+      vst2q_u32(reinterpret_cast<uint32_t*>(dst + 8 * i), pairs);
+    }
+  }
+#endif
+  return i;
+}
+
+size_t DeinterleaveStereo(const uint8_t* src,
+                          size_t frames,
+                          size_t sample_size,
+                          uint8_t* left,
+                          uint8_t* right) {
+  size_t i = 0;
+#if defined(__SSE2__)
+  if (sample_size == 2) {
+    for (; i + 8 <= frames; i += 8) {
+      // Sign extension keeps the L samples, the arithmetic shift the R ones;
+      // packs then cannot saturate.
+      const __m128i a =
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 4 * i));
+      const __m128i b =
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 4 * i + 16));
+      const __m128i l = _mm_packs_epi32(_mm_srai_epi32(_mm_slli_epi32(a, 16),
+                                                       16),
+                                        _mm_srai_epi32(_mm_slli_epi32(b, 16),
+                                                       16));
+      const __m128i r =
+          _mm_packs_epi32(_mm_srai_epi32(a, 16), _mm_srai_epi32(b, 16));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(left + 2 * i), l);
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(right + 2 * i), r);
+    }
+  } else if (sample_size == 4) {
+    for (; i + 4 <= frames; i += 4) {
+      const __m128 a =
+          _mm_loadu_ps(reinterpret_cast<const float*>(src + 8 * i));
+      const __m128 b =
+          _mm_loadu_ps(reinterpret_cast<const float*>(src + 8 * i + 16));
+      _mm_storeu_ps(reinterpret_cast<float*>(left + 4 * i),
+                    _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+      _mm_storeu_ps(reinterpret_cast<float*>(right + 4 * i),
+                    _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+    }
+  }
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+  if (sample_size == 2) {
+    for (; i + 8 <= frames; i += 8) {
+      const uint16x8x2_t pairs =
+          vld2q_u16(reinterpret_cast<const uint16_t*>(src + 4 * i));
+      vst1q_u8(left + 2 * i, vreinterpretq_u8_u16(pairs.val[0]));
+      vst1q_u8(right + 2 * i, vreinterpretq_u8_u16(pairs.val[1]));
+    }
+  } else if (sample_size == 4) {
+    for (; i + 4 <= frames; i += 4) {
+      const uint32x4x2_t pairs =
+          vld2q_u32(reinterpret_cast<const uint32_t*>(src + 8 * i));
+      vst1q_u8(left + 4 * i, vreinterpretq_u8_u32(pairs.val[0]));
+      vst1q_u8(right + 4 * i, vreinterpretq_u8_u32(pairs.val[1]));
+    }
+  }
+#endif
+  return i;
+}
+
+// |noise|, if set, is added in LSBs after scaling.
+int16_t FloatToS16(float sample, float noise) {
+  const float scaled = std::clamp(sample, -1.0f, 1.0f) * kS16Scale + noise;
+  return static_cast<int16_t>(
+      std::clamp(std::lrintf(scaled), static_cast<long>(INT16_MIN),
+                 static_cast<long>(INT16_MAX)));
+}
+
+int32_t FloatToS32(float sample) {
+  const double scaled =
+      static_cast<double>(std::clamp(sample, -1.0f, 1.0f)) * kS32Scale;
+  return static_cast<int32_t>(
+      std::min(std::llrint(scaled), static_cast<long long>(INT32_MAX)));
+}
+
+// |noise| is either null or holds |count| dither values.
+void ConvertFloatToS16(const float* src,
+                       const float* noise,
+                       int16_t* dst,
+                       size_t count) {
+  size_t i = 0;
+#if defined(__SSE2__)
+  const __m128 one = _mm_set1_ps(1.0f);
+  const __m128 minus_one = _mm_set1_ps(-1.0f);
+  const __m128 scale = _mm_set1_ps(kS16Scale);
+  for (; i + 8 <= count; i += 8) {
+    __m128 lo = _mm_mul_ps(
+        _mm_max_ps(_mm_min_ps(_mm_loadu_ps(src + i), one), minus_one), scale);
+    __m128 hi = _mm_mul_ps(
+        _mm_max_ps(_mm_min_ps(_mm_loadu_ps(src + i + 4), one), minus_one),
+        scale);
+    if (noise) {
+      lo = _mm_add_ps(lo, _mm_loadu_ps(noise + i));
+      hi = _mm_add_ps(hi, _mm_loadu_ps(noise + i + 4));
+    }
+    // packs saturates the 32768 of a full scale 1.0 to 32767.
+    _mm_storeu_si128(
+        reinterpret_cast<__m128i*>(dst + i),
+        _mm_packs_epi32(_mm_cvtps_epi32(lo), _mm_cvtps_epi32(hi)));
+  }
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+  const float32x4_t one = vdupq_n_f32(1.0f);
+  const float32x4_t minus_one = vdupq_n_f32(-1.0f);
+#if !defined(__aarch64__)
+  // Adding and removing 1.5 * 2^23 leaves |x| < 2^22 rounded to the nearest
+  // integer, ties to even.
+  const float32x4_t round_magic = vdupq_n_f32(12582912.0f);
+#endif
+  for (; i + 8 <= count; i += 8) {
+    float32x4_t lo = vmulq_n_f32(
+        vmaxq_f32(vminq_f32(vld1q_f32(src + i), one), minus_one), kS16Scale);
+    float32x4_t hi = vmulq_n_f32(
+        vmaxq_f32(vminq_f32(vld1q_f32(src + i + 4), one), minus_one),
+        kS16Scale);
+    if (noise) {
+      lo = vaddq_f32(lo, vld1q_f32(noise + i));
+      hi = vaddq_f32(hi, vld1q_f32(noise + i + 4));
+    }
+    // Round half to even like _mm_cvtps_epi32 and lrintf; vqmovn saturates a
+    // full scale 1.0 to 32767.
+#if defined(__aarch64__)
+    const int32x4_t lo32 = vcvtnq_s32_f32(lo);
+    const int32x4_t hi32 = vcvtnq_s32_f32(hi);
+#else
+    // vcvtq_s32_f32 truncates, the values are integral by then.
+    const int32x4_t lo32 =
+        vcvtq_s32_f32(vsubq_f32(vaddq_f32(lo, round_magic), round_magic));
+    const int32x4_t hi32 =
+        vcvtq_s32_f32(vsubq_f32(vaddq_f32(hi, round_magic), round_magic));
+#endif
+    vst1q_s16(dst + i, vcombine_s16(vqmovn_s32(lo32), vqmovn_s32(hi32)));
+  }
+#endif
+  for (; i < count; ++i) {
+    dst[i] = FloatToS16(src[i], noise ? noise[i] : 0.0f);
+  }
+}
+
+void ConvertFloatToS16Dithered(const float* src,
+                               int16_t* dst,
+                               size_t count,
+                               AudioDither* dither) {
+  float noise[kChunkSamples];
+  while (count > 0) {
+    const size_t n = std::min(count, kChunkSamples);
+    for (size_t i = 0; i < n; ++i) {
+      noise[i] = dither->Next();
+    }
+    ConvertFloatToS16(src, noise, dst, n);
+    src += n;
+    dst += n;
+    count -= n;
+  }
+}
+
+void ConvertS16ToFloat(const int16_t* src, float* dst, size_t count) {
+  const float scale = 1.0f / kS16Scale;
+  size_t i = 0;
+#if defined(__SSE2__)
+  const __m128 scale4 = _mm_set1_ps(scale);
+  for (; i + 8 <= count; i += 8) {
+    const __m128i samples =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+    // Sign extend by unpacking into the high halves and shifting back.
+    const __m128i lo =
+        _mm_srai_epi32(_mm_unpacklo_epi16(_mm_setzero_si128(), samples), 16);
+    const __m128i hi =
+        _mm_srai_epi32(_mm_unpackhi_epi16(_mm_setzero_si128(), samples), 16);
+    _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), scale4));
+    _mm_storeu_ps(dst + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale4));
+  }
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+  for (; i + 8 <= count; i += 8) {
+    const int16x8_t samples = vld1q_s16(src + i);
+    vst1q_f32(dst + i,
+              vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(samples))),
+                          scale));
+    vst1q_f32(dst + i + 4,
+              vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(samples))),
+                          scale));
+  }
+#endif
+  for (; i < count; ++i) {
+    dst[i] = src[i] * scale;
+  }
+}
+
+void ConvertFloatToS32(const float* src, int32_t* dst, size_t count) {
+  size_t i = 0;
+#if defined(__SSE2__)
+  const __m128 one = _mm_set1_ps(1.0f);
+  const __m128 minus_one = _mm_set1_ps(-1.0f);
+  const __m128 scale = _mm_set1_ps(kS32Scale);
+  for (; i + 4 <= count; i += 4) {
+    const __m128 scaled = _mm_mul_ps(
+        _mm_max_ps(_mm_min_ps(_mm_loadu_ps(src + i), one), minus_one), scale);
+    // A full scale 1.0 overflows to INT32_MIN; flip those lanes to
+    // INT32_MAX.
+    const __m128i overflow =
+        _mm_castps_si128(_mm_cmpge_ps(scaled, scale));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i),
+                     _mm_xor_si128(_mm_cvtps_epi32(scaled), overflow));
+  }
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+  for (; i + 4 <= count; i += 4) {
+    // Q31 conversion saturates a full scale 1.0 to INT32_MAX.
+    vst1q_s32(dst + i, vcvtq_n_s32_f32(vld1q_f32(src + i), 31));
+  }
+#endif
+  for (; i < count; ++i) {
+    dst[i] = FloatToS32(src[i]);
+  }
+}
+
+void ConvertS32ToFloat(const int32_t* src, float* dst, size_t count) {
+  const float scale = 1.0f / kS32Scale;
+  size_t i = 0;
+#if defined(__SSE2__)
+  const __m128 scale4 = _mm_set1_ps(scale);
+  for (; i + 4 <= count; i += 4) {
+    const __m128i samples =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+    _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(samples), scale4));
+  }
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+  for (; i + 4 <= count; i += 4) {
+    vst1q_f32(dst + i, vcvtq_n_f32_s32(vld1q_s32(src + i), 31));
+  }
+#endif
+  for (; i < count; ++i) {
+    dst[i] = static_cast<float>(src[i]) * scale;
+  }
+}
+
+void ConvertS16ToS32(const int16_t* src, int32_t* dst, size_t count) {
+  size_t i = 0;
+#if defined(__SSE2__)
+  for (; i + 8 <= count; i += 8) {
+    const __m128i samples =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i),
+                     _mm_unpacklo_epi16(_mm_setzero_si128(), samples));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i + 4),
+                     _mm_unpackhi_epi16(_mm_setzero_si128(), samples));
+  }
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+  for (; i + 8 <= count; i += 8) {
+    const int16x8_t samples = vld1q_s16(src + i);
+    vst1q_s32(dst + i, vshll_n_s16(vget_low_s16(samples), 16));
+    vst1q_s32(dst + i + 4, vshll_n_s16(vget_high_s16(samples), 16));
+  }
+#endif
+  for (; i < count; ++i) {
+    dst[i] = static_cast<int32_t>(static_cast<uint32_t>(src[i]) << 16);
+  }
+}
+
+void ConvertS32ToS16(const int32_t* src, int16_t* dst, size_t count) {
+  size_t i = 0;
+#if defined(__SSE2__)
+  for (; i + 8 <= count; i += 8) {
+    const __m128i lo = _mm_srai_epi32(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i)), 16);
+    const __m128i hi = _mm_srai_epi32(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 4)), 16);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i),
+                     _mm_packs_epi32(lo, hi));
+  }
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+  for (; i + 8 <= count; i += 8) {
+    vst1q_s16(dst + i, vcombine_s16(vshrn_n_s32(vld1q_s32(src + i), 16),
+                                    vshrn_n_s32(vld1q_s32(src + i + 4), 16)));
+  }
+#endif
+  for (; i < count; ++i) {
+    dst[i] = static_cast<int16_t>(src[i] >> 16);
+  }
+}
+
+// 24 bit packed samples are little endian and go through 32 bit.
+void ConvertS24ToS32(const uint8_t* src, int32_t* dst, size_t count) {
+  for (size_t i = 0; i < count; ++i, src += 3) {
+    dst[i] = static_cast<int32_t>(static_cast<uint32_t>(src[0]) << 8 |
+                                  static_cast<uint32_t>(src[1]) << 16 |
+                                  static_cast<uint32_t>(src[2]) << 24);
+  }
+}
+
+void ConvertS32ToS24(const int32_t* src, uint8_t* dst, size_t count) {
+  for (size_t i = 0; i < count; ++i, dst += 3) {
+    const auto sample = static_cast<uint32_t>(src[i]);
+    dst[0] = static_cast<uint8_t>(sample >> 8);
+    dst[1] = static_cast<uint8_t>(sample >> 16);
+    dst[2] = static_cast<uint8_t>(sample >> 24);
+  }
+}
+
+// Conversions between the 16 bit, 32 bit and float formats.
+bool ConvertDirect(const void* src,
+                   audio_format_t src_format,
+                   void* dst,
+                   audio_format_t dst_format,
+                   size_t count,
+                   AudioDither* dither) {
+  if (src_format == AUDIO_FORMAT_PCM_FLOAT &&
+      dst_format == AUDIO_FORMAT_PCM_16_BIT) {
+    if (dither) {
+      ConvertFloatToS16Dithered(static_cast<const float*>(src),
+                                static_cast<int16_t*>(dst), count, dither);
+    } else {
+      ConvertFloatToS16(static_cast<const float*>(src), nullptr,
+                        static_cast<int16_t*>(dst), count);
+    }
+  } else if (src_format == AUDIO_FORMAT_PCM_16_BIT &&
+             dst_format == AUDIO_FORMAT_PCM_FLOAT) {
+    ConvertS16ToFloat(static_cast<const int16_t*>(src),
+                      static_cast<float*>(dst), count);
+  } else if (src_format == AUDIO_FORMAT_PCM_FLOAT &&
+             dst_format == AUDIO_FORMAT_PCM_32_BIT) {
+    ConvertFloatToS32(static_cast<const float*>(src),
+                      static_cast<int32_t*>(dst), count);
+  } else if (src_format == AUDIO_FORMAT_PCM_32_BIT &&
+             dst_format == AUDIO_FORMAT_PCM_FLOAT) {
+    ConvertS32ToFloat(static_cast<const int32_t*>(src),
+                      static_cast<float*>(dst), count);
+  } else if (src_format == AUDIO_FORMAT_PCM_16_BIT &&
+             dst_format == AUDIO_FORMAT_PCM_32_BIT) {
+    ConvertS16ToS32(static_cast<const int16_t*>(src),
+                    static_cast<int32_t*>(dst), count);
+  } else if (src_format == AUDIO_FORMAT_PCM_32_BIT &&
+             dst_format == AUDIO_FORMAT_PCM_16_BIT) {
+    ConvertS32ToS16(static_cast<const int32_t*>(src),
+                    static_cast<int16_t*>(dst), count);
+  } else {
+    return false;
+  }
+  return true;
+}
+
+}  // namespace
+
+size_t PcmSampleSize(audio_format_t format) {
+  switch (format) {
+    case AUDIO_FORMAT_PCM_16_BIT:
+      return sizeof(int16_t);
+    case AUDIO_FORMAT_PCM_24_BIT_PACKED:
+      return 3;
+    case AUDIO_FORMAT_PCM_32_BIT:
+      return sizeof(int32_t);
+    case AUDIO_FORMAT_PCM_FLOAT:
+      return sizeof(float);
+    default:
+      return 0;
+  }
+}
+
+void InterleaveSamples(const uint8_t* const* planes,
+                       int channels,
+                       size_t frames,
+                       size_t sample_size,
+                       uint8_t* dst) {
+  if (channels == 1) {
+    std::memcpy(dst, planes[0], frames * sample_size);
+    return;
+  }
+  size_t done = 0;
+  if (channels == 2) {
+    done = InterleaveStereo(planes[0], planes[1], frames, sample_size, dst);
+  }
+  if (done == frames) {
+    return;
+  }
+
+  // The remaining frames start |done| samples into every plane.
+  std::array<const uint8_t*, kMaxConcurrentChannels> rest{};
+  const uint8_t* const* tail = planes;
+  if (done > 0) {
+    for (int ch = 0; ch < channels; ++ch) {
+      rest[ch] = planes[ch] + done * sample_size;
+    }
+    tail = rest.data();
+  }
+  dst += done * channels * sample_size;
+  frames -= done;
+  switch (sample_size) {
+    case 2:
+      InterleaveFixed<2>(tail, channels, frames, dst);
+      break;
+    case 3:
+      InterleaveFixed<3>(tail, channels, frames, dst);
+      break;
+    case 4:
+      InterleaveFixed<4>(tail, channels, frames, dst);
+      break;
+    case 8:
+      InterleaveFixed<8>(tail, channels, frames, dst);
+      break;
+    default:
+      for (size_t i = 0; i < frames; ++i) {
+        for (int ch = 0; ch < channels; ++ch) {
+          std::memcpy(dst, tail[ch] + i * sample_size, sample_size);
+          dst += sample_size;
+        }
+      }
+      break;
+  }
+}
+
+void DeinterleaveSamples(const uint8_t* src,
+                         int channels,
+                         size_t frames,
+                         size_t sample_size,
+                         uint8_t* const* planes) {
+  if (channels == 1) {
+    std::memcpy(planes[0], src, frames * sample_size);
+    return;
+  }
+  size_t done = 0;
+  if (channels == 2) {
+    done = DeinterleaveStereo(src, frames, sample_size, planes[0], planes[1]);
+  }
+  if (done == frames) {
+    return;
+  }
+
+  std::array<uint8_t*, kMaxConcurrentChannels> rest{};
+  uint8_t* const* tail = planes;
+  if (done > 0) {
+    for (int ch = 0; ch < channels; ++ch) {
+      rest[ch] = planes[ch] + done * sample_size;
+    }
+    tail = rest.data();
+  }
+  src += done * channels * sample_size;
+  frames -= done;
+  switch (sample_size) {
+    case 2:
+      DeinterleaveFixed<2>(src, channels, frames, tail);
+      break;
+    case 3:
+      DeinterleaveFixed<3>(src, channels, frames, tail);
+      break;
+    case 4:
+      DeinterleaveFixed<4>(src, channels, frames, tail);
+      break;
+    case 8:
+      DeinterleaveFixed<8>(src, channels, frames, tail);
+      break;
+    default:
+      for (size_t i = 0; i < frames; ++i) {
+        for (int ch = 0; ch < channels; ++ch) {
+          std::memcpy(tail[ch] + i * sample_size, src, sample_size);
+          src += sample_size;
+        }
+      }
+      break;
+  }
+}
+
+float AudioDither::Next() {
+  // Sum of two uniform values in [-0.5, 0.5) from a 32 bit LCG.
+  auto uniform = [this]() {
+    state_ = state_ * 1664525u + 1013904223u;
+    return static_cast<float>(state_ >> 8) * (1.0f / 16777216.0f) - 0.5f;
+  };
+  const float a = uniform();
+  return a + uniform();
+}
+
+bool ConvertPcmSamples(const void* src,
+                       audio_format_t src_format,
+                       void* dst,
+                       audio_format_t dst_format,
+                       size_t count,
+                       AudioDither* dither) {
+  const size_t src_size = PcmSampleSize(src_format);
+  const size_t dst_size = PcmSampleSize(dst_format);
+  if (src_size == 0 || dst_size == 0) {
+    return false;
+  }
+  if (src_format == dst_format) {
+    if (src != dst) {
+      std::memmove(dst, src, count * src_size);
+    }
+    return true;
+  }
+  if (src_format != AUDIO_FORMAT_PCM_24_BIT_PACKED &&
+      dst_format != AUDIO_FORMAT_PCM_24_BIT_PACKED) {
+    return ConvertDirect(src, src_format, dst, dst_format, count, dither);
+  }
+
+  // 24 bit packed on either side: go through 32 bit in chunks.
+  const auto* in = static_cast<const uint8_t*>(src);
+  auto* out = static_cast<uint8_t*>(dst);
+  int32_t chunk[kChunkSamples];
+  while (count > 0) {
+    const size_t n = std::min(count, kChunkSamples);
+    if (src_format == AUDIO_FORMAT_PCM_24_BIT_PACKED) {
+      ConvertS24ToS32(in, chunk, n);
+    } else if (src_format == AUDIO_FORMAT_PCM_32_BIT) {
+      std::memcpy(chunk, in, n * sizeof(int32_t));
+    } else {
+      ConvertDirect(in, src_format, chunk, AUDIO_FORMAT_PCM_32_BIT, n, dither);
+    }
+    if (dst_format == AUDIO_FORMAT_PCM_24_BIT_PACKED) {
+      ConvertS32ToS24(chunk, out, n);
+    } else if (dst_format == AUDIO_FORMAT_PCM_32_BIT) {
+      std::memcpy(out, chunk, n * sizeof(int32_t));
+    } else {
+      ConvertDirect(chunk, AUDIO_FORMAT_PCM_32_BIT, out, dst_format, n,
+                    dither);
+    }
+    in += n * src_size;
+    out += n * dst_size;
+    count -= n;
+  }
+  return true;
+}
+
+bool RemapChannels(const uint8_t* src,
+                   ChannelLayout src_layout,
+                   uint8_t* dst,
+                   ChannelLayout dst_layout,
+                   size_t frames,
+                   size_t sample_size) {
+  const int src_channels = ChannelLayoutToChannelCount(src_layout);
+  const int dst_channels = ChannelLayoutToChannelCount(dst_layout);
+  if (src_channels == 0 || dst_channels == 0) {
+    return false;
+  }
+
+  // Source index of every destination channel, -1 for silence.
+  std::array<int, kMaxConcurrentChannels> map;
+  map.fill(-1);
+  for (int c = 0; c <= CHANNELS_MAX; ++c) {
+    const auto channel = static_cast<Channels>(c);
+    const int to = ChannelOrder(dst_layout, channel);
+    if (to >= 0) {
+      map[to] = ChannelOrder(src_layout, channel);
+    }
+  }
+
+  const size_t src_frame = src_channels * sample_size;
+  const size_t dst_frame = dst_channels * sample_size;
+  for (size_t i = 0; i < frames; ++i) {
+    const uint8_t* in = src + i * src_frame;
+    uint8_t* out = dst + i * dst_frame;
+    for (int ch = 0; ch < dst_channels; ++ch) {
+      if (map[ch] >= 0) {
+        std::memcpy(out + ch * sample_size, in + map[ch] * sample_size,
+                    sample_size);
+      } else {
+        std::memset(out + ch * sample_size, 0, sample_size);
+      }
+    }
+  }
+  return true;
+}
+
+}  // namespace media
+}  // namespace ave
@@ -0,0 +1,81 @@
+/*
+ * sample_conversion.h
+ * Copyright (C) 2025 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#ifndef SAMPLE_CONVERSION_H
+#define SAMPLE_CONVERSION_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "audio_format.h"
+#include "channel_layout.h"
+
+namespace ave {
+namespace media {
+
+// Linear PCM helpers shared by the codecs and the audio tracks. The hot
+// paths are vectorized with SSE2 or NEON when the build targets them.
+// Samples are native endian; float samples are nominally in [-1, 1] and are
+// scaled by 2^15 / 2^31 to and from the integer formats, like FFmpeg does.
+
+// Bytes one sample of |format| takes, 0 if |format| is not one of
+// AUDIO_FORMAT_PCM_16_BIT, AUDIO_FORMAT_PCM_24_BIT_PACKED,
+// AUDIO_FORMAT_PCM_32_BIT or AUDIO_FORMAT_PCM_FLOAT.
+size_t PcmSampleSize(audio_format_t format);
+
+// Interleaves |frames| samples of each of the |channels| planes into
+// |dst|, and back. |sample_size| is in bytes.
+void InterleaveSamples(const uint8_t* const* planes,
+                       int channels,
+                       size_t frames,
+                       size_t sample_size,
+                       uint8_t* dst);
+void DeinterleaveSamples(const uint8_t* src,
+                         int channels,
+                         size_t frames,
+                         size_t sample_size,
+                         uint8_t* const* planes);
+
+// Triangular (TPDF) dither of +-1 LSB for conversions to 16 bit. Keeps its
+// state between calls so consecutive buffers do not repeat the noise.
+class AudioDither {
+ public:
+  explicit AudioDither(uint32_t seed = 1) : state_(seed) {}
+
+  // Next noise value in LSBs, in [-1, 1).
+  float Next();
+
+ private:
+  uint32_t state_;
+};
+
+// Converts |count| samples from |src_format| to |dst_format|, both among
+// the formats PcmSampleSize() knows. |dither|, if set, is applied when
+// converting float to 16 bit. Returns false for unsupported formats.
+// |src| and |dst| may only alias if the formats have the same size.
+bool ConvertPcmSamples(const void* src,
+                       audio_format_t src_format,
+                       void* dst,
+                       audio_format_t dst_format,
+                       size_t count,
+                       AudioDither* dither = nullptr);
+
+// Reorders interleaved |frames| from |src_layout| to |dst_layout| by
+// channel position. Channels |src_layout| lacks are silent and the ones
+// |dst_layout| lacks are dropped; nothing is mixed. Returns false if either
+// layout has no fixed channel order.
+bool RemapChannels(const uint8_t* src,
+                   ChannelLayout src_layout,
+                   uint8_t* dst,
+                   ChannelLayout dst_layout,
+                   size_t frames,
+                   size_t sample_size);
+
+}  // namespace media
+}  // namespace ave
+
+#endif /* !SAMPLE_CONVERSION_H */
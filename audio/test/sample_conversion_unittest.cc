@@ -0,0 +1,218 @@
+/*
+ * sample_conversion_unittest.cc
+ * Copyright (C) 2025 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#include "media/audio/sample_conversion.h"
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "test/gtest.h"
+
+namespace ave {
+namespace media {
+
+namespace {
+
+// Long enough for every vector width plus a scalar tail.
+constexpr size_t kFrames = 37;
+
+std::vector<int16_t> MakeS16(size_t count) {
+  std::vector<int16_t> samples(count);
+  for (size_t i = 0; i < count; ++i) {
+    samples[i] = static_cast<int16_t>(i * 1237 - 20000);
+  }
+  return samples;
+}
+
+}  // namespace
+
+TEST(SampleConversionTest, PcmSampleSize) {
+  EXPECT_EQ(PcmSampleSize(AUDIO_FORMAT_PCM_16_BIT), 2u);
+  EXPECT_EQ(PcmSampleSize(AUDIO_FORMAT_PCM_24_BIT_PACKED), 3u);
+  EXPECT_EQ(PcmSampleSize(AUDIO_FORMAT_PCM_32_BIT), 4u);
+  EXPECT_EQ(PcmSampleSize(AUDIO_FORMAT_PCM_FLOAT), 4u);
+  EXPECT_EQ(PcmSampleSize(AUDIO_FORMAT_AAC), 0u);
+}
+
+TEST(SampleConversionTest, InterleaveRoundTrip) {
+  for (const int channels : {1, 2, 3, 6, 8}) {
+    for (const size_t sample_size : {2u, 3u, 4u, 8u}) {
+      std::vector<std::vector<uint8_t>> planes(channels);
+      std::vector<const uint8_t*> src(channels);
+      for (int ch = 0; ch < channels; ++ch) {
+        planes[ch].resize(kFrames * sample_size);
+        for (size_t i = 0; i < planes[ch].size(); ++i) {
+          planes[ch][i] = static_cast<uint8_t>(ch * 31 + i);
+        }
+        src[ch] = planes[ch].data();
+      }
+
+      std::vector<uint8_t> interleaved(kFrames * channels * sample_size);
+      InterleaveSamples(src.data(), channels, kFrames, sample_size,
+                        interleaved.data());
+      for (size_t i = 0; i < kFrames; ++i) {
+        for (int ch = 0; ch < channels; ++ch) {
+          ASSERT_EQ(std::memcmp(
+                        interleaved.data() + (i * channels + ch) * sample_size,
+                        planes[ch].data() + i * sample_size, sample_size),
+                    0)
+              << "channels=" << channels << " size=" << sample_size
+              << " frame=" << i << " ch=" << ch;
+        }
+      }
+
+      std::vector<std::vector<uint8_t>> out(channels);
+      std::vector<uint8_t*> dst(channels);
+      for (int ch = 0; ch < channels; ++ch) {
+        out[ch].resize(kFrames * sample_size);
+        dst[ch] = out[ch].data();
+      }
+      DeinterleaveSamples(interleaved.data(), channels, kFrames, sample_size,
+                          dst.data());
+      EXPECT_EQ(out, planes) << "channels=" << channels
+                             << " size=" << sample_size;
+    }
+  }
+}
+
+TEST(SampleConversionTest, S16FloatRoundTrip) {
+  const std::vector<int16_t> src = MakeS16(kFrames);
+  std::vector<float> f32(kFrames);
+  ASSERT_TRUE(ConvertPcmSamples(src.data(), AUDIO_FORMAT_PCM_16_BIT,
+                                f32.data(), AUDIO_FORMAT_PCM_FLOAT, kFrames));
+  for (size_t i = 0; i < kFrames; ++i) {
+    ASSERT_FLOAT_EQ(f32[i], src[i] / 32768.0f) << "i=" << i;
+  }
+  std::vector<int16_t> back(kFrames);
+  ASSERT_TRUE(ConvertPcmSamples(f32.data(), AUDIO_FORMAT_PCM_FLOAT,
+                                back.data(), AUDIO_FORMAT_PCM_16_BIT,
+                                kFrames));
+  EXPECT_EQ(back, src);
+}
+
+TEST(SampleConversionTest, FloatToIntegerSaturates) {
+  std::vector<float> src(kFrames);
+  for (size_t i = 0; i < kFrames; ++i) {
+    src[i] = (i % 2) ? 4.0f : -4.0f;
+  }
+  src[1] = 1.0f;
+  src[2] = -1.0f;
+
+  std::vector<int16_t> s16(kFrames);
+  ASSERT_TRUE(ConvertPcmSamples(src.data(), AUDIO_FORMAT_PCM_FLOAT,
+                                s16.data(), AUDIO_FORMAT_PCM_16_BIT,
+                                kFrames));
+  std::vector<int32_t> s32(kFrames);
+  ASSERT_TRUE(ConvertPcmSamples(src.data(), AUDIO_FORMAT_PCM_FLOAT,
+                                s32.data(), AUDIO_FORMAT_PCM_32_BIT,
+                                kFrames));
+  for (size_t i = 0; i < kFrames; ++i) {
+    ASSERT_EQ(s16[i], (i % 2) ? INT16_MAX : INT16_MIN) << "i=" << i;
+    ASSERT_EQ(s32[i], (i % 2) ? INT32_MAX : INT32_MIN) << "i=" << i;
+  }
+}
+
+TEST(SampleConversionTest, FloatToS16RoundsHalfToEven) {
+  // Exact half LSB ties, repeated so the vector kernels see them too.
+  const float ties[] = {0.5f, 1.5f, 2.5f, -0.5f, -1.5f, -2.5f, 3.5f, -3.5f};
+  const int16_t expected[] = {0, 2, 2, 0, -2, -2, 4, -4};
+  std::vector<float> src(kFrames);
+  for (size_t i = 0; i < kFrames; ++i) {
+    src[i] = ties[i % 8] / 32768.0f;
+  }
+  std::vector<int16_t> s16(kFrames);
+  ASSERT_TRUE(ConvertPcmSamples(src.data(), AUDIO_FORMAT_PCM_FLOAT,
+                                s16.data(), AUDIO_FORMAT_PCM_16_BIT,
+                                kFrames));
+  for (size_t i = 0; i < kFrames; ++i) {
+    ASSERT_EQ(s16[i], expected[i % 8]) << "i=" << i;
+  }
+}
+
+TEST(SampleConversionTest, IntegerWidths) {
+  const std::vector<int16_t> src = MakeS16(kFrames);
+  std::vector<int32_t> s32(kFrames);
+  ASSERT_TRUE(ConvertPcmSamples(src.data(), AUDIO_FORMAT_PCM_16_BIT,
+                                s32.data(), AUDIO_FORMAT_PCM_32_BIT,
+                                kFrames));
+  for (size_t i = 0; i < kFrames; ++i) {
+    ASSERT_EQ(s32[i], src[i] * 65536) << "i=" << i;
+  }
+
+  std::vector<uint8_t> s24(kFrames * 3);
+  ASSERT_TRUE(ConvertPcmSamples(s32.data(), AUDIO_FORMAT_PCM_32_BIT,
+                                s24.data(), AUDIO_FORMAT_PCM_24_BIT_PACKED,
+                                kFrames));
+  // Little endian: the low byte of a 16 bit value shifted up by 8 is zero.
+  EXPECT_EQ(s24[0], 0);
+  EXPECT_EQ(s24[1], static_cast<uint8_t>(src[0]));
+  EXPECT_EQ(s24[2], static_cast<uint8_t>(src[0] >> 8));
+
+  std::vector<float> f32(kFrames);
+  ASSERT_TRUE(ConvertPcmSamples(s24.data(), AUDIO_FORMAT_PCM_24_BIT_PACKED,
+                                f32.data(), AUDIO_FORMAT_PCM_FLOAT, kFrames));
+  std::vector<int16_t> s16(kFrames);
+  ASSERT_TRUE(ConvertPcmSamples(f32.data(), AUDIO_FORMAT_PCM_FLOAT,
+                                s16.data(), AUDIO_FORMAT_PCM_16_BIT,
+                                kFrames));
+  EXPECT_EQ(s16, src);
+
+  EXPECT_FALSE(ConvertPcmSamples(src.data(), AUDIO_FORMAT_PCM_16_BIT,
+                                 s16.data(), AUDIO_FORMAT_PCM_8_BIT, kFrames));
+}
+
+TEST(SampleConversionTest, DitherStaysWithinOneLsb) {
+  std::vector<float> src(1000);
+  for (size_t i = 0; i < src.size(); ++i) {
+    src[i] = static_cast<float>(i) / 1000.0f - 0.5f;
+  }
+  std::vector<int16_t> plain(src.size());
+  std::vector<int16_t> dithered(src.size());
+  ConvertPcmSamples(src.data(), AUDIO_FORMAT_PCM_FLOAT, plain.data(),
+                    AUDIO_FORMAT_PCM_16_BIT, src.size());
+  AudioDither dither;
+  ConvertPcmSamples(src.data(), AUDIO_FORMAT_PCM_FLOAT, dithered.data(),
+                    AUDIO_FORMAT_PCM_16_BIT, src.size(), &dither);
+  size_t changed = 0;
+  for (size_t i = 0; i < src.size(); ++i) {
+    ASSERT_LE(std::abs(plain[i] - dithered[i]), 1) << "i=" << i;
+    changed += plain[i] != dithered[i];
+  }
+  EXPECT_GT(changed, 0u);
+}
+
+TEST(SampleConversionTest, RemapChannels) {
+  // 5.1 is L R C LFE SL SR; 5.1 back is L R C LFE BL BR.
+  std::vector<int16_t> surround(2 * 6);
+  for (size_t i = 0; i < surround.size(); ++i) {
+    surround[i] = static_cast<int16_t>(i + 1);
+  }
+
+  std::vector<int16_t> stereo(2 * 2);
+  ASSERT_TRUE(RemapChannels(
+      reinterpret_cast<const uint8_t*>(surround.data()), CHANNEL_LAYOUT_5_1,
+      reinterpret_cast<uint8_t*>(stereo.data()), CHANNEL_LAYOUT_STEREO, 2,
+      sizeof(int16_t)));
+  EXPECT_EQ(stereo, (std::vector<int16_t>{1, 2, 7, 8}));
+
+  std::vector<int16_t> back(2 * 6);
+  ASSERT_TRUE(RemapChannels(
+      reinterpret_cast<const uint8_t*>(surround.data()), CHANNEL_LAYOUT_5_1,
+      reinterpret_cast<uint8_t*>(back.data()), CHANNEL_LAYOUT_5_1_BACK, 2,
+      sizeof(int16_t)));
+  // The side channels have no place in the back layout.
+  EXPECT_EQ(back, (std::vector<int16_t>{1, 2, 3, 4, 0, 0, 7, 8, 9, 10, 0, 0}));
+
+  EXPECT_FALSE(RemapChannels(
+      reinterpret_cast<const uint8_t*>(surround.data()),
+      CHANNEL_LAYOUT_DISCRETE, reinterpret_cast<uint8_t*>(back.data()),
+      CHANNEL_LAYOUT_5_1, 2, sizeof(int16_t)));
+}
+
+}  // namespace media
+}  // namespace ave
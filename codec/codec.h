@@ -9,6 +9,7 @@
 #define CODEC_H
 
 #include <memory>
+#include <vector>
 
 #include "base/errors.h"
 
@@ -27,8 +28,18 @@ struct CodecInfo {
   std::string name;
   std::string mime;
   MediaType media_type = MediaType::UNKNOWN;
+  CodecId codec_id = CodecId::AVE_CODEC_ID_NONE;
 
-  // TODO: support resolution, frame rate, bit rate, etc
+  // capabilities, 0 or empty where the codec states no limit
+  int32_t max_width = 0;
+  int32_t max_height = 0;
+  std::vector<int32_t> profiles;
+  std::vector<PixelFormat> pixel_formats;
+
+  // measured by a calibration run, 0 if never calibrated: luma samples per
+  // second the codec got through and the thread count it did that with
+  int64_t max_pixel_rate = 0;
+  int thread_count = 0;
 
   bool is_encoder = false;
   bool hardware_accelerated = false;
@@ -57,6 +68,26 @@ struct CodecConfig {
   std::shared_ptr<VideoRender> video_render;
   std::shared_ptr<Crypto> crypto;
   std::shared_ptr<MediaMeta> format;
+  // worker threads for codecs that can decode in parallel, 0 means one per
+  // core and 1 keeps decoding on the codec thread
+  int thread_count = 0;
+  // decoders that support it hand out their own frame memory as output
+  // buffers instead of copying into them; the plane layout is then described
+  // by MediaMeta::plane_layout() and held until ReleaseOutputBuffer()
+  bool zero_copy_output = false;
+  // what video decoders output for 10/12 bit 4:2:0 content: 8 bit YUV420P,
+  // the native depth as YUV420P10LE/YUV420P12LE, or MSB aligned P010LE/P016LE
+  enum class HighBitDepthOutput {
+    k8Bit,
+    kNativePlanar,
+    kSemiPlanar,
+  };
+  HighBitDepthOutput high_bit_depth_output = HighBitDepthOutput::k8Bit;
+  // buffers are handed out through the callback only: the index passed to
+  // OnInputBufferAvailable() belongs to the client until it is queued, the
+  // one passed to OnOutputBufferAvailable() until it is released, and the
+  // Dequeue calls return -1
+  bool async_mode = false;
 };
 
 // this class is porting from Android MediaCodec
@@ -84,6 +115,13 @@ class Codec {
   virtual status_t Flush() = 0;
   virtual status_t Release() = 0;
 
+  // Applies |config| to a configured codec that is not started, like one
+  // CodecPool hands to another stream: its stream parameters and codec
+  // private data are replaced, its thread and buffers may be kept.
+  virtual status_t Reconfigure(const std::shared_ptr<CodecConfig>& config) {
+    return INVALID_OPERATION;
+  }
+
   /*
    * get input buffer from codec, can be used after DequeueInputBuffer
    * can be used to fill the buffer
@@ -123,6 +161,65 @@ class Codec {
    */
   virtual status_t ReleaseOutputBuffer(size_t index, bool render) = 0;
 
+  /*
+   * batch variants of the four calls above, for codecs with small frames
+   * where the per-buffer locking dominates
+   * dequeue: appends up to max_count indices to indices, waiting until
+   * timeout_ms for the first one only, and returns how many were appended
+   * queue/release: returns the first error; the default implementations
+   * have handled the indices before it, overrides may reject the whole batch
+   */
+  virtual size_t DequeueInputBuffers(std::vector<size_t>& indices,
+                                     size_t max_count,
+                                     int64_t timeout_ms) {
+    size_t count = 0;
+    while (count < max_count) {
+      const ssize_t index = DequeueInputBuffer(count == 0 ? timeout_ms : 0);
+      if (index < 0) {
+        break;
+      }
+      indices.push_back(static_cast<size_t>(index));
+      ++count;
+    }
+    return count;
+  }
+
+  virtual status_t QueueInputBuffers(const std::vector<size_t>& indices) {
+    for (const size_t index : indices) {
+      const status_t ret = QueueInputBuffer(index);
+      if (ret != OK) {
+        return ret;
+      }
+    }
+    return OK;
+  }
+
+  virtual size_t DequeueOutputBuffers(std::vector<size_t>& indices,
+                                      size_t max_count,
+                                      int64_t timeout_ms) {
+    size_t count = 0;
+    while (count < max_count) {
+      const ssize_t index = DequeueOutputBuffer(count == 0 ? timeout_ms : 0);
+      if (index < 0) {
+        break;
+      }
+      indices.push_back(static_cast<size_t>(index));
+      ++count;
+    }
+    return count;
+  }
+
+  virtual status_t ReleaseOutputBuffers(const std::vector<size_t>& indices,
+                                        bool render) {
+    for (const size_t index : indices) {
+      const status_t ret = ReleaseOutputBuffer(index, render);
+      if (ret != OK) {
+        return ret;
+      }
+    }
+    return OK;
+  }
+
   virtual bool IsValid() const { return true; }
 };
 
@@ -58,9 +58,32 @@ status_t CodecBuffer::EnsureCapacity(size_t capacity, bool copy) {
 }
 
 status_t CodecBuffer::ResetBuffer(std::shared_ptr<media::Buffer>& buffer) {
+  ReleaseExternal();
   buffer_ = buffer;
   return OK;
 }
 
+status_t CodecBuffer::WrapExternal(uint8_t* data,
+                                   size_t size,
+                                   std::shared_ptr<void> holder) {
+  if (data == nullptr || holder == nullptr) {
+    return BAD_VALUE;
+  }
+  if (!own_buffer_) {
+    own_buffer_ = std::move(buffer_);
+  }
+  buffer_ = std::make_shared<media::Buffer>(data, size);
+  external_holder_ = std::move(holder);
+  return OK;
+}
+
+void CodecBuffer::ReleaseExternal() {
+  if (!own_buffer_) {
+    return;
+  }
+  buffer_ = std::move(own_buffer_);
+  external_holder_.reset();
+}
+
 }  // namespace media
 }  // namespace ave
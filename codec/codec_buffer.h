@@ -39,6 +39,15 @@ class CodecBuffer {
 
   virtual status_t ResetBuffer(std::shared_ptr<media::Buffer>& buffer);
 
+  // Lends memory owned by someone else (e.g. a decoder frame) to this buffer
+  // without copying. |holder| keeps the memory alive until ReleaseExternal(),
+  // which switches back to the buffer's own memory.
+  status_t WrapExternal(uint8_t* data,
+                        size_t size,
+                        std::shared_ptr<void> holder);
+  void ReleaseExternal();
+  bool is_external() const { return external_holder_ != nullptr; }
+
   void SetTextureId(int32_t texture_id) {
     texture_id_ = texture_id;
     buffer_type_ = BufferType::kTypeTexture;
@@ -57,6 +66,9 @@ class CodecBuffer {
 
  private:
   std::shared_ptr<media::Buffer> buffer_;
+  // own memory while external memory is wrapped
+  std::shared_ptr<media::Buffer> own_buffer_;
+  std::shared_ptr<void> external_holder_;
   int32_t texture_id_;
   void* native_handle_;
   BufferType buffer_type_;
@@ -0,0 +1,304 @@
+/*
+ * codec_buffer_pool.cc
+ * Copyright (C) 2025 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#include "codec_buffer_pool.h"
+
+#include <algorithm>
+#include <deque>
+#include <map>
+
+#include "../audio/channel_layout.h"
+#include "../foundation/pixel_conversion.h"
+
+namespace ave {
+namespace media {
+
+namespace {
+
+const size_t kPageSize = 4096;
+
+// Used for whatever the format leaves open, like the fixed sizes before.
+const size_t kDefaultInputCount = 8;
+const size_t kDefaultOutputCount = 16;
+const size_t kDefaultBufferSize = 10 * 1024 * 1024;
+
+// Decoded video is big; the output count shrinks with the picture so a 4K
+// decoder does not hold 16 frames. Between 4 and 16 frames fit.
+const size_t kVideoOutputBudget = 96 * 1024 * 1024;
+const size_t kMinVideoOutputCount = 4;
+
+const size_t kMinAccessUnitSize = 16 * 1024;
+
+// Pools of the sizes asked for last stay alive after their codecs are gone,
+// enough for the input and output sides of an audio and a video codec.
+const size_t kCachedPools = 4;
+
+// MaxFS of H.264 Table A-1 in macroblocks, by level_idc as FFmpeg reports it.
+size_t H264MaxLumaSamples(int32_t level) {
+  size_t max_fs = 0;
+  if (level <= 0) {
+    return 0;
+  } else if (level <= 10) {
+    max_fs = 99;
+  } else if (level <= 20) {
+    max_fs = 396;
+  } else if (level <= 21) {
+    max_fs = 792;
+  } else if (level <= 30) {
+    max_fs = 1620;
+  } else if (level <= 31) {
+    max_fs = 3600;
+  } else if (level <= 32) {
+    max_fs = 5120;
+  } else if (level <= 41) {
+    max_fs = 8192;
+  } else if (level <= 42) {
+    max_fs = 8704;
+  } else if (level <= 50) {
+    max_fs = 22080;
+  } else if (level <= 52) {
+    max_fs = 36864;
+  } else {
+    max_fs = 139264;
+  }
+  return max_fs * 256;
+}
+
+// MaxLumaPs of HEVC Table A.8, general_level_idc is 30 times the level.
+size_t HevcMaxLumaSamples(int32_t level) {
+  if (level <= 0) {
+    return 0;
+  } else if (level <= 30) {
+    return 36864;
+  } else if (level <= 60) {
+    return 122880;
+  } else if (level <= 63) {
+    return 245760;
+  } else if (level <= 90) {
+    return 552960;
+  } else if (level <= 93) {
+    return 983040;
+  } else if (level <= 123) {
+    return 2228224;
+  } else if (level <= 156) {
+    return 8912896;
+  }
+  return 35651584;
+}
+
+size_t PictureSize(PixelFormat format, int32_t width, int32_t height) {
+  const size_t pixels = static_cast<size_t>(width) * height;
+  switch (format) {
+    case AVE_PIX_FMT_GRAY8:
+      return pixels;
+    case AVE_PIX_FMT_YUYV422:
+    case AVE_PIX_FMT_UYVY422:
+    case AVE_PIX_FMT_YUV422P:
+    case AVE_PIX_FMT_YUVJ422P:
+    case AVE_PIX_FMT_GRAY16LE:
+    case AVE_PIX_FMT_GRAY16BE:
+      return pixels * 2;
+    case AVE_PIX_FMT_RGB24:
+    case AVE_PIX_FMT_BGR24:
+    case AVE_PIX_FMT_YUV444P:
+    case AVE_PIX_FMT_YUVJ444P:
+      return pixels * 3;
+    case AVE_PIX_FMT_ARGB:
+    case AVE_PIX_FMT_RGBA:
+    case AVE_PIX_FMT_ABGR:
+    case AVE_PIX_FMT_BGRA:
+      return pixels * 4;
+    case AVE_PIX_FMT_YUV420P10LE:
+    case AVE_PIX_FMT_YUV420P12LE:
+    case AVE_PIX_FMT_P010LE:
+    case AVE_PIX_FMT_P016LE:
+      return YUV420PictureSize(format, width, height);
+    default:
+      // 8 bit 4:2:0 in any of its layouts, or not known yet.
+      return YUV420PictureSize(AVE_PIX_FMT_YUV420P, width, height);
+  }
+}
+
+// Samples per channel in one frame of the codec, the longest it allows.
+int64_t AudioFrameLength(CodecId codec) {
+  switch (codec) {
+    case CodecId::AVE_CODEC_ID_AAC:
+      return 2048;  // HE-AAC doubles the 1024 core samples
+    case CodecId::AVE_CODEC_ID_MP3:
+      return 1152;
+    case CodecId::AVE_CODEC_ID_AC3:
+      return 1536;
+    case CodecId::AVE_CODEC_ID_OPUS:
+      return 5760;  // 120 ms at 48 kHz
+    case CodecId::AVE_CODEC_ID_VORBIS:
+      return 4096;
+    case CodecId::AVE_CODEC_ID_FLAC:
+      return 16384;
+    default:
+      return 4096;
+  }
+}
+
+int AudioChannels(const MediaMeta& format) {
+  const ChannelLayout layout = format.channel_layout();
+  const int channels = layout == CHANNEL_LAYOUT_NONE
+                           ? 0
+                           : ChannelLayoutToChannelCount(layout);
+  // Discrete layouts carry no count, assume the most a layout can have.
+  return channels > 0 ? channels : 8;
+}
+
+size_t PcmFrameSize(const MediaMeta& format, int bytes_per_sample) {
+  int64_t samples = format.samples_per_channel();
+  if (samples <= 0) {
+    samples = AudioFrameLength(format.codec());
+  }
+  return static_cast<size_t>(samples) * AudioChannels(format) *
+         bytes_per_sample;
+}
+
+size_t RoundUpToPage(size_t size) {
+  return (size + kPageSize - 1) / kPageSize * kPageSize;
+}
+
+}  // namespace
+
+size_t RawFrameSize(const MediaMeta& format) {
+  if (format.stream_type() == MediaType::VIDEO) {
+    if (format.width() <= 0 || format.height() <= 0) {
+      return 0;
+    }
+    return PictureSize(format.pixel_format(), format.width(), format.height());
+  }
+  if (format.stream_type() == MediaType::AUDIO) {
+    const int16_t bits = format.bits_per_sample();
+    return PcmFrameSize(format, bits > 0 ? (bits + 7) / 8 : 4);
+  }
+  return 0;
+}
+
+size_t MaxAccessUnitSize(const MediaMeta& format) {
+  if (format.stream_type() == MediaType::VIDEO) {
+    size_t luma = 0;
+    if (format.width() > 0 && format.height() > 0) {
+      luma = static_cast<size_t>(format.width()) * format.height();
+    } else if (format.format_type() == MediaMeta::FormatType::kTrack) {
+      if (format.codec() == CodecId::AVE_CODEC_ID_H264) {
+        luma = H264MaxLumaSamples(format.codec_level());
+      } else if (format.codec() == CodecId::AVE_CODEC_ID_HEVC) {
+        luma = HevcMaxLumaSamples(format.codec_level());
+      }
+    }
+    if (luma == 0) {
+      return 0;
+    }
+    // Half of an 8 bit 4:2:0 picture.
+    return std::max(luma * 3 / 4, kMinAccessUnitSize);
+  }
+  if (format.stream_type() == MediaType::AUDIO) {
+    const size_t pcm = PcmFrameSize(format, 2);
+    return std::max(pcm + pcm / 8, kMinAccessUnitSize);
+  }
+  return 0;
+}
+
+CodecBufferRequirements GetCodecBufferRequirements(const MediaMeta& format,
+                                                   bool is_encoder) {
+  CodecBufferRequirements requirements;
+  const size_t raw = RawFrameSize(format);
+  const size_t compressed = MaxAccessUnitSize(format);
+  requirements.input_count = kDefaultInputCount;
+  requirements.input_size = is_encoder ? raw : compressed;
+  requirements.output_count = kDefaultOutputCount;
+  requirements.output_size = is_encoder ? compressed : raw;
+
+  if (!is_encoder && format.stream_type() == MediaType::VIDEO && raw > 0) {
+    requirements.output_count =
+        std::clamp(kVideoOutputBudget / raw, kMinVideoOutputCount,
+                   kDefaultOutputCount);
+  }
+  if (requirements.input_size == 0) {
+    requirements.input_size = kDefaultBufferSize;
+  }
+  if (requirements.output_size == 0) {
+    requirements.output_size = kDefaultBufferSize;
+  }
+  return requirements;
+}
+
+std::shared_ptr<CodecBufferPool> CodecBufferPool::GetShared(
+    size_t buffer_size) {
+  static std::mutex registry_lock;
+  static std::map<size_t, std::weak_ptr<CodecBufferPool>> registry;
+  // Most recently asked for first.
+  static std::deque<std::shared_ptr<CodecBufferPool>> recent;
+
+  const size_t size = RoundUpToPage(buffer_size);
+  std::scoped_lock lock(registry_lock);
+  auto& slot = registry[size];
+  auto pool = slot.lock();
+  if (!pool) {
+    pool = std::make_shared<CodecBufferPool>(size);
+    slot = pool;
+  }
+  auto cached = std::find(recent.begin(), recent.end(), pool);
+  if (cached != recent.end()) {
+    recent.erase(cached);
+  }
+  recent.push_front(pool);
+  if (recent.size() > kCachedPools) {
+    recent.pop_back();
+  }
+  // Drop the entries of pools nobody holds any more.
+  for (auto it = registry.begin(); it != registry.end();) {
+    it = it->second.expired() ? registry.erase(it) : std::next(it);
+  }
+  return pool;
+}
+
+CodecBufferPool::CodecBufferPool(size_t buffer_size, size_t max_free)
+    : buffer_size_(buffer_size), max_free_(max_free) {}
+
+size_t CodecBufferPool::free_count() {
+  std::scoped_lock lock(lock_);
+  return free_.size();
+}
+
+std::shared_ptr<CodecBuffer> CodecBufferPool::Acquire() {
+  {
+    std::scoped_lock lock(lock_);
+    if (!free_.empty()) {
+      auto buffer = std::move(free_.back());
+      free_.pop_back();
+      return buffer;
+    }
+  }
+  return std::make_shared<CodecBuffer>(buffer_size_);
+}
+
+void CodecBufferPool::Recycle(std::shared_ptr<CodecBuffer>&& buffer) {
+  if (!buffer || buffer.use_count() != 1) {
+    buffer.reset();
+    return;
+  }
+  buffer->ReleaseExternal();
+  if (buffer->capacity() < buffer_size_) {
+    buffer.reset();
+    return;
+  }
+  buffer->SetRange(0, 0);
+  buffer->format().reset();
+
+  std::scoped_lock lock(lock_);
+  if (free_.size() < max_free_) {
+    free_.push_back(std::move(buffer));
+  }
+  buffer.reset();
+}
+
+}  // namespace media
+}  // namespace ave
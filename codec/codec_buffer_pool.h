@@ -0,0 +1,81 @@
+/*
+ * codec_buffer_pool.h
+ * Copyright (C) 2025 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#ifndef CODEC_BUFFER_POOL_H
+#define CODEC_BUFFER_POOL_H
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "base/thread_annotation.h"
+
+#include "../foundation/media_meta.h"
+
+#include "codec_buffer.h"
+
+namespace ave {
+namespace media {
+
+// How many buffers of which size a codec's ports need for a format.
+struct CodecBufferRequirements {
+  size_t input_count = 0;
+  size_t input_size = 0;
+  size_t output_count = 0;
+  size_t output_size = 0;
+};
+
+// Bytes one decoded picture or audio frame of |format| takes: width x height
+// in its pixel format (8 bit 4:2:0 if unset), or samples per channel x
+// channels x bytes per sample (the codec's usual frame length if unset).
+// 0 if |format| says too little.
+size_t RawFrameSize(const MediaMeta& format);
+
+// Upper bound for one compressed access unit of |format|. Video uses the
+// picture size if known, else the largest picture its H.264/HEVC level
+// allows, halved (no level has a minimum compression ratio below 2); audio
+// uses the 16 bit PCM size of a frame plus headroom. 0 if |format| says too
+// little.
+size_t MaxAccessUnitSize(const MediaMeta& format);
+
+// Counts and sizes for a decoder (compressed in, raw out) or an encoder (raw
+// in, compressed out) configured with |format|. Falls back to generous
+// defaults for whatever |format| leaves open.
+CodecBufferRequirements GetCodecBufferRequirements(const MediaMeta& format,
+                                                   bool is_encoder);
+
+// Free CodecBuffers of one size, recycled between codec instances so a
+// codec configured for a format another one used starts without allocating.
+class CodecBufferPool {
+ public:
+  // The pool for |buffer_size|, rounded up to a page. Every codec asking for
+  // the same size shares it while any of them holds it; the few sizes asked
+  // for last are kept around for the next codec even when none does.
+  static std::shared_ptr<CodecBufferPool> GetShared(size_t buffer_size);
+
+  explicit CodecBufferPool(size_t buffer_size, size_t max_free = 32);
+
+  size_t buffer_size() const { return buffer_size_; }
+  size_t free_count();
+
+  // A free buffer, or a new one with buffer_size() capacity.
+  std::shared_ptr<CodecBuffer> Acquire();
+  // Takes |buffer| back unless someone else still references it, like a
+  // library it is lent to, or the pool is full.
+  void Recycle(std::shared_ptr<CodecBuffer>&& buffer);
+
+ private:
+  const size_t buffer_size_;
+  const size_t max_free_;
+  std::mutex lock_;
+  std::vector<std::shared_ptr<CodecBuffer>> free_ GUARDED_BY(lock_);
+};
+
+}  // namespace media
+}  // namespace ave
+
+#endif /* !CODEC_BUFFER_POOL_H */
@@ -7,9 +7,12 @@
 
 #include "codec_factory.h"
 
+#include <algorithm>
 #include <list>
 #include <memory>
+#include "base/logging.h"
 #include "media/codec/codec.h"
+#include "media/codec/codec_registry.h"
 
 namespace ave {
 namespace media {
@@ -17,6 +20,8 @@ namespace media {
 std::list<std::shared_ptr<CodecFactory>> gCodecFactories;
 
 status_t RegisterCodecFactory(std::shared_ptr<CodecFactory> factory) {
+  // Calibration results from earlier runs, before the first pick.
+  GetCodecRegistry().LoadIfNeeded();
   // insert with priority
   auto it = gCodecFactories.begin();
   for (; it != gCodecFactories.end(); it++) {
@@ -28,7 +33,59 @@ status_t RegisterCodecFactory(std::shared_ptr<CodecFactory> factory) {
   return OK;
 }
 
+status_t UnregisterCodecFactory(const std::shared_ptr<CodecFactory>& factory) {
+  auto it = std::find(gCodecFactories.begin(), gCodecFactories.end(), factory);
+  if (it == gCodecFactories.end()) {
+    return NAME_NOT_FOUND;
+  }
+  gCodecFactories.erase(it);
+  return OK;
+}
+
 std::shared_ptr<Codec> CreateCodecByType(CodecId codec_id, bool encoder) {
+  return CreateCodecByType(codec_id, encoder, MediaMeta(MediaType::UNKNOWN));
+}
+
+std::shared_ptr<Codec> CreateCodecByType(CodecId codec_id,
+                                         bool encoder,
+                                         const MediaMeta& format) {
+  // Among the codecs that keep up the first factory by priority wins, within
+  // it the fastest; if none keeps up, the fastest of all.
+  std::shared_ptr<CodecFactory> best_factory;
+  CodecInfo best;
+  bool best_sustains = false;
+  for (auto factory : gCodecFactories) {
+    for (const auto& info : GetCodecRegistry().GetCodecs(*factory)) {
+      if (info.codec_id != codec_id || info.is_encoder != encoder) {
+        continue;
+      }
+      const bool sustains = CanSustain(info, format);
+      bool better = false;
+      if (!best_factory || sustains != best_sustains) {
+        better = !best_factory || sustains;
+      } else if (!sustains || factory == best_factory) {
+        better = info.max_pixel_rate > best.max_pixel_rate;
+      }
+      if (better) {
+        best_factory = factory;
+        best = info;
+        best_sustains = sustains;
+      }
+    }
+  }
+
+  if (best_factory) {
+    if (!best_sustains) {
+      AVE_LOG(LS_WARNING) << "No codec known to keep up with "
+                          << static_cast<int>(codec_id) << ", using "
+                          << best.name;
+    }
+    auto codec = best_factory->CreateCodecByInfo(best);
+    if (codec) {
+      return codec;
+    }
+  }
+  // Nothing listed, the first factory by priority that makes one.
   for (auto factory : gCodecFactories) {
     auto codec = factory->CreateCodecByType(codec_id, encoder);
     if (codec) {
@@ -42,13 +42,31 @@ class CodecFactory {
   virtual std::shared_ptr<Codec> CreateCodecByMime(const std::string& mime,
                                                    bool encoder) = 0;
 
+  // creates the codec GetSupportedCodecs() described with |info|; factories
+  // whose encoders and decoders share names override this
+  virtual std::shared_ptr<Codec> CreateCodecByInfo(const CodecInfo& info) {
+    return CreateCodecByName(info.name);
+  }
+
   virtual std::string name() const = 0;
   virtual int16_t priority() const = 0;
 };
 
+// Registering loads the codec registry file the first time, see
+// CodecRegistry::SetPath().
 status_t RegisterCodecFactory(std::shared_ptr<CodecFactory> factory);
+// NAME_NOT_FOUND if |factory| is not registered.
+status_t UnregisterCodecFactory(const std::shared_ptr<CodecFactory>& factory);
 
+// The overload below for a stream nothing is known about.
 std::shared_ptr<Codec> CreateCodecByType(CodecId codec_id, bool encoder);
+// Picks among the codecs the registered factories list for |codec_id| (see
+// GetCodecRegistry()) one that CanSustain() |format|, the fastest calibrated
+// one if none can. If none is listed, the first factory by priority that
+// creates one for |codec_id| does.
+std::shared_ptr<Codec> CreateCodecByType(CodecId codec_id,
+                                         bool encoder,
+                                         const MediaMeta& format);
 std::shared_ptr<Codec> CreateCodecByName(std::string& name);
 
 }  // namespace media
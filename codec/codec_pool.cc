@@ -0,0 +1,223 @@
+/*
+ * codec_pool.cc
+ * Copyright (C) 2025 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#include "codec_pool.h"
+
+#include <bit>
+
+#include "base/logging.h"
+
+#include "codec_buffer_pool.h"
+#include "codec_factory.h"
+
+namespace ave {
+namespace media {
+
+namespace {
+
+// Buffer memory a codec configured for |format| holds, the decoder's own
+// state not included.
+size_t EstimateCodecBytes(const MediaMeta& format, bool encoder) {
+  const auto requirements = GetCodecBufferRequirements(format, encoder);
+  return requirements.input_count * requirements.input_size +
+         requirements.output_count * requirements.output_size;
+}
+
+}  // namespace
+
+CodecPool::CodecPool(size_t max_idle_codecs,
+                     size_t max_idle_bytes,
+                     CodecCreator creator)
+    : max_idle_codecs_(max_idle_codecs),
+      max_idle_bytes_(max_idle_bytes),
+      creator_(creator ? std::move(creator)
+                       : [](CodecId codec_id, bool encoder,
+                            const MediaMeta& format) {
+                           return CreateCodecByType(codec_id, encoder, format);
+                         }),
+      idle_bytes_(0) {}
+
+CodecPool::~CodecPool() {
+  Clear();
+}
+
+CodecPool::Key CodecPool::MakeKey(const CodecConfig& config, bool encoder) {
+  Key key;
+  key.encoder = encoder;
+  key.codec = config.format->codec();
+  key.stream_type = config.format->stream_type();
+  key.size_bucket =
+      std::bit_width(EstimateCodecBytes(*config.format, encoder));
+  key.thread_count = config.thread_count;
+  key.zero_copy_output = config.zero_copy_output;
+  key.high_bit_depth_output = config.high_bit_depth_output;
+  key.async_mode = config.async_mode;
+  return key;
+}
+
+CodecPool::Stream CodecPool::MakeStream(MediaMeta& format) {
+  Stream stream;
+  if (format.stream_type() == MediaType::VIDEO) {
+    stream.width = format.width();
+    stream.height = format.height();
+    stream.pixel_format = format.pixel_format();
+  } else if (format.stream_type() == MediaType::AUDIO) {
+    stream.sample_rate = format.sample_rate();
+    stream.channel_layout = format.channel_layout();
+    stream.bits_per_sample = format.bits_per_sample();
+  }
+  // SPS/PPS, AudioSpecificConfig and the like.
+  auto private_data = format.private_data();
+  if (private_data && private_data->size() > 0) {
+    stream.private_data.assign(private_data->data(),
+                               private_data->data() + private_data->size());
+  }
+  return stream;
+}
+
+std::shared_ptr<Codec> CodecPool::Acquire(
+    const std::shared_ptr<CodecConfig>& config,
+    bool encoder) {
+  if (!config || !config->format) {
+    return nullptr;
+  }
+  const bool poolable = !config->crypto && !config->video_render;
+  Entry entry;
+  entry.key = MakeKey(*config, encoder);
+  entry.stream = MakeStream(*config->format);
+  entry.bytes = EstimateCodecBytes(*config->format, encoder);
+
+  std::shared_ptr<Codec> codec;
+  Stream idle_stream;
+  if (poolable) {
+    std::scoped_lock lock(lock_);
+    // Rather one that needs no reconfiguring.
+    auto match = idle_.end();
+    for (auto it = idle_.begin(); it != idle_.end(); ++it) {
+      if (it->key != entry.key) {
+        continue;
+      }
+      if (match == idle_.end() || it->stream == entry.stream) {
+        match = it;
+      }
+      if (it->stream == entry.stream) {
+        break;
+      }
+    }
+    if (match != idle_.end()) {
+      codec = std::move(match->codec);
+      idle_stream = std::move(match->stream);
+      idle_bytes_ -= match->bytes;
+      idle_.erase(match);
+    }
+  }
+  if (codec && idle_stream != entry.stream &&
+      codec->Reconfigure(config) != OK) {
+    AVE_LOG(LS_WARNING) << "CodecPool: reconfiguring an idle codec failed";
+    codec->Release();
+    codec.reset();
+  }
+
+  if (!codec) {
+    codec = creator_(entry.key.codec, encoder, *config->format);
+    if (!codec) {
+      AVE_LOG(LS_WARNING) << "CodecPool: no codec for "
+                          << static_cast<int>(entry.key.codec);
+      return nullptr;
+    }
+    if (codec->Configure(config) != OK) {
+      codec->Release();
+      return nullptr;
+    }
+  }
+
+  if (poolable) {
+    std::scoped_lock lock(lock_);
+    // Forget codecs the clients dropped without recycling them.
+    for (auto it = handed_out_.begin(); it != handed_out_.end();) {
+      it = it->second.handed_out.expired() ? handed_out_.erase(it)
+                                           : std::next(it);
+    }
+    entry.handed_out = codec;
+    handed_out_[codec.get()] = std::move(entry);
+  }
+  return codec;
+}
+
+void CodecPool::Recycle(std::shared_ptr<Codec> codec) {
+  if (!codec) {
+    return;
+  }
+
+  Entry entry;
+  bool pooled = false;
+  {
+    std::scoped_lock lock(lock_);
+    auto it = handed_out_.find(codec.get());
+    if (it != handed_out_.end() && it->second.handed_out.lock() == codec) {
+      entry = std::move(it->second);
+      handed_out_.erase(it);
+      pooled = true;
+    }
+  }
+
+  // Not started is fine, the codec only has to be back in configured state.
+  // Reset() fails for released and errored codecs, those are dropped.
+  codec->Stop();
+  if (!pooled || codec->Reset() != OK ||
+      codec->SetCallback(nullptr) != OK) {
+    codec->Release();
+    return;
+  }
+
+  std::vector<std::shared_ptr<Codec>> evicted;
+  {
+    std::scoped_lock lock(lock_);
+    entry.handed_out.reset();
+    entry.codec = std::move(codec);
+    idle_bytes_ += entry.bytes;
+    idle_.push_front(std::move(entry));
+    Evict(evicted);
+  }
+  for (auto& victim : evicted) {
+    victim->Release();
+  }
+}
+
+void CodecPool::Clear() {
+  std::list<Entry> idle;
+  {
+    std::scoped_lock lock(lock_);
+    idle.swap(idle_);
+    idle_bytes_ = 0;
+  }
+  for (auto& entry : idle) {
+    entry.codec->Release();
+  }
+}
+
+size_t CodecPool::idle_count() {
+  std::scoped_lock lock(lock_);
+  return idle_.size();
+}
+
+size_t CodecPool::idle_bytes() {
+  std::scoped_lock lock(lock_);
+  return idle_bytes_;
+}
+
+void CodecPool::Evict(std::vector<std::shared_ptr<Codec>>& evicted) {
+  while (!idle_.empty() &&
+         (idle_.size() > max_idle_codecs_ || idle_bytes_ > max_idle_bytes_)) {
+    idle_bytes_ -= idle_.back().bytes;
+    evicted.push_back(std::move(idle_.back().codec));
+    idle_.pop_back();
+  }
+}
+
+}  // namespace media
+}  // namespace ave
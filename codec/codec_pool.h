@@ -0,0 +1,124 @@
+/*
+ * codec_pool.h
+ * Copyright (C) 2025 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#ifndef CODEC_POOL_H
+#define CODEC_POOL_H
+
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "base/thread_annotation.h"
+
+#include "../audio/channel_layout.h"
+
+#include "codec.h"
+#include "codec_id.h"
+
+namespace ave {
+namespace media {
+
+// Keeps configured codecs that are not in use, so switching to a stream of a
+// format seen before skips creating the codec and allocating its buffers.
+// Idle codecs are stopped and reset, never released. They are given out
+// again for a config with the same codec, direction and codec options and
+// buffers of about the same size; one configured for other stream
+// parameters or codec private data is reconfigured with the new ones first.
+// The least recently used ones are released once there are more than
+// |max_idle_codecs| or their buffers take more than |max_idle_bytes|.
+class CodecPool {
+ public:
+  // |format| is what the codec will be configured with.
+  using CodecCreator = std::function<std::shared_ptr<Codec>(
+      CodecId codec_id, bool encoder, const MediaMeta& format)>;
+
+  // |creator| defaults to CreateCodecByType(), picking a codec that can
+  // sustain the format.
+  explicit CodecPool(size_t max_idle_codecs = 4,
+                     size_t max_idle_bytes = 256 * 1024 * 1024,
+                     CodecCreator creator = nullptr);
+  ~CodecPool();
+
+  // An idle codec matching |config|, or a new one configured with it; not
+  // started and without a callback. nullptr if no codec could be created or
+  // configured. Configs with a crypto or a video render are never pooled.
+  std::shared_ptr<Codec> Acquire(const std::shared_ptr<CodecConfig>& config,
+                                 bool encoder);
+
+  // Takes back |codec| from Acquire(): stops and resets it and keeps it idle.
+  // Codecs the pool did not hand out or that fail to reset are released.
+  void Recycle(std::shared_ptr<Codec> codec);
+
+  // Releases all idle codecs.
+  void Clear();
+
+  size_t idle_count();
+  size_t idle_bytes();
+
+ private:
+  // What a config must match to reuse a codec configured with another one.
+  struct Key {
+    CodecId codec = CodecId::AVE_CODEC_ID_NONE;
+    bool encoder = false;
+    MediaType stream_type = MediaType::UNKNOWN;
+    // log2 of the buffer memory, codecs within about 2x of it are swapped
+    int size_bucket = 0;
+    int thread_count = 0;
+    bool zero_copy_output = false;
+    CodecConfig::HighBitDepthOutput high_bit_depth_output =
+        CodecConfig::HighBitDepthOutput::k8Bit;
+    bool async_mode = false;
+
+    bool operator==(const Key& other) const = default;
+  };
+
+  // What a reused codec must be reconfigured for unless it matches.
+  struct Stream {
+    int32_t width = 0;
+    int32_t height = 0;
+    PixelFormat pixel_format = AVE_PIX_FMT_NONE;
+    uint32_t sample_rate = 0;
+    ChannelLayout channel_layout = CHANNEL_LAYOUT_NONE;
+    int16_t bits_per_sample = 0;
+    std::vector<uint8_t> private_data;
+
+    bool operator==(const Stream& other) const = default;
+  };
+
+  struct Entry {
+    Key key;
+    Stream stream;
+    size_t bytes = 0;
+    std::weak_ptr<Codec> handed_out;
+    std::shared_ptr<Codec> codec;
+  };
+
+  static Key MakeKey(const CodecConfig& config, bool encoder);
+  static Stream MakeStream(MediaMeta& format);
+
+  // Moves the least recently used idle codecs beyond the limits to |evicted|.
+  void Evict(std::vector<std::shared_ptr<Codec>>& evicted) REQUIRES(lock_);
+
+  const size_t max_idle_codecs_;
+  const size_t max_idle_bytes_;
+  const CodecCreator creator_;
+
+  std::mutex lock_;
+  // most recently used first
+  std::list<Entry> idle_ GUARDED_BY(lock_);
+  size_t idle_bytes_ GUARDED_BY(lock_);
+  std::map<const Codec*, Entry> handed_out_ GUARDED_BY(lock_);
+};
+
+}  // namespace media
+}  // namespace ave
+
+#endif /* !CODEC_POOL_H */
@@ -0,0 +1,250 @@
+/*
+ * codec_registry.cc
+ * Copyright (C) 2025 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#include "codec_registry.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+#include "base/logging.h"
+#include "media/foundation/media_errors.h"
+
+namespace ave {
+namespace media {
+
+namespace {
+
+const char kFileHeader[] = "ave_codec_registry 1";
+// factory, name, mime, media type, codec id, encoder, hardware, max width,
+// max height, profiles, pixel formats, pixel rate, thread count
+const size_t kFieldCount = 13;
+
+template <typename T>
+std::string JoinList(const std::vector<T>& values) {
+  std::string joined;
+  for (const auto& value : values) {
+    if (!joined.empty()) {
+      joined += ',';
+    }
+    joined += std::to_string(static_cast<int64_t>(value));
+  }
+  return joined;
+}
+
+template <typename T>
+std::vector<T> SplitList(const std::string& joined) {
+  std::vector<T> values;
+  std::stringstream stream(joined);
+  std::string item;
+  while (std::getline(stream, item, ',')) {
+    if (!item.empty()) {
+      values.push_back(static_cast<T>(std::strtoll(item.c_str(), nullptr, 10)));
+    }
+  }
+  return values;
+}
+
+int64_t ToInt(const std::string& field) {
+  return std::strtoll(field.c_str(), nullptr, 10);
+}
+
+}  // namespace
+
+std::vector<CodecInfo> CodecRegistry::GetCodecs(CodecFactory& factory) {
+  const std::string factory_name = factory.name();
+  {
+    std::scoped_lock lock(lock_);
+    auto it = codecs_.find(factory_name);
+    if (it != codecs_.end()) {
+      return it->second;
+    }
+  }
+  // Outside the lock, factories may take a while to enumerate.
+  auto codecs = factory.GetSupportedCodecs();
+  std::scoped_lock lock(lock_);
+  return codecs_.emplace(factory_name, std::move(codecs)).first->second;
+}
+
+void CodecRegistry::UpdateCodec(const std::string& factory_name,
+                                const CodecInfo& info) {
+  std::scoped_lock lock(lock_);
+  auto& codecs = codecs_[factory_name];
+  auto it = std::find_if(codecs.begin(), codecs.end(),
+                         [&info](const CodecInfo& entry) {
+                           return entry.name == info.name &&
+                                  entry.is_encoder == info.is_encoder;
+                         });
+  if (it != codecs.end()) {
+    *it = info;
+  } else {
+    codecs.push_back(info);
+  }
+}
+
+void CodecRegistry::SetPath(const std::string& path) {
+  std::scoped_lock lock(lock_);
+  path_ = path;
+}
+
+std::string CodecRegistry::path() {
+  std::scoped_lock lock(lock_);
+  return path_;
+}
+
+void CodecRegistry::LoadIfNeeded() {
+  std::string path;
+  {
+    std::scoped_lock lock(lock_);
+    if (loaded_path_ == path_) {
+      return;
+    }
+    loaded_path_ = path_;
+    path = path_;
+  }
+  if (!path.empty()) {
+    Load(path);
+  }
+}
+
+status_t CodecRegistry::Load(const std::string& path) {
+  std::ifstream file(path);
+  if (!file) {
+    return NAME_NOT_FOUND;
+  }
+  std::string line;
+  if (!std::getline(file, line) || line != kFileHeader) {
+    AVE_LOG(LS_WARNING) << "CodecRegistry: ignoring " << path
+                        << ", unknown format";
+    return BAD_VALUE;
+  }
+
+  std::map<std::string, std::vector<CodecInfo>> loaded;
+  while (std::getline(file, line)) {
+    std::vector<std::string> fields;
+    std::stringstream stream(line);
+    std::string field;
+    while (std::getline(stream, field, '\t')) {
+      fields.push_back(field);
+    }
+    if (fields.size() != kFieldCount) {
+      AVE_LOG(LS_WARNING) << "CodecRegistry: bad line in " << path;
+      return BAD_VALUE;
+    }
+
+    CodecInfo info;
+    info.name = fields[1];
+    info.mime = fields[2];
+    info.media_type = static_cast<MediaType>(ToInt(fields[3]));
+    info.codec_id = static_cast<CodecId>(ToInt(fields[4]));
+    info.is_encoder = ToInt(fields[5]) != 0;
+    info.hardware_accelerated = ToInt(fields[6]) != 0;
+    info.max_width = static_cast<int32_t>(ToInt(fields[7]));
+    info.max_height = static_cast<int32_t>(ToInt(fields[8]));
+    info.profiles = SplitList<int32_t>(fields[9]);
+    info.pixel_formats = SplitList<PixelFormat>(fields[10]);
+    info.max_pixel_rate = ToInt(fields[11]);
+    info.thread_count = static_cast<int>(ToInt(fields[12]));
+    loaded[fields[0]].push_back(std::move(info));
+  }
+
+  std::scoped_lock lock(lock_);
+  for (auto& [factory_name, codecs] : loaded) {
+    codecs_[factory_name] = std::move(codecs);
+  }
+  return OK;
+}
+
+status_t CodecRegistry::Save(const std::string& path) {
+  std::stringstream out;
+  out << kFileHeader << '\n';
+  {
+    std::scoped_lock lock(lock_);
+    for (const auto& [factory_name, codecs] : codecs_) {
+      for (const auto& info : codecs) {
+        out << factory_name << '\t' << info.name << '\t' << info.mime << '\t'
+            << static_cast<int>(info.media_type) << '\t'
+            << static_cast<int>(info.codec_id) << '\t' << info.is_encoder
+            << '\t' << info.hardware_accelerated << '\t' << info.max_width
+            << '\t' << info.max_height << '\t' << JoinList(info.profiles)
+            << '\t' << JoinList(info.pixel_formats) << '\t'
+            << info.max_pixel_rate << '\t' << info.thread_count << '\n';
+      }
+    }
+  }
+
+  // Written aside and renamed, so a registering process never loads a
+  // partial file.
+  const std::string temp_path = path + ".tmp";
+  {
+    std::ofstream file(temp_path, std::ios::trunc);
+    if (!file || !(file << out.rdbuf()) || !file.flush()) {
+      AVE_LOG(LS_ERROR) << "CodecRegistry: failed to write " << temp_path;
+      return ERROR_IO;
+    }
+  }
+  std::error_code ec;
+  std::filesystem::rename(temp_path, path, ec);
+  if (ec) {
+    AVE_LOG(LS_ERROR) << "CodecRegistry: failed to rename " << temp_path
+                      << " to " << path << ": " << ec.message();
+    return ERROR_IO;
+  }
+  return OK;
+}
+
+void CodecRegistry::Clear() {
+  std::scoped_lock lock(lock_);
+  codecs_.clear();
+}
+
+CodecRegistry& GetCodecRegistry() {
+  static CodecRegistry registry;
+  return registry;
+}
+
+bool CanSustain(const CodecInfo& info, const MediaMeta& format) {
+  if (format.stream_type() != MediaType::VIDEO) {
+    return true;
+  }
+  const int64_t width = format.width();
+  const int64_t height = format.height();
+  if ((info.max_width > 0 && width > info.max_width) ||
+      (info.max_height > 0 && height > info.max_height)) {
+    return false;
+  }
+
+  int32_t fps = 0;
+  if (format.format_type() == MediaMeta::FormatType::kTrack) {
+    const int32_t profile = format.codec_profile();
+    if (profile >= 0 && !info.profiles.empty() &&
+        std::find(info.profiles.begin(), info.profiles.end(), profile) ==
+            info.profiles.end()) {
+      return false;
+    }
+    fps = format.fps();
+  }
+
+  // Decoders pick their output format, encoders have to take the input's.
+  const PixelFormat pixel_format = format.pixel_format();
+  if (info.is_encoder && pixel_format != AVE_PIX_FMT_NONE &&
+      !info.pixel_formats.empty() &&
+      std::find(info.pixel_formats.begin(), info.pixel_formats.end(),
+                pixel_format) == info.pixel_formats.end()) {
+    return false;
+  }
+
+  if (info.max_pixel_rate > 0 && width > 0 && height > 0) {
+    return width * height * (fps > 0 ? fps : 30) <= info.max_pixel_rate;
+  }
+  return true;
+}
+
+}  // namespace media
+}  // namespace ave
@@ -0,0 +1,73 @@
+/*
+ * codec_registry.h
+ * Copyright (C) 2025 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#ifndef CODEC_REGISTRY_H
+#define CODEC_REGISTRY_H
+
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "base/errors.h"
+#include "base/thread_annotation.h"
+
+#include "codec.h"
+#include "codec_factory.h"
+
+namespace ave {
+namespace media {
+
+// Caches the CodecInfo of every codec factory, asked once per factory name,
+// together with the throughput calibration runs measured. Save() and Load()
+// keep it in a text file across runs; delete the file to rescan the codecs.
+class CodecRegistry {
+ public:
+  // Where ave_codec_calibrate saves the registry unless told otherwise.
+  static constexpr char kCalibrationPath[] = "ave_codec_registry.txt";
+
+  // What |factory| supports, from the cache or GetSupportedCodecs().
+  std::vector<CodecInfo> GetCodecs(CodecFactory& factory);
+
+  // Replaces the entry of |factory_name| with the same name and direction,
+  // e.g. after calibrating it.
+  void UpdateCodec(const std::string& factory_name, const CodecInfo& info);
+
+  // The file RegisterCodecFactory() loads. Nothing is loaded until a path
+  // is set, so a stray file in the working directory cannot change which
+  // codecs get picked. Set it before registering the first factory.
+  void SetPath(const std::string& path);
+  std::string path();
+  // Load()s path() unless it was already tried, missing files included.
+  void LoadIfNeeded();
+
+  // Load() replaces the cached factories it finds in |path|.
+  status_t Load(const std::string& path);
+  status_t Save(const std::string& path);
+  void Clear();
+
+ private:
+  std::mutex lock_;
+  std::map<std::string, std::vector<CodecInfo>> codecs_ GUARDED_BY(lock_);
+  std::string path_ GUARDED_BY(lock_);
+  std::optional<std::string> loaded_path_ GUARDED_BY(lock_);
+};
+
+// The registry CreateCodecByType() picks codecs with.
+CodecRegistry& GetCodecRegistry();
+
+// Whether |info| can take |format| in real time: within its size limits,
+// with a profile and (for encoders) a pixel format it lists, and with a
+// calibrated rate covering width x height x frame rate (30 if unknown).
+// Uncalibrated codecs are assumed to keep up.
+bool CanSustain(const CodecInfo& info, const MediaMeta& format);
+
+}  // namespace media
+}  // namespace ave
+
+#endif /* !CODEC_REGISTRY_H */
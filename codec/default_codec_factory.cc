@@ -9,6 +9,8 @@
 
 #include "base/logging.h"
 
+#include "codec_registry.h"
+
 namespace ave {
 namespace media {
 
@@ -74,5 +76,15 @@ std::shared_ptr<Codec> DefaultCodecFactory::CreateCodecByMime(
   return software_factory_->CreateCodecByMime(mime, encoder);
 }
 
+std::shared_ptr<Codec> DefaultCodecFactory::CreateCodecByInfo(
+    const CodecInfo& info) {
+  for (const auto& hw_info : GetCodecRegistry().GetCodecs(*hardware_factory_)) {
+    if (hw_info.name == info.name && hw_info.is_encoder == info.is_encoder) {
+      return hardware_factory_->CreateCodecByInfo(info);
+    }
+  }
+  return software_factory_->CreateCodecByInfo(info);
+}
+
 }  // namespace media
 }  // namespace ave
@@ -7,17 +7,23 @@
 
 #include "ffmpeg_codec.h"
 
+#include <algorithm>
+#include <cstring>
+#include <memory>
 #include <queue>
 
 #include "base/attributes.h"
 #include "base/logging.h"
 #include "base/sequence_checker.h"
 #include "media/audio/channel_layout.h"
+#include "media/audio/sample_conversion.h"
+#include "media/foundation/pixel_conversion.h"
 #include "media/foundation/pixel_format.h"
 #include "media/modules/ffmpeg/ffmpeg_utils.h"
 
 extern "C" {
 #include <libavutil/imgutils.h>
+#include <libavutil/pixdesc.h>
 #include <libavutil/samplefmt.h>
 }
 
@@ -26,10 +32,58 @@ namespace media {
 
 namespace {
 const size_t kInvalidIndex = static_cast<size_t>(-1);
+// Row and plane alignment of pooled frame buffers, enough for AVX-512.
+const int kFrameAlign = 64;
+
+// Finds the planes of |frame| inside its only reference buffer. Returns false
+// if they are spread over several buffers and the frame cannot be lent.
+bool GetPlaneLayout(const AVFrame* frame,
+                    VideoPlaneLayout* layout,
+                    size_t* size) {
+  const AVBufferRef* buf = frame->buf[0];
+  const auto format = static_cast<AVPixelFormat>(frame->format);
+  const AVPixFmtDescriptor* desc = av_pix_fmt_desc_get(format);
+  const int num_planes = av_pix_fmt_count_planes(format);
+  if (!buf || frame->buf[1] || !desc || num_planes <= 0 ||
+      num_planes > static_cast<int>(VideoPlaneLayout::kMaxPlanes)) {
+    return false;
+  }
+
+  const auto begin = reinterpret_cast<uintptr_t>(buf->data);
+  const size_t buf_size = static_cast<size_t>(buf->size);
+  size_t end = 0;
+  for (int p = 0; p < num_planes; ++p) {
+    const auto data = reinterpret_cast<uintptr_t>(frame->data[p]);
+    if (frame->linesize[p] <= 0 || data < begin) {
+      return false;
+    }
+    const int shift = (p == 1 || p == 2) ? desc->log2_chroma_h : 0;
+    const size_t rows = (frame->height + (1 << shift) - 1) >> shift;
+    const size_t offset = data - begin;
+    const size_t plane_end = offset + rows * frame->linesize[p];
+    if (plane_end > buf_size) {
+      return false;
+    }
+    layout->planes[p].offset = offset;
+    layout->planes[p].stride = frame->linesize[p];
+    end = std::max(end, plane_end);
+  }
+  layout->num_planes = num_planes;
+  *size = end;
+  return true;
+}
+
 }  // namespace
 
 FFmpegCodec::FFmpegCodec(const AVCodec* codec, bool is_encoder)
-    : SimpleCodec(is_encoder), codec_(codec), codec_ctx_(nullptr) {}
+    : SimpleCodec(is_encoder),
+      codec_(codec),
+      codec_ctx_(nullptr),
+      output_frame_size_(0),
+      zero_copy_output_(false),
+      high_bit_depth_output_(CodecConfig::HighBitDepthOutput::k8Bit),
+      frame_pool_(nullptr),
+      frame_pool_size_(0) {}
 
 FFmpegCodec::~FFmpegCodec() {
   OnRelease();
@@ -44,14 +98,26 @@ status_t FFmpegCodec::OnConfigure(const std::shared_ptr<CodecConfig>& config) {
     return NO_MEMORY;
   }
 
+  output_frame_size_ = 0;
   auto format = config->format;
   if (format->stream_type() == MediaType::VIDEO) {
     AVE_LOG(LS_INFO) << "FFmpegCodec::OnConfigure: configuring video codec";
     ffmpeg_utils::ConfigureVideoCodec(format.get(), codec_ctx_);
-    // Use single-threaded decoding to prevent avcodec_send_packet EAGAIN
-    // caused by frame-threading buffering too many frames internally.
+    // Frame threading holds up to thread_count frames inside the decoder,
+    // avcodec_send_packet() then returns EAGAIN until they are received and
+    // SimpleCodec::Process() keeps that input pending meanwhile.
     if (!is_encoder_) {
-      codec_ctx_->thread_count = 1;
+      codec_ctx_->thread_count = std::max(config->thread_count, 0);
+      codec_ctx_->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+      AVE_LOG(LS_INFO) << "FFmpegCodec::OnConfigure: thread_count="
+                       << codec_ctx_->thread_count;
+
+      zero_copy_output_ = config->zero_copy_output;
+      high_bit_depth_output_ = config->high_bit_depth_output;
+      if (zero_copy_output_) {
+        codec_ctx_->opaque = this;
+        codec_ctx_->get_buffer2 = &FFmpegCodec::GetFrameBuffer;
+      }
     }
   } else if (format->stream_type() == MediaType::AUDIO) {
     AVE_LOG(LS_INFO) << "FFmpegCodec::OnConfigure: configuring audio codec"
@@ -88,6 +154,11 @@ status_t FFmpegCodec::OnStop() {
 }
 
 status_t FFmpegCodec::OnReset() {
+  output_frame_size_ = 0;
+  // A reset codec may be handed to another stream (see CodecPool).
+  while (!pts_queue_.empty()) {
+    pts_queue_.pop();
+  }
   if (codec_ctx_) {
     avcodec_flush_buffers(codec_ctx_);
   }
@@ -102,29 +173,113 @@ status_t FFmpegCodec::OnFlush() {
 }
 
 status_t FFmpegCodec::OnRelease() {
+  // Also runs from the destructor, where freeing the context drops the
+  // decoder's packet references while the codec goes away.
+  EndInputLoans();
   if (codec_ctx_) {
     avcodec_free_context(&codec_ctx_);
     codec_ctx_ = nullptr;
   }
+  // Frames still lent out keep the pool alive until they are unreferenced.
+  std::scoped_lock lock(frame_pool_lock_);
+  av_buffer_pool_uninit(&frame_pool_);
+  frame_pool_size_ = 0;
   return OK;
 }
 
-void FFmpegCodec::ProcessInput(size_t index) {
-  std::scoped_lock lock(lock_);
+size_t FFmpegCodec::InputBufferPadding() const {
+  return AV_INPUT_BUFFER_PADDING_SIZE;
+}
+
+void FFmpegCodec::ReturnLentInput(void* opaque, uint8_t* /* data */) {
+  delete static_cast<InputLoan*>(opaque);
+}
+
+int FFmpegCodec::GetFrameBuffer(AVCodecContext* ctx, AVFrame* frame, int flags)
+    NO_THREAD_SAFETY_ANALYSIS {
+  auto* self = static_cast<FFmpegCodec*>(ctx->opaque);
+  const auto format = static_cast<AVPixelFormat>(frame->format);
+  const AVPixFmtDescriptor* desc = av_pix_fmt_desc_get(format);
+  if (!(ctx->codec->capabilities & AV_CODEC_CAP_DR1) || !desc ||
+      (desc->flags & AV_PIX_FMT_FLAG_HWACCEL)) {
+    return avcodec_default_get_buffer2(ctx, frame, flags);
+  }
+
+  // Decoders may write past the visible picture up to the aligned size.
+  int width = frame->width;
+  int height = frame->height;
+  int linesize_align[AV_NUM_DATA_POINTERS];
+  avcodec_align_dimensions2(ctx, &width, &height, linesize_align);
+  const int image_size =
+      av_image_get_buffer_size(format, width, height, kFrameAlign);
+  if (image_size < 0) {
+    return image_size;
+  }
+  const size_t size = static_cast<size_t>(image_size) + kFrameAlign;
+
+  AVBufferRef* buf = nullptr;
+  {
+    std::scoped_lock lock(self->frame_pool_lock_);
+    if (!self->frame_pool_ || self->frame_pool_size_ != size) {
+      av_buffer_pool_uninit(&self->frame_pool_);
+      self->frame_pool_ = av_buffer_pool_init(size, nullptr);
+      self->frame_pool_size_ = size;
+    }
+    if (self->frame_pool_) {
+      buf = av_buffer_pool_get(self->frame_pool_);
+    }
+  }
+  if (!buf) {
+    return AVERROR(ENOMEM);
+  }
+
+  const int ret =
+      av_image_fill_arrays(frame->data, frame->linesize, buf->data, format,
+                           width, height, kFrameAlign);
+  if (ret < 0) {
+    av_buffer_unref(&buf);
+    return ret;
+  }
+  frame->buf[0] = buf;
+  frame->extended_data = frame->data;
+  return 0;
+}
+
+status_t FFmpegCodec::ProcessInput(size_t index) {
+  // The client hears about the slot or the error after lock_ is dropped, an
+  // async client may call straight back into the codec from its callback.
+  status_t status = OK;
+  bool lent = false;
+  {
+    std::scoped_lock lock(lock_);
+    if (index >= input_buffers_.size() || !input_buffers_[index].in_use) {
+      AVE_LOG(LS_WARNING) << "Invalid input buffer index or not in use";
+      return INVALID_OPERATION;
+    }
+    status = SendInput(index, &lent);
+    if (status == OK && !lent) {
+      FreeInputBuffer(index);
+    }
+  }
 
-  if (index >= input_buffers_.size() || !input_buffers_[index].in_use) {
-    AVE_LOG(LS_WARNING) << "Invalid input buffer index or not in use";
-    return;
+  if (status == OK) {
+    if (!lent) {
+      NotifyInputBufferAvailable(index);
+    }
+  } else if (status != E_AGAIN) {
+    NotifyError(status);
   }
+  return status;
+}
 
+status_t FFmpegCodec::SendInput(size_t index, bool* lent) {
   auto& buffer = input_buffers_[index].buffer;
   AVE_LOG(LS_VERBOSE) << "Input buffer size: " << buffer->size();
 
   if (is_encoder_) {
     AVFrame* frame = av_frame_alloc();
     if (!frame) {
-      NotifyError(NO_MEMORY);
-      return;
+      return NO_MEMORY;
     }
 
     // Configure frame based on codec type
@@ -141,8 +296,7 @@ void FFmpegCodec::ProcessInput(size_t index) {
 
     if (av_frame_get_buffer(frame, 0) < 0) {
       av_frame_free(&frame);
-      NotifyError(NO_MEMORY);
-      return;
+      return NO_MEMORY;
     }
 
     // Copy buffer data to frame
@@ -151,18 +305,14 @@ void FFmpegCodec::ProcessInput(size_t index) {
       if (data_size > 0) {
         if (av_sample_fmt_is_planar(codec_ctx_->sample_fmt)) {
           int channels = frame->ch_layout.nb_channels;
-          int samples = frame->nb_samples;
-          int bytes_per_sample =
+          size_t bytes_per_sample =
               av_get_bytes_per_sample(codec_ctx_->sample_fmt);
-          const uint8_t* src = buffer->data();
-
-          for (int sample = 0; sample < samples; sample++) {
-            for (int ch = 0; ch < channels; ch++) {
-              std::memcpy(frame->data[ch] + sample * bytes_per_sample, src,
-                          bytes_per_sample);
-              src += bytes_per_sample;
-            }
-          }
+          // A short last buffer only fills the start of the frame.
+          size_t samples =
+              std::min(static_cast<size_t>(frame->nb_samples),
+                       data_size / (channels * bytes_per_sample));
+          DeinterleaveSamples(buffer->data(), channels, samples,
+                              bytes_per_sample, frame->extended_data);
         } else {
           std::memcpy(frame->data[0], buffer->data(), data_size);
         }
@@ -176,24 +326,55 @@ void FFmpegCodec::ProcessInput(size_t index) {
     int ret = avcodec_send_frame(codec_ctx_, frame);
     av_frame_free(&frame);
 
-    if (ret < 0 && ret != AVERROR(EAGAIN)) {
-      NotifyError(UNKNOWN_ERROR);
-      return;
+    if (ret == AVERROR(EAGAIN)) {
+      // Pending packets must be received first.
+      return E_AGAIN;
+    }
+    if (ret < 0) {
+      return UNKNOWN_ERROR;
     }
   } else {
     // Decoder: send Annex-B packet directly (caller must provide complete AU)
     if (buffer->size() == 0) {
       // EOS: send NULL packet to drain the decoder
-      avcodec_send_packet(codec_ctx_, nullptr);
+      if (avcodec_send_packet(codec_ctx_, nullptr) == AVERROR(EAGAIN)) {
+        return E_AGAIN;
+      }
     } else {
       AVPacket* pkt = av_packet_alloc();
       if (!pkt) {
-        NotifyError(NO_MEMORY);
-        return;
+        return NO_MEMORY;
       }
       pkt->data = buffer->data();
       pkt->size = static_cast<int>(buffer->size());
 
+      // Lend the buffer to the decoder instead of letting
+      // avcodec_send_packet() copy it. The slot then goes back to the client
+      // when the decoder drops the packet rather than right after the send.
+      // Each frame thread keeps its last packet and no frame comes out
+      // before they all have one, so enough slots stay unlent for the
+      // client to get there; those inputs are copied. avcodec_open2() set
+      // thread_count to the number of threads it started, also for 0.
+      InputLoan* loan = nullptr;
+      const size_t tail =
+          buffer->capacity() - buffer->offset() - buffer->size();
+      if (tail >= AV_INPUT_BUFFER_PADDING_SIZE) {
+        const size_t keep_unlent =
+            static_cast<size_t>(std::max(codec_ctx_->thread_count, 1)) + 2;
+        loan = LendInputBuffer(index, keep_unlent).release();
+      }
+      if (loan) {
+        std::memset(buffer->data() + buffer->size(), 0,
+                    AV_INPUT_BUFFER_PADDING_SIZE);
+        pkt->buf = av_buffer_create(buffer->data(), buffer->size(),
+                                    &FFmpegCodec::ReturnLentInput, loan, 0);
+        if (!pkt->buf) {
+          loan->Cancel();
+          delete loan;
+          loan = nullptr;
+        }
+      }
+
       // Track input PTS so we can stamp output frames
       int64_t pts_us = AV_NOPTS_VALUE;
       if (buffer->format()) {
@@ -204,255 +385,333 @@ void FFmpegCodec::ProcessInput(size_t index) {
       }
 
       int ret = avcodec_send_packet(codec_ctx_, pkt);
+      if (loan && ret < 0) {
+        // Not taken, the slot stays with this input.
+        loan->Cancel();
+      }
       av_packet_free(&pkt);
 
       if (ret == AVERROR(EAGAIN)) {
-        // Decoder's internal buffer is full; output buffers are exhausted.
-        // Retry sending this input later without dropping the packet.
-        AVE_LOG(LS_WARNING) << "avcodec_send_packet EAGAIN at input index "
-                            << index << ", retrying after 5ms";
-        // Retry after a short delay (output consumption will free buffers)
-        task_runner_->PostDelayedTask(
-            [this, index]() {
-              AVE_DCHECK_RUN_ON(task_runner_.get());
-              ProcessInput(index);
-            },
-            5000);
-        return;  // Do NOT release input buffer or notify; do NOT push pts
+        // Decoded frames must be received first. Keep the input buffer and
+        // its pts, Process() offers it again after draining the output.
+        AVE_LOG(LS_VERBOSE) << "avcodec_send_packet EAGAIN at input index "
+                            << index;
+        return E_AGAIN;
       }
 
       if (ret < 0) {
         char errbuf[AV_ERROR_MAX_STRING_SIZE];
         av_strerror(ret, errbuf, sizeof(errbuf));
         AVE_LOG(LS_ERROR) << "avcodec_send_packet failed: " << errbuf;
-        NotifyError(UNKNOWN_ERROR);
-        return;
+        return UNKNOWN_ERROR;
       }
 
       // Push PTS only after the packet was successfully accepted by FFmpeg
       pts_queue_.push(pts_us);
+      *lent = loan != nullptr;
     }
   }
-
-  input_buffers_[index].in_use = false;
-  cv_.notify_all();
-  NotifyInputBufferAvailable(index);
+  return OK;
 }
 
 void FFmpegCodec::ProcessOutput() {
   size_t pushed_index = kInvalidIndex;
-
+  std::shared_ptr<MediaMeta> changed_format;
+  status_t status = OK;
   {
     std::scoped_lock lock(lock_);
+    status = ReceiveOutput(&pushed_index, &changed_format);
+  }
+
+  if (status != OK) {
+    NotifyError(status);
+  }
+  if (changed_format) {
+    NotifyOutputFormatChanged(changed_format);
+  }
+  if (pushed_index != kInvalidIndex) {
+    NotifyOutputBufferAvailable(pushed_index);
+  }
+}
+
+status_t FFmpegCodec::ReceiveOutput(
+    size_t* pushed_index,
+    std::shared_ptr<MediaMeta>* changed_format) {
+  size_t index = GetAvailableOutputBufferIndex();
+  if (index == static_cast<size_t>(-1)) {
+    AVE_LOG(LS_VERBOSE) << "No available output buffer";
+    return OK;
+  }
 
-    size_t index = GetAvailableOutputBufferIndex();
-    if (index == static_cast<size_t>(-1)) {
-      AVE_LOG(LS_VERBOSE) << "No available output buffer";
-      return;
+  AVE_LOG(LS_VERBOSE) << "Processing output, buffer index: " << index;
+
+  if (is_encoder_) {
+    // Encoder: receive packet
+    AVPacket* pkt = av_packet_alloc();
+    if (!pkt) {
+      return NO_MEMORY;
     }
 
-    AVE_LOG(LS_VERBOSE) << "Processing output, buffer index: " << index;
+    int ret = avcodec_receive_packet(codec_ctx_, pkt);
+    if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
+      av_packet_free(&pkt);
+      return OK;
+    }
 
-    if (is_encoder_) {
-      // Encoder: receive packet
-      AVPacket* pkt = av_packet_alloc();
-      if (!pkt) {
-        NotifyError(NO_MEMORY);
-        return;
-      }
+    if (ret < 0) {
+      av_packet_free(&pkt);
+      return UNKNOWN_ERROR;
+    }
 
-      int ret = avcodec_receive_packet(codec_ctx_, pkt);
-      if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
-        av_packet_free(&pkt);
-        return;
-      }
+    auto& buffer = output_buffers_[index].buffer;
+    buffer->EnsureCapacity(pkt->size, false);
+    std::memcpy(buffer->data(), pkt->data, pkt->size);
+    buffer->SetRange(0, pkt->size);
 
-      if (ret < 0) {
-        av_packet_free(&pkt);
-        NotifyError(UNKNOWN_ERROR);
-        return;
-      }
+    av_packet_free(&pkt);
+    *pushed_index = PushOutputBuffer(index);
+  } else {
+    // Decoder: receive frame
+    AVFrame* frame = av_frame_alloc();
+    if (!frame) {
+      return NO_MEMORY;
+    }
 
-      auto& buffer = output_buffers_[index].buffer;
-      buffer->EnsureCapacity(pkt->size, false);
-      std::memcpy(buffer->data(), pkt->data, pkt->size);
-      buffer->SetRange(0, pkt->size);
+    int ret = avcodec_receive_frame(codec_ctx_, frame);
+    if (ret == AVERROR(EAGAIN)) {
+      AVE_LOG(LS_VERBOSE) << "Decoder needs more input (EAGAIN)";
+      av_frame_free(&frame);
+      return OK;
+    }
 
-      av_packet_free(&pkt);
-      pushed_index = PushOutputBuffer(index);
-    } else {
-      // Decoder: receive frame
-      AVFrame* frame = av_frame_alloc();
-      if (!frame) {
-        NotifyError(NO_MEMORY);
-        return;
-      }
+    if (ret == AVERROR_EOF) {
+      AVE_LOG(LS_INFO) << "Decoder reached EOF";
+      av_frame_free(&frame);
+      return OK;
+    }
 
-      int ret = avcodec_receive_frame(codec_ctx_, frame);
-      if (ret == AVERROR(EAGAIN)) {
-        AVE_LOG(LS_VERBOSE) << "Decoder needs more input (EAGAIN)";
-        av_frame_free(&frame);
-        return;
-      }
+    if (ret < 0) {
+      AVE_LOG(LS_ERROR) << "Decoder error: " << ret;
+      av_frame_free(&frame);
+      return UNKNOWN_ERROR;
+    }
 
-      if (ret == AVERROR_EOF) {
-        AVE_LOG(LS_INFO) << "Decoder reached EOF";
-        av_frame_free(&frame);
-        return;
-      }
+    AVE_LOG(LS_VERBOSE) << "Decoder produced output frame";
 
-      if (ret < 0) {
-        AVE_LOG(LS_ERROR) << "Decoder error: " << ret;
-        av_frame_free(&frame);
-        NotifyError(UNKNOWN_ERROR);
-        return;
-      }
+    auto& buffer = output_buffers_[index].buffer;
 
-      AVE_LOG(LS_VERBOSE) << "Decoder produced output frame";
+    // Pop the PTS associated with this output frame
+    int64_t pts_us = AV_NOPTS_VALUE;
+    if (!pts_queue_.empty()) {
+      pts_us = pts_queue_.front();
+      pts_queue_.pop();
+    }
 
-      auto& buffer = output_buffers_[index].buffer;
+    if (codec_ctx_->codec_type == AVMEDIA_TYPE_AUDIO) {
+      int data_size = av_samples_get_buffer_size(
+          nullptr, frame->ch_layout.nb_channels, frame->nb_samples,
+          static_cast<AVSampleFormat>(frame->format), 1);
 
-      // Pop the PTS associated with this output frame
-      int64_t pts_us = AV_NOPTS_VALUE;
-      if (!pts_queue_.empty()) {
-        pts_us = pts_queue_.front();
-        pts_queue_.pop();
+      if (data_size > 0) {
+        buffer->EnsureCapacity(data_size, false);
+
+        // Set format on output buffer
+        auto meta = MediaMeta::CreatePtr(MediaType::AUDIO,
+                                         MediaMeta::FormatType::kSample);
+        meta->SetSampleRate(frame->sample_rate);
+        int channels = frame->ch_layout.nb_channels;
+        meta->SetChannelLayout(GuessChannelLayout(channels));
+        meta->SetSamplesPerChannel(frame->nb_samples);
+        meta->SetBitsPerSample(static_cast<int16_t>(
+            av_get_bytes_per_sample(
+                static_cast<AVSampleFormat>(frame->format)) *
+            8));
+        if (av_sample_fmt_is_planar(
+                static_cast<AVSampleFormat>(frame->format))) {
+          if (frame->format == AV_SAMPLE_FMT_FLTP) {
+            meta->SetCodec(CodecId::AVE_CODEC_ID_PCM_F32LE);
+          } else if (frame->format == AV_SAMPLE_FMT_S16P) {
+            meta->SetCodec(CodecId::AVE_CODEC_ID_PCM_S16LE);
+          } else if (frame->format == AV_SAMPLE_FMT_S32P) {
+            meta->SetCodec(CodecId::AVE_CODEC_ID_PCM_S32LE);
+          }
+        } else {
+          if (frame->format == AV_SAMPLE_FMT_FLT) {
+            meta->SetCodec(CodecId::AVE_CODEC_ID_PCM_F32LE);
+          } else if (frame->format == AV_SAMPLE_FMT_S16) {
+            meta->SetCodec(CodecId::AVE_CODEC_ID_PCM_S16LE);
+          } else if (frame->format == AV_SAMPLE_FMT_S32) {
+            meta->SetCodec(CodecId::AVE_CODEC_ID_PCM_S32LE);
+          }
+        }
+        if (pts_us != AV_NOPTS_VALUE) {
+          meta->SetPts(base::Timestamp::Micros(pts_us));
+        }
+        buffer->format() = meta;
+
+        if (av_sample_fmt_is_planar(
+                static_cast<AVSampleFormat>(frame->format))) {
+          int bytes_per_sample = av_get_bytes_per_sample(
+              static_cast<AVSampleFormat>(frame->format));
+          InterleaveSamples(frame->extended_data, channels,
+                            frame->nb_samples, bytes_per_sample,
+                            buffer->data());
+          buffer->SetRange(0, data_size);
+        } else {
+          std::memcpy(buffer->data(), frame->data[0], data_size);
+          buffer->SetRange(0, data_size);
+        }
+      }
+    } else if (codec_ctx_->codec_type == AVMEDIA_TYPE_VIDEO) {
+      AVPixelFormat src_fmt = static_cast<AVPixelFormat>(frame->format);
+
+      // 10/12-bit HEVC/VP9/AV1 HDR output is converted to what the client
+      // asked for, everything else is handed out as yuv420p
+      bool is_yuv420_hbd = (src_fmt == AV_PIX_FMT_YUV420P10LE ||
+                            src_fmt == AV_PIX_FMT_YUV420P10BE ||
+                            src_fmt == AV_PIX_FMT_YUV420P12LE ||
+                            src_fmt == AV_PIX_FMT_YUV420P12BE);
+      bool is_yuvj420 = (src_fmt == AV_PIX_FMT_YUVJ420P);
+      AVPixelFormat dst_fmt =
+          (is_yuv420_hbd || is_yuvj420) ? AV_PIX_FMT_YUV420P : src_fmt;
+      const int bit_depth = (src_fmt == AV_PIX_FMT_YUV420P12LE ||
+                             src_fmt == AV_PIX_FMT_YUV420P12BE)
+                                ? 12
+                                : 10;
+      PixelFormat out_format = PixelFormat::AVE_PIX_FMT_YUV420P;
+      if (is_yuv420_hbd) {
+        switch (high_bit_depth_output_) {
+          case CodecConfig::HighBitDepthOutput::kNativePlanar:
+            out_format = bit_depth == 12
+                             ? PixelFormat::AVE_PIX_FMT_YUV420P12LE
+                             : PixelFormat::AVE_PIX_FMT_YUV420P10LE;
+            break;
+          case CodecConfig::HighBitDepthOutput::kSemiPlanar:
+            out_format = bit_depth == 12 ? PixelFormat::AVE_PIX_FMT_P016LE
+                                         : PixelFormat::AVE_PIX_FMT_P010LE;
+            break;
+          default:
+            break;
+        }
       }
 
-      if (codec_ctx_->codec_type == AVMEDIA_TYPE_AUDIO) {
-        int data_size = av_samples_get_buffer_size(
-            nullptr, frame->ch_layout.nb_channels, frame->nb_samples,
-            static_cast<AVSampleFormat>(frame->format), 1);
+      // Set video format metadata
+      auto meta = MediaMeta::CreatePtr(MediaType::VIDEO,
+                                       MediaMeta::FormatType::kSample);
+      meta->SetWidth(frame->width);
+      meta->SetHeight(frame->height);
+      meta->SetPixelFormat(out_format);
+      meta->SetColorSpace(ffmpeg_utils::ExtractColorSpaceFromFrame(frame));
+      if (pts_us != AV_NOPTS_VALUE) {
+        meta->SetPts(base::Timestamp::Micros(pts_us));
+      }
 
-        if (data_size > 0) {
-          buffer->EnsureCapacity(data_size, false);
+      // Zero copy: the output buffer references the decoded frame until
+      // ReleaseOutputBuffer() and the meta tells where its planes are.
+      VideoPlaneLayout layout;
+      size_t lent_size = 0;
+      bool lent = false;
+      if (zero_copy_output_ && !is_yuv420_hbd &&
+          (src_fmt == AV_PIX_FMT_YUV420P || is_yuvj420) &&
+          GetPlaneLayout(frame, &layout, &lent_size)) {
+        AVFrame* ref = av_frame_clone(frame);
+        if (ref) {
+          uint8_t* base = ref->buf[0]->data;
+          const size_t capacity = static_cast<size_t>(ref->buf[0]->size);
+          std::shared_ptr<void> holder(ref, [](void* p) {
+            auto* lent_frame = static_cast<AVFrame*>(p);
+            av_frame_free(&lent_frame);
+          });
+          lent = buffer->WrapExternal(base, capacity, std::move(holder)) ==
+                 OK;
+        }
+      }
 
-          // Set format on output buffer
-          auto meta = MediaMeta::CreatePtr(MediaType::AUDIO,
-                                           MediaMeta::FormatType::kSample);
-          meta->SetSampleRate(frame->sample_rate);
-          int channels = frame->ch_layout.nb_channels;
-          meta->SetChannelLayout(GuessChannelLayout(channels));
-          meta->SetSamplesPerChannel(frame->nb_samples);
-          meta->SetBitsPerSample(static_cast<int16_t>(
-              av_get_bytes_per_sample(
-                  static_cast<AVSampleFormat>(frame->format)) *
-              8));
-          if (av_sample_fmt_is_planar(
-                  static_cast<AVSampleFormat>(frame->format))) {
-            if (frame->format == AV_SAMPLE_FMT_FLTP) {
-              meta->SetCodec(CodecId::AVE_CODEC_ID_PCM_F32LE);
-            } else if (frame->format == AV_SAMPLE_FMT_S16P) {
-              meta->SetCodec(CodecId::AVE_CODEC_ID_PCM_S16LE);
-            } else if (frame->format == AV_SAMPLE_FMT_S32P) {
-              meta->SetCodec(CodecId::AVE_CODEC_ID_PCM_S32LE);
-            }
-          } else {
-            if (frame->format == AV_SAMPLE_FMT_FLT) {
-              meta->SetCodec(CodecId::AVE_CODEC_ID_PCM_F32LE);
-            } else if (frame->format == AV_SAMPLE_FMT_S16) {
-              meta->SetCodec(CodecId::AVE_CODEC_ID_PCM_S16LE);
-            } else if (frame->format == AV_SAMPLE_FMT_S32) {
-              meta->SetCodec(CodecId::AVE_CODEC_ID_PCM_S32LE);
-            }
+      if (lent) {
+        buffer->SetRange(0, lent_size);
+        meta->SetStride(layout.planes[0].stride);
+        meta->SetPlaneLayout(layout);
+        buffer->format() = meta;
+      } else {
+        buffer->ReleaseExternal();
+        if (is_yuv420_hbd) {
+          HighBitDepthYUV420 picture;
+          for (int p = 0; p < 3; ++p) {
+            picture.data[p] = frame->data[p];
+            picture.stride[p] = frame->linesize[p];
           }
-          if (pts_us != AV_NOPTS_VALUE) {
-            meta->SetPts(base::Timestamp::Micros(pts_us));
-          }
-          buffer->format() = meta;
-
-          if (av_sample_fmt_is_planar(
-                  static_cast<AVSampleFormat>(frame->format))) {
-            int samples = frame->nb_samples;
-            int bytes_per_sample = av_get_bytes_per_sample(
-                static_cast<AVSampleFormat>(frame->format));
-
-            uint8_t* dst = buffer->data();
-            for (int sample = 0; sample < samples; sample++) {
-              for (int ch = 0; ch < channels; ch++) {
-                std::memcpy(dst, frame->data[ch] + sample * bytes_per_sample,
-                            bytes_per_sample);
-                dst += bytes_per_sample;
-              }
-            }
-            buffer->SetRange(0, data_size);
-          } else {
-            std::memcpy(buffer->data(), frame->data[0], data_size);
+          picture.width = frame->width;
+          picture.height = frame->height;
+          picture.bit_depth = bit_depth;
+          const size_t data_size =
+              YUV420PictureSize(out_format, frame->width, frame->height);
+          if (data_size > 0) {
+            buffer->EnsureCapacity(data_size, false);
+            ConvertHighBitDepthYUV420(picture, out_format, buffer->data(),
+                                      data_size);
             buffer->SetRange(0, data_size);
-          }
-        }
-      } else if (codec_ctx_->codec_type == AVMEDIA_TYPE_VIDEO) {
-        AVPixelFormat src_fmt = static_cast<AVPixelFormat>(frame->format);
-
-        // Check if source needs conversion to yuv420p (e.g. 10/12-bit HEVC HDR)
-        bool is_yuv420_hbd = (src_fmt == AV_PIX_FMT_YUV420P10LE ||
-                              src_fmt == AV_PIX_FMT_YUV420P10BE ||
-                              src_fmt == AV_PIX_FMT_YUV420P12LE ||
-                              src_fmt == AV_PIX_FMT_YUV420P12BE);
-        bool is_yuvj420 = (src_fmt == AV_PIX_FMT_YUVJ420P);
-        AVPixelFormat dst_fmt =
-            (is_yuv420_hbd || is_yuvj420) ? AV_PIX_FMT_YUV420P : src_fmt;
-
-        int data_size =
-            av_image_get_buffer_size(dst_fmt, frame->width, frame->height, 1);
-
-        if (data_size > 0) {
-          buffer->EnsureCapacity(data_size, false);
-
-          if (is_yuv420_hbd) {
-            // Manually convert high-bit-depth YUV420 to 8-bit YUV420P.
-            // Each sample is stored as uint16_t; right-shift 2 (10-bit) or 4
-            // (12-bit) to produce uint8_t.
-            const int shift = (src_fmt == AV_PIX_FMT_YUV420P12LE ||
-                               src_fmt == AV_PIX_FMT_YUV420P12BE)
-                                  ? 4
-                                  : 2;
-            uint8_t* dst = buffer->data();
-            for (int p = 0; p < 3; ++p) {
-              int plane_w = (p == 0) ? frame->width : (frame->width + 1) / 2;
-              int plane_h = (p == 0) ? frame->height : (frame->height + 1) / 2;
-              const uint16_t* src16 =
-                  reinterpret_cast<const uint16_t*>(frame->data[p]);
-              int src_stride16 = frame->linesize[p] / 2;
-              for (int y = 0; y < plane_h; ++y) {
-                for (int x = 0; x < plane_w; ++x) {
-                  *dst++ = static_cast<uint8_t>(src16[y * src_stride16 + x] >>
-                                                shift);
-                }
+            if (out_format == PixelFormat::AVE_PIX_FMT_YUV420P) {
+              meta->SetStride(frame->width);
+            } else {
+              // Two bytes per sample, the chroma planes follow the luma
+              // plane; P010/P016 have a single interleaved UV plane.
+              const int chroma_width = (frame->width + 1) / 2;
+              const size_t luma_size =
+                  static_cast<size_t>(frame->width) * frame->height * 2;
+              const size_t chroma_size = static_cast<size_t>(chroma_width) *
+                                         ((frame->height + 1) / 2) * 2;
+              VideoPlaneLayout hbd_layout;
+              hbd_layout.planes[0].stride = frame->width * 2;
+              hbd_layout.planes[1].offset = luma_size;
+              if (out_format == PixelFormat::AVE_PIX_FMT_P010LE ||
+                  out_format == PixelFormat::AVE_PIX_FMT_P016LE) {
+                hbd_layout.num_planes = 2;
+                hbd_layout.planes[1].stride = chroma_width * 4;
+              } else {
+                hbd_layout.num_planes = 3;
+                hbd_layout.planes[1].stride = chroma_width * 2;
+                hbd_layout.planes[2].offset = luma_size + chroma_size;
+                hbd_layout.planes[2].stride = chroma_width * 2;
               }
+              meta->SetStride(hbd_layout.planes[0].stride);
+              meta->SetPlaneLayout(hbd_layout);
             }
-            buffer->SetRange(0, data_size);
-          } else {
+            buffer->format() = meta;
+          }
+        } else {
+          int data_size = av_image_get_buffer_size(dst_fmt, frame->width,
+                                                   frame->height, 1);
+          if (data_size > 0) {
+            buffer->EnsureCapacity(data_size, false);
             // Direct copy for yuv420p / yuvj420p
             av_image_copy_to_buffer(buffer->data(), data_size,
                                     const_cast<const uint8_t**>(frame->data),
                                     frame->linesize, dst_fmt, frame->width,
                                     frame->height, 1);
             buffer->SetRange(0, data_size);
+            meta->SetStride(frame->width);
+            buffer->format() = meta;
           }
-
-          // Set video format metadata
-          auto meta = MediaMeta::CreatePtr(MediaType::VIDEO,
-                                           MediaMeta::FormatType::kSample);
-          meta->SetWidth(frame->width);
-          meta->SetHeight(frame->height);
-          meta->SetStride(frame->width);
-          meta->SetPixelFormat(PixelFormat::AVE_PIX_FMT_YUV420P);
-          if (pts_us != AV_NOPTS_VALUE) {
-            meta->SetPts(base::Timestamp::Micros(pts_us));
-          }
-          buffer->format() = meta;
         }
       }
-
-      av_frame_free(&frame);
-      pushed_index = PushOutputBuffer(index);
     }
-  }
 
-  if (pushed_index != kInvalidIndex) {
-    NotifyOutputBufferAvailable(pushed_index);
+    av_frame_free(&frame);
+
+    // The first frame and every picture size change resize the free output
+    // buffers; audio only grows them, a short last frame is no new format.
+    if (buffer->format()) {
+      const size_t frame_size = RawFrameSize(*buffer->format());
+      if (frame_size > output_frame_size_ ||
+          (frame_size != output_frame_size_ &&
+           codec_ctx_->codec_type == AVMEDIA_TYPE_VIDEO)) {
+        output_frame_size_ = frame_size;
+        *changed_format = buffer->format();
+      }
+    }
+    *pushed_index = PushOutputBuffer(index);
   }
+  return OK;
 }
 
 }  // namespace media
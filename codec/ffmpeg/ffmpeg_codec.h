@@ -8,10 +8,13 @@
 #ifndef FFMPEG_CODEC_H
 #define FFMPEG_CODEC_H
 
+#include <mutex>
+
 #include "media/codec/simple_codec.h"
 
 extern "C" {
 #include <libavcodec/avcodec.h>
+#include <libavutil/buffer.h>
 }
 
 namespace ave {
@@ -31,13 +34,43 @@ class FFmpegCodec : public SimpleCodec {
   status_t OnFlush() REQUIRES(task_runner_) override;
   status_t OnRelease() REQUIRES(task_runner_) override;
 
-  void ProcessInput(size_t index) REQUIRES(task_runner_) override;
+  status_t ProcessInput(size_t index) REQUIRES(task_runner_) override;
   void ProcessOutput() REQUIRES(task_runner_) override;
+  size_t InputBufferPadding() const override;
 
  private:
+  // The locked halves of ProcessInput() and ProcessOutput(). They only do
+  // the bookkeeping; the callers notify the client once lock_ is released.
+  // |lent| tells whether the decoder kept the input, an error status is
+  // for NotifyError().
+  status_t SendInput(size_t index, bool* lent)
+      REQUIRES(task_runner_, lock_);
+  status_t ReceiveOutput(size_t* pushed_index,
+                         std::shared_ptr<MediaMeta>* changed_format)
+      REQUIRES(task_runner_, lock_);
+
+  // av_buffer_create() free callback for input lent to the decoder, the
+  // opaque is the InputLoan. Runs on whichever thread unreferences the
+  // packet, possibly after the codec is gone.
+  static void ReturnLentInput(void* opaque, uint8_t* data);
+
+  // get_buffer2 for zero copy output: allocates all planes of a picture from
+  // one pooled buffer so the frame can be lent as a single CodecBuffer. Runs
+  // on the decoder's frame threads.
+  static int GetFrameBuffer(AVCodecContext* ctx, AVFrame* frame, int flags);
+
   const AVCodec* codec_;
   AVCodecContext* codec_ctx_ GUARDED_BY(task_runner_);
   std::queue<int64_t> pts_queue_ GUARDED_BY(lock_);  // input PTS fifo (us)
+  // RawFrameSize() of the last decoded frame, 0 before the first one
+  size_t output_frame_size_ GUARDED_BY(lock_);
+  bool zero_copy_output_ GUARDED_BY(task_runner_);
+  CodecConfig::HighBitDepthOutput high_bit_depth_output_
+      GUARDED_BY(task_runner_);
+
+  std::mutex frame_pool_lock_;
+  AVBufferPool* frame_pool_ GUARDED_BY(frame_pool_lock_);
+  size_t frame_pool_size_ GUARDED_BY(frame_pool_lock_);
 };
 
 }  // namespace media
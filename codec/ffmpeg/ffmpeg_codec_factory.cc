@@ -18,6 +18,62 @@ extern "C" {
 namespace ave {
 namespace media {
 
+namespace {
+
+// Exact counterparts only; ffmpeg_utils::ConvertFromFFmpegPixelFormat() maps
+// whatever it does not know to YUV420P, which would list formats a codec
+// does not take.
+PixelFormat ToListedPixelFormat(AVPixelFormat format) {
+  switch (format) {
+    case AV_PIX_FMT_YUV420P:
+      return AVE_PIX_FMT_YUV420P;
+    case AV_PIX_FMT_YUVJ420P:
+      return AVE_PIX_FMT_YUVJ420P;
+    case AV_PIX_FMT_YUV422P:
+      return AVE_PIX_FMT_YUV422P;
+    case AV_PIX_FMT_YUVJ422P:
+      return AVE_PIX_FMT_YUVJ422P;
+    case AV_PIX_FMT_YUV444P:
+      return AVE_PIX_FMT_YUV444P;
+    case AV_PIX_FMT_YUVJ444P:
+      return AVE_PIX_FMT_YUVJ444P;
+    case AV_PIX_FMT_YUYV422:
+      return AVE_PIX_FMT_YUYV422;
+    case AV_PIX_FMT_UYVY422:
+      return AVE_PIX_FMT_UYVY422;
+    case AV_PIX_FMT_NV12:
+      return AVE_PIX_FMT_NV12;
+    case AV_PIX_FMT_NV21:
+      return AVE_PIX_FMT_NV21;
+    case AV_PIX_FMT_GRAY8:
+      return AVE_PIX_FMT_GRAY8;
+    case AV_PIX_FMT_RGB24:
+      return AVE_PIX_FMT_RGB24;
+    case AV_PIX_FMT_BGR24:
+      return AVE_PIX_FMT_BGR24;
+    case AV_PIX_FMT_ARGB:
+      return AVE_PIX_FMT_ARGB;
+    case AV_PIX_FMT_RGBA:
+      return AVE_PIX_FMT_RGBA;
+    case AV_PIX_FMT_ABGR:
+      return AVE_PIX_FMT_ABGR;
+    case AV_PIX_FMT_BGRA:
+      return AVE_PIX_FMT_BGRA;
+    case AV_PIX_FMT_YUV420P10LE:
+      return AVE_PIX_FMT_YUV420P10LE;
+    case AV_PIX_FMT_YUV420P12LE:
+      return AVE_PIX_FMT_YUV420P12LE;
+    case AV_PIX_FMT_P010LE:
+      return AVE_PIX_FMT_P010LE;
+    case AV_PIX_FMT_P016LE:
+      return AVE_PIX_FMT_P016LE;
+    default:
+      return AVE_PIX_FMT_NONE;
+  }
+}
+
+}  // namespace
+
 FFmpegCodecFactory::FFmpegCodecFactory() {}
 FFmpegCodecFactory::FFmpegCodecFactory(bool use_simple_codec) {
   // Note: use_simple_codec parameter is now ignored since we only have one
@@ -67,6 +123,18 @@ std::shared_ptr<Codec> FFmpegCodecFactory::CreateCodecByMime(
   return CreateCodecByType(codec_id, encoder);
 }
 
+std::shared_ptr<Codec> FFmpegCodecFactory::CreateCodecByInfo(
+    const CodecInfo& info) {
+  // Decoders and encoders share names like "aac".
+  const AVCodec* codec =
+      info.is_encoder ? avcodec_find_encoder_by_name(info.name.c_str())
+                      : avcodec_find_decoder_by_name(info.name.c_str());
+  if (!codec) {
+    return nullptr;
+  }
+  return std::make_shared<FFmpegCodec>(codec, info.is_encoder);
+}
+
 std::vector<CodecInfo> FFmpegCodecFactory::GetSupportedCodecs() {
   if (!supported_codecs_.empty()) {
     return supported_codecs_;
@@ -88,10 +156,25 @@ std::vector<CodecInfo> FFmpegCodecFactory::GetSupportedCodecs() {
       continue;  // Skip other types
     }
 
+    info.codec_id = ffmpeg_utils::ConvertToAVECodecId(codec->id);
     info.is_encoder = av_codec_is_encoder(codec);
     info.hardware_accelerated =
         (codec->capabilities & AV_CODEC_CAP_HARDWARE) != 0;
 
+    // FFmpeg states no size limits; profiles and pixel formats only where
+    // the codec restricts them.
+    for (const AVProfile* profile = codec->profiles;
+         profile && profile->profile != FF_PROFILE_UNKNOWN; ++profile) {
+      info.profiles.push_back(profile->profile);
+    }
+    for (const AVPixelFormat* format = codec->pix_fmts;
+         format && *format != AV_PIX_FMT_NONE; ++format) {
+      const PixelFormat pixel_format = ToListedPixelFormat(*format);
+      if (pixel_format != AVE_PIX_FMT_NONE) {
+        info.pixel_formats.push_back(pixel_format);
+      }
+    }
+
     supported_codecs_.push_back(info);
   }
 
@@ -78,5 +78,13 @@ std::shared_ptr<Codec> HardwareCodecFactory::CreateCodecByMime(
   return nullptr;
 }
 
+std::shared_ptr<Codec> HardwareCodecFactory::CreateCodecByInfo(
+    const CodecInfo& info) {
+  if (platform_factory_) {
+    return platform_factory_->CreateCodecByInfo(info);
+  }
+  return nullptr;
+}
+
 }  // namespace media
 }  // namespace ave
@@ -127,7 +127,7 @@ status_t OpusCodec::OnRelease() {
   return OK;
 }
 
-void OpusCodec::ProcessInput(size_t index) {
+status_t OpusCodec::ProcessInput(size_t index) {
   size_t pushed_index = kInvalidIndex;
   bool should_notify_input = true;
   status_t error_to_notify = OK;
@@ -136,7 +136,7 @@ void OpusCodec::ProcessInput(size_t index) {
     std::scoped_lock<std::mutex> lock(lock_);
     if (index >= input_buffers_.size() || !input_buffers_[index].in_use) {
       AVE_LOG(LS_WARNING) << "Invalid input buffer index or not in use";
-      return;
+      return INVALID_OPERATION;
     }
 
     auto& buffer = input_buffers_[index].buffer;
@@ -147,6 +147,7 @@ void OpusCodec::ProcessInput(size_t index) {
       int pcm_samples = buffer->size() / (channels_ * sizeof(opus_int16));
 
       // Opus requires exact frame size
+      bool encode = true;
       if (pcm_samples != frame_size_) {
         if (pcm_samples < frame_size_ && pcm_samples > 0) {
           AVE_LOG(LS_INFO) << "Padding partial frame: " << pcm_samples << " -> "
@@ -161,21 +162,21 @@ void OpusCodec::ProcessInput(size_t index) {
             pcm_samples = frame_size_;
           } else {
             AVE_LOG(LS_WARNING) << "Buffer capacity insufficient for padding";
-            input_buffers_[index].in_use = false;
+            encode = false;
           }
         } else {
           AVE_LOG(LS_WARNING) << "PCM samples (" << pcm_samples
                               << ") doesn't match frame size (" << frame_size_
                               << "), skipping frame";
-          input_buffers_[index].in_use = false;
+          encode = false;
         }
       }
 
-      if (input_buffers_[index].in_use) {
+      if (encode) {
         size_t output_index = GetAvailableOutputBufferIndex();
         if (output_index == kInvalidIndex) {
-          AVE_LOG(LS_WARNING) << "No available output buffer for encoding";
-          input_buffers_[index].in_use = false;
+          // Retried once the client released an output buffer.
+          return E_AGAIN;
         } else {
           auto& output_buffer = output_buffers_[output_index].buffer;
           int encoded_bytes = opus_encode(
@@ -184,7 +185,6 @@ void OpusCodec::ProcessInput(size_t index) {
 
           if (encoded_bytes < 0) {
             AVE_LOG(LS_ERROR) << "Opus encoding failed: " << encoded_bytes;
-            input_buffers_[index].in_use = false;
             error_to_notify = UNKNOWN_ERROR;
           } else {
             output_buffer->SetRange(0, encoded_bytes);
@@ -202,8 +202,7 @@ void OpusCodec::ProcessInput(size_t index) {
 
       size_t output_index = GetAvailableOutputBufferIndex();
       if (output_index == kInvalidIndex) {
-        AVE_LOG(LS_WARNING) << "No available output buffer for decoding";
-        input_buffers_[index].in_use = false;
+        return E_AGAIN;
       } else {
         auto& output_buffer = output_buffers_[output_index].buffer;
         auto* pcm = reinterpret_cast<opus_int16*>(output_buffer->data());
@@ -221,7 +220,6 @@ void OpusCodec::ProcessInput(size_t index) {
 
         if (decoded_samples < 0) {
           AVE_LOG(LS_ERROR) << "Opus decoding failed: " << decoded_samples;
-          input_buffers_[index].in_use = false;
           error_to_notify = UNKNOWN_ERROR;
         } else {
           auto pcm_bytes = decoded_samples * channels_ * sizeof(opus_int16);
@@ -236,7 +234,7 @@ void OpusCodec::ProcessInput(size_t index) {
       }
     }
 
-    input_buffers_[index].in_use = false;
+    FreeInputBuffer(index);
   }
 
   if (error_to_notify != OK) {
@@ -248,6 +246,7 @@ void OpusCodec::ProcessInput(size_t index) {
   if (should_notify_input) {
     NotifyInputBufferAvailable(index);
   }
+  return OK;
 }
 
 void OpusCodec::ProcessOutput() {
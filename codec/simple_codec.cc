@@ -7,6 +7,8 @@
 
 #include "simple_codec.h"
 
+#include <algorithm>
+
 #include "base/attributes.h"
 #include "base/logging.h"
 #include "base/sequence_checker.h"
@@ -16,10 +18,26 @@ namespace ave {
 namespace media {
 
 namespace {
-const int32_t kMaxInputBuffers = 8;
-const int32_t kMaxOutputBuffers = 16;
-const int32_t kDefaultBufferSize = 10 * 1024 * 1024;  // 4MB
 const size_t kInvalidIndex = static_cast<size_t>(-1);
+
+void FillSlots(std::deque<size_t>& slots, size_t count) {
+  slots.clear();
+  for (size_t i = 0; i < count; ++i) {
+    slots.push_back(i);
+  }
+}
+
+void EraseSlot(std::deque<size_t>& slots, size_t index) {
+  // Slots are nearly always taken from the front.
+  if (!slots.empty() && slots.front() == index) {
+    slots.pop_front();
+    return;
+  }
+  auto it = std::find(slots.begin(), slots.end(), index);
+  if (it != slots.end()) {
+    slots.erase(it);
+  }
+}
 }  // namespace
 
 SimpleCodec::SimpleCodec(bool is_encoder)
@@ -29,23 +47,36 @@ SimpleCodec::SimpleCodec(bool is_encoder)
               "SimpleCodec",
               base::TaskRunnerFactory::Priority::NORMAL))),
       state_(State::UNINITIALIZED),
-      callback_(nullptr) {}
+      callback_(nullptr),
+      async_mode_(false),
+      process_scheduled_(false),
+      output_pushed_(0),
+      loan_state_(std::make_shared<LoanState>()) {
+  std::scoped_lock lock(loan_state_->lock);
+  loan_state_->codec = this;
+  loan_state_->generation = 0;
+}
 
 SimpleCodec::~SimpleCodec() {
+  {
+    std::scoped_lock lock(loan_state_->lock);
+    loan_state_->codec = nullptr;
+  }
   // Don't call Release() here - it invokes virtual OnRelease() which causes
   // pure virtual call since derived class is already destroyed.
   // Just clean up our own resources.
   task_runner_->PostTaskAndWait([this]() {
     AVE_DCHECK_RUN_ON(task_runner_.get());
     std::scoped_lock lock(lock_);
-    input_buffers_.clear();
-    output_buffers_.clear();
+    RecycleBuffers();
     while (!input_queue_.empty()) {
       input_queue_.pop();
     }
     while (!output_queue_.empty()) {
       output_queue_.pop();
     }
+    free_inputs_.clear();
+    free_outputs_.clear();
     state_ = State::RELEASED;
     callback_ = nullptr;
   });
@@ -66,34 +97,78 @@ status_t SimpleCodec::Configure(const std::shared_ptr<CodecConfig>& config) {
       return;
     }
 
-    std::scoped_lock lock(lock_);
+    ret = ApplyConfig(config);
+  });
 
-    AVE_LOG(LS_INFO) << "SimpleCodec::Configure: allocating buffers";
-    input_buffers_ = std::vector<BufferEntry>(kMaxInputBuffers);
-    for (auto& entry : input_buffers_) {
-      entry.buffer = std::make_shared<CodecBuffer>(kDefaultBufferSize);
-      entry.in_use = false;
-    }
+  AVE_LOG(LS_INFO) << "SimpleCodec::Configure: PostTaskAndWait returned, ret="
+                   << ret;
+  return ret;
+}
 
-    output_buffers_ = std::vector<BufferEntry>(kMaxOutputBuffers);
-    for (auto& entry : output_buffers_) {
-      entry.buffer = std::make_shared<CodecBuffer>(kDefaultBufferSize);
-      entry.in_use = false;
+status_t SimpleCodec::Reconfigure(
+    const std::shared_ptr<CodecConfig>& config) {
+  status_t ret = OK;
+  task_runner_->PostTaskAndWait([this, &ret, config]() {
+    AVE_DCHECK_RUN_ON(task_runner_.get());
+    if (state_ != State::CONFIGURED) {
+      ret = INVALID_OPERATION;
+      return;
     }
-
-    config_ = config;
-    AVE_LOG(LS_INFO) << "SimpleCodec::Configure: calling OnConfigure";
-    ret = OnConfigure(config);
-    AVE_LOG(LS_INFO) << "SimpleCodec::Configure: OnConfigure returned " << ret;
-    if (ret == OK) {
-      state_ = State::CONFIGURED;
-    } else {
+    // Only the library state is rebuilt; the buffers come back from the
+    // shared pools.
+    EndInputLoans();
+    ret = OnRelease();
+    if (ret != OK) {
       state_ = State::ERROR;
+      return;
     }
+    ret = ApplyConfig(config);
   });
+  return ret;
+}
 
-  AVE_LOG(LS_INFO) << "SimpleCodec::Configure: PostTaskAndWait returned, ret="
-                   << ret;
+status_t SimpleCodec::ApplyConfig(const std::shared_ptr<CodecConfig>& config) {
+  std::scoped_lock lock(lock_);
+
+  const auto requirements = GetCodecBufferRequirements(
+      config && config->format ? *config->format
+                               : MediaMeta(MediaType::UNKNOWN),
+      is_encoder_);
+  AVE_LOG(LS_INFO) << "SimpleCodec::Configure: allocating "
+                   << requirements.input_count << " x "
+                   << requirements.input_size << " input and "
+                   << requirements.output_count << " x "
+                   << requirements.output_size << " output bytes";
+  RecycleBuffers();
+  input_pool_ = CodecBufferPool::GetShared(requirements.input_size +
+                                           InputBufferPadding());
+  input_buffers_ = std::vector<BufferEntry>(requirements.input_count);
+  for (auto& entry : input_buffers_) {
+    entry.buffer = input_pool_->Acquire();
+    entry.pool = input_pool_;
+    entry.in_use = false;
+  }
+
+  output_pool_ = CodecBufferPool::GetShared(requirements.output_size);
+  output_buffers_ = std::vector<BufferEntry>(requirements.output_count);
+  for (auto& entry : output_buffers_) {
+    entry.buffer = output_pool_->Acquire();
+    entry.pool = output_pool_;
+    entry.in_use = false;
+  }
+  FillSlots(free_inputs_, input_buffers_.size());
+  FillSlots(free_outputs_, output_buffers_.size());
+  async_mode_ = config && config->async_mode;
+
+  config_ = config;
+  AVE_LOG(LS_INFO) << "SimpleCodec::Configure: calling OnConfigure";
+  const status_t ret = OnConfigure(config);
+  AVE_LOG(LS_INFO) << "SimpleCodec::Configure: OnConfigure returned " << ret;
+  if (ret == OK) {
+    state_ = State::CONFIGURED;
+  } else {
+    state_ = State::ERROR;
+  }
   return ret;
 }
 
@@ -119,15 +194,18 @@ status_t SimpleCodec::Start() {
     ret = OnStart();
     if (ret == OK) {
       state_ = State::STARTED;
-      // Notify all initially free input buffers to kick off processing
+      // Announce the free input buffers to kick off processing. In async
+      // mode they are handed to the client; in sync mode they stay in the
+      // free list for DequeueInputBuffer().
       std::vector<size_t> free_indices;
       {
         std::scoped_lock lock(lock_);
-        for (size_t i = 0; i < input_buffers_.size(); ++i) {
-          if (!input_buffers_[i].in_use) {
-            input_buffers_[i].in_use = true;  // mark as given to the caller
-            free_indices.push_back(i);
+        free_indices.assign(free_inputs_.begin(), free_inputs_.end());
+        if (async_mode_) {
+          for (size_t idx : free_indices) {
+            input_buffers_[idx].in_use = true;
           }
+          free_inputs_.clear();
         }
       }
       for (size_t idx : free_indices) {
@@ -167,6 +245,12 @@ status_t SimpleCodec::Reset() {
   status_t ret = OK;
   task_runner_->PostTaskAndWait([this, &ret]() {
     AVE_DCHECK_RUN_ON(task_runner_.get());
+    // A released codec has nothing left to reset, an errored one needs
+    // Release().
+    if (state_ == State::RELEASED || state_ == State::ERROR) {
+      ret = INVALID_OPERATION;
+      return;
+    }
     std::scoped_lock lock(lock_);
 
     ret = OnReset();
@@ -177,12 +261,24 @@ status_t SimpleCodec::Reset() {
       while (!output_queue_.empty()) {
         output_queue_.pop();
       }
+      EndInputLoans();
       for (auto& entry : input_buffers_) {
+        if (!entry.lent.expired()) {
+          // The library may still read it; the slot gets new memory rather
+          // than handing that back to the client.
+          entry.buffer = input_pool_->Acquire();
+          entry.pool = input_pool_;
+          entry.lent.reset();
+        }
         entry.in_use = false;
       }
       for (auto& entry : output_buffers_) {
+        entry.buffer->ReleaseExternal();
         entry.in_use = false;
       }
+      FillSlots(free_inputs_, input_buffers_.size());
+      FillSlots(free_outputs_, output_buffers_.size());
+      process_scheduled_ = false;
       state_ = State::CONFIGURED;
     } else {
       state_ = State::ERROR;
@@ -224,16 +320,18 @@ status_t SimpleCodec::Release() {
     ret = OnRelease();
     state_ = State::RELEASED;
     callback_ = nullptr;
+    EndInputLoans();
 
     std::scoped_lock lock(lock_);
-    input_buffers_.clear();
-    output_buffers_.clear();
+    RecycleBuffers();
     while (!input_queue_.empty()) {
       input_queue_.pop();
     }
     while (!output_queue_.empty()) {
       output_queue_.pop();
     }
+    free_inputs_.clear();
+    free_outputs_.clear();
   });
   return ret;
 }
@@ -260,138 +358,229 @@ status_t SimpleCodec::GetOutputBuffer(size_t index,
 
 ssize_t SimpleCodec::DequeueInputBuffer(int64_t timeout_ms)
     NO_THREAD_SAFETY_ANALYSIS {
-  {
-    std::scoped_lock lock(lock_);
-    for (size_t i = 0; i < input_buffers_.size(); ++i) {
-      if (!input_buffers_[i].in_use) {
-        input_buffers_[i].in_use = true;
-        return static_cast<ssize_t>(i);
-      }
-    }
+  std::unique_lock<std::mutex> lock(lock_);
+  if (async_mode_) {
+    return -1;
   }
 
-  if (timeout_ms == 0) {
+  // Only freeing a slot can satisfy the wait, and that already schedules
+  // whatever processing it needs.
+  if (free_inputs_.empty() && timeout_ms > 0) {
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wthread-safety-analysis"
+    input_cv_.wait_for(lock, std::chrono::milliseconds(timeout_ms),
+                       [this]() { return !free_inputs_.empty(); });
+#pragma clang diagnostic pop
+  }
+  if (free_inputs_.empty()) {
     return -1;
   }
 
-  // Post task to process
-  task_runner_->PostTask([this]() {
-    AVE_DCHECK_RUN_ON(task_runner_.get());
-    Process();
-  });
+  const size_t index = free_inputs_.front();
+  free_inputs_.pop_front();
+  input_buffers_[index].in_use = true;
+  return static_cast<ssize_t>(index);
+}
 
-  // Wait for input buffer with lock
+status_t SimpleCodec::QueueInputBuffer(size_t index) {
+  std::scoped_lock lock(lock_);
+  if (index >= input_buffers_.size()) {
+    return INVALID_OPERATION;
+  }
+  EnqueueInputBuffer(index);
+  ScheduleProcess();
+
+  return OK;
+}
+
+ssize_t SimpleCodec::DequeueOutputBuffer(int64_t timeout_ms)
+    NO_THREAD_SAFETY_ANALYSIS {
   std::unique_lock<std::mutex> lock(lock_);
-  auto end =
-      std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+  if (async_mode_) {
+    return -1;
+  }
 
+  // Output is produced by the Process() runs that queueing input and
+  // releasing output schedule, nothing to kick off here.
+  if (output_queue_.empty() && timeout_ms > 0) {
 #pragma clang diagnostic push
 #pragma clang diagnostic ignored "-Wthread-safety-analysis"
-  cv_.wait_until(lock, end, [this]() {
-    for (const auto& entry : input_buffers_) {
-      if (!entry.in_use) {
-        return true;
-      }
-    }
-    return false;
-  });
-
-  // Check again after wait
-  for (size_t i = 0; i < input_buffers_.size(); ++i) {
-    if (!input_buffers_[i].in_use) {
-      input_buffers_[i].in_use = true;
-      return static_cast<ssize_t>(i);
-    }
-  }
+    output_cv_.wait_for(lock, std::chrono::milliseconds(timeout_ms),
+                        [this]() { return !output_queue_.empty(); });
 #pragma clang diagnostic pop
+  }
+  if (output_queue_.empty()) {
+    return -1;
+  }
 
-  return -1;
+  const size_t index = output_queue_.front();
+  output_queue_.pop();
+  return static_cast<ssize_t>(index);
 }
 
-status_t SimpleCodec::QueueInputBuffer(size_t index) {
+status_t SimpleCodec::ReleaseOutputBuffer(size_t index, bool render) {
   std::scoped_lock lock(lock_);
-  if (index >= input_buffers_.size()) {
+  if (index >= output_buffers_.size() || !output_buffers_[index].in_use) {
     return INVALID_OPERATION;
   }
-  // Mark in_use here so ProcessInput's check passes even when called from
-  // the NotifyInputBufferAvailable callback (where in_use was reset to false).
-  input_buffers_[index].in_use = true;
-  input_queue_.push(index);
 
-  task_runner_->PostTask([this]() {
-    AVE_DCHECK_RUN_ON(task_runner_.get());
-    Process();
-  });
+  if (render) {
+    // TODO: Implement rendering logic if supported
+  }
+
+  // Process() only stalls on output when no slot was free, or with input
+  // the codec refused until output drains.
+  const bool was_starved = free_outputs_.empty();
+  RecycleOutputBuffer(index);
+  if (was_starved || !input_queue_.empty()) {
+    ScheduleProcess();
+  }
 
   return OK;
 }
 
-ssize_t SimpleCodec::DequeueOutputBuffer(int64_t timeout_ms)
+size_t SimpleCodec::DequeueInputBuffers(std::vector<size_t>& indices,
+                                        size_t max_count,
+                                        int64_t timeout_ms)
     NO_THREAD_SAFETY_ANALYSIS {
-  {
-    std::scoped_lock lock(lock_);
-    if (!output_queue_.empty()) {
-      size_t front_index = output_queue_.front();
-      output_queue_.pop();
-      return static_cast<ssize_t>(front_index);
+  std::unique_lock<std::mutex> lock(lock_);
+  if (async_mode_ || max_count == 0) {
+    return 0;
+  }
+
+  if (free_inputs_.empty() && timeout_ms > 0) {
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wthread-safety-analysis"
+    input_cv_.wait_for(lock, std::chrono::milliseconds(timeout_ms),
+                       [this]() { return !free_inputs_.empty(); });
+#pragma clang diagnostic pop
+  }
+
+  size_t count = 0;
+  while (count < max_count && !free_inputs_.empty()) {
+    const size_t index = free_inputs_.front();
+    free_inputs_.pop_front();
+    input_buffers_[index].in_use = true;
+    indices.push_back(index);
+    ++count;
+  }
+  return count;
+}
+
+status_t SimpleCodec::QueueInputBuffers(const std::vector<size_t>& indices) {
+  std::scoped_lock lock(lock_);
+  for (const size_t index : indices) {
+    if (index >= input_buffers_.size()) {
+      return INVALID_OPERATION;
     }
   }
+  if (indices.empty()) {
+    return OK;
+  }
 
-  if (timeout_ms == 0) {
-    return -1;
+  for (const size_t index : indices) {
+    EnqueueInputBuffer(index);
   }
+  ScheduleProcess();
 
-  // Post task to process
-  task_runner_->PostTask([this]() {
-    AVE_DCHECK_RUN_ON(task_runner_.get());
-    Process();
-  });
+  return OK;
+}
 
-  // Wait for output with lock
+size_t SimpleCodec::DequeueOutputBuffers(std::vector<size_t>& indices,
+                                         size_t max_count,
+                                         int64_t timeout_ms)
+    NO_THREAD_SAFETY_ANALYSIS {
   std::unique_lock<std::mutex> lock(lock_);
-  auto end =
-      std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+  if (async_mode_ || max_count == 0) {
+    return 0;
+  }
 
+  if (output_queue_.empty() && timeout_ms > 0) {
 #pragma clang diagnostic push
 #pragma clang diagnostic ignored "-Wthread-safety-analysis"
-  cv_.wait_until(lock, end, [this]() { return !output_queue_.empty(); });
+    output_cv_.wait_for(lock, std::chrono::milliseconds(timeout_ms),
+                        [this]() { return !output_queue_.empty(); });
+#pragma clang diagnostic pop
+  }
 
-  // Check again after wait
-  if (!output_queue_.empty()) {
-    size_t front_index = output_queue_.front();
+  size_t count = 0;
+  while (count < max_count && !output_queue_.empty()) {
+    indices.push_back(output_queue_.front());
     output_queue_.pop();
-    return static_cast<ssize_t>(front_index);
+    ++count;
   }
-#pragma clang diagnostic pop
-
-  return -1;
+  return count;
 }
 
-status_t SimpleCodec::ReleaseOutputBuffer(size_t index, bool render) {
-  {
-    std::scoped_lock lock(lock_);
+status_t SimpleCodec::ReleaseOutputBuffers(const std::vector<size_t>& indices,
+                                           bool render) {
+  std::scoped_lock lock(lock_);
+  for (const size_t index : indices) {
     if (index >= output_buffers_.size() || !output_buffers_[index].in_use) {
       return INVALID_OPERATION;
     }
+  }
+  if (indices.empty()) {
+    return OK;
+  }
 
-    if (render) {
-      // TODO: Implement rendering logic if supported
-    }
+  const bool was_starved = free_outputs_.empty();
+  for (const size_t index : indices) {
+    RecycleOutputBuffer(index);
+  }
+  if (was_starved || !input_queue_.empty()) {
+    ScheduleProcess();
+  }
+
+  return OK;
+}
 
-    output_buffers_[index].in_use = false;
-    cv_.notify_all();
+void SimpleCodec::EnqueueInputBuffer(size_t index) {
+  // A sync client may queue an index it was only told about by the
+  // callback without dequeuing it first; take it off the free list then.
+  if (!input_buffers_[index].in_use) {
+    EraseSlot(free_inputs_, index);
+    input_buffers_[index].in_use = true;
   }
+  input_queue_.push(index);
+}
 
-  // Post Process task asynchronously to avoid blocking
+void SimpleCodec::RecycleOutputBuffer(size_t index) {
+  auto& entry = output_buffers_[index];
+  // A batch may name the same index twice.
+  if (!entry.in_use) {
+    return;
+  }
+  // Drops the reference on memory lent by the codec.
+  entry.buffer->ReleaseExternal();
+  entry.in_use = false;
+  if (entry.pool != output_pool_) {
+    // Sized for a format the codec no longer outputs.
+    entry.pool->Recycle(std::move(entry.buffer));
+    entry.buffer = output_pool_->Acquire();
+    entry.pool = output_pool_;
+  }
+  free_outputs_.push_back(index);
+}
+
+void SimpleCodec::ScheduleProcess() {
+  if (process_scheduled_) {
+    return;
+  }
+  process_scheduled_ = true;
   task_runner_->PostTask([this]() {
     AVE_DCHECK_RUN_ON(task_runner_.get());
     Process();
   });
-
-  return OK;
 }
 
 void SimpleCodec::Process() {
+  {
+    // Cleared before looking at the queues, so changes made from here on
+    // schedule another run.
+    std::scoped_lock lock(lock_);
+    process_scheduled_ = false;
+  }
   if (state_ != State::STARTED) {
     AVE_LOG(LS_WARNING) << "Process called but state is not STARTED";
     return;
@@ -399,51 +588,147 @@ void SimpleCodec::Process() {
 
   AVE_LOG(LS_VERBOSE) << "SimpleCodec::Process() called";
 
-  size_t input_index = kInvalidIndex;
-  {
-    std::scoped_lock lock(lock_);
-    AVE_LOG(LS_VERBOSE) << "Input queue size: " << input_queue_.size();
-    // Only dequeue input when an output slot is available. This prevents
-    // feeding the codec when all output buffers are in-use, which would cause
-    // avcodec_send_packet to return EAGAIN (internal buffer full).
-    if (!input_queue_.empty() &&
-        GetAvailableOutputBufferIndex() != kInvalidIndex) {
-      input_index = input_queue_.front();
-      input_queue_.pop();
-    } else {
-      AVE_LOG(LS_VERBOSE) << "Input queue is empty or no output slot available";
+  // Alternate between feeding the head of the input queue and draining the
+  // output until neither makes progress. An input the codec refuses with
+  // E_AGAIN stays queued and is retried once output was drained; if nothing
+  // could be drained either (all output buffers are held by the client),
+  // ReleaseOutputBuffer() schedules the next round.
+  while (state_ == State::STARTED) {
+    bool progressed = false;
+
+    size_t input_index = kInvalidIndex;
+    {
+      std::scoped_lock lock(lock_);
+      AVE_LOG(LS_VERBOSE) << "Input queue size: " << input_queue_.size();
+      if (!input_queue_.empty()) {
+        input_index = input_queue_.front();
+      }
+    }
+
+    // Process input without holding lock
+    if (input_index != kInvalidIndex) {
+      AVE_LOG(LS_VERBOSE) << "Calling ProcessInput(" << input_index << ")";
+      const status_t err = ProcessInput(input_index);
+      AVE_LOG(LS_VERBOSE) << "ProcessInput returned " << err;
+      if (err != E_AGAIN) {
+        // Only Process() pops, so the head is still this input even if the
+        // client queued the same index again from the callback.
+        std::scoped_lock lock(lock_);
+        input_queue_.pop();
+        progressed = true;
+      }
     }
-  }
 
-  // Process input without holding lock
-  if (input_index != kInvalidIndex) {
-    AVE_LOG(LS_VERBOSE) << "Calling ProcessInput(" << input_index << ")";
-    ProcessInput(input_index);
-    AVE_LOG(LS_VERBOSE) << "ProcessInput completed";
+    if (DrainOutput() > 0) {
+      progressed = true;
+    }
+
+    if (!progressed) {
+      break;
+    }
   }
+}
 
-  // Process all available outputs
+size_t SimpleCodec::DrainOutput() {
   AVE_LOG(LS_VERBOSE) << "Starting output processing loop";
+  size_t produced = 0;
   while (state_ == State::STARTED) {
-    size_t output_count_before{0};
+    // Counted at the push, the client may dequeue concurrently.
+    uint64_t pushed_before{0};
     {
       std::scoped_lock lock(lock_);
-      output_count_before = output_queue_.size();
+      pushed_before = output_pushed_;
     }
 
     ProcessOutput();
 
-    size_t output_count_after{0};
+    uint64_t pushed_after{0};
     {
       std::scoped_lock lock(lock_);
-      output_count_after = output_queue_.size();
+      pushed_after = output_pushed_;
     }
 
     // If no new output was produced, stop trying
-    if (output_count_after <= output_count_before) {
+    if (pushed_after == pushed_before) {
       break;
     }
+    produced += static_cast<size_t>(pushed_after - pushed_before);
   }
+  return produced;
+}
+
+void SimpleCodec::ReturnInputBuffer(size_t index) {
+  {
+    std::scoped_lock lock(lock_);
+    if (index >= input_buffers_.size() || !input_buffers_[index].in_use) {
+      return;
+    }
+    FreeInputBuffer(index);
+  }
+  NotifyInputBufferAvailable(index);
+}
+
+std::unique_ptr<SimpleCodec::InputLoan> SimpleCodec::LendInputBuffer(
+    size_t index,
+    size_t keep_unlent) {
+  const size_t lent = std::count_if(
+      input_buffers_.begin(), input_buffers_.end(),
+      [](const BufferEntry& entry) { return !entry.lent.expired(); });
+  if (lent + 1 + keep_unlent > input_buffers_.size()) {
+    return nullptr;
+  }
+  auto& entry = input_buffers_[index];
+  std::unique_ptr<InputLoan> loan(new InputLoan());
+  // A reference of its own, so the slot can tell while the loan is out.
+  loan->buffer_ = std::shared_ptr<CodecBuffer>(
+      entry.buffer.get(), [buffer = entry.buffer](CodecBuffer*) {});
+  entry.lent = loan->buffer_;
+  loan->state_ = loan_state_;
+  loan->index_ = index;
+  std::scoped_lock lock(loan_state_->lock);
+  loan->generation_ = loan_state_->generation;
+  return loan;
+}
+
+void SimpleCodec::EndInputLoans() {
+  std::scoped_lock lock(loan_state_->lock);
+  ++loan_state_->generation;
+}
+
+SimpleCodec::InputLoan::~InputLoan() {
+  auto state = state_.lock();
+  if (!return_slot_ || !state) {
+    return;
+  }
+  // May run on a library thread, or inside a library call made with lock_
+  // held, so the slot is returned from a task. The task checks again: the
+  // codec may be reset or destroyed before it runs.
+  std::scoped_lock lock(state->lock);
+  if (!state->codec || state->generation != generation_) {
+    return;
+  }
+  state->codec->task_runner_->PostTask(
+      [state, index = index_, generation = generation_]() {
+        SimpleCodec* codec = nullptr;
+        {
+          std::scoped_lock lock(state->lock);
+          if (!state->codec || state->generation != generation) {
+            return;
+          }
+          codec = state->codec;
+        }
+        AVE_DCHECK_RUN_ON(codec->task_runner_.get());
+        codec->ReturnInputBuffer(index);
+      });
+}
+
+void SimpleCodec::FreeInputBuffer(size_t index) {
+  if (async_mode_) {
+    return;
+  }
+  input_buffers_[index].in_use = false;
+  free_inputs_.push_back(index);
+  input_cv_.notify_one();
 }
 
 void SimpleCodec::NotifyInputBufferAvailable(size_t index) {
@@ -460,6 +745,10 @@ void SimpleCodec::NotifyOutputBufferAvailable(size_t index) {
 
 void SimpleCodec::NotifyOutputFormatChanged(
     const std::shared_ptr<MediaMeta>& format) {
+  if (format) {
+    std::scoped_lock lock(lock_);
+    ApplyOutputFormat(*format);
+  }
   if (callback_) {
     callback_->OnOutputFormatChanged(format);
   }
@@ -471,20 +760,57 @@ void SimpleCodec::NotifyError(status_t error) {
   }
 }
 
-size_t SimpleCodec::GetAvailableOutputBufferIndex() {
-  for (size_t i = 0; i < output_buffers_.size(); ++i) {
-    if (!output_buffers_[i].in_use) {
-      return i;
+void SimpleCodec::ApplyOutputFormat(const MediaMeta& format) {
+  const size_t size = is_encoder_ ? MaxAccessUnitSize(format)
+                                  : RawFrameSize(format);
+  if (size == 0 || !output_pool_) {
+    return;
+  }
+  auto pool = CodecBufferPool::GetShared(size);
+  if (pool == output_pool_) {
+    return;
+  }
+  AVE_LOG(LS_INFO) << "Output buffers resized from "
+                   << output_pool_->buffer_size() << " to "
+                   << pool->buffer_size() << " bytes";
+  output_pool_ = std::move(pool);
+  for (auto& entry : output_buffers_) {
+    if (!entry.in_use) {
+      entry.pool->Recycle(std::move(entry.buffer));
+      entry.buffer = output_pool_->Acquire();
+      entry.pool = output_pool_;
     }
   }
-  return kInvalidIndex;
+}
+
+void SimpleCodec::RecycleBuffers() {
+  for (auto* buffers : {&input_buffers_, &output_buffers_}) {
+    for (auto& entry : *buffers) {
+      // Memory still lent out must not be handed to another codec.
+      if (entry.pool && entry.lent.expired()) {
+        entry.pool->Recycle(std::move(entry.buffer));
+      }
+    }
+    buffers->clear();
+  }
+  input_pool_.reset();
+  output_pool_.reset();
+}
+
+size_t SimpleCodec::GetAvailableOutputBufferIndex() {
+  return free_outputs_.empty() ? kInvalidIndex : free_outputs_.front();
 }
 
 size_t SimpleCodec::PushOutputBuffer(size_t index) {
   if (index < output_buffers_.size()) {
+    EraseSlot(free_outputs_, index);
     output_buffers_[index].in_use = true;
-    output_queue_.push(index);
-    cv_.notify_all();
+    ++output_pushed_;
+    // Async clients get the index from the callback only.
+    if (!async_mode_) {
+      output_queue_.push(index);
+      output_cv_.notify_one();
+    }
     return index;
   }
   return kInvalidIndex;
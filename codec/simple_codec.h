@@ -9,6 +9,7 @@
 #define SIMPLE_CODEC_H
 
 #include <condition_variable>
+#include <deque>
 #include <memory>
 #include <mutex>
 #include <queue>
@@ -17,6 +18,7 @@
 #include "base/task_util/task_runner.h"
 #include "base/thread_annotation.h"
 #include "codec.h"
+#include "codec_buffer_pool.h"
 
 namespace ave {
 namespace media {
@@ -33,6 +35,7 @@ class SimpleCodec : public Codec {
   status_t Reset() override;
   status_t Flush() override;
   status_t Release() override;
+  status_t Reconfigure(const std::shared_ptr<CodecConfig>& config) override;
 
   status_t GetInputBuffer(size_t index,
                           std::shared_ptr<CodecBuffer>& buffer) override;
@@ -46,6 +49,21 @@ class SimpleCodec : public Codec {
       NO_THREAD_SAFETY_ANALYSIS override;
   status_t ReleaseOutputBuffer(size_t index, bool render) override;
 
+  // Move the whole batch under one lock_ and post at most one Process().
+  // Queue and release validate every index first and reject the batch on
+  // the first bad one.
+  size_t DequeueInputBuffers(std::vector<size_t>& indices,
+                             size_t max_count,
+                             int64_t timeout_ms)
+      NO_THREAD_SAFETY_ANALYSIS override;
+  status_t QueueInputBuffers(const std::vector<size_t>& indices) override;
+  size_t DequeueOutputBuffers(std::vector<size_t>& indices,
+                              size_t max_count,
+                              int64_t timeout_ms)
+      NO_THREAD_SAFETY_ANALYSIS override;
+  status_t ReleaseOutputBuffers(const std::vector<size_t>& indices,
+                                bool render) override;
+
   bool IsEncoder() const { return is_encoder_; }
 
  protected:
@@ -61,6 +79,45 @@ class SimpleCodec : public Codec {
   struct BufferEntry {
     bool in_use{false};
     std::shared_ptr<CodecBuffer> buffer;
+    // where |buffer| goes back to
+    std::shared_ptr<CodecBufferPool> pool;
+    // Alive while an InputLoan holds |buffer|.
+    std::weak_ptr<CodecBuffer> lent;
+  };
+
+  struct LoanState;
+
+  // An input buffer whose memory the codec library keeps referencing after
+  // ProcessInput() returned, e.g. as the AVBufferRef of a packet. Keeps the
+  // buffer alive; destroying the loan, on any thread, hands the slot back to
+  // the client on the codec thread. Slots taken back by Reset() or Release()
+  // meanwhile, and codecs destroyed meanwhile, are left alone.
+  class InputLoan {
+   public:
+    ~InputLoan();
+
+    // The library never took the buffer, the slot stays with its input.
+    void Cancel() { return_slot_ = false; }
+    CodecBuffer* buffer() const { return buffer_.get(); }
+
+   private:
+    friend class SimpleCodec;
+    InputLoan() = default;
+
+    std::shared_ptr<CodecBuffer> buffer_;
+    std::weak_ptr<LoanState> state_;
+    size_t index_ = 0;
+    uint64_t generation_ = 0;
+    bool return_slot_ = true;
+  };
+
+  // Outlives the codec for loans still out when it is destroyed.
+  struct LoanState {
+    std::mutex lock;
+    // nullptr once the codec is being destroyed
+    SimpleCodec* codec GUARDED_BY(lock);
+    // bumped whenever the codec takes all input slots back
+    uint64_t generation GUARDED_BY(lock);
   };
 
   virtual status_t OnConfigure(const std::shared_ptr<CodecConfig>& config)
@@ -71,32 +128,95 @@ class SimpleCodec : public Codec {
   virtual status_t OnFlush() REQUIRES(task_runner_) = 0;
   virtual status_t OnRelease() REQUIRES(task_runner_) = 0;
 
-  virtual void ProcessInput(size_t index) REQUIRES(task_runner_) = 0;
+  // Returns E_AGAIN when the codec cannot take the input until some output
+  // was drained; the buffer then stays at the head of the input queue and is
+  // offered again by the next Process().
+  virtual status_t ProcessInput(size_t index) REQUIRES(task_runner_) = 0;
   virtual void ProcessOutput() REQUIRES(task_runner_) = 0;
 
+  // Extra bytes reserved behind every input buffer, for codecs that read
+  // past the end of their input.
+  virtual size_t InputBufferPadding() const { return 0; }
+
   void Process() REQUIRES(task_runner_);
+  // Lock held halves of QueueInputBuffer() and ReleaseOutputBuffer() for
+  // an index that was already validated.
+  void EnqueueInputBuffer(size_t index) REQUIRES(lock_);
+  void RecycleOutputBuffer(size_t index) REQUIRES(lock_);
+  // Posts one Process() unless one is already pending. Callers only
+  // schedule when the queues changed in a way Process() can act on.
+  void ScheduleProcess() REQUIRES(lock_);
+  // Runs ProcessOutput() until it stops producing, returns the number of
+  // buffers it pushed.
+  size_t DrainOutput() REQUIRES(task_runner_);
+  // Hands an input buffer the codec held on to back to the client.
+  void ReturnInputBuffer(size_t index) REQUIRES(task_runner_);
+  // Lends input buffer |index| to the codec library, see InputLoan. The slot
+  // stays in use until the loan is destroyed. Returns nullptr if that would
+  // leave fewer than |keep_unlent| slots that are not lent: a library that
+  // holds on to packets until it gets more input would otherwise starve the
+  // client of slots. The caller then has the library copy the input.
+  std::unique_ptr<InputLoan> LendInputBuffer(size_t index, size_t keep_unlent)
+      REQUIRES(lock_);
+  // Keeps the input loans still out from returning their slots. Reset() and
+  // Release() call it; codecs whose destructor releases the library call it
+  // first, as that may end loans while the codec goes away.
+  void EndInputLoans();
+  // Marks an input buffer the codec is done with as free: it goes back to
+  // the free list in sync mode and stays with the client in async mode. The
+  // caller still announces it with NotifyInputBufferAvailable().
+  void FreeInputBuffer(size_t index) REQUIRES(lock_);
   void NotifyInputBufferAvailable(size_t index) REQUIRES(task_runner_);
   void NotifyOutputBufferAvailable(size_t index) REQUIRES(task_runner_);
+  // Resizes the output buffers for |format| before telling the client.
   void NotifyOutputFormatChanged(const std::shared_ptr<MediaMeta>& format)
       REQUIRES(task_runner_);
   void NotifyError(status_t error) REQUIRES(task_runner_);
 
+  // Switches the output buffers to the pool sized for |format|, for codecs
+  // that learn the new format with lock_ held and notify later. Free buffers
+  // are swapped now, the ones the client holds when released. A no-op if
+  // the size does not change.
+  void ApplyOutputFormat(const MediaMeta& format) REQUIRES(lock_);
+  // Hands every buffer back to its pool.
+  void RecycleBuffers() REQUIRES(lock_);
+
+  // Head of the free output list without taking it, kInvalidIndex if none.
   size_t GetAvailableOutputBufferIndex() REQUIRES(lock_);
   size_t PushOutputBuffer(size_t index) REQUIRES(lock_);
 
   const bool is_encoder_;
   std::unique_ptr<base::TaskRunner> task_runner_;
   std::mutex lock_;
-  std::condition_variable cv_;
+  // signalled when a slot enters free_inputs_ / output_queue_
+  std::condition_variable input_cv_;
+  std::condition_variable output_cv_;
 
   State state_ GUARDED_BY(task_runner_);
   CodecCallback* callback_ GUARDED_BY(task_runner_);
   std::shared_ptr<CodecConfig> config_ GUARDED_BY(task_runner_);
 
+  std::shared_ptr<CodecBufferPool> input_pool_ GUARDED_BY(lock_);
+  std::shared_ptr<CodecBufferPool> output_pool_ GUARDED_BY(lock_);
   std::vector<BufferEntry> input_buffers_ GUARDED_BY(lock_);
   std::vector<BufferEntry> output_buffers_ GUARDED_BY(lock_);
   std::queue<size_t> input_queue_ GUARDED_BY(lock_);
   std::queue<size_t> output_queue_ GUARDED_BY(lock_);
+  // slots neither the client nor the codec holds, oldest first
+  std::deque<size_t> free_inputs_ GUARDED_BY(lock_);
+  std::deque<size_t> free_outputs_ GUARDED_BY(lock_);
+  bool async_mode_ GUARDED_BY(lock_);
+  bool process_scheduled_ GUARDED_BY(lock_);
+  // total buffers pushed by PushOutputBuffer()
+  uint64_t output_pushed_ GUARDED_BY(lock_);
+
+ private:
+  // Sizes the buffers for |config| and calls OnConfigure(), for Configure()
+  // and Reconfigure().
+  status_t ApplyConfig(const std::shared_ptr<CodecConfig>& config)
+      REQUIRES(task_runner_);
+
+  const std::shared_ptr<LoanState> loan_state_;
 };
 
 }  // namespace media
@@ -68,62 +68,66 @@ status_t SimplePassthroughCodec::OnRelease() {
   return OK;
 }
 
-void SimplePassthroughCodec::ProcessInput(size_t index) {
+status_t SimplePassthroughCodec::ProcessInput(size_t index) {
   AVE_LOG(LS_VERBOSE) << "SimplePassthroughCodec::ProcessInput(" << index
                       << ")";
 
-  std::scoped_lock lock(lock_);
+  size_t output_index = kInvalidIndex;
+  {
+    std::scoped_lock lock(lock_);
 
-  // Validate input buffer
-  if (index >= input_buffers_.size() || !input_buffers_[index].in_use) {
-    AVE_LOG(LS_WARNING) << "Invalid input buffer index: " << index;
-    return;
-  }
+    // Validate input buffer
+    if (index >= input_buffers_.size() || !input_buffers_[index].in_use) {
+      AVE_LOG(LS_WARNING) << "Invalid input buffer index: " << index;
+      return INVALID_OPERATION;
+    }
 
-  auto& input_buffer = input_buffers_[index].buffer;
-  size_t input_size = input_buffer->size();
+    auto& input_buffer = input_buffers_[index].buffer;
+    size_t input_size = input_buffer->size();
 
-  AVE_LOG(LS_VERBOSE) << "Input buffer size: " << input_size;
+    AVE_LOG(LS_VERBOSE) << "Input buffer size: " << input_size;
 
-  // Find available output buffer
-  size_t output_index = GetAvailableOutputBufferIndex();
-  if (output_index == kInvalidIndex) {
-    AVE_LOG(LS_WARNING) << "No available output buffer";
-    // Keep input buffer occupied, will retry later
-    return;
-  }
+    // Find available output buffer
+    output_index = GetAvailableOutputBufferIndex();
+    if (output_index == kInvalidIndex) {
+      AVE_LOG(LS_VERBOSE) << "No available output buffer";
+      // Keep input buffer occupied, will retry later
+      return E_AGAIN;
+    }
 
-  // Get output buffer
-  auto& output_buffer = output_buffers_[output_index].buffer;
+    // Get output buffer
+    auto& output_buffer = output_buffers_[output_index].buffer;
 
-  // Passthrough: simply copy data from input to output
-  output_buffer->EnsureCapacity(input_size, false);
-  if (input_size > 0) {
-    std::memcpy(output_buffer->data(), input_buffer->data(), input_size);
-  }
-  output_buffer->SetRange(0, input_size);
+    // Passthrough: simply copy data from input to output
+    output_buffer->EnsureCapacity(input_size, false);
+    if (input_size > 0) {
+      std::memcpy(output_buffer->data(), input_buffer->data(), input_size);
+    }
+    output_buffer->SetRange(0, input_size);
 
-  // Copy metadata if present
-  if (input_buffer->format()) {
-    output_buffer->format() = input_buffer->format();
-  }
+    // Copy metadata if present
+    if (input_buffer->format()) {
+      output_buffer->format() = input_buffer->format();
+    }
 
-  // Release input buffer
-  input_buffers_[index].in_use = false;
-  cv_.notify_all();
+    // Release input buffer
+    FreeInputBuffer(index);
 
-  // Push output buffer to queue
-  PushOutputBuffer(output_index);
+    // Push output buffer to queue
+    PushOutputBuffer(output_index);
 
-  frame_count_++;
+    frame_count_++;
 
-  AVE_LOG(LS_VERBOSE) << "Passthrough frame " << frame_count_
-                      << ", size: " << input_size;
+    AVE_LOG(LS_VERBOSE) << "Passthrough frame " << frame_count_
+                        << ", size: " << input_size;
+  }
 
-  // Notify that input buffer is available again
+  // Notify outside lock_ so the client may queue and release from the
+  // callbacks. Input buffer is available again
   NotifyInputBufferAvailable(index);
   // Notify that output buffer is ready
   NotifyOutputBufferAvailable(output_index);
+  return OK;
 }
 
 void SimplePassthroughCodec::ProcessOutput() {
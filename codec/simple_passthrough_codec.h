@@ -39,7 +39,7 @@ class SimplePassthroughCodec : public SimpleCodec {
   status_t OnFlush() REQUIRES(task_runner_) override;
   status_t OnRelease() REQUIRES(task_runner_) override;
 
-  void ProcessInput(size_t index) REQUIRES(task_runner_) override;
+  status_t ProcessInput(size_t index) REQUIRES(task_runner_) override;
   void ProcessOutput() REQUIRES(task_runner_) override;
 
  private:
@@ -67,5 +67,15 @@ std::shared_ptr<Codec> SoftwareCodecFactory::CreateCodecByMime(
   return nullptr;
 }
 
+std::shared_ptr<Codec> SoftwareCodecFactory::CreateCodecByInfo(
+    const CodecInfo& info) {
+#ifdef AVE_FFMPEG_CODEC
+  if (ffmpeg_factory_) {
+    return ffmpeg_factory_->CreateCodecByInfo(info);
+  }
+#endif
+  return nullptr;
+}
+
 }  // namespace media
 }  // namespace ave
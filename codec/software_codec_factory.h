@@ -27,6 +27,7 @@ class SoftwareCodecFactory : public CodecFactory {
   std::shared_ptr<Codec> CreateCodecByName(const std::string& name) override;
   std::shared_ptr<Codec> CreateCodecByMime(const std::string& mime,
                                            bool encoder) override;
+  std::shared_ptr<Codec> CreateCodecByInfo(const CodecInfo& info) override;
 
   std::string name() const override { return "software"; }
   int16_t priority() const override { return 100; }
@@ -0,0 +1,151 @@
+/*
+ * codec_buffer_pool_unittest.cc
+ * Copyright (C) 2025 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#include "media/codec/codec_buffer_pool.h"
+
+#include <memory>
+
+#include "media/audio/channel_layout.h"
+#include "media/foundation/media_meta.h"
+#include "test/gtest.h"
+
+namespace ave {
+namespace media {
+
+namespace {
+
+MediaMeta VideoTrack(CodecId codec, int32_t width, int32_t height) {
+  MediaMeta format(MediaType::VIDEO, MediaMeta::FormatType::kTrack);
+  format.SetCodec(codec);
+  format.SetWidth(width);
+  format.SetHeight(height);
+  return format;
+}
+
+}  // namespace
+
+TEST(CodecBufferPoolTest, VideoDecoderRequirements) {
+  auto requirements = GetCodecBufferRequirements(
+      VideoTrack(CodecId::AVE_CODEC_ID_H264, 1920, 1080), false);
+  EXPECT_EQ(requirements.input_size, 1920u * 1080 * 3 / 4);
+  EXPECT_EQ(requirements.output_size, 1920u * 1080 * 3 / 2);
+  EXPECT_EQ(requirements.input_count, 8u);
+  EXPECT_EQ(requirements.output_count, 16u);
+
+  // 4K pictures get fewer output buffers.
+  requirements = GetCodecBufferRequirements(
+      VideoTrack(CodecId::AVE_CODEC_ID_HEVC, 3840, 2160), false);
+  EXPECT_EQ(requirements.output_size, 3840u * 2160 * 3 / 2);
+  EXPECT_EQ(requirements.output_count, 8u);
+}
+
+TEST(CodecBufferPoolTest, VideoSizeFromLevel) {
+  MediaMeta format(MediaType::VIDEO, MediaMeta::FormatType::kTrack);
+  format.SetCodec(CodecId::AVE_CODEC_ID_H264);
+  format.SetCodecLevel(40);
+  // 8192 macroblocks of level 4.
+  EXPECT_EQ(MaxAccessUnitSize(format), 8192u * 256 * 3 / 4);
+  EXPECT_EQ(RawFrameSize(format), 0u);
+}
+
+TEST(CodecBufferPoolTest, HighBitDepthOutput) {
+  MediaMeta format(MediaType::VIDEO, MediaMeta::FormatType::kSample);
+  format.SetWidth(1280);
+  format.SetHeight(720);
+  format.SetPixelFormat(AVE_PIX_FMT_P010LE);
+  EXPECT_EQ(RawFrameSize(format), 1280u * 720 * 3);
+}
+
+TEST(CodecBufferPoolTest, AudioDecoderRequirements) {
+  MediaMeta format(MediaType::AUDIO, MediaMeta::FormatType::kTrack);
+  format.SetCodec(CodecId::AVE_CODEC_ID_AAC);
+  format.SetChannelLayout(CHANNEL_LAYOUT_STEREO);
+  const auto requirements = GetCodecBufferRequirements(format, false);
+  // 2048 samples, floats out.
+  EXPECT_EQ(requirements.output_size, 2048u * 2 * 4);
+  EXPECT_EQ(requirements.input_size, 16u * 1024);
+}
+
+TEST(CodecBufferPoolTest, EncoderSwapsSides) {
+  MediaMeta format(MediaType::VIDEO, MediaMeta::FormatType::kSample);
+  format.SetWidth(1280);
+  format.SetHeight(720);
+  const auto requirements = GetCodecBufferRequirements(format, true);
+  EXPECT_EQ(requirements.input_size, 1280u * 720 * 3 / 2);
+  EXPECT_EQ(requirements.output_size, 1280u * 720 * 3 / 4);
+}
+
+TEST(CodecBufferPoolTest, UnknownFormatUsesDefaults) {
+  const auto requirements =
+      GetCodecBufferRequirements(MediaMeta(MediaType::UNKNOWN), false);
+  EXPECT_EQ(requirements.input_size, 10u * 1024 * 1024);
+  EXPECT_EQ(requirements.output_size, 10u * 1024 * 1024);
+}
+
+TEST(CodecBufferPoolTest, SharedPoolPerPageSize) {
+  auto pool = CodecBufferPool::GetShared(5000);
+  EXPECT_EQ(pool->buffer_size(), 8192u);
+  EXPECT_EQ(CodecBufferPool::GetShared(8192), pool);
+  EXPECT_NE(CodecBufferPool::GetShared(8193), pool);
+}
+
+TEST(CodecBufferPoolTest, SharedPoolOutlivesItsLastUser) {
+  // A size no other test asks for.
+  const size_t size = 123 * 4096;
+  CodecBuffer* raw = nullptr;
+  {
+    auto pool = CodecBufferPool::GetShared(size);
+    auto buffer = pool->Acquire();
+    raw = buffer.get();
+    pool->Recycle(std::move(buffer));
+  }
+  // Like a codec recreated for the same format.
+  auto pool = CodecBufferPool::GetShared(size);
+  ASSERT_EQ(pool->free_count(), 1u);
+  EXPECT_EQ(pool->Acquire().get(), raw);
+}
+
+TEST(CodecBufferPoolTest, RecycledBufferIsReused) {
+  CodecBufferPool pool(4096);
+  auto buffer = pool.Acquire();
+  ASSERT_NE(buffer, nullptr);
+  EXPECT_GE(buffer->capacity(), 4096u);
+  buffer->SetRange(0, 100);
+  CodecBuffer* raw = buffer.get();
+
+  pool.Recycle(std::move(buffer));
+  EXPECT_EQ(buffer, nullptr);
+  EXPECT_EQ(pool.free_count(), 1u);
+
+  auto again = pool.Acquire();
+  EXPECT_EQ(again.get(), raw);
+  EXPECT_EQ(again->size(), 0u);
+  EXPECT_EQ(pool.free_count(), 0u);
+}
+
+TEST(CodecBufferPoolTest, HeldBufferIsNotRecycled) {
+  CodecBufferPool pool(4096);
+  auto buffer = pool.Acquire();
+  auto holder = buffer;
+  pool.Recycle(std::move(buffer));
+  EXPECT_EQ(pool.free_count(), 0u);
+
+  // Too small for the pool.
+  pool.Recycle(std::make_shared<CodecBuffer>(1024));
+  EXPECT_EQ(pool.free_count(), 0u);
+}
+
+TEST(CodecBufferPoolTest, FreeListIsBounded) {
+  CodecBufferPool pool(4096, 2);
+  for (int i = 0; i < 4; ++i) {
+    pool.Recycle(std::make_shared<CodecBuffer>(4096));
+  }
+  EXPECT_EQ(pool.free_count(), 2u);
+}
+
+}  // namespace media
+}  // namespace ave
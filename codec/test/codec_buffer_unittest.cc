@@ -8,6 +8,8 @@
 #include "media/codec/codec_buffer.h"
 
 #include <cstring>
+#include <memory>
+#include <vector>
 
 #include "test/gtest.h"
 
@@ -103,5 +105,34 @@ TEST(CodecBufferTest, WriteAndReadData) {
   EXPECT_EQ(std::memcmp(buffer.data(), test_data, len), 0);
 }
 
+TEST(CodecBufferTest, WrapExternalKeepsHolderUntilRelease) {
+  CodecBuffer buffer(64);
+  uint8_t* own_data = buffer.base();
+
+  auto external = std::make_shared<std::vector<uint8_t>>(512, 0x5A);
+  std::weak_ptr<std::vector<uint8_t>> weak = external;
+  uint8_t* external_data = external->data();
+  EXPECT_EQ(buffer.WrapExternal(external_data, external->size(),
+                                std::move(external)),
+            OK);
+  EXPECT_TRUE(buffer.is_external());
+  EXPECT_EQ(buffer.base(), external_data);
+  EXPECT_EQ(buffer.capacity(), 512u);
+  EXPECT_FALSE(weak.expired());
+
+  buffer.ReleaseExternal();
+  EXPECT_FALSE(buffer.is_external());
+  EXPECT_TRUE(weak.expired());
+  EXPECT_EQ(buffer.base(), own_data);
+  EXPECT_EQ(buffer.capacity(), 64u);
+}
+
+TEST(CodecBufferTest, WrapExternalRejectsMissingHolder) {
+  CodecBuffer buffer(64);
+  uint8_t data[16];
+  EXPECT_EQ(buffer.WrapExternal(data, sizeof(data), nullptr), BAD_VALUE);
+  EXPECT_FALSE(buffer.is_external());
+}
+
 }  // namespace media
 }  // namespace ave
@@ -0,0 +1,224 @@
+/*
+ * codec_pool_unittest.cc
+ * Copyright (C) 2025 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#include "media/codec/codec_pool.h"
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "media/codec/simple_passthrough_codec.h"
+#include "media/foundation/media_meta.h"
+#include "test/gtest.h"
+
+namespace ave {
+namespace media {
+
+namespace {
+
+std::shared_ptr<CodecConfig> CreateVideoConfig(int32_t width, int32_t height) {
+  auto config = std::make_shared<CodecConfig>();
+  config->format =
+      MediaMeta::CreatePtr(MediaType::VIDEO, MediaMeta::FormatType::kTrack);
+  config->format->SetCodec(CodecId::AVE_CODEC_ID_H264);
+  config->format->SetWidth(width);
+  config->format->SetHeight(height);
+  return config;
+}
+
+// Remembers the codec private data of every config it was configured with.
+class RecordingCodec : public SimplePassthroughCodec {
+ public:
+  explicit RecordingCodec(bool encoder) : SimplePassthroughCodec(encoder) {}
+
+  std::vector<std::vector<uint8_t>> configured() {
+    std::scoped_lock lock(configured_lock_);
+    return configured_;
+  }
+
+ protected:
+  status_t OnConfigure(const std::shared_ptr<CodecConfig>& config)
+      REQUIRES(task_runner_) override {
+    auto private_data = config->format->private_data();
+    {
+      std::scoped_lock lock(configured_lock_);
+      configured_.emplace_back();
+      if (private_data) {
+        configured_.back().assign(private_data->data(),
+                                  private_data->data() + private_data->size());
+      }
+    }
+    return SimplePassthroughCodec::OnConfigure(config);
+  }
+
+ private:
+  std::mutex configured_lock_;
+  std::vector<std::vector<uint8_t>> configured_;
+};
+
+// Ends up in the error state when started.
+class FailingStartCodec : public SimplePassthroughCodec {
+ public:
+  explicit FailingStartCodec(bool encoder)
+      : SimplePassthroughCodec(encoder) {}
+
+ protected:
+  status_t OnStart() REQUIRES(task_runner_) override { return UNKNOWN_ERROR; }
+};
+
+}  // namespace
+
+class CodecPoolTest : public ::testing::Test {
+ protected:
+  CodecPool::CodecCreator Creator() {
+    return [this](CodecId /* codec_id */, bool encoder,
+                  const MediaMeta& /* format */) {
+      ++created_;
+      return std::make_shared<SimplePassthroughCodec>(encoder);
+    };
+  }
+
+  int created_ = 0;
+};
+
+TEST_F(CodecPoolTest, RecycledCodecIsReused) {
+  CodecPool pool(4, SIZE_MAX, Creator());
+  auto config = CreateVideoConfig(320, 240);
+
+  auto codec = pool.Acquire(config, false);
+  ASSERT_NE(codec, nullptr);
+  ASSERT_EQ(codec->Start(), OK);
+  EXPECT_GE(codec->DequeueInputBuffer(100), 0);
+  pool.Recycle(codec);
+  EXPECT_EQ(pool.idle_count(), 1u);
+  EXPECT_GT(pool.idle_bytes(), 0u);
+
+  // A new config with the same stream parameters gets the idle codec,
+  // configured and with all buffers back.
+  auto again = pool.Acquire(CreateVideoConfig(320, 240), false);
+  EXPECT_EQ(again, codec);
+  EXPECT_EQ(created_, 1);
+  EXPECT_EQ(pool.idle_count(), 0u);
+  EXPECT_EQ(pool.idle_bytes(), 0u);
+  ASSERT_EQ(again->Start(), OK);
+  EXPECT_GE(again->DequeueInputBuffer(100), 0);
+  again->Stop();
+}
+
+TEST_F(CodecPoolTest, DifferentFormatGetsNewCodec) {
+  CodecPool pool(4, SIZE_MAX, Creator());
+  auto codec = pool.Acquire(CreateVideoConfig(320, 240), false);
+  pool.Recycle(codec);
+
+  auto other = pool.Acquire(CreateVideoConfig(640, 480), false);
+  EXPECT_NE(other, codec);
+  auto encoder = pool.Acquire(CreateVideoConfig(320, 240), true);
+  EXPECT_NE(encoder, codec);
+  EXPECT_EQ(created_, 3);
+  EXPECT_EQ(pool.idle_count(), 1u);
+}
+
+TEST_F(CodecPoolTest, EvictsLeastRecentlyUsed) {
+  CodecPool pool(2, SIZE_MAX, Creator());
+  auto a = pool.Acquire(CreateVideoConfig(160, 120), false);
+  auto b = pool.Acquire(CreateVideoConfig(320, 240), false);
+  auto c = pool.Acquire(CreateVideoConfig(640, 480), false);
+  pool.Recycle(a);
+  pool.Recycle(b);
+  pool.Recycle(c);
+  EXPECT_EQ(pool.idle_count(), 2u);
+
+  // |a| went first.
+  EXPECT_EQ(pool.Acquire(CreateVideoConfig(320, 240), false), b);
+  EXPECT_EQ(pool.Acquire(CreateVideoConfig(640, 480), false), c);
+  EXPECT_NE(pool.Acquire(CreateVideoConfig(160, 120), false), a);
+  EXPECT_EQ(created_, 4);
+}
+
+TEST_F(CodecPoolTest, MemoryCap) {
+  CodecPool pool(4, 1, Creator());
+  pool.Recycle(pool.Acquire(CreateVideoConfig(320, 240), false));
+  EXPECT_EQ(pool.idle_count(), 0u);
+  EXPECT_EQ(pool.idle_bytes(), 0u);
+}
+
+TEST_F(CodecPoolTest, ForeignCodecIsReleased) {
+  CodecPool pool(4, SIZE_MAX, Creator());
+  auto codec = std::make_shared<SimplePassthroughCodec>(false);
+  ASSERT_EQ(codec->Configure(CreateVideoConfig(320, 240)), OK);
+  pool.Recycle(codec);
+  EXPECT_EQ(pool.idle_count(), 0u);
+  EXPECT_NE(codec->Start(), OK);
+}
+
+TEST_F(CodecPoolTest, ClearReleasesIdleCodecs) {
+  CodecPool pool(4, SIZE_MAX, Creator());
+  auto codec = pool.Acquire(CreateVideoConfig(320, 240), false);
+  pool.Recycle(codec);
+  pool.Clear();
+  EXPECT_EQ(pool.idle_count(), 0u);
+  EXPECT_NE(codec->Start(), OK);
+}
+
+TEST_F(CodecPoolTest, SimilarFormatReconfiguresIdleCodec) {
+  std::shared_ptr<RecordingCodec> created;
+  CodecPool pool(4, SIZE_MAX, [&created](CodecId /* codec_id */,
+                                         bool encoder,
+                                         const MediaMeta& /* format */) {
+    created = std::make_shared<RecordingCodec>(encoder);
+    return created;
+  });
+  const uint8_t sps_a[] = {0x67, 0x42, 0x00, 0x1e};
+  const uint8_t sps_b[] = {0x67, 0x64, 0x00, 0x28};
+  auto config = CreateVideoConfig(320, 240);
+  config->format->SetPrivateData(sizeof(sps_a), sps_a);
+  auto codec = pool.Acquire(config, false);
+  ASSERT_NE(codec, nullptr);
+  pool.Recycle(codec);
+
+  // A slightly bigger picture with other parameter sets gets the idle
+  // codec, configured with the new private data.
+  auto other = CreateVideoConfig(336, 240);
+  other->format->SetPrivateData(sizeof(sps_b), sps_b);
+  EXPECT_EQ(pool.Acquire(other, false), codec);
+  auto configured = created->configured();
+  ASSERT_EQ(configured.size(), 2u);
+  EXPECT_EQ(configured[1], std::vector<uint8_t>(std::begin(sps_b),
+                                                std::end(sps_b)));
+
+  // The same stream again needs no reconfiguring.
+  pool.Recycle(codec);
+  EXPECT_EQ(pool.Acquire(other, false), codec);
+  EXPECT_EQ(created->configured().size(), 2u);
+  ASSERT_EQ(codec->Start(), OK);
+  codec->Stop();
+}
+
+TEST_F(CodecPoolTest, ReleasedAndErroredCodecsAreDropped) {
+  CodecPool pool(4, SIZE_MAX, Creator());
+  auto released = pool.Acquire(CreateVideoConfig(320, 240), false);
+  ASSERT_NE(released, nullptr);
+  ASSERT_EQ(released->Release(), OK);
+  EXPECT_NE(released->Reset(), OK);
+  pool.Recycle(released);
+  EXPECT_EQ(pool.idle_count(), 0u);
+
+  CodecPool failing_pool(4, SIZE_MAX, [](CodecId /* codec_id */,
+                                         bool encoder,
+                                         const MediaMeta& /* format */) {
+    return std::make_shared<FailingStartCodec>(encoder);
+  });
+  auto errored = failing_pool.Acquire(CreateVideoConfig(320, 240), false);
+  ASSERT_NE(errored, nullptr);
+  EXPECT_NE(errored->Start(), OK);
+  EXPECT_NE(errored->Reset(), OK);
+  failing_pool.Recycle(errored);
+  EXPECT_EQ(failing_pool.idle_count(), 0u);
+}
+
+}  // namespace media
+}  // namespace ave
@@ -0,0 +1,231 @@
+/*
+ * codec_registry_unittest.cc
+ * Copyright (C) 2025 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#include "media/codec/codec_registry.h"
+
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "media/codec/codec_factory.h"
+#include "media/codec/simple_passthrough_codec.h"
+#include "media/foundation/media_meta.h"
+#include "test/gtest.h"
+
+namespace ave {
+namespace media {
+
+namespace {
+
+constexpr int64_t k1080pPixels = 1920 * 1080;
+
+CodecInfo H264Decoder(const std::string& name, int64_t pixel_rate) {
+  CodecInfo info;
+  info.name = name;
+  info.mime = "video/avc";
+  info.media_type = MediaType::VIDEO;
+  info.codec_id = CodecId::AVE_CODEC_ID_H264;
+  info.max_pixel_rate = pixel_rate;
+  return info;
+}
+
+// Lists two H.264 decoders of different speed and remembers what it made.
+class TestCodecFactory : public CodecFactory {
+ public:
+  std::vector<CodecInfo> GetSupportedCodecs() override {
+    ++listed_;
+    CodecInfo encoder = H264Decoder("h264_encoder", 0);
+    encoder.is_encoder = true;
+    encoder.pixel_formats = {AVE_PIX_FMT_NV12};
+    return {H264Decoder("slow_h264", k1080pPixels * 10),
+            H264Decoder("fast_h264", k1080pPixels * 60), encoder};
+  }
+
+  std::shared_ptr<Codec> CreateCodecByType(CodecId /* codec_id */,
+                                           bool encoder) override {
+    created_.push_back("by_type");
+    return std::make_shared<SimplePassthroughCodec>(encoder);
+  }
+
+  std::shared_ptr<Codec> CreateCodecByName(const std::string& name) override {
+    created_.push_back(name);
+    return std::make_shared<SimplePassthroughCodec>(name == "h264_encoder");
+  }
+
+  std::shared_ptr<Codec> CreateCodecByMime(const std::string& /* mime */,
+                                           bool encoder) override {
+    return std::make_shared<SimplePassthroughCodec>(encoder);
+  }
+
+  std::string name() const override { return "registry_test"; }
+  int16_t priority() const override { return 0; }
+
+  int listed_ = 0;
+  std::vector<std::string> created_;
+};
+
+MediaMeta VideoTrack(int32_t width, int32_t height, int32_t fps) {
+  MediaMeta format(MediaType::VIDEO, MediaMeta::FormatType::kTrack);
+  format.SetCodec(CodecId::AVE_CODEC_ID_H264);
+  format.SetWidth(width);
+  format.SetHeight(height);
+  format.SetFrameRate(fps);
+  return format;
+}
+
+// Registers |factory| for the scope, and forgets what the global registry
+// learned meanwhile so later tests start empty.
+class ScopedCodecFactory {
+ public:
+  explicit ScopedCodecFactory(std::shared_ptr<CodecFactory> factory)
+      : factory_(std::move(factory)) {
+    RegisterCodecFactory(factory_);
+  }
+  ~ScopedCodecFactory() {
+    UnregisterCodecFactory(factory_);
+    GetCodecRegistry().Clear();
+  }
+
+ private:
+  std::shared_ptr<CodecFactory> factory_;
+};
+
+}  // namespace
+
+TEST(CodecRegistryTest, ListsEachFactoryOnce) {
+  CodecRegistry registry;
+  TestCodecFactory factory;
+  EXPECT_EQ(registry.GetCodecs(factory).size(), 3u);
+  EXPECT_EQ(registry.GetCodecs(factory).size(), 3u);
+  EXPECT_EQ(factory.listed_, 1);
+}
+
+TEST(CodecRegistryTest, SaveAndLoad) {
+  const std::string path = ::testing::TempDir() + "codec_registry_test.txt";
+  TestCodecFactory factory;
+  {
+    CodecRegistry registry;
+    auto codecs = registry.GetCodecs(factory);
+    codecs[0].max_width = 4096;
+    codecs[0].max_height = 2304;
+    codecs[0].profiles = {66, 77, 100};
+    codecs[0].thread_count = 4;
+    registry.UpdateCodec(factory.name(), codecs[0]);
+    ASSERT_EQ(registry.Save(path), OK);
+  }
+
+  CodecRegistry registry;
+  ASSERT_EQ(registry.Load(path), OK);
+  const auto codecs = registry.GetCodecs(factory);
+  EXPECT_EQ(factory.listed_, 1);
+  ASSERT_EQ(codecs.size(), 3u);
+  EXPECT_EQ(codecs[0].name, "slow_h264");
+  EXPECT_EQ(codecs[0].mime, "video/avc");
+  EXPECT_EQ(codecs[0].codec_id, CodecId::AVE_CODEC_ID_H264);
+  EXPECT_EQ(codecs[0].max_width, 4096);
+  EXPECT_EQ(codecs[0].max_height, 2304);
+  EXPECT_EQ(codecs[0].profiles, (std::vector<int32_t>{66, 77, 100}));
+  EXPECT_EQ(codecs[0].max_pixel_rate, k1080pPixels * 10);
+  EXPECT_EQ(codecs[0].thread_count, 4);
+  EXPECT_TRUE(codecs[2].is_encoder);
+  EXPECT_EQ(codecs[2].pixel_formats,
+            (std::vector<PixelFormat>{AVE_PIX_FMT_NV12}));
+  std::remove(path.c_str());
+
+  EXPECT_EQ(registry.Load(path), NAME_NOT_FOUND);
+}
+
+TEST(CodecRegistryTest, CanSustain) {
+  CodecInfo info = H264Decoder("h264", k1080pPixels * 30);
+  EXPECT_TRUE(CanSustain(info, VideoTrack(1920, 1080, 30)));
+  EXPECT_FALSE(CanSustain(info, VideoTrack(1920, 1080, 60)));
+  // 30 fps if the track does not say.
+  EXPECT_TRUE(CanSustain(info, VideoTrack(1920, 1080, -1)));
+
+  info.max_width = 1280;
+  info.max_height = 720;
+  EXPECT_TRUE(CanSustain(info, VideoTrack(1280, 720, 60)));
+  EXPECT_FALSE(CanSustain(info, VideoTrack(1920, 1080, 25)));
+
+  info.profiles = {66, 77};
+  auto high_profile = VideoTrack(1280, 720, 30);
+  high_profile.SetCodecProfile(100);
+  EXPECT_FALSE(CanSustain(info, high_profile));
+
+  // Uncalibrated codecs are assumed to keep up.
+  EXPECT_TRUE(CanSustain(H264Decoder("h264", 0), VideoTrack(7680, 4320, 120)));
+}
+
+TEST(CodecRegistryTest, CreateCodecByTypePicksSustainingCodec) {
+  auto factory = std::make_shared<TestCodecFactory>();
+  ScopedCodecFactory scoped_factory(factory);
+
+  EXPECT_NE(CreateCodecByType(CodecId::AVE_CODEC_ID_H264, false,
+                              VideoTrack(1920, 1080, 30)),
+            nullptr);
+  // Too much for both, still the faster one.
+  EXPECT_NE(CreateCodecByType(CodecId::AVE_CODEC_ID_H264, false,
+                              VideoTrack(3840, 2160, 60)),
+            nullptr);
+  // The encoder lists only NV12.
+  MediaMeta nv12(MediaType::VIDEO, MediaMeta::FormatType::kSample);
+  nv12.SetPixelFormat(AVE_PIX_FMT_NV12);
+  EXPECT_NE(CreateCodecByType(CodecId::AVE_CODEC_ID_H264, true, nv12),
+            nullptr);
+  // Nothing listed for HEVC.
+  EXPECT_NE(CreateCodecByType(CodecId::AVE_CODEC_ID_HEVC, false,
+                              VideoTrack(1920, 1080, 30)),
+            nullptr);
+  // Nothing known about the stream, still the faster one.
+  EXPECT_NE(CreateCodecByType(CodecId::AVE_CODEC_ID_H264, false), nullptr);
+
+  EXPECT_EQ(factory->created_,
+            (std::vector<std::string>{"fast_h264", "fast_h264",
+                                      "h264_encoder", "by_type",
+                                      "fast_h264"}));
+}
+
+TEST(CodecRegistryTest, RegisterLoadsRegistryFile) {
+  const std::string path = ::testing::TempDir() + "codec_registry_load.txt";
+  auto factory = std::make_shared<TestCodecFactory>();
+  {
+    // Calibrated the other way around than the factory lists them.
+    CodecRegistry registry;
+    auto codecs = registry.GetCodecs(*factory);
+    codecs[0].max_pixel_rate = k1080pPixels * 60;
+    codecs[1].max_pixel_rate = k1080pPixels * 10;
+    registry.UpdateCodec(factory->name(), codecs[0]);
+    registry.UpdateCodec(factory->name(), codecs[1]);
+    ASSERT_EQ(registry.Save(path), OK);
+  }
+  factory->listed_ = 0;
+
+  // Loading is opt-in.
+  EXPECT_EQ(GetCodecRegistry().path(), "");
+  GetCodecRegistry().SetPath(path);
+  {
+    ScopedCodecFactory scoped_factory(factory);
+    EXPECT_NE(CreateCodecByType(CodecId::AVE_CODEC_ID_H264, false,
+                                VideoTrack(1920, 1080, 30)),
+              nullptr);
+  }
+  GetCodecRegistry().SetPath("");
+  std::remove(path.c_str());
+
+  EXPECT_EQ(factory->listed_, 0);
+  EXPECT_EQ(factory->created_, (std::vector<std::string>{"slow_h264"}));
+}
+
+TEST(CodecRegistryTest, UnregisterUnknownFactory) {
+  EXPECT_EQ(UnregisterCodecFactory(std::make_shared<TestCodecFactory>()),
+            NAME_NOT_FOUND);
+}
+
+}  // namespace media
+}  // namespace ave
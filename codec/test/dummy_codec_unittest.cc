@@ -11,6 +11,7 @@
 #include <cstring>
 #include <memory>
 #include <thread>
+#include <vector>
 
 #include "media/codec/codec.h"
 #include "media/codec/codec_factory.h"
@@ -61,6 +62,17 @@ TEST_F(DummyCodecTest, DequeueInputBuffer) {
   codec_->Stop();
 }
 
+TEST_F(DummyCodecTest, DequeueInputBuffersLoopsOverSingleCalls) {
+  EXPECT_EQ(codec_->Start(), OK);
+  std::vector<size_t> indices;
+  EXPECT_EQ(codec_->DequeueInputBuffers(indices, 2, 0), 2u);
+  // Stops at the first failed dequeue once the codec runs out.
+  EXPECT_EQ(codec_->DequeueInputBuffers(indices, 100, 0), 3u);
+  EXPECT_EQ(indices, (std::vector<size_t>{0, 1, 2, 3, 4}));
+  EXPECT_EQ(codec_->QueueInputBuffers({0, 1}), OK);
+  codec_->Stop();
+}
+
 TEST_F(DummyCodecTest, DequeueInputBufferWhenNotStarted) {
   ssize_t index = codec_->DequeueInputBuffer(0);
   EXPECT_LT(index, 0);
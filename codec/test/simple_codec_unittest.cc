@@ -0,0 +1,449 @@
+/*
+ * simple_codec_unittest.cc
+ * Copyright (C) 2025 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#include "media/codec/simple_codec.h"
+
+#include <algorithm>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "media/codec/codec_buffer_pool.h"
+#include "media/foundation/media_meta.h"
+#include "test/gtest.h"
+
+namespace ave {
+namespace media {
+
+namespace {
+
+const size_t kInvalidIndex = static_cast<size_t>(-1);
+
+// Lends every input's bytes to its output as external memory, the way
+// FFmpegCodec lends decoded frames. Keeps a weak reference to each lent
+// block so tests can tell when the codec let go of it.
+class ExternalOutputCodec : public SimpleCodec {
+ public:
+  ExternalOutputCodec() : SimpleCodec(false) {}
+  ~ExternalOutputCodec() override = default;
+
+  std::vector<std::weak_ptr<std::vector<uint8_t>>> lent() {
+    std::scoped_lock lock(lent_lock_);
+    return lent_;
+  }
+
+ protected:
+  status_t OnConfigure(const std::shared_ptr<CodecConfig>& config)
+      REQUIRES(task_runner_) override {
+    return OK;
+  }
+  status_t OnStart() REQUIRES(task_runner_) override { return OK; }
+  status_t OnStop() REQUIRES(task_runner_) override { return OK; }
+  status_t OnReset() REQUIRES(task_runner_) override { return OK; }
+  status_t OnFlush() REQUIRES(task_runner_) override { return OK; }
+  status_t OnRelease() REQUIRES(task_runner_) override { return OK; }
+
+  status_t ProcessInput(size_t index) REQUIRES(task_runner_) override {
+    size_t output_index = kInvalidIndex;
+    {
+      std::scoped_lock lock(lock_);
+      output_index = GetAvailableOutputBufferIndex();
+      if (output_index == kInvalidIndex) {
+        return E_AGAIN;
+      }
+      auto& input = input_buffers_[index].buffer;
+      auto frame = std::make_shared<std::vector<uint8_t>>(
+          input->data(), input->data() + input->size());
+      output_buffers_[output_index].buffer->WrapExternal(
+          frame->data(), frame->size(), frame);
+      {
+        std::scoped_lock lent_lock(lent_lock_);
+        lent_.push_back(frame);
+      }
+      FreeInputBuffer(index);
+      PushOutputBuffer(output_index);
+    }
+    NotifyInputBufferAvailable(index);
+    NotifyOutputBufferAvailable(output_index);
+    return OK;
+  }
+  void ProcessOutput() REQUIRES(task_runner_) override {}
+
+ private:
+  std::mutex lent_lock_;
+  std::vector<std::weak_ptr<std::vector<uint8_t>>> lent_;
+};
+
+// Keeps every input lent, the way FFmpegCodec lends packets to the
+// decoder, and emits an empty output for it. The test decides when the
+// "library" drops the loans.
+class LendingCodec : public SimpleCodec {
+ public:
+  using SimpleCodec::InputLoan;
+
+  LendingCodec() : SimpleCodec(false) {}
+  ~LendingCodec() override = default;
+
+  std::vector<std::unique_ptr<InputLoan>> TakeLoans() {
+    std::scoped_lock lock(lock_);
+    return std::move(loans_);
+  }
+
+ protected:
+  status_t OnConfigure(const std::shared_ptr<CodecConfig>& config)
+      REQUIRES(task_runner_) override {
+    return OK;
+  }
+  status_t OnStart() REQUIRES(task_runner_) override { return OK; }
+  status_t OnStop() REQUIRES(task_runner_) override { return OK; }
+  status_t OnReset() REQUIRES(task_runner_) override { return OK; }
+  status_t OnFlush() REQUIRES(task_runner_) override { return OK; }
+  status_t OnRelease() REQUIRES(task_runner_) override { return OK; }
+
+  status_t ProcessInput(size_t index) REQUIRES(task_runner_) override {
+    size_t output_index = kInvalidIndex;
+    {
+      std::scoped_lock lock(lock_);
+      output_index = GetAvailableOutputBufferIndex();
+      if (output_index == kInvalidIndex) {
+        return E_AGAIN;
+      }
+      loans_.push_back(LendInputBuffer(index, 0));
+      output_buffers_[output_index].buffer->SetRange(0, 0);
+      PushOutputBuffer(output_index);
+    }
+    NotifyOutputBufferAvailable(output_index);
+    return OK;
+  }
+  void ProcessOutput() REQUIRES(task_runner_) override {}
+
+ private:
+  std::vector<std::unique_ptr<InputLoan>> loans_ GUARDED_BY(lock_);
+};
+
+// Models FFmpeg frame threading: each of |threads| decoder threads keeps
+// the last packet it was given, and no frame comes out before every thread
+// got one. Inputs it may not lend are copied, as FFmpegCodec does.
+class FrameThreadCodec : public SimpleCodec {
+ public:
+  using SimpleCodec::InputLoan;
+
+  explicit FrameThreadCodec(size_t threads)
+      : SimpleCodec(false), threads_(threads) {}
+  ~FrameThreadCodec() override = default;
+
+  size_t loan_count() {
+    std::scoped_lock lock(lock_);
+    return loan_count_;
+  }
+
+ protected:
+  status_t OnConfigure(const std::shared_ptr<CodecConfig>& config)
+      REQUIRES(task_runner_) override {
+    return OK;
+  }
+  status_t OnStart() REQUIRES(task_runner_) override { return OK; }
+  status_t OnStop() REQUIRES(task_runner_) override { return OK; }
+  status_t OnReset() REQUIRES(task_runner_) override { return OK; }
+  status_t OnFlush() REQUIRES(task_runner_) override { return OK; }
+  status_t OnRelease() REQUIRES(task_runner_) override { return OK; }
+
+  status_t ProcessInput(size_t index) REQUIRES(task_runner_) override {
+    size_t output_index = kInvalidIndex;
+    bool copied = false;
+    {
+      std::scoped_lock lock(lock_);
+      const bool emits = received_ + 1 >= threads_;
+      if (emits) {
+        output_index = GetAvailableOutputBufferIndex();
+        if (output_index == kInvalidIndex) {
+          return E_AGAIN;
+        }
+      }
+      auto loan = LendInputBuffer(index, threads_ + 2);
+      if (loan) {
+        ++loan_count_;
+      } else {
+        FreeInputBuffer(index);
+        copied = true;
+      }
+      // The thread taking this packet drops the one it had.
+      held_.push_back(std::move(loan));
+      if (held_.size() > threads_) {
+        held_.pop_front();
+      }
+      ++received_;
+      if (emits) {
+        output_buffers_[output_index].buffer->SetRange(0, 0);
+        PushOutputBuffer(output_index);
+      }
+    }
+    if (copied) {
+      NotifyInputBufferAvailable(index);
+    }
+    if (output_index != kInvalidIndex) {
+      NotifyOutputBufferAvailable(output_index);
+    }
+    return OK;
+  }
+  void ProcessOutput() REQUIRES(task_runner_) override {}
+
+ private:
+  const size_t threads_;
+  std::deque<std::unique_ptr<InputLoan>> held_ GUARDED_BY(lock_);
+  size_t received_ GUARDED_BY(lock_) = 0;
+  size_t loan_count_ GUARDED_BY(lock_) = 0;
+};
+
+class InputCallback : public CodecCallback {
+ public:
+  void OnInputBufferAvailable(size_t index) override {
+    std::scoped_lock lock(lock_);
+    returned_.push_back(index);
+  }
+  void OnOutputBufferAvailable(size_t index) override {}
+  void OnOutputFormatChanged(
+      const std::shared_ptr<MediaMeta>& format) override {}
+  void OnError(status_t error) override {}
+  void OnFrameRendered(std::shared_ptr<Message> notify) override {}
+
+  std::vector<size_t> returned() {
+    std::scoped_lock lock(lock_);
+    return returned_;
+  }
+
+ private:
+  std::mutex lock_;
+  std::vector<size_t> returned_;
+};
+
+std::shared_ptr<CodecConfig> CreateTestConfig() {
+  auto config = std::make_shared<CodecConfig>();
+  config->format =
+      MediaMeta::CreatePtr(MediaType::AUDIO, MediaMeta::FormatType::kSample);
+  return config;
+}
+
+// Queues a one byte input and returns the index of the output it became.
+ssize_t Decode(Codec* codec, uint8_t value) {
+  const ssize_t input_idx = codec->DequeueInputBuffer(200);
+  if (input_idx < 0) {
+    return -1;
+  }
+  std::shared_ptr<CodecBuffer> input;
+  codec->GetInputBuffer(static_cast<size_t>(input_idx), input);
+  input->data()[0] = value;
+  input->SetRange(0, 1);
+  codec->QueueInputBuffer(static_cast<size_t>(input_idx));
+  return codec->DequeueOutputBuffer(500);
+}
+
+}  // namespace
+
+TEST(SimpleCodecTest, ReleaseOutputBufferDropsExternalMemory) {
+  auto codec = std::make_shared<ExternalOutputCodec>();
+  ASSERT_EQ(codec->Configure(CreateTestConfig()), OK);
+  ASSERT_EQ(codec->Start(), OK);
+
+  const ssize_t output_idx = Decode(codec.get(), 0x5a);
+  ASSERT_GE(output_idx, 0);
+  std::shared_ptr<CodecBuffer> output;
+  codec->GetOutputBuffer(static_cast<size_t>(output_idx), output);
+  EXPECT_TRUE(output->is_external());
+  ASSERT_EQ(output->size(), 1u);
+  EXPECT_EQ(output->data()[0], 0x5a);
+  ASSERT_EQ(codec->lent().size(), 1u);
+  EXPECT_FALSE(codec->lent()[0].expired());
+
+  EXPECT_EQ(codec->ReleaseOutputBuffer(static_cast<size_t>(output_idx), false),
+            OK);
+  EXPECT_TRUE(codec->lent()[0].expired());
+  EXPECT_FALSE(output->is_external());
+  codec->Stop();
+  codec->Release();
+}
+
+TEST(SimpleCodecTest, ResetDropsExternalMemoryOfHeldOutput) {
+  auto codec = std::make_shared<ExternalOutputCodec>();
+  ASSERT_EQ(codec->Configure(CreateTestConfig()), OK);
+  ASSERT_EQ(codec->Start(), OK);
+
+  // The client never releases these.
+  ASSERT_GE(Decode(codec.get(), 1), 0);
+  ASSERT_GE(Decode(codec.get(), 2), 0);
+  ASSERT_EQ(codec->lent().size(), 2u);
+
+  ASSERT_EQ(codec->Stop(), OK);
+  ASSERT_EQ(codec->Reset(), OK);
+  for (const auto& frame : codec->lent()) {
+    EXPECT_TRUE(frame.expired());
+  }
+
+  // The slots are usable again after the reset.
+  ASSERT_EQ(codec->Start(), OK);
+  const ssize_t output_idx = Decode(codec.get(), 3);
+  ASSERT_GE(output_idx, 0);
+  EXPECT_EQ(codec->ReleaseOutputBuffer(static_cast<size_t>(output_idx), false),
+            OK);
+  codec->Stop();
+  codec->Release();
+}
+
+TEST(SimpleCodecTest, DroppedLoanReturnsInputSlot) {
+  auto codec = std::make_shared<LendingCodec>();
+  InputCallback callback;
+  ASSERT_EQ(codec->Configure(CreateTestConfig()), OK);
+  ASSERT_EQ(codec->SetCallback(&callback), OK);
+  ASSERT_EQ(codec->Start(), OK);
+  // Start() announces the free slots.
+  const size_t announced = callback.returned().size();
+
+  const ssize_t input_idx = codec->DequeueInputBuffer(0);
+  ASSERT_GE(input_idx, 0);
+  ASSERT_EQ(codec->QueueInputBuffer(static_cast<size_t>(input_idx)), OK);
+  ASSERT_GE(codec->DequeueOutputBuffer(500), 0);
+  auto loans = codec->TakeLoans();
+  ASSERT_EQ(loans.size(), 1u);
+  EXPECT_EQ(callback.returned().size(), announced);
+
+  // Dropped off the codec thread, as a decoder thread would.
+  std::thread([&loans]() { loans.clear(); }).join();
+  // Flush() runs on the codec thread after the return task.
+  codec->Flush();
+  ASSERT_EQ(callback.returned().size(), announced + 1);
+  EXPECT_EQ(callback.returned().back(), static_cast<size_t>(input_idx));
+  std::vector<size_t> inputs;
+  codec->DequeueInputBuffers(inputs, 64, 0);
+  EXPECT_NE(std::find(inputs.begin(), inputs.end(),
+                      static_cast<size_t>(input_idx)),
+            inputs.end());
+  codec->Stop();
+  codec->Release();
+}
+
+TEST(SimpleCodecTest, LoanFromBeforeResetDoesNotReturnSlot) {
+  auto codec = std::make_shared<LendingCodec>();
+  ASSERT_EQ(codec->Configure(CreateTestConfig()), OK);
+  ASSERT_EQ(codec->Start(), OK);
+
+  ssize_t input_idx = codec->DequeueInputBuffer(0);
+  ASSERT_GE(input_idx, 0);
+  ASSERT_EQ(codec->QueueInputBuffer(static_cast<size_t>(input_idx)), OK);
+  ASSERT_GE(codec->DequeueOutputBuffer(500), 0);
+  auto loans = codec->TakeLoans();
+  ASSERT_EQ(loans.size(), 1u);
+
+  // After the reset the client holds every input slot, including the lent
+  // one. The stale loan must not free it behind the client's back.
+  ASSERT_EQ(codec->Stop(), OK);
+  ASSERT_EQ(codec->Reset(), OK);
+  ASSERT_EQ(codec->Start(), OK);
+  std::vector<size_t> inputs;
+  codec->DequeueInputBuffers(inputs, 64, 0);
+  ASSERT_FALSE(inputs.empty());
+  loans.clear();
+  codec->Flush();
+  EXPECT_EQ(codec->DequeueInputBuffer(0), -1);
+  codec->Stop();
+  codec->Release();
+}
+
+TEST(SimpleCodecTest, LentInputIsNotReused) {
+  auto codec = std::make_shared<LendingCodec>();
+  ASSERT_EQ(codec->Configure(CreateTestConfig()), OK);
+  ASSERT_EQ(codec->Start(), OK);
+
+  const ssize_t input_idx = codec->DequeueInputBuffer(0);
+  ASSERT_GE(input_idx, 0);
+  ASSERT_EQ(codec->QueueInputBuffer(static_cast<size_t>(input_idx)), OK);
+  ASSERT_GE(codec->DequeueOutputBuffer(500), 0);
+  auto loans = codec->TakeLoans();
+  ASSERT_EQ(loans.size(), 1u);
+  CodecBuffer* lent = loans[0]->buffer();
+
+  // The slot comes back from the reset with other memory.
+  ASSERT_EQ(codec->Stop(), OK);
+  ASSERT_EQ(codec->Reset(), OK);
+  std::shared_ptr<CodecBuffer> input;
+  codec->GetInputBuffer(static_cast<size_t>(input_idx), input);
+  ASSERT_NE(input, nullptr);
+  EXPECT_NE(input.get(), lent);
+
+  // Released buffers go back to the shared pool, the lent one does not.
+  auto pool = CodecBufferPool::GetShared(input->capacity());
+  input.reset();
+  codec->Release();
+  std::vector<std::shared_ptr<CodecBuffer>> pooled;
+  while (pool->free_count() > 0) {
+    pooled.push_back(pool->Acquire());
+    EXPECT_NE(pooled.back().get(), lent);
+  }
+  EXPECT_FALSE(pooled.empty());
+}
+
+// With more decoder threads than input slots, lending every input would
+// leave the client without a slot before the first frame.
+TEST(SimpleCodecTest, ThreadsHoldingLoansStillGetInput) {
+  for (size_t threads : {2u, 16u}) {
+    SCOPED_TRACE(threads);
+    auto codec = std::make_shared<FrameThreadCodec>(threads);
+    ASSERT_EQ(codec->Configure(CreateTestConfig()), OK);
+    ASSERT_EQ(codec->Start(), OK);
+
+    const size_t kInputs = 40;
+    size_t outputs = 0;
+    for (size_t i = 0; i < kInputs; ++i) {
+      const ssize_t input_idx = codec->DequeueInputBuffer(500);
+      ASSERT_GE(input_idx, 0) << "input " << i;
+      ASSERT_EQ(codec->QueueInputBuffer(static_cast<size_t>(input_idx)), OK);
+      const bool expected = i + 1 >= threads;
+      const ssize_t output_idx = codec->DequeueOutputBuffer(expected ? 500 : 0);
+      EXPECT_EQ(output_idx >= 0, expected) << "input " << i;
+      if (output_idx >= 0) {
+        ++outputs;
+        codec->ReleaseOutputBuffer(static_cast<size_t>(output_idx), false);
+      }
+    }
+    EXPECT_EQ(outputs, kInputs - threads + 1);
+    // Few threads still get their packets lent.
+    if (threads == 2) {
+      EXPECT_GT(codec->loan_count(), 0u);
+    }
+    codec->Stop();
+    codec->Release();
+  }
+}
+
+TEST(SimpleCodecTest, LoanOutlivesCodec) {
+  auto codec = std::make_shared<LendingCodec>();
+  ASSERT_EQ(codec->Configure(CreateTestConfig()), OK);
+  ASSERT_EQ(codec->Start(), OK);
+
+  const ssize_t input_idx = codec->DequeueInputBuffer(0);
+  ASSERT_GE(input_idx, 0);
+  std::shared_ptr<CodecBuffer> input;
+  codec->GetInputBuffer(static_cast<size_t>(input_idx), input);
+  input->data()[0] = 0x42;
+  input->SetRange(0, 1);
+  input.reset();
+  ASSERT_EQ(codec->QueueInputBuffer(static_cast<size_t>(input_idx)), OK);
+  ASSERT_GE(codec->DequeueOutputBuffer(500), 0);
+  auto loans = codec->TakeLoans();
+  ASSERT_EQ(loans.size(), 1u);
+
+  codec->Stop();
+  codec->Release();
+  codec.reset();
+  // The lent memory is still there, and dropping the loan is harmless.
+  EXPECT_EQ(loans[0]->buffer()->data()[0], 0x42);
+  loans.clear();
+}
+
+}  // namespace media
+}  // namespace ave
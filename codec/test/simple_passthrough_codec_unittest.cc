@@ -8,9 +8,12 @@
 #include "media/codec/simple_passthrough_codec.h"
 
 #include <atomic>
+#include <condition_variable>
 #include <cstring>
 #include <memory>
+#include <mutex>
 #include <thread>
+#include <vector>
 
 #include "media/codec/codec.h"
 #include "media/foundation/media_meta.h"
@@ -56,6 +59,61 @@ class TestCallback : public CodecCallback {
   std::atomic<status_t> last_error_{OK};
 };
 
+/**
+ * @brief Drives the codec from its callbacks only, as an async-mode client.
+ */
+class AsyncPipelineCallback : public CodecCallback {
+ public:
+  AsyncPipelineCallback(Codec* codec, int frames)
+      : codec_(codec), frames_(frames) {}
+
+  void OnInputBufferAvailable(size_t index) override {
+    if (queued_ == frames_) {
+      return;
+    }
+    std::shared_ptr<CodecBuffer> buffer;
+    codec_->GetInputBuffer(index, buffer);
+    buffer->data()[0] = static_cast<uint8_t>(queued_);
+    buffer->SetRange(0, 1);
+    ++queued_;
+    codec_->QueueInputBuffer(index);
+  }
+  void OnOutputBufferAvailable(size_t index) override {
+    std::shared_ptr<CodecBuffer> buffer;
+    codec_->GetOutputBuffer(index, buffer);
+    if (buffer->size() != 1 ||
+        buffer->data()[0] != static_cast<uint8_t>(received_)) {
+      ++mismatches_;
+    }
+    codec_->ReleaseOutputBuffer(index, false);
+    if (++received_ == frames_) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      done_ = true;
+      cv_.notify_all();
+    }
+  }
+  void OnOutputFormatChanged(
+      const std::shared_ptr<MediaMeta>& format) override {}
+  void OnError(status_t error) override { ++mismatches_; }
+  void OnFrameRendered(std::shared_ptr<Message> notify) override {}
+
+  bool WaitDone(int64_t timeout_ms) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return cv_.wait_for(lock, std::chrono::milliseconds(timeout_ms),
+                        [this]() { return done_; });
+  }
+
+  Codec* codec_;
+  const int frames_;
+  // only touched on the codec thread
+  int queued_ = 0;
+  int received_ = 0;
+  std::atomic<int> mismatches_{0};
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  bool done_ = false;
+};
+
 std::shared_ptr<CodecConfig> CreateTestConfig() {
   auto config = std::make_shared<CodecConfig>();
   config->format =
@@ -339,5 +397,130 @@ TEST_F(SimplePassthroughCodecTest, EmptyBufferPassthrough) {
   codec_->Stop();
 }
 
+TEST_F(SimplePassthroughCodecTest, AsyncModePipelinesThroughCallbacks) {
+  // More frames than buffers, so slots are recycled through the callbacks.
+  constexpr int kFrames = 100;
+  auto config = CreateTestConfig();
+  config->async_mode = true;
+  AsyncPipelineCallback callback(codec_.get(), kFrames);
+  EXPECT_EQ(codec_->Configure(config), OK);
+  EXPECT_EQ(codec_->SetCallback(&callback), OK);
+  EXPECT_EQ(codec_->Start(), OK);
+
+  ASSERT_TRUE(callback.WaitDone(5000));
+  EXPECT_EQ(callback.received_, kFrames);
+  EXPECT_EQ(callback.mismatches_, 0);
+  EXPECT_EQ(codec_->DequeueInputBuffer(0), -1);
+  EXPECT_EQ(codec_->DequeueOutputBuffer(0), -1);
+  codec_->Stop();
+}
+
+TEST_F(SimplePassthroughCodecTest, InputWaitsWhileClientHoldsAllOutput) {
+  auto config = CreateTestConfig();
+  EXPECT_EQ(codec_->Configure(config), OK);
+  EXPECT_EQ(codec_->Start(), OK);
+
+  // Feed one frame at a time and hold every output until the codec runs
+  // out of output buffers and answers the next input with E_AGAIN.
+  constexpr int kMaxFrames = 64;
+  std::vector<size_t> held;
+  int stalled = -1;
+  for (int i = 0; i < kMaxFrames && stalled < 0; ++i) {
+    ssize_t input_idx = codec_->DequeueInputBuffer(200);
+    ASSERT_GE(input_idx, 0) << "frame " << i;
+    std::shared_ptr<CodecBuffer> input;
+    codec_->GetInputBuffer(static_cast<size_t>(input_idx), input);
+    input->data()[0] = static_cast<uint8_t>(i);
+    input->SetRange(0, 1);
+    ASSERT_EQ(codec_->QueueInputBuffer(static_cast<size_t>(input_idx)), OK);
+
+    ssize_t output_idx = codec_->DequeueOutputBuffer(200);
+    if (output_idx < 0) {
+      stalled = i;
+      break;
+    }
+    std::shared_ptr<CodecBuffer> output;
+    codec_->GetOutputBuffer(static_cast<size_t>(output_idx), output);
+    ASSERT_EQ(output->size(), 1u);
+    EXPECT_EQ(output->data()[0], static_cast<uint8_t>(i));
+    held.push_back(static_cast<size_t>(output_idx));
+  }
+  ASSERT_GT(stalled, 0);
+  ASSERT_EQ(held.size(), static_cast<size_t>(stalled));
+
+  // Releasing one output lets the waiting input through, exactly once.
+  EXPECT_EQ(codec_->ReleaseOutputBuffer(held.front(), false), OK);
+  held.erase(held.begin());
+  ssize_t output_idx = codec_->DequeueOutputBuffer(500);
+  ASSERT_GE(output_idx, 0);
+  std::shared_ptr<CodecBuffer> output;
+  codec_->GetOutputBuffer(static_cast<size_t>(output_idx), output);
+  ASSERT_EQ(output->size(), 1u);
+  EXPECT_EQ(output->data()[0], static_cast<uint8_t>(stalled));
+  held.push_back(static_cast<size_t>(output_idx));
+
+  EXPECT_EQ(codec_->ReleaseOutputBuffers(held, false), OK);
+  EXPECT_EQ(codec_->DequeueOutputBuffer(100), -1);
+  codec_->Stop();
+}
+
+TEST_F(SimplePassthroughCodecTest, BatchedQueueAndDequeue) {
+  constexpr size_t kBatch = 4;
+  auto config = CreateTestConfig();
+  EXPECT_EQ(codec_->Configure(config), OK);
+  EXPECT_EQ(codec_->Start(), OK);
+
+  std::vector<size_t> inputs;
+  ASSERT_EQ(codec_->DequeueInputBuffers(inputs, kBatch, 100), kBatch);
+  ASSERT_EQ(inputs.size(), kBatch);
+  for (size_t i = 0; i < kBatch; ++i) {
+    std::shared_ptr<CodecBuffer> buffer;
+    codec_->GetInputBuffer(inputs[i], buffer);
+    buffer->data()[0] = static_cast<uint8_t>(0xa0 + i);
+    buffer->SetRange(0, 1);
+  }
+
+  // One bad index rejects the whole batch.
+  std::vector<size_t> bad = inputs;
+  bad.push_back(9999);
+  EXPECT_EQ(codec_->QueueInputBuffers(bad), INVALID_OPERATION);
+  EXPECT_EQ(codec_->QueueInputBuffers(inputs), OK);
+
+  std::vector<size_t> outputs;
+  while (outputs.size() < kBatch) {
+    ASSERT_GT(codec_->DequeueOutputBuffers(outputs, kBatch, 500), 0u);
+  }
+  ASSERT_EQ(outputs.size(), kBatch);
+  for (size_t i = 0; i < kBatch; ++i) {
+    std::shared_ptr<CodecBuffer> buffer;
+    codec_->GetOutputBuffer(outputs[i], buffer);
+    ASSERT_EQ(buffer->size(), 1u);
+    EXPECT_EQ(buffer->data()[0], 0xa0 + i);
+  }
+
+  EXPECT_EQ(codec_->ReleaseOutputBuffers(outputs, false), OK);
+  EXPECT_EQ(codec_->ReleaseOutputBuffers(outputs, false), INVALID_OPERATION);
+  codec_->Stop();
+}
+
+TEST_F(SimplePassthroughCodecTest, BuffersSizedFromFormat) {
+  auto config = std::make_shared<CodecConfig>();
+  config->format =
+      MediaMeta::CreatePtr(MediaType::VIDEO, MediaMeta::FormatType::kTrack);
+  config->format->SetWidth(320);
+  config->format->SetHeight(240);
+  EXPECT_EQ(codec_->Configure(config), OK);
+
+  std::shared_ptr<CodecBuffer> input;
+  std::shared_ptr<CodecBuffer> output;
+  ASSERT_EQ(codec_->GetInputBuffer(0, input), OK);
+  ASSERT_EQ(codec_->GetOutputBuffer(0, output), OK);
+  // One compressed and one yuv420p picture, not the 10 MB default.
+  EXPECT_GE(input->capacity(), 320u * 240 * 3 / 4);
+  EXPECT_LT(input->capacity(), 320u * 240);
+  EXPECT_GE(output->capacity(), 320u * 240 * 3 / 2);
+  EXPECT_LT(output->capacity(), 320u * 240 * 2);
+}
+
 }  // namespace media
 }  // namespace ave
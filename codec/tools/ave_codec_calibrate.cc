@@ -0,0 +1,341 @@
+/*
+ * ave_codec_calibrate.cc
+ * Copyright (C) 2025 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+// One-time calibration run for the codec registry: decodes an H.264 and
+// optionally an HEVC Annex-B clip with every decoder the codec factories
+// list for them, single threaded and with a thread per core, and stores the
+// best luma sample rate each reached in the registry file. Processes that
+// point CodecRegistry::SetPath() at it load it when registering factories,
+// and CreateCodecByType() picks codecs from it.
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "base/errors.h"
+#include "base/logging.h"
+#include "media/codec/codec.h"
+#include "media/codec/codec_factory.h"
+#include "media/codec/codec_id.h"
+#include "media/codec/codec_registry.h"
+#include "media/codec/default_codec_factory.h"
+#include "media/foundation/framing_queue.h"
+#include "media/foundation/media_meta.h"
+
+using namespace ave;
+using namespace ave::media;
+
+namespace {
+
+// How long the decoder may stay silent after EOS before the run is over.
+constexpr int64_t kDrainTimeoutMs = 200;
+
+struct CalibrateOptions {
+  std::string cache_path = CodecRegistry::kCalibrationPath;
+  std::string h264_path = "codec/tools/bun33s.h264";
+  std::string hevc_path;
+  std::vector<int> thread_counts = {1, 0};
+};
+
+// Hands the input buffers the codec releases to the feeding loop.
+class InputCallback : public CodecCallback {
+ public:
+  void OnInputBufferAvailable(size_t index) override {
+    std::scoped_lock lock(lock_);
+    free_inputs_.push_back(index);
+    cv_.notify_one();
+  }
+
+  void OnOutputBufferAvailable(size_t /* index */) override {}
+
+  void OnOutputFormatChanged(
+      const std::shared_ptr<MediaMeta>& /* format */) override {}
+
+  void OnError(status_t error) override {
+    std::scoped_lock lock(lock_);
+    error_ = error;
+    cv_.notify_one();
+  }
+
+  void OnFrameRendered(std::shared_ptr<Message> /* notify */) override {}
+
+  ssize_t TakeInput() {
+    std::scoped_lock lock(lock_);
+    if (free_inputs_.empty()) {
+      return -1;
+    }
+    const size_t index = free_inputs_.front();
+    free_inputs_.pop_front();
+    return static_cast<ssize_t>(index);
+  }
+
+  status_t error() {
+    std::scoped_lock lock(lock_);
+    return error_;
+  }
+
+ private:
+  std::mutex lock_;
+  std::condition_variable cv_;
+  std::deque<size_t> free_inputs_;
+  status_t error_ = OK;
+};
+
+std::vector<uint8_t> ReadFile(const std::string& path) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    AVE_LOG(LS_ERROR) << "Failed to open " << path;
+    return {};
+  }
+  return std::vector<uint8_t>((std::istreambuf_iterator<char>(file)),
+                              std::istreambuf_iterator<char>());
+}
+
+std::vector<std::vector<uint8_t>> ReadH264AccessUnits(const std::string& path) {
+  const auto data = ReadFile(path);
+  FramingQueue framing_queue(FramingQueue::CodecType::kH264);
+  framing_queue.PushData(data.data(), data.size());
+  framing_queue.Flush();
+  std::vector<std::vector<uint8_t>> access_units;
+  while (framing_queue.HasFrame()) {
+    auto frame = framing_queue.PopFrame();
+    access_units.emplace_back(frame->data(), frame->data() + frame->size());
+  }
+  return access_units;
+}
+
+// FramingQueue has no HEVC mode: a new access unit starts at an AUD, a
+// parameter set, a prefix SEI or a slice with first_slice_segment_in_pic_flag
+// once the current one has a slice.
+std::vector<std::vector<uint8_t>> ReadHevcAccessUnits(const std::string& path) {
+  const auto data = ReadFile(path);
+  std::vector<size_t> starts;
+  for (size_t i = 0; i + 3 < data.size(); ++i) {
+    if (data[i] == 0 && data[i + 1] == 0 && data[i + 2] == 1) {
+      starts.push_back(i > 0 && data[i - 1] == 0 ? i - 1 : i);
+      i += 2;
+    }
+  }
+
+  std::vector<std::vector<uint8_t>> access_units;
+  size_t au_start = starts.empty() ? data.size() : starts[0];
+  bool has_slice = false;
+  for (size_t n = 0; n < starts.size(); ++n) {
+    size_t header = starts[n] + (data[starts[n] + 2] == 1 ? 3 : 4);
+    if (header + 2 >= data.size()) {
+      break;
+    }
+    const int type = (data[header] >> 1) & 0x3f;
+    const bool is_slice = type <= 31;
+    const bool first_slice = is_slice && (data[header + 2] & 0x80) != 0;
+    const bool starts_au =
+        type == 35 || (type >= 32 && type <= 34) || type == 39 || first_slice;
+    if (starts_au && has_slice) {
+      access_units.emplace_back(data.begin() + au_start,
+                                data.begin() + starts[n]);
+      au_start = starts[n];
+      has_slice = false;
+    }
+    has_slice = has_slice || is_slice;
+  }
+  if (au_start < data.size()) {
+    access_units.emplace_back(data.begin() + au_start, data.end());
+  }
+  return access_units;
+}
+
+bool QueueAccessUnit(Codec* codec,
+                     size_t index,
+                     const std::vector<uint8_t>* access_unit,
+                     int64_t pts_us) {
+  std::shared_ptr<CodecBuffer> buffer;
+  if (codec->GetInputBuffer(index, buffer) != OK || !buffer) {
+    return false;
+  }
+  const size_t size = access_unit ? access_unit->size() : 0;
+  if (size > 0) {
+    buffer->EnsureCapacity(size, false);
+    std::memcpy(buffer->data(), access_unit->data(), size);
+  }
+  buffer->SetRange(0, size);
+  auto meta = MediaMeta::CreatePtr();
+  meta->SetPts(base::Timestamp::Micros(pts_us));
+  buffer->format() = meta;
+  return codec->QueueInputBuffer(index) == OK;
+}
+
+// Luma samples per second |info| decodes |aus| with, 0 if it failed.
+int64_t MeasurePixelRate(CodecFactory& factory,
+                         const CodecInfo& info,
+                         const std::vector<std::vector<uint8_t>>& aus,
+                         int thread_count) {
+  auto codec = factory.CreateCodecByInfo(info);
+  if (!codec) {
+    return 0;
+  }
+
+  auto format = std::make_shared<MediaMeta>();
+  format->SetCodec(info.codec_id);
+  format->SetStreamType(MediaType::VIDEO);
+  auto config = std::make_shared<CodecConfig>();
+  config->format = format;
+  config->thread_count = thread_count;
+
+  InputCallback callback;
+  status_t err = codec->Configure(config);
+  if (err == OK) {
+    err = codec->SetCallback(&callback);
+  }
+  const auto start = std::chrono::steady_clock::now();
+  auto last_output = start;
+  if (err == OK) {
+    err = codec->Start();
+  }
+
+  size_t next = 0;
+  bool eos_sent = false;
+  int64_t pixels = 0;
+  while (err == OK) {
+    while (!eos_sent) {
+      const ssize_t index = callback.TakeInput();
+      if (index < 0) {
+        break;
+      }
+      const bool eos = next == aus.size();
+      const int64_t pts_us = static_cast<int64_t>(next) * 1000000 / 30;
+      if (!QueueAccessUnit(codec.get(), index, eos ? nullptr : &aus[next],
+                           pts_us)) {
+        err = UNKNOWN_ERROR;
+        break;
+      }
+      eos_sent = eos;
+      ++next;
+    }
+
+    const ssize_t output =
+        codec->DequeueOutputBuffer(eos_sent ? kDrainTimeoutMs : 10);
+    if (output >= 0) {
+      std::shared_ptr<CodecBuffer> buffer;
+      if (codec->GetOutputBuffer(output, buffer) == OK && buffer &&
+          buffer->size() > 0 && buffer->format()) {
+        pixels += static_cast<int64_t>(buffer->format()->width()) *
+                  buffer->format()->height();
+        last_output = std::chrono::steady_clock::now();
+      }
+      codec->ReleaseOutputBuffer(output, false);
+    } else if (eos_sent) {
+      break;
+    }
+
+    if (callback.error() != OK) {
+      err = callback.error();
+    }
+  }
+
+  codec->Stop();
+  codec->Release();
+  const double elapsed_s =
+      std::chrono::duration<double>(last_output - start).count();
+  if (err != OK || elapsed_s <= 0) {
+    return 0;
+  }
+  return static_cast<int64_t>(static_cast<double>(pixels) / elapsed_s);
+}
+
+void Calibrate(CodecFactory& factory,
+               CodecId codec_id,
+               const std::vector<std::vector<uint8_t>>& aus,
+               const std::vector<int>& thread_counts) {
+  for (auto info : GetCodecRegistry().GetCodecs(factory)) {
+    if (info.codec_id != codec_id || info.is_encoder) {
+      continue;
+    }
+    info.max_pixel_rate = 0;
+    info.thread_count = 0;
+    for (const int thread_count : thread_counts) {
+      const int64_t rate = MeasurePixelRate(factory, info, aus, thread_count);
+      std::printf("%-24s %8d %14lld\n", info.name.c_str(), thread_count,
+                  static_cast<long long>(rate));
+      if (rate > info.max_pixel_rate) {
+        info.max_pixel_rate = rate;
+        info.thread_count = thread_count;
+      }
+    }
+    GetCodecRegistry().UpdateCodec(factory.name(), info);
+  }
+}
+
+void PrintUsage(const char* program_name) {
+  std::cout << "Usage: " << program_name << " [options]\n";
+  std::cout << "\nOptions:\n";
+  std::cout << "  --cache <file>      Registry file to update "
+               "(default ave_codec_registry.txt)\n";
+  std::cout << "  --h264 <file>       H.264 Annex-B clip "
+               "(default codec/tools/bun33s.h264)\n";
+  std::cout << "  --hevc <file>       HEVC Annex-B clip, skipped if not "
+               "given\n";
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  CalibrateOptions options;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    if (arg == "--help" || arg == "-h") {
+      PrintUsage(argv[0]);
+      return 0;
+    }
+    if (i + 1 >= argc) {
+      PrintUsage(argv[0]);
+      return 1;
+    }
+    if (arg == "--cache") {
+      options.cache_path = argv[++i];
+    } else if (arg == "--h264") {
+      options.h264_path = argv[++i];
+    } else if (arg == "--hevc") {
+      options.hevc_path = argv[++i];
+    } else {
+      PrintUsage(argv[0]);
+      return 1;
+    }
+  }
+
+  // Keeps what earlier runs measured for other codecs.
+  GetCodecRegistry().Load(options.cache_path);
+  auto factory = std::make_shared<DefaultCodecFactory>();
+
+  std::printf("%-24s %8s %14s\n", "decoder", "threads", "pixels/s");
+  const auto h264 = ReadH264AccessUnits(options.h264_path);
+  if (!h264.empty()) {
+    Calibrate(*factory, CodecId::AVE_CODEC_ID_H264, h264,
+              options.thread_counts);
+  }
+  if (!options.hevc_path.empty()) {
+    const auto hevc = ReadHevcAccessUnits(options.hevc_path);
+    if (!hevc.empty()) {
+      Calibrate(*factory, CodecId::AVE_CODEC_ID_HEVC, hevc,
+                options.thread_counts);
+    }
+  }
+
+  if (GetCodecRegistry().Save(options.cache_path) != OK) {
+    return 1;
+  }
+  std::printf("Saved to %s\n", options.cache_path.c_str());
+  return 0;
+}
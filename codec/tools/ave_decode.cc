@@ -68,7 +68,7 @@ void PrintUsage(const char* program_name) {
          "[options]\n";
   std::cout << "\nCodec types:\n";
   std::cout << "  Audio: aac, opus, mp3\n";
-  std::cout << "  Video: h264, h265, vp8, vp9\n";
+  std::cout << "  Video: h264, h265, vp8, vp9, av1 (av1: low-overhead .obu)\n";
   std::cout << "\nOptions:\n";
   std::cout << "  --passthrough       Use SimplePassthroughCodec (no actual "
                "decoding)\n";
@@ -116,6 +116,9 @@ CodecId GetCodecIdFromType(const std::string& type) {
   if (type == "vp9") {
     return CodecId::AVE_CODEC_ID_VP9;
   }
+  if (type == "av1") {
+    return CodecId::AVE_CODEC_ID_AV1;
+  }
   return CodecId::AVE_CODEC_ID_NONE;
 }
 
@@ -132,6 +135,10 @@ FramingQueue::CodecType GetFramingCodecType(const std::string& type) {
   if (type == "h264" || type == "avc") {
     return FramingQueue::CodecType::kH264;
   }
+
+  if (type == "av1") {
+    return FramingQueue::CodecType::kAV1;
+  }
   // Default to H264 for other video codecs (might need adjustment)
   return FramingQueue::CodecType::kH264;
 }
@@ -221,7 +228,17 @@ int main(int argc, char** argv) {
     AVE_LOG(LS_INFO) << "Decoding " << input_file << " to " << output_file
                      << " using codec: " << codec_type;
 
-    codec = CreateCodecByType(codec_id, false);
+    // What the command line tells about the stream, for picking a decoder
+    // that keeps up with it.
+    MediaMeta hints(IsAudioCodec(codec_id) ? MediaType::AUDIO
+                                           : MediaType::VIDEO,
+                    MediaMeta::FormatType::kTrack);
+    hints.SetCodec(codec_id);
+    if (width > 0 && height > 0) {
+      hints.SetWidth(width);
+      hints.SetHeight(height);
+    }
+    codec = CreateCodecByType(codec_id, false, hints);
     if (!codec) {
       AVE_LOG(LS_ERROR) << "Failed to create decoder for codec: " << codec_type;
       return 1;
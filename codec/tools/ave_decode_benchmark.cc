@@ -0,0 +1,320 @@
+/*
+ * ave_decode_benchmark.cc
+ * Copyright (C) 2025 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+// Decodes an H.264 Annex-B stream (the bundled bun33s.h264 by default) once
+// per decoder thread count and reports decoded frames per second and the
+// speedup over a single thread, optionally with zero copy output.
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "base/errors.h"
+#include "base/logging.h"
+#include "media/codec/codec.h"
+#include "media/codec/codec_factory.h"
+#include "media/codec/codec_id.h"
+#include "media/codec/default_codec_factory.h"
+#include "media/foundation/framing_queue.h"
+#include "media/foundation/media_meta.h"
+
+using namespace ave;
+using namespace ave::media;
+
+namespace {
+
+// How long the decoder may stay silent after EOS before the run is over.
+constexpr int64_t kDrainTimeoutMs = 200;
+
+struct BenchmarkOptions {
+  std::string h264_path = "codec/tools/bun33s.h264";
+  std::vector<int> thread_counts = {1, 2, 4, 8};
+  size_t max_frames = 0;
+  bool zero_copy = false;
+};
+
+struct DecodeResult {
+  size_t frames = 0;
+  double elapsed_s = 0;
+};
+
+// Hands the input buffers the codec releases to the feeding loop.
+class InputCallback : public CodecCallback {
+ public:
+  void OnInputBufferAvailable(size_t index) override {
+    std::scoped_lock lock(lock_);
+    free_inputs_.push_back(index);
+    cv_.notify_one();
+  }
+
+  void OnOutputBufferAvailable(size_t /* index */) override {}
+
+  void OnOutputFormatChanged(
+      const std::shared_ptr<MediaMeta>& /* format */) override {}
+
+  void OnError(status_t error) override {
+    std::scoped_lock lock(lock_);
+    error_ = error;
+    cv_.notify_one();
+  }
+
+  void OnFrameRendered(std::shared_ptr<Message> /* notify */) override {}
+
+  // Returns -1 if no input buffer was released in time.
+  ssize_t TakeInput(int64_t timeout_ms) {
+    std::unique_lock<std::mutex> lock(lock_);
+    cv_.wait_for(lock, std::chrono::milliseconds(timeout_ms),
+                 [this]() { return !free_inputs_.empty() || error_ != OK; });
+    if (free_inputs_.empty()) {
+      return -1;
+    }
+    const size_t index = free_inputs_.front();
+    free_inputs_.pop_front();
+    return static_cast<ssize_t>(index);
+  }
+
+  status_t error() {
+    std::scoped_lock lock(lock_);
+    return error_;
+  }
+
+ private:
+  std::mutex lock_;
+  std::condition_variable cv_;
+  std::deque<size_t> free_inputs_;
+  status_t error_ = OK;
+};
+
+std::vector<std::shared_ptr<MediaFrame>> ReadAccessUnits(
+    const std::string& path) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    AVE_LOG(LS_ERROR) << "Failed to open " << path;
+    return {};
+  }
+  const std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)),
+                                  std::istreambuf_iterator<char>());
+
+  FramingQueue framing_queue(FramingQueue::CodecType::kH264);
+  framing_queue.PushData(data.data(), data.size());
+  framing_queue.Flush();
+  std::vector<std::shared_ptr<MediaFrame>> access_units;
+  while (framing_queue.HasFrame()) {
+    access_units.push_back(framing_queue.PopFrame());
+  }
+  return access_units;
+}
+
+bool QueueAccessUnit(Codec* codec,
+                     size_t index,
+                     const std::shared_ptr<MediaFrame>& access_unit,
+                     int64_t pts_us) {
+  std::shared_ptr<CodecBuffer> buffer;
+  if (codec->GetInputBuffer(index, buffer) != OK || !buffer) {
+    return false;
+  }
+  const size_t size = access_unit ? access_unit->size() : 0;
+  if (size > 0) {
+    buffer->EnsureCapacity(size, false);
+    std::memcpy(buffer->data(), access_unit->data(), size);
+  }
+  buffer->SetRange(0, size);
+  auto meta = MediaMeta::CreatePtr();
+  meta->SetPts(base::Timestamp::Micros(pts_us));
+  buffer->format() = meta;
+  return codec->QueueInputBuffer(index) == OK;
+}
+
+// Feeds every access unit plus EOS and drains the decoder, timing from the
+// first queued input to the last decoded frame.
+status_t DecodeOnce(const std::vector<std::shared_ptr<MediaFrame>>& aus,
+                    int thread_count,
+                    bool zero_copy,
+                    DecodeResult* result) {
+  auto codec = CreateCodecByType(CodecId::AVE_CODEC_ID_H264, false);
+  if (!codec) {
+    AVE_LOG(LS_ERROR) << "No H.264 decoder";
+    return UNKNOWN_ERROR;
+  }
+
+  auto format = std::make_shared<MediaMeta>();
+  format->SetCodec(CodecId::AVE_CODEC_ID_H264);
+  format->SetStreamType(MediaType::VIDEO);
+  auto config = std::make_shared<CodecConfig>();
+  config->format = format;
+  config->thread_count = thread_count;
+  config->zero_copy_output = zero_copy;
+
+  InputCallback callback;
+  status_t err = codec->Configure(config);
+  if (err == OK) {
+    err = codec->SetCallback(&callback);
+  }
+  const auto start = std::chrono::steady_clock::now();
+  auto last_output = start;
+  if (err == OK) {
+    err = codec->Start();
+  }
+
+  size_t next = 0;
+  bool eos_sent = false;
+  size_t frames = 0;
+  while (err == OK) {
+    // Feed as much as the codec takes; it keeps what it cannot decode yet.
+    while (!eos_sent) {
+      const ssize_t index = callback.TakeInput(0);
+      if (index < 0) {
+        break;
+      }
+      const bool eos = next == aus.size();
+      const int64_t pts_us = static_cast<int64_t>(next) * 1000000 / 30;
+      if (!QueueAccessUnit(codec.get(), index, eos ? nullptr : aus[next],
+                           pts_us)) {
+        err = UNKNOWN_ERROR;
+        break;
+      }
+      eos_sent = eos;
+      ++next;
+    }
+
+    const ssize_t output = codec->DequeueOutputBuffer(
+        eos_sent ? kDrainTimeoutMs : 10);
+    if (output >= 0) {
+      std::shared_ptr<CodecBuffer> buffer;
+      if (codec->GetOutputBuffer(output, buffer) == OK && buffer &&
+          buffer->size() > 0) {
+        ++frames;
+        last_output = std::chrono::steady_clock::now();
+      }
+      codec->ReleaseOutputBuffer(output, false);
+    } else if (eos_sent) {
+      break;
+    }
+
+    if (callback.error() != OK) {
+      err = callback.error();
+    }
+  }
+
+  codec->Stop();
+  codec->Release();
+  if (err != OK) {
+    return err;
+  }
+
+  result->frames = frames;
+  result->elapsed_s =
+      std::chrono::duration<double>(last_output - start).count();
+  return OK;
+}
+
+std::vector<int> ParseThreadCounts(const std::string& list) {
+  std::vector<int> counts;
+  std::stringstream stream(list);
+  std::string item;
+  while (std::getline(stream, item, ',')) {
+    if (!item.empty()) {
+      counts.push_back(std::max(std::atoi(item.c_str()), 0));
+    }
+  }
+  return counts;
+}
+
+void PrintUsage(const char* program_name) {
+  std::cout << "Usage: " << program_name << " [options]\n";
+  std::cout << "\nOptions:\n";
+  std::cout << "  --h264 <file>       H.264 Annex-B input "
+               "(default codec/tools/bun33s.h264)\n";
+  std::cout << "  --threads <list>    Comma separated decoder thread counts, "
+               "0 = auto (default 1,2,4,8)\n";
+  std::cout << "  --frames <n>        Only decode the first <n> access "
+               "units\n";
+  std::cout << "  --zero_copy         Lend decoded frames instead of copying "
+               "them\n";
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  BenchmarkOptions options;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    if (arg == "--help" || arg == "-h") {
+      PrintUsage(argv[0]);
+      return 0;
+    }
+    if (arg == "--zero_copy") {
+      options.zero_copy = true;
+      continue;
+    }
+    if (i + 1 >= argc) {
+      PrintUsage(argv[0]);
+      return 1;
+    }
+    if (arg == "--h264") {
+      options.h264_path = argv[++i];
+    } else if (arg == "--threads") {
+      options.thread_counts = ParseThreadCounts(argv[++i]);
+    } else if (arg == "--frames") {
+      options.max_frames = std::strtoul(argv[++i], nullptr, 10);
+    } else {
+      PrintUsage(argv[0]);
+      return 1;
+    }
+  }
+
+  std::vector<std::shared_ptr<MediaFrame>> aus =
+      ReadAccessUnits(options.h264_path);
+  if (options.max_frames > 0 && aus.size() > options.max_frames) {
+    aus.resize(options.max_frames);
+  }
+  if (aus.empty() || options.thread_counts.empty()) {
+    PrintUsage(argv[0]);
+    return 1;
+  }
+
+  RegisterCodecFactory(std::make_shared<DefaultCodecFactory>());
+
+  std::printf("%zu access units from %s\n", aus.size(),
+              options.h264_path.c_str());
+  std::printf("%8s %8s %10s %8s\n", "threads", "frames", "fps", "speedup");
+  double single_thread_fps = 0;
+  for (const int thread_count : options.thread_counts) {
+    DecodeResult result;
+    const status_t err =
+        DecodeOnce(aus, thread_count, options.zero_copy, &result);
+    if (err != OK) {
+      AVE_LOG(LS_ERROR) << "Decoding with " << thread_count
+                        << " threads failed: " << err;
+      return 1;
+    }
+    const double fps =
+        result.elapsed_s > 0 ? result.frames / result.elapsed_s : 0;
+    if (thread_count == 1) {
+      single_thread_fps = fps;
+    }
+    std::printf("%8d %8zu %10.1f", thread_count, result.frames, fps);
+    if (single_thread_fps > 0) {
+      std::printf(" %7.2fx\n", fps / single_thread_fps);
+    } else {
+      std::printf(" %8s\n", "-");
+    }
+  }
+  return 0;
+}
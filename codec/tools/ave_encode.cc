@@ -175,6 +175,29 @@ int main(int argc, char** argv) {
     return 1;
   }
 
+  // The format to configure with, known before the encoder is picked.
+  bool is_audio = IsAudioCodec(codec_id);
+  auto config = std::make_shared<CodecConfig>();
+  auto format =
+      MediaMeta::CreatePtr(is_audio ? MediaType::AUDIO : MediaType::VIDEO,
+                           MediaMeta::FormatType::kTrack);
+  if (is_audio) {
+    format->SetSampleRate(sample_rate);
+    if (channels == 1) {
+      format->SetChannelLayout(CHANNEL_LAYOUT_MONO);
+    } else {
+      format->SetChannelLayout(CHANNEL_LAYOUT_STEREO);
+    }
+    format->SetBitrate(bitrate > 0 ? bitrate : 128000);
+  } else {
+    format->SetWidth(width);
+    format->SetHeight(height);
+    format->SetFrameRate(fps);
+    format->SetBitrate(bitrate > 0 ? bitrate : 2000000);
+  }
+
+  config->format = format;
+
   // Create codec
   std::shared_ptr<Codec> codec;
 
@@ -192,7 +215,7 @@ int main(int argc, char** argv) {
     AVE_LOG(LS_INFO) << "Encoding " << input_file << " to " << output_file
                      << " using codec: " << codec_type;
 
-    codec = CreateCodecByType(codec_id, true);
+    codec = CreateCodecByType(codec_id, true, *format);
     if (!codec) {
       AVE_LOG(LS_ERROR) << "Failed to create encoder for codec: " << codec_type;
       return 1;
@@ -213,27 +236,6 @@ int main(int argc, char** argv) {
   }
 
   // Configure codec
-  bool is_audio = IsAudioCodec(codec_id);
-  auto config = std::make_shared<CodecConfig>();
-  auto format =
-      MediaMeta::CreatePtr(is_audio ? MediaType::AUDIO : MediaType::VIDEO,
-                           MediaMeta::FormatType::kTrack);
-  if (is_audio) {
-    format->SetSampleRate(sample_rate);
-    if (channels == 1) {
-      format->SetChannelLayout(CHANNEL_LAYOUT_MONO);
-    } else {
-      format->SetChannelLayout(CHANNEL_LAYOUT_STEREO);
-    }
-    format->SetBitrate(bitrate > 0 ? bitrate : 128000);
-  } else {
-    format->SetWidth(width);
-    format->SetHeight(height);
-    format->SetFrameRate(fps);
-    format->SetBitrate(bitrate > 0 ? bitrate : 2000000);
-  }
-
-  config->format = format;
   status_t result = codec->Configure(config);
   if (result != OK) {
     AVE_LOG(LS_ERROR) << "Failed to configure encoder: " << result;
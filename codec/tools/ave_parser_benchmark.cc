@@ -0,0 +1,882 @@
+/*
+ * ave_parser_benchmark.cc
+ * Copyright (C) 2025 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+// Microbenchmarks for the bitstream parsing hot paths: FramingQueue,
+// getNextNALUnit, H265BitstreamParser, the ADTS helpers, TSParser and the
+// H.264/H.265 RTP depacketizers. Runs over the bundled bun33s.h264/aac files
+// plus synthetic H.265, TS and RTP streams built from them, and reports
+// throughput, time per NAL unit and heap allocations per access unit.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/copy_on_write_buffer.h"
+#include "base/errors.h"
+#include "base/logging.h"
+#include "media/foundation/aac/aac_utils.h"
+#include "media/foundation/framing_queue.h"
+#include "media/foundation/h264/avc_utils.h"
+#include "media/foundation/h265/h265_bitstream_parser.h"
+#include "media/modules/mpeg2ts/ts_parser.h"
+#include "media/modules/rtp_rtcp/src/video/video_rtp_depacketizer_h264.h"
+#include "media/modules/rtp_rtcp/src/video/video_rtp_depacketizer_h265.h"
+
+using namespace ave;
+using namespace ave::media;
+
+namespace {
+
+// Counts every heap allocation made by the process so the benchmarks can
+// report allocations per access unit.
+std::atomic<uint64_t> g_allocations{0};
+
+}  // namespace
+
+void* operator new(size_t size) {
+  g_allocations.fetch_add(1, std::memory_order_relaxed);
+  if (void* p = std::malloc(size == 0 ? 1 : size)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+void* operator new[](size_t size) {
+  return operator new(size);
+}
+
+void operator delete(void* p) noexcept {
+  std::free(p);
+}
+
+void operator delete[](void* p) noexcept {
+  std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+  std::free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept {
+  std::free(p);
+}
+
+namespace {
+
+constexpr size_t kTSPacketSize = 188;
+constexpr size_t kRtpMaxPayloadSize = 1200;
+constexpr size_t kFeedChunkSize = 4096;
+
+// What one pass over the input processed.
+struct WorkCount {
+  size_t bytes = 0;
+  size_t nal_units = 0;
+  size_t access_units = 0;
+};
+
+struct BenchmarkOptions {
+  std::string h264_path = "codec/tools/bun33s.h264";
+  std::string aac_path = "codec/tools/bun33s.aac";
+  std::string filter;
+  double min_time_s = 0.5;
+};
+
+void RunBenchmark(const BenchmarkOptions& options,
+                  const std::string& name,
+                  const std::function<WorkCount()>& pass) {
+  if (!options.filter.empty() &&
+      name.find(options.filter) == std::string::npos) {
+    return;
+  }
+
+  // One untimed pass to warm caches and grow reusable buffers.
+  pass();
+
+  WorkCount total;
+  size_t iterations = 0;
+  const uint64_t allocations_before =
+      g_allocations.load(std::memory_order_relaxed);
+  const auto start = std::chrono::steady_clock::now();
+  double elapsed_s = 0;
+  do {
+    const WorkCount count = pass();
+    total.bytes += count.bytes;
+    total.nal_units += count.nal_units;
+    total.access_units += count.access_units;
+    ++iterations;
+    elapsed_s = std::chrono::duration<double>(
+                    std::chrono::steady_clock::now() - start)
+                    .count();
+  } while (elapsed_s < options.min_time_s);
+  const uint64_t allocations =
+      g_allocations.load(std::memory_order_relaxed) - allocations_before;
+
+  const double mb_per_s = total.bytes / elapsed_s / (1024.0 * 1024.0);
+  std::printf("%-36s %6zu iters %9.1f MB/s", name.c_str(), iterations,
+              mb_per_s);
+  // Audio has no NAL units.
+  if (total.nal_units > 0) {
+    std::printf(" %9.1f ns/NAL", elapsed_s * 1e9 / total.nal_units);
+  } else {
+    std::printf(" %16s", "-");
+  }
+  std::printf(" %8.2f allocs/AU\n",
+              total.access_units
+                  ? static_cast<double>(allocations) / total.access_units
+                  : 0.0);
+}
+
+std::vector<uint8_t> ReadFile(const std::string& path) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    AVE_LOG(LS_ERROR) << "Failed to open " << path;
+    return {};
+  }
+  return std::vector<uint8_t>(std::istreambuf_iterator<char>(file),
+                              std::istreambuf_iterator<char>());
+}
+
+// Splits an Annex-B stream into NAL units, without start codes.
+std::vector<std::span<const uint8_t>> SplitNalUnits(
+    std::span<const uint8_t> stream) {
+  std::vector<std::span<const uint8_t>> nals;
+  const uint8_t* data = stream.data();
+  size_t size = stream.size();
+  const uint8_t* nal_start = nullptr;
+  size_t nal_size = 0;
+  while (getNextNALUnit(&data, &size, &nal_start, &nal_size, true) == OK) {
+    if (nal_size > 0) {
+      nals.emplace_back(nal_start, nal_size);
+    }
+  }
+  return nals;
+}
+
+// Groups H.264 NAL units into access units; a new one starts at an AUD or
+// at a parameter set/SEI/slice following a VCL NAL unit of the previous AU.
+std::vector<std::vector<uint8_t>> SplitH264AccessUnits(
+    const std::vector<std::span<const uint8_t>>& nals) {
+  std::vector<std::vector<uint8_t>> access_units;
+  std::vector<uint8_t> current;
+  bool has_vcl = false;
+  for (const auto& nal : nals) {
+    const uint8_t type = nal[0] & 0x1f;
+    const bool vcl = type >= 1 && type <= 5;
+    // first_mb_in_slice == 0 shows up as a leading 1 bit in the slice header.
+    const bool first_slice = vcl && nal.size() > 1 && (nal[1] & 0x80);
+    const bool starts_au =
+        type == 9 || ((type == 6 || type == 7 || type == 8) && has_vcl) ||
+        (first_slice && has_vcl);
+    if (starts_au && !current.empty()) {
+      access_units.push_back(std::move(current));
+      current.clear();
+      has_vcl = false;
+    }
+    const uint8_t start_code[] = {0, 0, 0, 1};
+    current.insert(current.end(), std::begin(start_code),
+                   std::end(start_code));
+    current.insert(current.end(), nal.begin(), nal.end());
+    has_vcl |= vcl;
+  }
+  if (!current.empty()) {
+    access_units.push_back(std::move(current));
+  }
+  return access_units;
+}
+
+class BitWriter {
+ public:
+  void WriteBits(uint64_t value, int bits) {
+    for (int i = bits - 1; i >= 0; --i) {
+      if (bit_pos_ == 0) {
+        bytes_.push_back(0);
+      }
+      bytes_.back() |= ((value >> i) & 1) << (7 - bit_pos_);
+      bit_pos_ = (bit_pos_ + 1) % 8;
+    }
+  }
+
+  void WriteUE(uint32_t value) {
+    const uint64_t code = static_cast<uint64_t>(value) + 1;
+    int bits = 0;
+    while ((code >> bits) > 1) {
+      ++bits;
+    }
+    WriteBits(0, bits);
+    WriteBits(code, bits + 1);
+  }
+
+  void WriteSE(int32_t value) {
+    WriteUE(value > 0 ? 2 * value - 1 : -2 * value);
+  }
+
+  // rbsp_trailing_bits()
+  std::vector<uint8_t> Finish() {
+    WriteBits(1, 1);
+    while (bit_pos_ != 0) {
+      WriteBits(0, 1);
+    }
+    return bytes_;
+  }
+
+ private:
+  std::vector<uint8_t> bytes_;
+  int bit_pos_ = 0;
+};
+
+// Appends |rbsp| to |out| as an Annex-B NAL unit with emulation prevention.
+void AppendNalUnit(std::vector<uint8_t>* out,
+                   const std::vector<uint8_t>& header,
+                   const std::vector<uint8_t>& rbsp) {
+  const uint8_t start_code[] = {0, 0, 0, 1};
+  out->insert(out->end(), std::begin(start_code), std::end(start_code));
+  out->insert(out->end(), header.begin(), header.end());
+  int zeros = 0;
+  for (uint8_t byte : rbsp) {
+    if (zeros >= 2 && byte <= 3) {
+      out->push_back(0x03);
+      zeros = 0;
+    }
+    out->push_back(byte);
+    zeros = byte == 0 ? zeros + 1 : 0;
+  }
+}
+
+void WriteProfileTierLevel(BitWriter* w) {
+  w->WriteBits(0, 2);           // general_profile_space
+  w->WriteBits(0, 1);           // general_tier_flag
+  w->WriteBits(1, 5);           // general_profile_idc (Main)
+  w->WriteBits(0x60000000, 32); // general_profile_compatibility_flags
+  w->WriteBits(0b1001, 4);      // progressive, interlaced, non_packed, frame
+  w->WriteBits(0, 43);          // general_reserved_zero_43bits
+  w->WriteBits(0, 1);           // general_inbld_flag
+  w->WriteBits(93, 8);          // general_level_idc (3.1)
+}
+
+std::vector<uint8_t> MakeH265Vps() {
+  BitWriter w;
+  w.WriteBits(0, 4);       // vps_video_parameter_set_id
+  w.WriteBits(3, 2);       // base_layer_internal, base_layer_available
+  w.WriteBits(0, 6);       // vps_max_layers_minus1
+  w.WriteBits(0, 3);       // vps_max_sub_layers_minus1
+  w.WriteBits(1, 1);       // vps_temporal_id_nesting_flag
+  w.WriteBits(0xffff, 16); // vps_reserved_0xffff_16bits
+  WriteProfileTierLevel(&w);
+  w.WriteBits(0, 1);       // vps_sub_layer_ordering_info_present_flag
+  w.WriteUE(4);            // vps_max_dec_pic_buffering_minus1
+  w.WriteUE(0);            // vps_max_num_reorder_pics
+  w.WriteUE(0);            // vps_max_latency_increase_plus1
+  w.WriteBits(0, 6);       // vps_max_layer_id
+  w.WriteUE(0);            // vps_num_layer_sets_minus1
+  w.WriteBits(0, 1);       // vps_timing_info_present_flag
+  w.WriteBits(0, 1);       // vps_extension_flag
+  return w.Finish();
+}
+
+// 1280x720 Main profile, 8x8..64x64 CTBs, no SAO/PCM/temporal MVP.
+std::vector<uint8_t> MakeH265Sps() {
+  BitWriter w;
+  w.WriteBits(0, 4);  // sps_video_parameter_set_id
+  w.WriteBits(0, 3);  // sps_max_sub_layers_minus1
+  w.WriteBits(1, 1);  // sps_temporal_id_nesting_flag
+  WriteProfileTierLevel(&w);
+  w.WriteUE(0);       // sps_seq_parameter_set_id
+  w.WriteUE(1);       // chroma_format_idc
+  w.WriteUE(1280);    // pic_width_in_luma_samples
+  w.WriteUE(720);     // pic_height_in_luma_samples
+  w.WriteBits(0, 1);  // conformance_window_flag
+  w.WriteUE(0);       // bit_depth_luma_minus8
+  w.WriteUE(0);       // bit_depth_chroma_minus8
+  w.WriteUE(4);       // log2_max_pic_order_cnt_lsb_minus4
+  w.WriteBits(0, 1);  // sps_sub_layer_ordering_info_present_flag
+  w.WriteUE(4);       // sps_max_dec_pic_buffering_minus1
+  w.WriteUE(0);       // sps_max_num_reorder_pics
+  w.WriteUE(0);       // sps_max_latency_increase_plus1
+  w.WriteUE(0);       // log2_min_luma_coding_block_size_minus3
+  w.WriteUE(3);       // log2_diff_max_min_luma_coding_block_size
+  w.WriteUE(0);       // log2_min_luma_transform_block_size_minus2
+  w.WriteUE(3);       // log2_diff_max_min_luma_transform_block_size
+  w.WriteUE(1);       // max_transform_hierarchy_depth_inter
+  w.WriteUE(1);       // max_transform_hierarchy_depth_intra
+  w.WriteBits(0, 1);  // scaling_list_enabled_flag
+  w.WriteBits(0, 1);  // amp_enabled_flag
+  w.WriteBits(0, 1);  // sample_adaptive_offset_enabled_flag
+  w.WriteBits(0, 1);  // pcm_enabled_flag
+  w.WriteUE(0);       // num_short_term_ref_pic_sets
+  w.WriteBits(0, 1);  // long_term_ref_pics_present_flag
+  w.WriteBits(0, 1);  // sps_temporal_mvp_enabled_flag
+  w.WriteBits(1, 1);  // strong_intra_smoothing_enabled_flag
+  w.WriteBits(0, 1);  // vui_parameters_present_flag
+  w.WriteBits(0, 1);  // sps_extension_present_flag
+  return w.Finish();
+}
+
+std::vector<uint8_t> MakeH265Pps() {
+  BitWriter w;
+  w.WriteUE(0);       // pps_pic_parameter_set_id
+  w.WriteUE(0);       // pps_seq_parameter_set_id
+  w.WriteBits(0, 1);  // dependent_slice_segments_enabled_flag
+  w.WriteBits(0, 1);  // output_flag_present_flag
+  w.WriteBits(0, 3);  // num_extra_slice_header_bits
+  w.WriteBits(0, 1);  // sign_data_hiding_enabled_flag
+  w.WriteBits(0, 1);  // cabac_init_present_flag
+  w.WriteUE(0);       // num_ref_idx_l0_default_active_minus1
+  w.WriteUE(0);       // num_ref_idx_l1_default_active_minus1
+  w.WriteSE(0);       // init_qp_minus26
+  w.WriteBits(0, 1);  // constrained_intra_pred_flag
+  w.WriteBits(0, 1);  // transform_skip_enabled_flag
+  w.WriteBits(0, 1);  // cu_qp_delta_enabled_flag
+  w.WriteSE(0);       // pps_cb_qp_offset
+  w.WriteSE(0);       // pps_cr_qp_offset
+  w.WriteBits(0, 1);  // pps_slice_chroma_qp_offsets_present_flag
+  w.WriteBits(0, 1);  // weighted_pred_flag
+  w.WriteBits(0, 1);  // weighted_bipred_flag
+  w.WriteBits(0, 1);  // transquant_bypass_enabled_flag
+  w.WriteBits(0, 1);  // tiles_enabled_flag
+  w.WriteBits(0, 1);  // entropy_coding_sync_enabled_flag
+  w.WriteBits(1, 1);  // pps_loop_filter_across_slices_enabled_flag
+  w.WriteBits(0, 1);  // deblocking_filter_control_present_flag
+  w.WriteBits(0, 1);  // pps_scaling_list_data_present_flag
+  w.WriteBits(0, 1);  // lists_modification_present_flag
+  w.WriteUE(0);       // log2_parallel_merge_level_minus2
+  w.WriteBits(0, 1);  // slice_segment_header_extension_present_flag
+  w.WriteBits(0, 1);  // pps_extension_present_flag
+  return w.Finish();
+}
+
+// A slice segment header followed by |payload_size| bytes of fake slice data.
+std::vector<uint8_t> MakeH265Slice(bool idr,
+                                   uint32_t poc,
+                                   size_t payload_size,
+                                   uint32_t* seed) {
+  BitWriter w;
+  w.WriteBits(1, 1);  // first_slice_segment_in_pic_flag
+  if (idr) {
+    w.WriteBits(0, 1);  // no_output_of_prior_pics_flag
+  }
+  w.WriteUE(0);                // slice_pic_parameter_set_id
+  w.WriteUE(idr ? 2 : 1);      // slice_type (I or P)
+  if (!idr) {
+    w.WriteBits(poc & 0xff, 8);  // slice_pic_order_cnt_lsb
+    w.WriteBits(0, 1);           // short_term_ref_pic_set_sps_flag
+    w.WriteUE(1);                // num_negative_pics
+    w.WriteUE(0);                // num_positive_pics
+    w.WriteUE(0);                // delta_poc_s0_minus1
+    w.WriteBits(1, 1);           // used_by_curr_pic_s0_flag
+    w.WriteBits(0, 1);           // num_ref_idx_active_override_flag
+    w.WriteUE(0);                // five_minus_max_num_merge_cand
+  }
+  w.WriteSE(idr ? -4 : 2);  // slice_qp_delta
+  std::vector<uint8_t> rbsp = w.Finish();
+  for (size_t i = 0; i < payload_size; ++i) {
+    *seed = *seed * 1664525u + 1013904223u;
+    rbsp.push_back(static_cast<uint8_t>(*seed >> 24));
+  }
+  return rbsp;
+}
+
+struct H265Stream {
+  std::vector<uint8_t> bytes;
+  // Access unit boundaries within |bytes|.
+  std::vector<std::span<const uint8_t>> access_units;
+};
+
+// A 1280x720 stream with an IDR (and parameter sets) every 30 pictures.
+H265Stream MakeH265Stream(size_t num_pictures) {
+  H265Stream stream;
+  std::vector<size_t> au_offsets;
+  const std::vector<uint8_t> vps = MakeH265Vps();
+  const std::vector<uint8_t> sps = MakeH265Sps();
+  const std::vector<uint8_t> pps = MakeH265Pps();
+  uint32_t seed = 1;
+  for (size_t i = 0; i < num_pictures; ++i) {
+    au_offsets.push_back(stream.bytes.size());
+    const bool idr = i % 30 == 0;
+    if (idr) {
+      AppendNalUnit(&stream.bytes, {0x40, 0x01}, vps);
+      AppendNalUnit(&stream.bytes, {0x42, 0x01}, sps);
+      AppendNalUnit(&stream.bytes, {0x44, 0x01}, pps);
+      // IDR_W_RADL
+      AppendNalUnit(&stream.bytes, {0x26, 0x01},
+                    MakeH265Slice(true, 0, 20000, &seed));
+    } else {
+      // TRAIL_R
+      AppendNalUnit(&stream.bytes, {0x02, 0x01},
+                    MakeH265Slice(false, i % 30, 3000, &seed));
+    }
+  }
+  au_offsets.push_back(stream.bytes.size());
+  for (size_t i = 0; i + 1 < au_offsets.size(); ++i) {
+    stream.access_units.emplace_back(stream.bytes.data() + au_offsets[i],
+                                     au_offsets[i + 1] - au_offsets[i]);
+  }
+  return stream;
+}
+
+// CRC-32/MPEG-2 for PSI sections.
+uint32_t Crc32Mpeg(std::span<const uint8_t> data) {
+  uint32_t crc = 0xffffffff;
+  for (uint8_t byte : data) {
+    crc ^= static_cast<uint32_t>(byte) << 24;
+    for (int i = 0; i < 8; ++i) {
+      crc = (crc & 0x80000000) ? (crc << 1) ^ 0x04c11db7 : crc << 1;
+    }
+  }
+  return crc;
+}
+
+// Just enough of a TS muxer to produce programs with one H.264 and one ADTS
+// AAC elementary stream each for TSParser.
+class SyntheticTsMuxer {
+ public:
+  static constexpr uint16_t kPmtPid = 0x1000;
+
+  explicit SyntheticTsMuxer(size_t num_programs = 1)
+      : num_programs_(num_programs) {}
+
+  // Program |program| is numbered program + 1, with its PMT on
+  // kPmtPid + program.
+  static uint16_t VideoPid(size_t program) {
+    return static_cast<uint16_t>(0x100 + 2 * program);
+  }
+  static uint16_t AudioPid(size_t program) {
+    return static_cast<uint16_t>(0x101 + 2 * program);
+  }
+
+  void WriteTables() {
+    std::vector<uint8_t> pat = {0x00, 0xb0, 0x00, 0x00, 0x01,
+                                0xc1, 0x00, 0x00};
+    for (size_t p = 0; p < num_programs_; ++p) {
+      const uint16_t pmt_pid = static_cast<uint16_t>(kPmtPid + p);
+      pat.insert(pat.end(), {static_cast<uint8_t>((p + 1) >> 8),
+                             static_cast<uint8_t>(p + 1),
+                             static_cast<uint8_t>(0xe0 | (pmt_pid >> 8)),
+                             static_cast<uint8_t>(pmt_pid & 0xff)});
+    }
+    WriteSection(0, pat);
+
+    // PMT: PCR on the video PID, H.264 and ADTS AAC streams.
+    for (size_t p = 0; p < num_programs_; ++p) {
+      const uint16_t video_pid = VideoPid(p);
+      const uint16_t audio_pid = AudioPid(p);
+      WriteSection(
+          static_cast<uint16_t>(kPmtPid + p),
+          {0x02, 0xb0, 0x00, static_cast<uint8_t>((p + 1) >> 8),
+           static_cast<uint8_t>(p + 1), 0xc1, 0x00, 0x00,
+           static_cast<uint8_t>(0xe0 | (video_pid >> 8)),
+           static_cast<uint8_t>(video_pid & 0xff), 0xf0, 0x00, 0x1b,
+           static_cast<uint8_t>(0xe0 | (video_pid >> 8)),
+           static_cast<uint8_t>(video_pid & 0xff), 0xf0, 0x00, 0x0f,
+           static_cast<uint8_t>(0xe0 | (audio_pid >> 8)),
+           static_cast<uint8_t>(audio_pid & 0xff), 0xf0, 0x00});
+    }
+  }
+
+  void WritePes(uint16_t pid,
+                uint8_t stream_id,
+                int64_t pts_90k,
+                std::span<const uint8_t> payload) {
+    std::vector<uint8_t> pes = {0x00, 0x00, 0x01, stream_id};
+    const size_t pes_length = 3 + 5 + payload.size();
+    const bool bounded = stream_id != 0xe0 && pes_length <= 0xffff;
+    pes.push_back(bounded ? static_cast<uint8_t>(pes_length >> 8) : 0);
+    pes.push_back(bounded ? static_cast<uint8_t>(pes_length) : 0);
+    pes.push_back(0x80);  // marker bits
+    pes.push_back(0x80);  // PTS only
+    pes.push_back(5);     // PES_header_data_length
+    pes.push_back(static_cast<uint8_t>(0x21 | ((pts_90k >> 29) & 0x0e)));
+    pes.push_back(static_cast<uint8_t>(pts_90k >> 22));
+    pes.push_back(static_cast<uint8_t>(0x01 | ((pts_90k >> 14) & 0xfe)));
+    pes.push_back(static_cast<uint8_t>(pts_90k >> 7));
+    pes.push_back(static_cast<uint8_t>(0x01 | ((pts_90k << 1) & 0xfe)));
+    pes.insert(pes.end(), payload.begin(), payload.end());
+    WritePayload(pid, pes);
+  }
+
+  const std::vector<uint8_t>& data() const { return data_; }
+
+ private:
+  void WriteSection(uint16_t pid, std::vector<uint8_t> section) {
+    const size_t section_length = section.size() - 3 + 4;
+    section[1] |= static_cast<uint8_t>(section_length >> 8);
+    section[2] = static_cast<uint8_t>(section_length);
+    const uint32_t crc = Crc32Mpeg(section);
+    for (int shift = 24; shift >= 0; shift -= 8) {
+      section.push_back(static_cast<uint8_t>(crc >> shift));
+    }
+    section.insert(section.begin(), 0x00);  // pointer_field
+    WritePayload(pid, section);
+  }
+
+  // Splits |payload| into TS packets, padding the last one with an
+  // adaptation field.
+  void WritePayload(uint16_t pid, std::span<const uint8_t> payload) {
+    bool first = true;
+    while (!payload.empty()) {
+      const size_t chunk = std::min(payload.size(), kTSPacketSize - 4);
+      const size_t stuffing = kTSPacketSize - 4 - chunk;
+      data_.push_back(0x47);
+      data_.push_back(static_cast<uint8_t>((first ? 0x40 : 0x00) |
+                                           ((pid >> 8) & 0x1f)));
+      data_.push_back(static_cast<uint8_t>(pid));
+      data_.push_back(static_cast<uint8_t>((stuffing ? 0x30 : 0x10) |
+                                           (continuity_[pid] & 0x0f)));
+      ++continuity_[pid];
+      if (stuffing > 0) {
+        data_.push_back(static_cast<uint8_t>(stuffing - 1));
+        if (stuffing > 1) {
+          data_.push_back(0x00);  // no adaptation field flags
+          data_.insert(data_.end(), stuffing - 2, 0xff);
+        }
+      }
+      data_.insert(data_.end(), payload.begin(), payload.begin() + chunk);
+      payload = payload.subspan(chunk);
+      first = false;
+    }
+  }
+
+  const size_t num_programs_;
+  std::vector<uint8_t> data_;
+  uint8_t continuity_[0x2000] = {};
+};
+
+// Every program carries the same streams.
+std::vector<uint8_t> MakeTransportStream(
+    std::span<const std::vector<uint8_t>> video_aus,
+    std::span<const uint8_t> aac,
+    size_t num_programs = 1) {
+  SyntheticTsMuxer muxer(num_programs);
+  muxer.WriteTables();
+
+  // 25 fps video against 1024-sample AAC frames at 48 kHz, interleaved by
+  // timestamp.
+  const uint8_t* data = aac.data();
+  size_t size = aac.size();
+  const uint8_t* frame = nullptr;
+  size_t frame_size = 0;
+  int64_t audio_pts = 0;
+  for (size_t i = 0; i < video_aus.size(); ++i) {
+    const int64_t video_pts = static_cast<int64_t>(i) * 3600;
+    if (i % 25 == 0) {
+      muxer.WriteTables();
+    }
+    while (audio_pts <= video_pts &&
+           GetNextAACFrame(&data, &size, &frame, &frame_size) == OK) {
+      for (size_t p = 0; p < num_programs; ++p) {
+        muxer.WritePes(SyntheticTsMuxer::AudioPid(p), 0xc0, audio_pts,
+                       std::span(frame, frame_size));
+      }
+      audio_pts += 1920;
+    }
+    for (size_t p = 0; p < num_programs; ++p) {
+      muxer.WritePes(SyntheticTsMuxer::VideoPid(p), 0xe0, video_pts,
+                     video_aus[i]);
+    }
+  }
+  return muxer.data();
+}
+
+// Packetizes NAL units the way RtpPacketizerH264/H265 do in non-interleaved
+// mode: single NAL unit packets, FU-A/FU fragments above the MTU.
+std::vector<base::CopyOnWriteBuffer> PacketizeForRtp(
+    const std::vector<std::span<const uint8_t>>& nals,
+    bool h265) {
+  std::vector<base::CopyOnWriteBuffer> packets;
+  const size_t header_size = h265 ? 2 : 1;
+  for (const auto& nal : nals) {
+    if (nal.size() <= kRtpMaxPayloadSize) {
+      packets.emplace_back(nal.data(), nal.size());
+      continue;
+    }
+    std::span<const uint8_t> rest = nal.subspan(header_size);
+    bool first = true;
+    while (!rest.empty()) {
+      const size_t chunk =
+          std::min(rest.size(), kRtpMaxPayloadSize - header_size - 1);
+      const bool last = chunk == rest.size();
+      std::vector<uint8_t> packet;
+      if (h265) {
+        const uint8_t type = (nal[0] >> 1) & 0x3f;
+        packet.push_back(static_cast<uint8_t>((nal[0] & 0x81) | (49 << 1)));
+        packet.push_back(nal[1]);
+        packet.push_back(static_cast<uint8_t>((first ? 0x80 : 0) |
+                                              (last ? 0x40 : 0) | type));
+      } else {
+        packet.push_back(static_cast<uint8_t>((nal[0] & 0xe0) | 28));
+        packet.push_back(static_cast<uint8_t>(
+            (first ? 0x80 : 0) | (last ? 0x40 : 0) | (nal[0] & 0x1f)));
+      }
+      packet.insert(packet.end(), rest.begin(), rest.begin() + chunk);
+      packets.emplace_back(packet.data(), packet.size());
+      rest = rest.subspan(chunk);
+      first = false;
+    }
+  }
+  return packets;
+}
+
+void PrintUsage(const char* program_name) {
+  std::cout << "Usage: " << program_name << " [options]\n";
+  std::cout << "\nOptions:\n";
+  std::cout << "  --h264 <file>       H.264 Annex-B input "
+               "(default codec/tools/bun33s.h264)\n";
+  std::cout << "  --aac <file>        ADTS AAC input "
+               "(default codec/tools/bun33s.aac)\n";
+  std::cout << "  --filter <text>     Only run benchmarks whose name "
+               "contains <text>\n";
+  std::cout << "  --min_time_ms <ms>  Minimum run time per benchmark "
+               "(default 500)\n";
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  BenchmarkOptions options;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    if (arg == "--help" || arg == "-h") {
+      PrintUsage(argv[0]);
+      return 0;
+    }
+    if (i + 1 >= argc) {
+      PrintUsage(argv[0]);
+      return 1;
+    }
+    if (arg == "--h264") {
+      options.h264_path = argv[++i];
+    } else if (arg == "--aac") {
+      options.aac_path = argv[++i];
+    } else if (arg == "--filter") {
+      options.filter = argv[++i];
+    } else if (arg == "--min_time_ms") {
+      options.min_time_s = std::atof(argv[++i]) / 1000.0;
+    } else {
+      PrintUsage(argv[0]);
+      return 1;
+    }
+  }
+
+  const std::vector<uint8_t> h264 = ReadFile(options.h264_path);
+  const std::vector<uint8_t> aac = ReadFile(options.aac_path);
+  if (h264.empty() || aac.empty()) {
+    PrintUsage(argv[0]);
+    return 1;
+  }
+
+  const std::vector<std::span<const uint8_t>> h264_nals = SplitNalUnits(h264);
+  const std::vector<std::vector<uint8_t>> h264_aus =
+      SplitH264AccessUnits(h264_nals);
+  const H265Stream h265 = MakeH265Stream(300);
+  const std::vector<std::span<const uint8_t>> h265_nals =
+      SplitNalUnits(h265.bytes);
+  const std::vector<uint8_t> ts = MakeTransportStream(h264_aus, aac);
+  const size_t ts_nals = h264_nals.size();
+  const size_t ts_aus = h264_aus.size();
+
+  // The first ten seconds in each of 20 programs.
+  constexpr size_t kNumMuxPrograms = 20;
+  const std::span<const std::vector<uint8_t>> mux_aus(
+      h264_aus.data(), std::min<size_t>(h264_aus.size(), 250));
+  const std::vector<uint8_t> ts_mux =
+      MakeTransportStream(mux_aus, aac, kNumMuxPrograms);
+  size_t ts_mux_nals = 0;
+  for (const auto& au : mux_aus) {
+    ts_mux_nals += SplitNalUnits(au).size() * kNumMuxPrograms;
+  }
+  const size_t ts_mux_aus = mux_aus.size() * kNumMuxPrograms;
+  const std::vector<base::CopyOnWriteBuffer> h264_rtp =
+      PacketizeForRtp(h264_nals, false);
+  const std::vector<base::CopyOnWriteBuffer> h265_rtp =
+      PacketizeForRtp(h265_nals, true);
+
+  size_t aac_frames = 0;
+  {
+    const uint8_t* data = aac.data();
+    size_t size = aac.size();
+    const uint8_t* frame = nullptr;
+    size_t frame_size = 0;
+    while (GetNextAACFrame(&data, &size, &frame, &frame_size) == OK) {
+      ++aac_frames;
+    }
+  }
+
+  std::printf("h264: %zu bytes, %zu NALs, %zu AUs; aac: %zu bytes, %zu "
+              "frames\n",
+              h264.size(), h264_nals.size(), h264_aus.size(), aac.size(),
+              aac_frames);
+  std::printf("h265 (synthetic): %zu bytes, %zu NALs, %zu AUs; ts "
+              "(synthetic): %zu bytes\n\n",
+              h265.bytes.size(), h265_nals.size(), h265.access_units.size(),
+              ts.size());
+
+  RunBenchmark(options, "getNextNALUnit/h264", [&] {
+    WorkCount count{h264.size(), 0, h264_aus.size()};
+    const uint8_t* data = h264.data();
+    size_t size = h264.size();
+    const uint8_t* nal_start = nullptr;
+    size_t nal_size = 0;
+    while (getNextNALUnit(&data, &size, &nal_start, &nal_size, true) == OK) {
+      ++count.nal_units;
+    }
+    return count;
+  });
+
+  RunBenchmark(options, "FramingQueue/h264", [&] {
+    WorkCount count{h264.size(), h264_nals.size(), 0};
+    FramingQueue queue(FramingQueue::CodecType::kH264);
+    for (size_t offset = 0; offset < h264.size(); offset += kFeedChunkSize) {
+      queue.PushData(h264.data() + offset,
+                     std::min(kFeedChunkSize, h264.size() - offset));
+      while (queue.PopFrame()) {
+        ++count.access_units;
+      }
+    }
+    queue.Flush();
+    while (queue.PopFrame()) {
+      ++count.access_units;
+    }
+    return count;
+  });
+
+  RunBenchmark(options, "FramingQueue/aac", [&] {
+    WorkCount count{aac.size(), 0, 0};
+    FramingQueue queue(FramingQueue::CodecType::kAAC);
+    for (size_t offset = 0; offset < aac.size(); offset += kFeedChunkSize) {
+      queue.PushData(aac.data() + offset,
+                     std::min(kFeedChunkSize, aac.size() - offset));
+      while (queue.PopFrame()) {
+        ++count.access_units;
+      }
+    }
+    return count;
+  });
+
+  RunBenchmark(options, "GetNextAACFrame/aac", [&] {
+    WorkCount count{aac.size(), 0, 0};
+    const uint8_t* data = aac.data();
+    size_t size = aac.size();
+    const uint8_t* frame = nullptr;
+    size_t frame_size = 0;
+    ADTSHeader header;
+    while (GetNextAACFrame(&data, &size, &frame, &frame_size) == OK) {
+      ParseADTSHeader(frame, frame_size, &header);
+      ++count.access_units;
+    }
+    return count;
+  });
+
+  RunBenchmark(options, "H265BitstreamParser/synthetic", [&] {
+    WorkCount count{h265.bytes.size(), h265_nals.size(),
+                    h265.access_units.size()};
+    H265BitstreamParser parser;
+    for (const auto& au : h265.access_units) {
+      parser.ParseBitstream(au);
+    }
+    if (!parser.GetLastSliceQp()) {
+      AVE_LOG(LS_WARNING) << "Synthetic H.265 slices did not parse";
+    }
+    return count;
+  });
+
+  // Drains like a consumer would, so queues stay short.
+  auto drain_ts = [](mpeg2ts::TSParser* parser) {
+    std::shared_ptr<MediaFrame> frame;
+    for (auto type : {mpeg2ts::TSParser::VIDEO, mpeg2ts::TSParser::AUDIO}) {
+      if (auto source = parser->GetSource(type)) {
+        status_t final_result = OK;
+        while (source->HasBufferAvailable(&final_result) &&
+               source->DequeueAccessUnit(frame) == OK) {
+        }
+      }
+    }
+  };
+
+  RunBenchmark(options, "TSParser::FeedTSPacket/h264+aac", [&] {
+    WorkCount count{ts.size(), ts_nals, ts_aus};
+    mpeg2ts::TSParser parser;
+    for (size_t offset = 0; offset + kTSPacketSize <= ts.size();
+         offset += kTSPacketSize) {
+      parser.FeedTSPacket(ts.data() + offset, kTSPacketSize);
+      if ((offset / kTSPacketSize) % 63 == 0) {
+        drain_ts(&parser);
+      }
+    }
+    return count;
+  });
+
+  // Seven packets per call, the usual UDP datagram payload.
+  RunBenchmark(options, "TSParser::FeedTSBuffer/h264+aac", [&] {
+    WorkCount count{ts.size(), ts_nals, ts_aus};
+    mpeg2ts::TSParser parser;
+    constexpr size_t kDatagramSize = 7 * kTSPacketSize;
+    for (size_t offset = 0; offset < ts.size(); offset += kDatagramSize) {
+      const size_t size = std::min(kDatagramSize, ts.size() - offset);
+      parser.FeedTSBuffer(std::span(ts.data() + offset, size));
+      if ((offset / kDatagramSize) % 9 == 0) {
+        drain_ts(&parser);
+      }
+    }
+    return count;
+  });
+
+  // ES framing inline, then on worker threads. The parser keeps every
+  // access unit; SignalEOS() waits for the workers.
+  for (size_t num_workers : {0, 4}) {
+    std::string name = "TSParser/20 programs";
+    if (num_workers > 0) {
+      name += ", " + std::to_string(num_workers) + " workers";
+    }
+    RunBenchmark(options, name, [&] {
+      WorkCount count{ts_mux.size(), ts_mux_nals, ts_mux_aus};
+      mpeg2ts::TSParser parser;
+      parser.SetNumWorkers(num_workers);
+      constexpr size_t kDatagramSize = 7 * kTSPacketSize;
+      for (size_t offset = 0; offset < ts_mux.size();
+           offset += kDatagramSize) {
+        const size_t size = std::min(kDatagramSize, ts_mux.size() - offset);
+        parser.FeedTSBuffer(std::span(ts_mux.data() + offset, size));
+      }
+      parser.SignalEOS(ERROR_END_OF_STREAM);
+      return count;
+    });
+  }
+
+  RunBenchmark(options, "VideoRtpDepacketizerH264/h264", [&] {
+    WorkCount count{h264.size(), h264_nals.size(), h264_aus.size()};
+    rtp_rtcp::VideoRtpDepacketizerH264 depacketizer;
+    for (const auto& packet : h264_rtp) {
+      depacketizer.Parse(packet);
+    }
+    return count;
+  });
+
+  RunBenchmark(options, "VideoRtpDepacketizerH265/synthetic", [&] {
+    WorkCount count{h265.bytes.size(), h265_nals.size(),
+                    h265.access_units.size()};
+    rtp_rtcp::VideoRtpDepacketizerH265 depacketizer;
+    for (const auto& packet : h265_rtp) {
+      depacketizer.Parse(packet);
+    }
+    return count;
+  });
+
+  return 0;
+}
@@ -0,0 +1,85 @@
+/*
+ * av1_common.cc
+ * Copyright (C) 2025 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#include "media/foundation/av1/av1_common.h"
+
+namespace ave {
+namespace media {
+namespace AV1 {
+
+namespace {
+
+constexpr uint8_t kObuForbiddenBit = 0b1000'0000;
+constexpr uint8_t kObuExtensionBit = 0b0000'0100;
+constexpr uint8_t kObuHasSizeBit = 0b0000'0010;
+constexpr size_t kMaxLeb128Bytes = 8;
+
+}  // namespace
+
+std::optional<uint64_t> ReadLeb128(std::span<const uint8_t>* data) {
+  uint64_t value = 0;
+  for (size_t i = 0; i < kMaxLeb128Bytes && i < data->size(); ++i) {
+    const uint8_t byte = (*data)[i];
+    value |= static_cast<uint64_t>(byte & 0x7f) << (i * 7);
+    if ((byte & 0x80) == 0) {
+      *data = data->subspan(i + 1);
+      return value;
+    }
+  }
+  return std::nullopt;
+}
+
+std::optional<ObuInfo> ParseObu(std::span<const uint8_t> data) {
+  if (data.empty() || (data[0] & kObuForbiddenBit) != 0) {
+    return std::nullopt;
+  }
+
+  ObuInfo obu;
+  const uint8_t obu_header = data[0];
+  obu.type = static_cast<ObuType>((obu_header >> 3) & 0x0f);
+  std::span<const uint8_t> rest = data.subspan(1);
+  if (obu_header & kObuExtensionBit) {
+    if (rest.empty()) {
+      return std::nullopt;
+    }
+    obu.temporal_id = rest[0] >> 5;
+    obu.spatial_id = (rest[0] >> 3) & 0x03;
+    rest = rest.subspan(1);
+  }
+
+  if (obu_header & kObuHasSizeBit) {
+    std::optional<uint64_t> obu_size = ReadLeb128(&rest);
+    if (!obu_size || *obu_size > rest.size()) {
+      return std::nullopt;
+    }
+    obu.header_size = data.size() - rest.size();
+    obu.payload = rest.first(static_cast<size_t>(*obu_size));
+  } else {
+    obu.header_size = data.size() - rest.size();
+    obu.payload = rest;
+  }
+  return obu;
+}
+
+std::vector<ObuInfo> FindObus(std::span<const uint8_t> data) {
+  std::vector<ObuInfo> obus;
+  while (!data.empty()) {
+    // An OBU without obu_size runs to the end of |data|, so it is always the
+    // last one found.
+    std::optional<ObuInfo> obu = ParseObu(data);
+    if (!obu) {
+      break;
+    }
+    obus.push_back(*obu);
+    data = data.subspan(obu->header_size + obu->payload.size());
+  }
+  return obus;
+}
+
+}  // namespace AV1
+}  // namespace media
+}  // namespace ave
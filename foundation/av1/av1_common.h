@@ -0,0 +1,68 @@
+/*
+ * av1_common.h
+ * Copyright (C) 2025 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#ifndef AVE_MEDIA_FOUNDATION_AV1_AV1_COMMON_H_
+#define AVE_MEDIA_FOUNDATION_AV1_AV1_COMMON_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <optional>
+#include <span>
+#include <vector>
+
+namespace ave {
+namespace media {
+namespace AV1 {
+
+// OBU types, AV1 spec section 6.2.2.
+enum ObuType : uint8_t {
+  kObuSequenceHeader = 1,
+  kObuTemporalDelimiter = 2,
+  kObuFrameHeader = 3,
+  kObuTileGroup = 4,
+  kObuMetadata = 5,
+  kObuFrame = 6,
+  kObuRedundantFrameHeader = 7,
+  kObuTileList = 8,
+  kObuPadding = 15,
+};
+
+// frame_type, AV1 spec section 6.8.2.
+enum FrameType : uint8_t {
+  kKeyFrame = 0,
+  kInterFrame = 1,
+  kIntraOnlyFrame = 2,
+  kSwitchFrame = 3,
+};
+
+struct ObuInfo {
+  ObuType type = kObuPadding;
+  uint8_t temporal_id = 0;
+  uint8_t spatial_id = 0;
+  // Size of obu_header(), the optional extension and the obu_size field.
+  size_t header_size = 0;
+  // OBU payload, excluding everything counted in |header_size|.
+  std::span<const uint8_t> payload;
+};
+
+// Parses the OBU starting at the beginning of |data|. Without obu_size the
+// OBU is assumed to extend to the end of |data| (RTP / Annex-less framing).
+std::optional<ObuInfo> ParseObu(std::span<const uint8_t> data);
+
+// Splits a low-overhead bitstream (section 5.2) into OBUs. An OBU without
+// obu_size ends the walk. Stops at the first malformed OBU.
+std::vector<ObuInfo> FindObus(std::span<const uint8_t> data);
+
+// Reads an unsigned leb128 value, at most 8 bytes. Advances |data| on success.
+std::optional<uint64_t> ReadLeb128(std::span<const uint8_t>* data);
+
+}  // namespace AV1
+}  // namespace media
+}  // namespace ave
+
+#endif  // AVE_MEDIA_FOUNDATION_AV1_AV1_COMMON_H_
@@ -0,0 +1,523 @@
+/*
+ * av1_obu_parser.cc
+ * Copyright (C) 2025 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#include "media/foundation/av1/av1_obu_parser.h"
+
+#include <utility>
+
+#include "base/buffer/bitstream_reader.h"
+#include "base/logging.h"
+#include "media/foundation/color_space.h"
+#include "media/foundation/media_meta.h"
+
+namespace ave {
+namespace media {
+
+namespace {
+
+constexpr uint8_t kSeqProfileProfessional = 2;
+constexpr uint8_t kCpBt709 = 1;
+constexpr uint8_t kTcSrgb = 13;
+constexpr uint8_t kMcIdentity = 0;
+
+// uvlc(), section 4.10.3.
+uint32_t ReadUvlc(base::BitstreamReader& reader) {
+  int leading_zeros = 0;
+  while (reader.Ok() && !reader.Read<bool>()) {
+    ++leading_zeros;
+    if (leading_zeros >= 32) {
+      reader.Invalidate();
+      return 0;
+    }
+  }
+  if (leading_zeros == 0) {
+    return 0;
+  }
+  const uint32_t value = static_cast<uint32_t>(reader.ReadBits(leading_zeros));
+  return value + (1u << leading_zeros) - 1;
+}
+
+// color_config(), section 5.5.2.
+void ParseColorConfig(base::BitstreamReader& reader,
+                      Av1ObuParser::SequenceHeader* seq) {
+  const bool high_bitdepth = reader.Read<bool>();
+  if (seq->seq_profile == kSeqProfileProfessional && high_bitdepth) {
+    const bool twelve_bit = reader.Read<bool>();
+    seq->bit_depth = twelve_bit ? 12 : 10;
+  } else {
+    seq->bit_depth = high_bitdepth ? 10 : 8;
+  }
+
+  seq->mono_chrome = seq->seq_profile == 1 ? false : reader.Read<bool>();
+
+  if (reader.Read<bool>()) {  // color_description_present_flag
+    seq->color_primaries = reader.Read<uint8_t>();
+    seq->transfer_characteristics = reader.Read<uint8_t>();
+    seq->matrix_coefficients = reader.Read<uint8_t>();
+  }
+
+  if (seq->mono_chrome) {
+    seq->color_range = reader.Read<bool>();
+    seq->subsampling_x = true;
+    seq->subsampling_y = true;
+    return;
+  }
+
+  if (seq->color_primaries == kCpBt709 &&
+      seq->transfer_characteristics == kTcSrgb &&
+      seq->matrix_coefficients == kMcIdentity) {
+    seq->color_range = true;
+    seq->subsampling_x = false;
+    seq->subsampling_y = false;
+  } else {
+    seq->color_range = reader.Read<bool>();
+    if (seq->seq_profile == 0) {
+      seq->subsampling_x = true;
+      seq->subsampling_y = true;
+    } else if (seq->seq_profile == 1) {
+      seq->subsampling_x = false;
+      seq->subsampling_y = false;
+    } else if (seq->bit_depth == 12) {
+      seq->subsampling_x = reader.Read<bool>();
+      seq->subsampling_y = seq->subsampling_x ? reader.Read<bool>() : false;
+    } else {
+      seq->subsampling_x = true;
+      seq->subsampling_y = false;
+    }
+    if (seq->subsampling_x && seq->subsampling_y) {
+      reader.ConsumeBits(2);  // chroma_sample_position
+    }
+  }
+  reader.ConsumeBits(1);  // separate_uv_delta_q
+}
+
+PixelFormat Av1PixelFormat(const Av1ObuParser::SequenceHeader& seq) {
+  if (seq.mono_chrome) {
+    switch (seq.bit_depth) {
+      case 10:
+        return AVE_PIX_FMT_GRAY10LE;
+      case 12:
+        return AVE_PIX_FMT_GRAY12LE;
+      default:
+        return AVE_PIX_FMT_GRAY8;
+    }
+  }
+  if (seq.subsampling_x && seq.subsampling_y) {
+    switch (seq.bit_depth) {
+      case 10:
+        return AVE_PIX_FMT_YUV420P10LE;
+      case 12:
+        return AVE_PIX_FMT_YUV420P12LE;
+      default:
+        return AVE_PIX_FMT_YUV420P;
+    }
+  }
+  if (seq.subsampling_x) {
+    switch (seq.bit_depth) {
+      case 10:
+        return AVE_PIX_FMT_YUV422P10LE;
+      case 12:
+        return AVE_PIX_FMT_YUV422P12LE;
+      default:
+        return AVE_PIX_FMT_YUV422P;
+    }
+  }
+  switch (seq.bit_depth) {
+    case 10:
+      return AVE_PIX_FMT_YUV444P10LE;
+    case 12:
+      return AVE_PIX_FMT_YUV444P12LE;
+    default:
+      return AVE_PIX_FMT_YUV444P;
+  }
+}
+
+}  // namespace
+
+// sequence_header_obu(), section 5.5.1.
+std::optional<Av1ObuParser::SequenceHeader> Av1ObuParser::ParseSequenceHeader(
+    std::span<const uint8_t> payload) {
+  base::BitstreamReader reader(payload);
+  SequenceHeader seq;
+
+  seq.seq_profile = static_cast<uint8_t>(reader.ReadBits(3));
+  if (seq.seq_profile > kSeqProfileProfessional) {
+    AVE_LOG(LS_WARNING) << "Unsupported AV1 seq_profile "
+                        << static_cast<int>(seq.seq_profile);
+    return std::nullopt;
+  }
+  seq.still_picture = reader.Read<bool>();
+  seq.reduced_still_picture_header = reader.Read<bool>();
+
+  if (seq.reduced_still_picture_header) {
+    seq.seq_level_idx = static_cast<uint8_t>(reader.ReadBits(5));
+  } else {
+    seq.timing_info_present_flag = reader.Read<bool>();
+    uint8_t buffer_delay_length_minus_1 = 0;
+    if (seq.timing_info_present_flag) {
+      // timing_info()
+      seq.num_units_in_display_tick = reader.Read<uint32_t>();
+      seq.time_scale = reader.Read<uint32_t>();
+      seq.equal_picture_interval = reader.Read<bool>();
+      if (seq.equal_picture_interval) {
+        ReadUvlc(reader);  // num_ticks_per_picture_minus_1
+      }
+      seq.decoder_model_info_present_flag = reader.Read<bool>();
+      if (seq.decoder_model_info_present_flag) {
+        // decoder_model_info()
+        buffer_delay_length_minus_1 = static_cast<uint8_t>(reader.ReadBits(5));
+        reader.ConsumeBits(32);  // num_units_in_decoding_tick
+        seq.buffer_removal_time_length_minus_1 =
+            static_cast<uint8_t>(reader.ReadBits(5));
+        seq.frame_presentation_time_length_minus_1 =
+            static_cast<uint8_t>(reader.ReadBits(5));
+      }
+    }
+    const bool initial_display_delay_present_flag = reader.Read<bool>();
+    seq.operating_points_cnt = static_cast<uint8_t>(reader.ReadBits(5)) + 1;
+    for (uint8_t i = 0; i < seq.operating_points_cnt; ++i) {
+      const uint16_t operating_point_idc =
+          static_cast<uint16_t>(reader.ReadBits(12));
+      const uint8_t seq_level_idx = static_cast<uint8_t>(reader.ReadBits(5));
+      uint8_t seq_tier = 0;
+      if (seq_level_idx > 7) {
+        seq_tier = reader.Read<bool>() ? 1 : 0;
+      }
+      seq.operating_point_idcs[i] = operating_point_idc;
+      if (i == 0) {
+        seq.operating_point_idc = operating_point_idc;
+        seq.seq_level_idx = seq_level_idx;
+        seq.seq_tier = seq_tier;
+      }
+      if (seq.decoder_model_info_present_flag) {
+        if (reader.Read<bool>()) {  // decoder_model_present_for_this_op
+          seq.decoder_model_present_mask |= 1u << i;
+          // operating_parameters_info()
+          const int n = buffer_delay_length_minus_1 + 1;
+          reader.ConsumeBits(n);  // decoder_buffer_delay
+          reader.ConsumeBits(n);  // encoder_buffer_delay
+          reader.ConsumeBits(1);  // low_delay_mode_flag
+        }
+      }
+      if (initial_display_delay_present_flag) {
+        if (reader.Read<bool>()) {  // initial_display_delay_present_for_op
+          reader.ConsumeBits(4);    // initial_display_delay_minus_1
+        }
+      }
+    }
+  }
+
+  seq.frame_width_bits = static_cast<uint8_t>(reader.ReadBits(4)) + 1;
+  seq.frame_height_bits = static_cast<uint8_t>(reader.ReadBits(4)) + 1;
+  seq.max_frame_width =
+      static_cast<uint32_t>(reader.ReadBits(seq.frame_width_bits)) + 1;
+  seq.max_frame_height =
+      static_cast<uint32_t>(reader.ReadBits(seq.frame_height_bits)) + 1;
+
+  if (!seq.reduced_still_picture_header) {
+    seq.frame_id_numbers_present_flag = reader.Read<bool>();
+  }
+  if (seq.frame_id_numbers_present_flag) {
+    seq.delta_frame_id_length_minus_2 =
+        static_cast<uint8_t>(reader.ReadBits(4));
+    seq.additional_frame_id_length_minus_1 =
+        static_cast<uint8_t>(reader.ReadBits(3));
+  }
+
+  reader.ConsumeBits(1);  // use_128x128_superblock
+  reader.ConsumeBits(1);  // enable_filter_intra
+  reader.ConsumeBits(1);  // enable_intra_edge_filter
+
+  if (!seq.reduced_still_picture_header) {
+    reader.ConsumeBits(1);  // enable_interintra_compound
+    reader.ConsumeBits(1);  // enable_masked_compound
+    reader.ConsumeBits(1);  // enable_warped_motion
+    reader.ConsumeBits(1);  // enable_dual_filter
+    seq.enable_order_hint = reader.Read<bool>();
+    if (seq.enable_order_hint) {
+      reader.ConsumeBits(1);  // enable_jnt_comp
+      reader.ConsumeBits(1);  // enable_ref_frame_mvs
+    }
+    if (!reader.Read<bool>()) {  // seq_choose_screen_content_tools
+      seq.seq_force_screen_content_tools = reader.Read<bool>() ? 1 : 0;
+    }
+    if (seq.seq_force_screen_content_tools > 0) {
+      if (!reader.Read<bool>()) {  // seq_choose_integer_mv
+        seq.seq_force_integer_mv = reader.Read<bool>() ? 1 : 0;
+      }
+    }
+    if (seq.enable_order_hint) {
+      seq.order_hint_bits = static_cast<uint8_t>(reader.ReadBits(3)) + 1;
+    }
+  }
+
+  reader.ConsumeBits(1);  // enable_superres
+  reader.ConsumeBits(1);  // enable_cdef
+  reader.ConsumeBits(1);  // enable_restoration
+  ParseColorConfig(reader, &seq);
+  seq.film_grain_params_present = reader.Read<bool>();
+
+  if (!reader.Ok()) {
+    AVE_LOG(LS_WARNING) << "Truncated AV1 sequence header.";
+    return std::nullopt;
+  }
+  return seq;
+}
+
+// uncompressed_header(), section 5.9.2, up to frame_size().
+std::optional<Av1ObuParser::FrameHeader> Av1ObuParser::ParseFrameHeader(
+    std::span<const uint8_t> payload,
+    const SequenceHeader& sequence_header,
+    uint8_t temporal_id,
+    uint8_t spatial_id) {
+  const SequenceHeader& seq = sequence_header;
+  base::BitstreamReader reader(payload);
+  FrameHeader header;
+  if (seq.reduced_still_picture_header) {
+    header.frame_type = AV1::kKeyFrame;
+    header.show_frame = true;
+  } else {
+    header.show_existing_frame = reader.Read<bool>();
+    if (header.show_existing_frame) {
+      header.frame_to_show_map_idx = static_cast<uint8_t>(reader.ReadBits(3));
+      header.show_frame = true;
+      if (!reader.Ok()) {
+        return std::nullopt;
+      }
+      return header;
+    }
+    header.frame_type = static_cast<AV1::FrameType>(reader.ReadBits(2));
+    header.show_frame = reader.Read<bool>();
+    if (!reader.Ok()) {
+      return std::nullopt;
+    }
+  }
+
+  // The rest only matters for the frame size, a header cut short before it
+  // still reports the frame type.
+  const AV1::FrameType frame_type = *header.frame_type;
+  const bool frame_is_intra =
+      frame_type == AV1::kKeyFrame || frame_type == AV1::kIntraOnlyFrame;
+  const bool shown_key_or_switch =
+      frame_type == AV1::kSwitchFrame ||
+      (frame_type == AV1::kKeyFrame && header.show_frame);
+  bool error_resilient_mode = true;
+  if (!seq.reduced_still_picture_header) {
+    if (header.show_frame && seq.decoder_model_info_present_flag &&
+        !seq.equal_picture_interval) {
+      // temporal_point_info()
+      reader.ConsumeBits(seq.frame_presentation_time_length_minus_1 + 1);
+    }
+    if (!header.show_frame) {
+      reader.ConsumeBits(1);  // showable_frame
+    }
+    if (!shown_key_or_switch) {
+      error_resilient_mode = reader.Read<bool>();
+    }
+  }
+
+  reader.ConsumeBits(1);  // disable_cdf_update
+  bool allow_screen_content_tools = seq.seq_force_screen_content_tools > 0;
+  if (seq.seq_force_screen_content_tools == kSelect) {
+    allow_screen_content_tools = reader.Read<bool>();
+  }
+  if (allow_screen_content_tools && seq.seq_force_integer_mv == kSelect) {
+    reader.ConsumeBits(1);  // force_integer_mv
+  }
+  if (seq.frame_id_numbers_present_flag) {
+    // current_frame_id
+    reader.ConsumeBits(seq.additional_frame_id_length_minus_1 +
+                       seq.delta_frame_id_length_minus_2 + 3);
+  }
+  bool frame_size_override_flag = false;
+  if (frame_type == AV1::kSwitchFrame) {
+    frame_size_override_flag = true;
+  } else if (!seq.reduced_still_picture_header) {
+    frame_size_override_flag = reader.Read<bool>();
+  }
+  reader.ConsumeBits(seq.order_hint_bits);  // order_hint
+  if (!frame_is_intra && !error_resilient_mode) {
+    reader.ConsumeBits(3);  // primary_ref_frame
+  }
+  if (seq.decoder_model_info_present_flag &&
+      reader.Read<bool>()) {  // buffer_removal_time_present_flag
+    for (uint8_t i = 0; i < seq.operating_points_cnt; ++i) {
+      if ((seq.decoder_model_present_mask & (1u << i)) == 0) {
+        continue;
+      }
+      const uint16_t idc = seq.operating_point_idcs[i];
+      const bool in_temporal_layer = (idc >> temporal_id) & 1;
+      const bool in_spatial_layer = (idc >> (spatial_id + 8)) & 1;
+      if (idc == 0 || (in_temporal_layer && in_spatial_layer)) {
+        // buffer_removal_time
+        reader.ConsumeBits(seq.buffer_removal_time_length_minus_1 + 1);
+      }
+    }
+  }
+
+  if (!frame_is_intra) {
+    // Without the override flag frame_size() falls back to the maximum,
+    // otherwise the size may come from a reference frame.
+    if (!frame_size_override_flag && reader.Ok()) {
+      header.frame_width = seq.max_frame_width;
+      header.frame_height = seq.max_frame_height;
+    }
+    return header;
+  }
+
+  uint8_t refresh_frame_flags = 0xff;
+  if (!shown_key_or_switch) {
+    refresh_frame_flags = reader.Read<uint8_t>();
+  }
+  if (refresh_frame_flags != 0xff && error_resilient_mode &&
+      seq.enable_order_hint) {
+    reader.ConsumeBits(8 * seq.order_hint_bits);  // ref_order_hint[i]
+  }
+
+  // frame_size(). The superres downscale that follows does not change the
+  // upscaled width decoders output.
+  uint32_t frame_width = seq.max_frame_width;
+  uint32_t frame_height = seq.max_frame_height;
+  if (frame_size_override_flag) {
+    frame_width =
+        static_cast<uint32_t>(reader.ReadBits(seq.frame_width_bits)) + 1;
+    frame_height =
+        static_cast<uint32_t>(reader.ReadBits(seq.frame_height_bits)) + 1;
+  }
+  if (reader.Ok()) {
+    header.frame_width = frame_width;
+    header.frame_height = frame_height;
+  }
+  return header;
+}
+
+ColorSpace Av1ObuParser::GetColorSpace(const SequenceHeader& sequence_header) {
+  // AV1 color_primaries, transfer_characteristics and matrix_coefficients use
+  // the ISO/IEC 23091-4 code points, as ColorSpace does. Unknown values are
+  // left unspecified.
+  ColorSpace color_space;
+  color_space.set_primaries_from_uint8(sequence_header.color_primaries);
+  color_space.set_transfer_from_uint8(sequence_header.transfer_characteristics);
+  color_space.set_matrix_from_uint8(sequence_header.matrix_coefficients);
+  color_space.set_range_from_uint8(static_cast<uint8_t>(
+      sequence_header.color_range ? ColorSpace::RangeID::kFull
+                                  : ColorSpace::RangeID::kLimited));
+  return color_space;
+}
+
+void Av1ObuParser::FillMediaMeta(const SequenceHeader& sequence_header,
+                                 uint32_t frame_width,
+                                 uint32_t frame_height,
+                                 MediaMeta* meta) {
+  if (frame_width == 0 || frame_height == 0) {
+    frame_width = sequence_header.max_frame_width;
+    frame_height = sequence_header.max_frame_height;
+  }
+  meta->SetWidth(static_cast<int32_t>(frame_width));
+  meta->SetHeight(static_cast<int32_t>(frame_height));
+  meta->SetCodecProfile(sequence_header.seq_profile);
+  meta->SetCodecLevel(sequence_header.seq_level_idx);
+  meta->SetPixelFormat(Av1PixelFormat(sequence_header));
+  meta->SetColorSpace(GetColorSpace(sequence_header));
+}
+
+Av1BitstreamParser::Av1BitstreamParser() = default;
+Av1BitstreamParser::~Av1BitstreamParser() = default;
+
+void Av1BitstreamParser::ParseBitstream(std::span<const uint8_t> bitstream) {
+  ClearTemporalUnitFlags();
+  for (const AV1::ObuInfo& obu : AV1::FindObus(bitstream)) {
+    HandleObu(obu);
+  }
+}
+
+void Av1BitstreamParser::ParseObu(std::span<const uint8_t> obu) {
+  std::optional<AV1::ObuInfo> info = AV1::ParseObu(obu);
+  if (!info) {
+    AVE_LOG(LS_WARNING) << "Malformed AV1 OBU.";
+    return;
+  }
+  HandleObu(*info);
+}
+
+void Av1BitstreamParser::FillMediaMeta(MediaMeta* meta) const {
+  if (sequence_header_) {
+    Av1ObuParser::FillMediaMeta(*sequence_header_, frame_width_, frame_height_,
+                                meta);
+  }
+}
+
+void Av1BitstreamParser::ClearTemporalUnitFlags() {
+  key_frame_ = false;
+  starts_temporal_unit_ = false;
+  sequence_header_changed_ = false;
+}
+
+void Av1BitstreamParser::Reset() {
+  sequence_header_cache_.Invalidate();
+  sequence_header_.reset();
+  last_frame_header_.reset();
+  sequence_header_hash_ = 0;
+  frame_width_ = 0;
+  frame_height_ = 0;
+  ClearTemporalUnitFlags();
+}
+
+void Av1BitstreamParser::HandleObu(const AV1::ObuInfo& obu) {
+  switch (obu.type) {
+    case AV1::kObuTemporalDelimiter:
+      starts_temporal_unit_ = true;
+      last_frame_header_.reset();
+      break;
+    case AV1::kObuSequenceHeader: {
+      const uint64_t hash = HashParameterSet(obu.payload);
+      const Av1ObuParser::SequenceHeader* seq =
+          sequence_header_cache_.Lookup(hash, obu.payload);
+      if (!seq) {
+        std::optional<Av1ObuParser::SequenceHeader> parsed =
+            Av1ObuParser::ParseSequenceHeader(obu.payload);
+        if (!parsed) {
+          AVE_LOG(LS_WARNING) << "Unable to parse AV1 sequence header.";
+          break;
+        }
+        seq = sequence_header_cache_.Insert(hash, obu.payload,
+                                            std::move(*parsed));
+      }
+      if (!sequence_header_ || hash != sequence_header_hash_) {
+        sequence_header_changed_ = true;
+        sequence_header_hash_ = hash;
+        sequence_header_ = *seq;
+      }
+      break;
+    }
+    case AV1::kObuFrameHeader:
+    case AV1::kObuFrame: {
+      if (!sequence_header_) {
+        break;
+      }
+      last_frame_header_ = Av1ObuParser::ParseFrameHeader(
+          obu.payload, *sequence_header_, obu.temporal_id, obu.spatial_id);
+      if (!last_frame_header_) {
+        break;
+      }
+      if (last_frame_header_->show_frame &&
+          last_frame_header_->frame_type == AV1::kKeyFrame) {
+        key_frame_ = true;
+      }
+      if (last_frame_header_->frame_width > 0) {
+        frame_width_ = last_frame_header_->frame_width;
+        frame_height_ = last_frame_header_->frame_height;
+      }
+      break;
+    }
+    default:
+      break;
+  }
+}
+
+}  // namespace media
+}  // namespace ave
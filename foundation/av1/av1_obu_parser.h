@@ -0,0 +1,185 @@
+/*
+ * av1_obu_parser.h
+ * Copyright (C) 2025 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#ifndef AVE_MEDIA_FOUNDATION_AV1_AV1_OBU_PARSER_H_
+#define AVE_MEDIA_FOUNDATION_AV1_AV1_OBU_PARSER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <array>
+#include <optional>
+#include <span>
+
+#include "media/foundation/av1/av1_common.h"
+#include "media/foundation/color_space.h"
+#include "media/foundation/parameter_set_cache.h"
+
+namespace ave {
+namespace media {
+
+class MediaMeta;
+
+// Parses the parts of AV1 OBUs needed to describe a stream without decoding
+// it: the sequence header and the start of the uncompressed frame header.
+// See https://aomediacodec.github.io/av1-spec/.
+class Av1ObuParser {
+ public:
+  // SELECT_SCREEN_CONTENT_TOOLS / SELECT_INTEGER_MV.
+  static constexpr uint8_t kSelect = 2;
+
+  // The parsed state of a sequence header OBU (section 5.5). Only fields
+  // needed to describe the stream and to reach frame_type are kept.
+  struct SequenceHeader {
+    uint8_t seq_profile = 0;
+    bool still_picture = false;
+    bool reduced_still_picture_header = false;
+    // Operating point 0 is what a decoder selects by default.
+    uint8_t operating_points_cnt = 1;
+    uint16_t operating_point_idc = 0;
+    uint8_t seq_level_idx = 0;
+    uint8_t seq_tier = 0;
+
+    bool timing_info_present_flag = false;
+    bool decoder_model_info_present_flag = false;
+    bool equal_picture_interval = false;
+    uint32_t num_units_in_display_tick = 0;
+    uint32_t time_scale = 0;
+    uint8_t frame_presentation_time_length_minus_1 = 0;
+    uint8_t buffer_removal_time_length_minus_1 = 0;
+    // operating_point_idc and decoder_model_present_for_this_op of every
+    // operating point, frame headers carry buffer_removal_time for them.
+    std::array<uint16_t, 32> operating_point_idcs = {};
+    uint32_t decoder_model_present_mask = 0;
+
+    uint8_t frame_width_bits = 0;
+    uint8_t frame_height_bits = 0;
+    uint32_t max_frame_width = 0;
+    uint32_t max_frame_height = 0;
+    bool frame_id_numbers_present_flag = false;
+    uint8_t delta_frame_id_length_minus_2 = 0;
+    uint8_t additional_frame_id_length_minus_1 = 0;
+    bool enable_order_hint = false;
+    uint8_t order_hint_bits = 0;
+    // 0, 1 or kSelect, the frame header then carries the flag.
+    uint8_t seq_force_screen_content_tools = kSelect;
+    uint8_t seq_force_integer_mv = kSelect;
+
+    // color_config(), section 5.5.2.
+    uint8_t bit_depth = 8;
+    bool mono_chrome = false;
+    uint8_t color_primaries = 2;           // CP_UNSPECIFIED
+    uint8_t transfer_characteristics = 2;  // TC_UNSPECIFIED
+    uint8_t matrix_coefficients = 2;       // MC_UNSPECIFIED
+    bool color_range = false;
+    bool subsampling_x = true;
+    bool subsampling_y = true;
+
+    bool film_grain_params_present = false;
+  };
+
+  // The start of uncompressed_header() (section 5.9.2).
+  struct FrameHeader {
+    bool show_existing_frame = false;
+    // Valid when |show_existing_frame| is set.
+    uint8_t frame_to_show_map_idx = 0;
+    // Not known for show_existing_frame, which only re-shows a decoded frame.
+    std::optional<AV1::FrameType> frame_type;
+    bool show_frame = true;
+    // UpscaledWidth and FrameHeight from frame_size(), 0 when the header is
+    // truncated or an inter frame takes its size from a reference frame.
+    uint32_t frame_width = 0;
+    uint32_t frame_height = 0;
+  };
+
+  // |payload| is the OBU payload, without obu_header and obu_size.
+  static std::optional<SequenceHeader> ParseSequenceHeader(
+      std::span<const uint8_t> payload);
+
+  // Parses a frame header OBU or the header part of a frame OBU.
+  // |temporal_id| and |spatial_id| come from the OBU extension header.
+  static std::optional<FrameHeader> ParseFrameHeader(
+      std::span<const uint8_t> payload,
+      const SequenceHeader& sequence_header,
+      uint8_t temporal_id = 0,
+      uint8_t spatial_id = 0);
+
+  static ColorSpace GetColorSpace(const SequenceHeader& sequence_header);
+
+  // Copies dimensions, profile, level, pixel format and color description
+  // into |meta|. The dimensions are the frame size when known (non zero),
+  // the sequence maximum otherwise.
+  static void FillMediaMeta(const SequenceHeader& sequence_header,
+                            uint32_t frame_width,
+                            uint32_t frame_height,
+                            MediaMeta* meta);
+};
+
+// Stateful AV1 parser, keeps the active sequence header so frame headers can
+// be interpreted. Feed it whole OBUs or whole temporal units.
+class Av1BitstreamParser {
+ public:
+  Av1BitstreamParser();
+  ~Av1BitstreamParser();
+
+  // Parses a low-overhead bitstream (OBUs with obu_size), e.g. a temporal
+  // unit read from a file or reassembled from RTP. Clears the per temporal
+  // unit flags below first.
+  void ParseBitstream(std::span<const uint8_t> bitstream);
+
+  // Parses a single OBU; |obu| may omit obu_size. Flags accumulate until
+  // ClearTemporalUnitFlags() is called.
+  void ParseObu(std::span<const uint8_t> obu);
+
+  void ClearTemporalUnitFlags();
+
+  // Returns true if a shown key frame was seen.
+  bool IsKeyFrame() const { return key_frame_; }
+
+  // Set when a temporal delimiter was seen, i.e. a new temporal unit started.
+  bool StartsTemporalUnit() const { return starts_temporal_unit_; }
+
+  // Set when the last parsed sequence header differs from the previous one.
+  bool SequenceHeaderChanged() const { return sequence_header_changed_; }
+
+  const Av1ObuParser::SequenceHeader* GetSequenceHeader() const {
+    return sequence_header_ ? &*sequence_header_ : nullptr;
+  }
+
+  const std::optional<Av1ObuParser::FrameHeader>& GetLastFrameHeader() const {
+    return last_frame_header_;
+  }
+
+  // Size of the last frame whose header carried one, 0 until then.
+  uint32_t frame_width() const { return frame_width_; }
+  uint32_t frame_height() const { return frame_height_; }
+
+  // Av1ObuParser::FillMediaMeta() with the active sequence header and the
+  // current frame size. Does nothing before a sequence header was seen.
+  void FillMediaMeta(MediaMeta* meta) const;
+
+  void Reset();
+
+ private:
+  void HandleObu(const AV1::ObuInfo& obu);
+
+  // Sequence headers are repeated in front of every key frame.
+  ParameterSetCache<Av1ObuParser::SequenceHeader> sequence_header_cache_;
+  std::optional<Av1ObuParser::SequenceHeader> sequence_header_;
+  std::optional<Av1ObuParser::FrameHeader> last_frame_header_;
+  uint64_t sequence_header_hash_ = 0;
+  uint32_t frame_width_ = 0;
+  uint32_t frame_height_ = 0;
+  bool key_frame_ = false;
+  bool starts_temporal_unit_ = false;
+  bool sequence_header_changed_ = false;
+};
+
+}  // namespace media
+}  // namespace ave
+
+#endif  // AVE_MEDIA_FOUNDATION_AV1_AV1_OBU_PARSER_H_
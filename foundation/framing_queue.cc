@@ -69,6 +69,8 @@ status_t FramingQueue::PushData(const uint8_t* data, size_t size) {
       result = ParseH264Frame();
     } else if (codec_type_ == CodecType::kAAC) {
       result = ParseAACFrame();
+    } else if (codec_type_ == CodecType::kAV1) {
+      result = ParseAV1Frame();
     } else {
       return INVALID_OPERATION;
     }
@@ -98,12 +100,18 @@ void FramingQueue::Clear() {
   buffer_.clear();
   au_buf_.clear();
   au_has_vcl_ = false;
+  av1_parser_.Reset();
   while (!frames_.empty()) {
     frames_.pop();
   }
 }
 
 void FramingQueue::Flush() {
+  if (codec_type_ == CodecType::kAV1) {
+    EmitAV1TemporalUnit();
+    return;
+  }
+
   // Emit any accumulated access unit data as the final frame.
   if (!au_buf_.empty()) {
     auto frame = MediaFrame::CreateShared(au_buf_.size(), MediaType::VIDEO);
@@ -239,5 +247,62 @@ status_t FramingQueue::ParseAACFrame() {
   return OK;
 }
 
+// Parse an AV1 low-overhead bitstream into temporal units. A temporal unit
+// ends where the next temporal delimiter OBU starts; the delimiters are
+// kept in the output since decoders expect them.
+status_t FramingQueue::ParseAV1Frame() {
+  if (buffer_.empty()) {
+    return E_AGAIN;
+  }
+
+  std::span<const uint8_t> data(buffer_.data(), buffer_.size());
+  // Bit 1 of obu_header is obu_has_size_field. Without it the OBU length is
+  // unknown in a raw stream.
+  if ((data[0] & 0x02) == 0) {
+    AVE_LOG(LS_WARNING) << "AV1 OBU without obu_size, dropping buffered data";
+    buffer_.clear();
+    return INVALID_OPERATION;
+  }
+
+  // Bit 2 is obu_extension_flag, one more header byte.
+  const size_t header_size = (data[0] & 0x04) ? 2 : 1;
+  if (data.size() <= header_size) {
+    return E_AGAIN;
+  }
+  std::span<const uint8_t> rest = data.subspan(header_size);
+  std::optional<uint64_t> obu_size = AV1::ReadLeb128(&rest);
+  if (!obu_size || *obu_size > rest.size()) {
+    // Wait for the rest of the OBU.
+    return E_AGAIN;
+  }
+  const size_t obu_total = (data.size() - rest.size()) + *obu_size;
+  std::span<const uint8_t> obu = data.first(obu_total);
+
+  const auto type = static_cast<AV1::ObuType>((obu[0] >> 3) & 0x0f);
+  if (type == AV1::kObuTemporalDelimiter) {
+    EmitAV1TemporalUnit();
+  }
+  av1_parser_.ParseObu(obu);
+  au_buf_.insert(au_buf_.end(), obu.begin(), obu.end());
+
+  buffer_.erase(buffer_.begin(), buffer_.begin() + obu_total);
+  return OK;
+}
+
+void FramingQueue::EmitAV1TemporalUnit() {
+  if (!au_buf_.empty()) {
+    auto frame = MediaFrame::CreateShared(au_buf_.size(), MediaType::VIDEO);
+    std::memcpy(frame->data(), au_buf_.data(), au_buf_.size());
+    frame->setRange(0, au_buf_.size());
+    av1_parser_.FillMediaMeta(frame->meta());
+    if (av1_parser_.IsKeyFrame()) {
+      frame->SetPictureType(PictureType::I);
+    }
+    frames_.push(frame);
+    au_buf_.clear();
+  }
+  av1_parser_.ClearTemporalUnitFlags();
+}
+
 }  // namespace media
 }  // namespace ave
@@ -12,6 +12,7 @@
 #include <queue>
 #include <vector>
 
+#include "av1/av1_obu_parser.h"
 #include "base/errors.h"
 #include "media_frame.h"
 
@@ -26,11 +27,16 @@ namespace media {
 //            with 0x00000001 start codes). Each popped frame is ready to be
 //            passed directly to an H.264 decoder.
 // For AAC:   outputs individual ADTS frames.
+// For AV1:   outputs temporal units from a low-overhead OBU stream (section
+//            5.2, every OBU carries obu_size), split on temporal delimiters.
+//            Frames carry the frame size and sequence header color and are
+//            marked as I pictures when they hold a shown key frame.
 class FramingQueue {
  public:
   enum class CodecType {
     kH264,
     kAAC,
+    kAV1,
   };
 
   explicit FramingQueue(CodecType codec_type);
@@ -60,11 +66,14 @@ class FramingQueue {
  private:
   status_t ParseH264Frame();
   status_t ParseAACFrame();
+  status_t ParseAV1Frame();
+  void EmitAV1TemporalUnit();
 
   CodecType codec_type_;
   std::vector<uint8_t> buffer_;  // Accumulated input data
   std::vector<uint8_t> au_buf_;  // Current H.264 access unit being built
   bool au_has_vcl_ = false;      // Whether current AU contains a VCL NAL
+  Av1BitstreamParser av1_parser_;
   std::queue<std::shared_ptr<MediaFrame>> frames_;
 };
 
@@ -76,6 +76,12 @@ namespace media {
 H265BitstreamParser::H265BitstreamParser() = default;
 H265BitstreamParser::~H265BitstreamParser() = default;
 
+void H265BitstreamParser::InvalidateParameterSetCache() {
+  vps_cache_.Invalidate();
+  sps_cache_.Invalidate();
+  pps_cache_.Invalidate();
+}
+
 // General note: this is based off the 08/2021 version of the H.265 standard,
 // section 7.3.6.1. You can find it on this page:
 // http://www.itu.int/rec/T-REC-H.265
@@ -432,10 +438,13 @@ void H265BitstreamParser::ParseSlice(std::span<const uint8_t> slice) {
   H265::NaluType nalu_type = H265::ParseNaluType(slice[0]);
   switch (nalu_type) {
     case H265::NaluType::kVps: {
-      std::optional<H265VpsParser::VpsState> vps_state;
+      const H265VpsParser::VpsState* vps_state = nullptr;
       if (slice.size() >= H265::kNaluHeaderSize) {
-        vps_state =
-            H265VpsParser::ParseVps(slice.subspan(H265::kNaluHeaderSize));
+        vps_state = vps_cache_.GetOrParse(
+            slice.subspan(H265::kNaluHeaderSize),
+            [](std::span<const uint8_t> vps) {
+              return H265VpsParser::ParseVps(vps);
+            });
       }
 
       if (!vps_state) {
@@ -446,34 +455,51 @@ void H265BitstreamParser::ParseSlice(std::span<const uint8_t> slice) {
       break;
     }
     case H265::NaluType::kSps: {
-      std::optional<H265SpsParser::SpsState> sps_state;
+      const H265SpsParser::SpsState* sps_state = nullptr;
       if (slice.size() >= H265::kNaluHeaderSize) {
-        sps_state =
-            H265SpsParser::ParseSps(slice.subspan(H265::kNaluHeaderSize));
+        sps_state = sps_cache_.GetOrParse(
+            slice.subspan(H265::kNaluHeaderSize),
+            [](std::span<const uint8_t> sps) {
+              return H265SpsParser::ParseSps(sps);
+            });
       }
       if (!sps_state) {
         AVE_LOG(LS_WARNING) << "Unable to parse SPS from H265 bitstream.";
       } else {
+        // PPS states are parsed against the SPS they refer to, so they are
+        // stale as soon as the SPS behind an id changes, even to one that
+        // was cached before.
+        const uint64_t sps_hash =
+            HashParameterSet(slice.subspan(H265::kNaluHeaderSize));
+        auto [it, inserted] =
+            sps_hashes_.try_emplace(sps_state->sps_id, sps_hash);
+        if (!inserted && it->second != sps_hash) {
+          pps_cache_.Invalidate();
+          it->second = sps_hash;
+        }
         sps_[sps_state->sps_id] = *sps_state;
       }
       break;
     }
     case H265::NaluType::kPps: {
-      std::optional<H265PpsParser::PpsState> pps_state;
+      const H265PpsParser::PpsState* pps_state = nullptr;
       if (slice.size() >= H265::kNaluHeaderSize) {
-        std::vector<uint8_t> unpacked_buffer =
-            H265::ParseRbsp(slice.subspan(H265::kNaluHeaderSize));
-        base::BitstreamReader slice_reader(std::span<const uint8_t>(
-            unpacked_buffer.data(), unpacked_buffer.size()));
-        // pic_parameter_set_id: ue(v)
-        uint32_t pps_id = slice_reader.ReadExponentialGolomb();
-        IN_RANGE_OR_RETURN_VOID(pps_id, 0, 63);
-        // seq_parameter_set_id: ue(v)
-        uint32_t sps_id = slice_reader.ReadExponentialGolomb();
-        IN_RANGE_OR_RETURN_VOID(sps_id, 0, 15);
-        const H265SpsParser::SpsState* sps = GetSPS(sps_id);
-        pps_state =
-            H265PpsParser::ParsePps(slice.subspan(H265::kNaluHeaderSize), sps);
+        pps_state = pps_cache_.GetOrParse(
+            slice.subspan(H265::kNaluHeaderSize),
+            [this](std::span<const uint8_t> pps)
+                -> std::optional<H265PpsParser::PpsState> {
+              std::vector<uint8_t> unpacked_buffer = H265::ParseRbsp(pps);
+              base::BitstreamReader slice_reader(std::span<const uint8_t>(
+                  unpacked_buffer.data(), unpacked_buffer.size()));
+              // pic_parameter_set_id: ue(v)
+              uint32_t pps_id = slice_reader.ReadExponentialGolomb();
+              IN_RANGE_OR_RETURN_NULL(pps_id, 0, 63);
+              // seq_parameter_set_id: ue(v)
+              uint32_t sps_id = slice_reader.ReadExponentialGolomb();
+              IN_RANGE_OR_RETURN_NULL(sps_id, 0, 15);
+              const H265SpsParser::SpsState* sps = GetSPS(sps_id);
+              return H265PpsParser::ParsePps(pps, sps);
+            });
       }
       if (!pps_state) {
         AVE_LOG(LS_WARNING) << "Unable to parse PPS from H265 bitstream.";
@@ -19,6 +19,7 @@
 #include "media/foundation/h265/h265_pps_parser.h"
 #include "media/foundation/h265/h265_sps_parser.h"
 #include "media/foundation/h265/h265_vps_parser.h"
+#include "media/foundation/parameter_set_cache.h"
 
 namespace ave {
 namespace media {
@@ -45,6 +46,10 @@ class H265BitstreamParser {
   static std::optional<bool> IsFirstSliceSegmentInPic(
       std::span<const uint8_t> data);
 
+  // Drops the parsed VPS/SPS/PPS kept for repeated parameter sets. Call when
+  // the stream is switched or flushed.
+  void InvalidateParameterSetCache();
+
  protected:
   enum Result {
     kOk,
@@ -64,6 +69,14 @@ class H265BitstreamParser {
   std::map<uint32_t, H265SpsParser::SpsState> sps_;
   std::map<uint32_t, H265PpsParser::PpsState> pps_;
 
+  // Parsed states keyed by the hash of the raw parameter set, so parameter
+  // sets repeated before every IRAP are not parsed again.
+  ParameterSetCache<H265VpsParser::VpsState> vps_cache_;
+  ParameterSetCache<H265SpsParser::SpsState> sps_cache_;
+  ParameterSetCache<H265PpsParser::PpsState> pps_cache_;
+  // Hash of the SPS currently stored under each id in |sps_|.
+  std::map<uint32_t, uint64_t> sps_hashes_;
+
   // Last parsed slice QP.
   std::optional<int32_t> last_slice_qp_delta_;
   std::optional<uint32_t> last_slice_pps_id_;
@@ -438,6 +438,8 @@ MediaMeta& MediaMeta::SetPixelFormat(PixelFormat pixel_format) {
 
   if (format_type_ == FormatType::kTrack) {
     track_info()->video().pixel_format = pixel_format;
+  } else if (format_type_ == FormatType::kSample) {
+    sample_info()->video().pixel_format = pixel_format;
   }
   return *this;
 }
@@ -451,6 +453,9 @@ PixelFormat MediaMeta::pixel_format() const {
   if (format_type_ == FormatType::kTrack) {
     return std::get<MediaTrackInfo>(info_).video().pixel_format;
   }
+  if (format_type_ == FormatType::kSample) {
+    return std::get<MediaSampleInfo>(info_).video().pixel_format;
+  }
   return PixelFormat::AVE_PIX_FMT_NONE;
 }
 
@@ -865,5 +870,23 @@ bool MediaMeta::eos() const {
   }
 }
 
+MediaMeta& MediaMeta::SetPlaneLayout(const VideoPlaneLayout& layout) {
+  if (stream_type_ != MediaType::VIDEO || format_type_ != FormatType::kSample) {
+    AVE_LOG(LS_WARNING) << "SetPlaneLayout failed, invalid format";
+    return *this;
+  }
+  sample_info()->video().plane_layout = layout;
+  return *this;
+}
+
+const VideoPlaneLayout& MediaMeta::plane_layout() const {
+  static const VideoPlaneLayout kEmptyLayout;
+  if (stream_type_ != MediaType::VIDEO || format_type_ != FormatType::kSample) {
+    AVE_LOG(LS_WARNING) << "plane_layout failed, invalid format";
+    return kEmptyLayout;
+  }
+  return std::get<MediaSampleInfo>(info_).video().plane_layout;
+}
+
 }  // namespace media
 }  // namespace ave
@@ -40,6 +40,7 @@ class MediaMeta {
                      FormatType format_type = FormatType::kSample);
   virtual ~MediaMeta() = default;
 
+  FormatType format_type() const { return format_type_; }
   MediaTrackInfo* track_info();
   MediaSampleInfo* sample_info();
 
@@ -148,6 +149,8 @@ class MediaMeta {
   /****** 3.2 audio sample same info ******/
 
   /****** 3.3 video sample same info ******/
+  MediaMeta& SetPlaneLayout(const VideoPlaneLayout& layout);
+  const VideoPlaneLayout& plane_layout() const;
 
   // TODO(youfa): add meta filed like Message
 
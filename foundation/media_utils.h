@@ -10,6 +10,7 @@
 
 #include <sys/types.h>
 
+#include <array>
 #include <variant>
 
 #include "base/buffer.h"
@@ -61,6 +62,20 @@ static constexpr size_t kMaxCsdSize =
 
 const char* get_media_type_string(enum MediaType media_type);
 
+// Where the planes of a raw video frame live inside its buffer. Offsets are
+// in bytes from the start of the buffer data, strides in bytes per row.
+struct VideoPlaneLayout {
+  static constexpr size_t kMaxPlanes = 4;
+
+  struct Plane {
+    size_t offset = 0;
+    int32_t stride = 0;
+  };
+
+  size_t num_planes = 0;
+  std::array<Plane, kMaxPlanes> planes;
+};
+
 /*******************************************************/
 struct AudioSampleInfo {
   CodecId codec_id = CodecId::AVE_CODEC_ID_NONE;
@@ -98,6 +113,8 @@ struct VideoSampleInfo {
   FieldOrder field_order = FieldOrder::kUNSPECIFIED;
 
   std::pair<int32_t, int32_t> sample_aspect_ratio = {1, 1};
+  // empty if the planes are packed back to back with stride as row size
+  VideoPlaneLayout plane_layout;
 
   // encoded
   PictureType picture_type = PictureType::NONE;
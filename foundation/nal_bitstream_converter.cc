@@ -0,0 +1,362 @@
+/*
+ * nal_bitstream_converter.cc
+ * Copyright (C) 2025 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#include "nal_bitstream_converter.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "base/logging.h"
+#include "bit_reader.h"
+#include "h265/hevc_utils.h"
+#include "media_errors.h"
+#include "parameter_set_cache.h"
+
+namespace ave {
+namespace media {
+
+namespace {
+
+constexpr size_t kLengthSize = 4;
+constexpr uint8_t kStartCode[kLengthSize] = {0x00, 0x00, 0x00, 0x01};
+
+constexpr uint8_t kAvcNalSps = 7;
+constexpr uint8_t kAvcNalPps = 8;
+
+// Stands in for the id of a parameter set too short to carry one.
+constexpr uint32_t kUnknownParameterSetId = 0xffffffff;
+
+void WriteLength(uint8_t* out, uint32_t length) {
+  out[0] = static_cast<uint8_t>(length >> 24);
+  out[1] = static_cast<uint8_t>(length >> 16);
+  out[2] = static_cast<uint8_t>(length >> 8);
+  out[3] = static_cast<uint8_t>(length);
+}
+
+uint32_t ReadLength(const uint8_t* in, size_t length_size) {
+  uint32_t length = 0;
+  for (size_t i = 0; i < length_size; ++i) {
+    length = (length << 8) | in[i];
+  }
+  return length;
+}
+
+}  // namespace
+
+NalBitstreamConverter::NalBitstreamConverter(Codec codec) : codec_(codec) {}
+
+NalBitstreamConverter::~NalBitstreamConverter() = default;
+
+// static
+bool NalBitstreamConverter::CanConvertAnnexBInPlace(
+    std::span<const NALPosition> nals) {
+  size_t out_offset = 0;
+  for (const NALPosition& nal : nals) {
+    if (out_offset + kLengthSize > nal.nalOffset) {
+      return false;
+    }
+    out_offset += kLengthSize + nal.nalSize;
+  }
+  return true;
+}
+
+status_t NalBitstreamConverter::AnnexBToLengthPrefixed(
+    std::shared_ptr<Buffer>* buffer) {
+  Buffer* in = buffer->get();
+  uint8_t* base = in->data();
+
+  nals_.clear();
+  const uint8_t* data = base;
+  size_t size = in->size();
+  const uint8_t* nal_start = nullptr;
+  size_t nal_size = 0;
+  size_t out_size = 0;
+  while (getNextNALUnit(&data, &size, &nal_start, &nal_size, true) == OK) {
+    if (nal_size == 0) {
+      continue;
+    }
+    nals_.push_back({static_cast<uint32_t>(nal_start - base),
+                     static_cast<uint32_t>(nal_size)});
+    out_size += kLengthSize + nal_size;
+  }
+  if (nals_.empty()) {
+    return ERROR_MALFORMED;
+  }
+
+  // Must run before the NAL units are moved.
+  CollectParameterSets(base);
+
+  if (CanConvertAnnexBInPlace(nals_)) {
+    // Every NAL unit moves towards the start (or stays), so copying front to
+    // back never overwrites bytes that are still to be read.
+    uint8_t* out = base;
+    for (const NALPosition& nal : nals_) {
+      WriteLength(out, nal.nalSize);
+      out += kLengthSize;
+      if (out != base + nal.nalOffset) {
+        memmove(out, base + nal.nalOffset, nal.nalSize);
+      }
+      out += nal.nalSize;
+    }
+    in->setRange(in->offset(), out_size);
+    return OK;
+  }
+
+  auto out_buffer = std::make_shared<Buffer>(out_size);
+  out_buffer->setInt32Data(in->int32Data());
+  uint8_t* out = out_buffer->data();
+  for (const NALPosition& nal : nals_) {
+    WriteLength(out, nal.nalSize);
+    memcpy(out + kLengthSize, base + nal.nalOffset, nal.nalSize);
+    out += kLengthSize + nal.nalSize;
+  }
+  *buffer = std::move(out_buffer);
+  return OK;
+}
+
+status_t NalBitstreamConverter::LengthPrefixedToAnnexB(
+    std::shared_ptr<Buffer>* buffer,
+    size_t length_size) {
+  if (length_size != 1 && length_size != 2 && length_size != 4) {
+    return BAD_VALUE;
+  }
+
+  Buffer* in = buffer->get();
+  uint8_t* data = in->data();
+  const size_t size = in->size();
+
+  size_t num_nals = 0;
+  size_t offset = 0;
+  while (offset < size) {
+    if (size - offset < length_size) {
+      return ERROR_MALFORMED;
+    }
+    const uint32_t nal_size = ReadLength(data + offset, length_size);
+    offset += length_size;
+    if (nal_size > size - offset) {
+      AVE_LOG(LS_WARNING) << "NAL length " << nal_size << " exceeds the "
+                          << size - offset << " remaining bytes";
+      return ERROR_MALFORMED;
+    }
+    offset += nal_size;
+    ++num_nals;
+  }
+
+  if (length_size == kLengthSize) {
+    for (offset = 0; offset < size;) {
+      const uint32_t nal_size = ReadLength(data + offset, kLengthSize);
+      memcpy(data + offset, kStartCode, kLengthSize);
+      offset += kLengthSize + nal_size;
+    }
+    return OK;
+  }
+
+  const size_t out_size = size + num_nals * (kLengthSize - length_size);
+  auto out_buffer = std::make_shared<Buffer>(out_size);
+  out_buffer->setInt32Data(in->int32Data());
+  uint8_t* out = out_buffer->data();
+  for (offset = 0; offset < size;) {
+    const uint32_t nal_size = ReadLength(data + offset, length_size);
+    offset += length_size;
+    memcpy(out, kStartCode, kLengthSize);
+    memcpy(out + kLengthSize, data + offset, nal_size);
+    out += kLengthSize + nal_size;
+    offset += nal_size;
+  }
+  *buffer = std::move(out_buffer);
+  return OK;
+}
+
+std::shared_ptr<Buffer> NalBitstreamConverter::GetCodecConfigRecord() {
+  if (!config_record_) {
+    config_record_ = codec_ == Codec::kH264 ? MakeAvcC() : MakeHvcC();
+  }
+  return config_record_;
+}
+
+void NalBitstreamConverter::Reset() {
+  nals_.clear();
+  parameter_sets_.clear();
+  parameter_sets_hash_ = 0;
+  parameter_sets_changed_ = false;
+  config_record_.reset();
+}
+
+bool NalBitstreamConverter::IsParameterSet(uint8_t nal_header) const {
+  if (codec_ == Codec::kH264) {
+    const uint8_t type = nal_header & 0x1f;
+    return type == kAvcNalSps || type == kAvcNalPps;
+  }
+  const uint8_t type = (nal_header >> 1) & 0x3f;
+  return type == kHevcNalUnitTypeVps || type == kHevcNalUnitTypeSps ||
+         type == kHevcNalUnitTypePps;
+}
+
+// The id is the first field of a PPS; an H.264 SPS puts it after
+// profile_idc, the constraint flags and level_idc, an H.265 SPS after
+// profile_tier_level(), ITU-T H.265 section 7.3.2.2.
+uint64_t NalBitstreamConverter::ParameterSetKey(
+    std::span<const uint8_t> nal) const {
+  uint8_t type = 0;
+  uint32_t id = kUnknownParameterSetId;
+  NALBitReader reader(nal.data(), nal.size());
+  if (codec_ == Codec::kH264) {
+    type = nal[0] & 0x1f;
+    reader.skipBits(8);
+    if (type == kAvcNalSps) {
+      reader.skipBits(24);
+    }
+    id = parseUEWithFallback(&reader, kUnknownParameterSetId);
+  } else {
+    type = (nal[0] >> 1) & 0x3f;
+    reader.skipBits(16);
+    if (type == kHevcNalUnitTypeVps) {
+      id = reader.getBitsWithFallback(4, kUnknownParameterSetId);
+    } else if (type == kHevcNalUnitTypeSps) {
+      reader.skipBits(4);  // sps_video_parameter_set_id
+      const uint32_t max_sub_layers_minus1 = reader.getBitsWithFallback(3, 0);
+      reader.skipBits(1);   // sps_temporal_id_nesting_flag
+      reader.skipBits(96);  // general profile, tier and level
+      uint32_t sub_layer_flags = 0;
+      if (max_sub_layers_minus1 > 0) {
+        sub_layer_flags = reader.getBitsWithFallback(16, 0);
+      }
+      for (uint32_t i = 0; i < max_sub_layers_minus1; ++i) {
+        if (sub_layer_flags & (0x8000 >> (2 * i))) {
+          reader.skipBits(88);  // sub_layer profile
+        }
+        if (sub_layer_flags & (0x4000 >> (2 * i))) {
+          reader.skipBits(8);  // sub_layer_level_idc
+        }
+      }
+      id = parseUEWithFallback(&reader, kUnknownParameterSetId);
+    } else {
+      id = parseUEWithFallback(&reader, kUnknownParameterSetId);
+    }
+  }
+  if (reader.overRead()) {
+    id = kUnknownParameterSetId;
+  }
+  return (static_cast<uint64_t>(type) << 32) | id;
+}
+
+void NalBitstreamConverter::CollectParameterSets(const uint8_t* data) {
+  parameter_sets_changed_ = false;
+
+  // Most access units carry no parameter sets, and most that do repeat the
+  // previous ones; only hash when there are any.
+  uint64_t hash = 0;
+  bool found = false;
+  for (const NALPosition& nal : nals_) {
+    if (!IsParameterSet(data[nal.nalOffset])) {
+      continue;
+    }
+    const uint64_t nal_hash =
+        HashParameterSet(std::span(data + nal.nalOffset, nal.nalSize));
+    hash = found ? CombineParameterSetHashes(hash, nal_hash) : nal_hash;
+    found = true;
+  }
+  if (!found || (!parameter_sets_.empty() && hash == parameter_sets_hash_)) {
+    return;
+  }
+  parameter_sets_hash_ = hash;
+
+  // A parameter set only replaces the one with the same type and id, so an
+  // SPS and PPS sent in different access units are both kept.
+  for (const NALPosition& nal : nals_) {
+    if (!IsParameterSet(data[nal.nalOffset])) {
+      continue;
+    }
+    const std::span<const uint8_t> bytes(data + nal.nalOffset, nal.nalSize);
+    const uint64_t key = ParameterSetKey(bytes);
+    auto it = std::find_if(
+        parameter_sets_.begin(), parameter_sets_.end(),
+        [key](const ParameterSet& entry) { return entry.key == key; });
+    if (it == parameter_sets_.end()) {
+      parameter_sets_.push_back({key, {bytes.begin(), bytes.end()}});
+    } else if (!std::equal(bytes.begin(), bytes.end(), it->nal.begin(),
+                           it->nal.end())) {
+      it->nal.assign(bytes.begin(), bytes.end());
+    } else {
+      continue;
+    }
+    parameter_sets_changed_ = true;
+  }
+  if (parameter_sets_changed_) {
+    config_record_.reset();
+  }
+}
+
+// AVCDecoderConfigurationRecord, ISO/IEC 14496-15 section 5.3.3.1. The
+// chroma_format/bit depth extension for high profiles is optional for
+// decoders and not written, as in MakeAVCCodecSpecificData().
+std::shared_ptr<Buffer> NalBitstreamConverter::MakeAvcC() const {
+  std::vector<const std::vector<uint8_t>*> sps;
+  std::vector<const std::vector<uint8_t>*> pps;
+  size_t size = 7;
+  for (const auto& [key, nal] : parameter_sets_) {
+    const uint8_t type = nal[0] & 0x1f;
+    if (type == kAvcNalSps && nal.size() >= 4) {
+      sps.push_back(&nal);
+      size += 2 + nal.size();
+    } else if (type == kAvcNalPps) {
+      pps.push_back(&nal);
+      size += 2 + nal.size();
+    }
+  }
+  if (sps.empty() || pps.empty() || sps.size() > 31 || pps.size() > 255) {
+    return nullptr;
+  }
+
+  auto record = std::make_shared<Buffer>(size);
+  uint8_t* out = record->data();
+  *out++ = 0x01;                            // configurationVersion
+  memcpy(out, sps.front()->data() + 1, 3);  // profile, compat, level
+  out += 3;
+  *out++ = 0xfc | (kLengthSize - 1);  // lengthSizeMinusOne
+  *out++ = 0xe0 | static_cast<uint8_t>(sps.size());
+  for (const auto* nal : sps) {
+    *out++ = static_cast<uint8_t>(nal->size() >> 8);
+    *out++ = static_cast<uint8_t>(nal->size());
+    memcpy(out, nal->data(), nal->size());
+    out += nal->size();
+  }
+  *out++ = static_cast<uint8_t>(pps.size());
+  for (const auto* nal : pps) {
+    *out++ = static_cast<uint8_t>(nal->size() >> 8);
+    *out++ = static_cast<uint8_t>(nal->size());
+    memcpy(out, nal->data(), nal->size());
+    out += nal->size();
+  }
+  return record;
+}
+
+// HEVCDecoderConfigurationRecord, built by HevcParameterSets::makeHvcc().
+std::shared_ptr<Buffer> NalBitstreamConverter::MakeHvcC() const {
+  HevcParameterSets hevc_parameter_sets;
+  size_t size = 23 + 3 * 3;
+  for (const auto& [key, nal] : parameter_sets_) {
+    if (hevc_parameter_sets.addNalUnit(nal.data(), nal.size()) != OK) {
+      return nullptr;
+    }
+    size += 2 + nal.size();
+  }
+  if (hevc_parameter_sets.getNumNalUnitsOfType(kHevcNalUnitTypeSps) == 0 ||
+      hevc_parameter_sets.getNumNalUnitsOfType(kHevcNalUnitTypePps) == 0) {
+    return nullptr;
+  }
+
+  auto record = std::make_shared<Buffer>(size);
+  if (hevc_parameter_sets.makeHvcc(record->data(), &size, kLengthSize) != OK) {
+    return nullptr;
+  }
+  record->setRange(0, size);
+  return record;
+}
+
+}  // namespace media
+}  // namespace ave
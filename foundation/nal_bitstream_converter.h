@@ -0,0 +1,101 @@
+/*
+ * nal_bitstream_converter.h
+ * Copyright (C) 2025 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#ifndef AVE_MEDIA_FOUNDATION_NAL_BITSTREAM_CONVERTER_H_
+#define AVE_MEDIA_FOUNDATION_NAL_BITSTREAM_CONVERTER_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include <memory>
+#include <span>
+#include <vector>
+
+#include "base/errors.h"
+#include "buffer.h"
+#include "h264/avc_utils.h"
+
+namespace ave {
+namespace media {
+
+// Converts H.264/H.265 access units between Annex-B (start codes, as used by
+// TS, RTP and FramingQueue) and the length-prefixed layout of MP4 and
+// MediaCodec (AVCC/HVCC). Length-prefixed output always uses 4-byte lengths.
+//
+// Conversions rewrite |buffer| in place whenever the NAL units fit, which is
+// always the case for 4-byte start codes or 4-byte lengths, and otherwise
+// replace it with a single-pass copy.
+//
+// Parameter sets seen in Annex-B input are remembered by NAL type and
+// parameter set id, so the matching avcC/hvcC record can be produced without
+// another scan even when SPS and PPS arrive in different access units. Not
+// thread safe.
+class NalBitstreamConverter {
+ public:
+  enum class Codec {
+    kH264,
+    kH265,
+  };
+
+  explicit NalBitstreamConverter(Codec codec);
+  ~NalBitstreamConverter();
+
+  // Annex-B -> 4-byte length prefixes. Returns ERROR_MALFORMED if |*buffer|
+  // holds no NAL unit.
+  status_t AnnexBToLengthPrefixed(std::shared_ptr<Buffer>* buffer);
+
+  // |length_size|-byte length prefixes (1, 2 or 4) -> Annex-B with 4-byte
+  // start codes. Returns ERROR_MALFORMED if a length runs past the end.
+  status_t LengthPrefixedToAnnexB(std::shared_ptr<Buffer>* buffer,
+                                  size_t length_size = 4);
+
+  // Returns the avcC/hvcC record for the most recent parameter sets, or
+  // nullptr if they are incomplete. The record is rebuilt only after the
+  // parameter sets change.
+  std::shared_ptr<Buffer> GetCodecConfigRecord();
+
+  // True if the last Annex-B access unit carried a parameter set that was
+  // new or differed from the one previously seen with its type and id.
+  bool ParameterSetsChanged() const { return parameter_sets_changed_; }
+
+  void Reset();
+
+  // Returns true if |data| can be rewritten in place, i.e. no NAL unit would
+  // have to move towards the end of the buffer. |nals| are the positions of
+  // the NAL payloads within |data|.
+  static bool CanConvertAnnexBInPlace(std::span<const NALPosition> nals);
+
+ private:
+  struct ParameterSet {
+    // NAL unit type in the upper and parameter set id in the lower half.
+    uint64_t key;
+    std::vector<uint8_t> nal;
+  };
+
+  bool IsParameterSet(uint8_t nal_header) const;
+  uint64_t ParameterSetKey(std::span<const uint8_t> nal) const;
+  void CollectParameterSets(const uint8_t* data);
+  std::shared_ptr<Buffer> MakeAvcC() const;
+  std::shared_ptr<Buffer> MakeHvcC() const;
+
+  const Codec codec_;
+  // NAL positions of the access unit being converted, reused across calls.
+  std::vector<NALPosition> nals_;
+
+  // Latest raw VPS/SPS/PPS NAL unit for each type and id, in the order they
+  // first appeared.
+  std::vector<ParameterSet> parameter_sets_;
+  // Hash of the parameter sets in the last access unit that carried any.
+  uint64_t parameter_sets_hash_ = 0;
+  bool parameter_sets_changed_ = false;
+  std::shared_ptr<Buffer> config_record_;
+};
+
+}  // namespace media
+}  // namespace ave
+
+#endif  // AVE_MEDIA_FOUNDATION_NAL_BITSTREAM_CONVERTER_H_
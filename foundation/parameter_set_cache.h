@@ -0,0 +1,130 @@
+/*
+ * parameter_set_cache.h
+ * Copyright (C) 2025 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#ifndef AVE_MEDIA_FOUNDATION_PARAMETER_SET_CACHE_H_
+#define AVE_MEDIA_FOUNDATION_PARAMETER_SET_CACHE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <optional>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace ave {
+namespace media {
+
+// 64-bit FNV-1a hash of a raw parameter set NAL unit (VPS/SPS/PPS). Streams
+// repeat identical parameter sets in front of every IDR, so comparing hashes
+// is enough to tell whether anything changed.
+inline uint64_t HashParameterSet(std::span<const uint8_t> nal,
+                                 uint64_t seed = 0xcbf29ce484222325ull) {
+  uint64_t hash = seed;
+  for (uint8_t byte : nal) {
+    hash ^= byte;
+    hash *= 0x100000001b3ull;
+  }
+  return hash;
+}
+
+// Mixes two parameter set hashes, e.g. an SPS and the PPS that refers to it.
+inline uint64_t CombineParameterSetHashes(uint64_t a, uint64_t b) {
+  return a ^ (b + 0x9e3779b97f4a7c15ull + (a << 6) + (a >> 2));
+}
+
+// Small cache of parsed parameter sets keyed by the hash of their raw bytes.
+// The raw bytes are kept as well so a hash collision can never hand back the
+// wrong state. Once |capacity| entries are held the oldest one is replaced.
+//
+// Pointers returned by Lookup()/Insert()/GetOrParse() stay valid until the
+// next Insert()/GetOrParse() miss or Invalidate(). Not thread safe.
+template <typename State>
+class ParameterSetCache {
+ public:
+  static constexpr size_t kDefaultCapacity = 32;
+
+  explicit ParameterSetCache(size_t capacity = kDefaultCapacity)
+      : capacity_(capacity > 0 ? capacity : 1) {
+    entries_.reserve(capacity_);
+  }
+
+  const State* Lookup(uint64_t hash, std::span<const uint8_t> nal) const {
+    for (const auto& entry : entries_) {
+      if (entry.hash == hash && entry.nal.size() == nal.size() &&
+          memcmp(entry.nal.data(), nal.data(), nal.size()) == 0) {
+        return &entry.state;
+      }
+    }
+    return nullptr;
+  }
+
+  const State* Insert(uint64_t hash,
+                      std::span<const uint8_t> nal,
+                      State state) {
+    Entry entry{hash, std::vector<uint8_t>(nal.begin(), nal.end()),
+                std::move(state)};
+    if (entries_.size() < capacity_) {
+      entries_.push_back(std::move(entry));
+      return &entries_.back().state;
+    }
+    Entry& slot = entries_[next_evict_];
+    next_evict_ = (next_evict_ + 1) % capacity_;
+    slot = std::move(entry);
+    return &slot.state;
+  }
+
+  // Returns the state cached for |nal|, calling |parse(nal)| on a miss.
+  // |parse| returns std::optional<State>; failed parses are not cached.
+  // |hit| (optional) reports whether the parse was skipped.
+  template <typename ParseFn>
+  const State* GetOrParse(std::span<const uint8_t> nal,
+                          ParseFn&& parse,
+                          bool* hit = nullptr) {
+    const uint64_t hash = HashParameterSet(nal);
+    if (const State* state = Lookup(hash, nal)) {
+      if (hit) {
+        *hit = true;
+      }
+      return state;
+    }
+    if (hit) {
+      *hit = false;
+    }
+    std::optional<State> parsed = parse(nal);
+    if (!parsed) {
+      return nullptr;
+    }
+    return Insert(hash, nal, std::move(*parsed));
+  }
+
+  // Drops every cached entry, e.g. on a flush or when a dependent parameter
+  // set changed and states parsed against it are stale.
+  void Invalidate() {
+    entries_.clear();
+    next_evict_ = 0;
+  }
+
+  size_t size() const { return entries_.size(); }
+
+ private:
+  struct Entry {
+    uint64_t hash;
+    std::vector<uint8_t> nal;
+    State state;
+  };
+
+  const size_t capacity_;
+  size_t next_evict_ = 0;
+  std::vector<Entry> entries_;
+};
+
+}  // namespace media
+}  // namespace ave
+
+#endif  // AVE_MEDIA_FOUNDATION_PARAMETER_SET_CACHE_H_
@@ -0,0 +1,273 @@
+/*
+ * pixel_conversion.cc
+ * Copyright (C) 2025 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#include "pixel_conversion.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
+namespace ave {
+namespace media {
+
+namespace {
+
+int ChromaSize(int size) {
+  return (size + 1) / 2;
+}
+
+const uint16_t* Row16(const uint8_t* plane, int stride, int y) {
+  return reinterpret_cast<const uint16_t*>(plane + static_cast<ptrdiff_t>(y) *
+                                                       stride);
+}
+
+}  // namespace
+
+void ConvertRowTo8Bit(const uint16_t* src,
+                      uint8_t* dst,
+                      size_t count,
+                      int bit_depth) {
+  const int shift = bit_depth - 8;
+  size_t i = 0;
+#if defined(__AVX2__)
+  {
+    const __m128i count128 = _mm_cvtsi32_si128(shift);
+    for (; i + 32 <= count; i += 32) {
+      const __m256i lo = _mm256_srl_epi16(
+          _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i)),
+          count128);
+      const __m256i hi = _mm256_srl_epi16(
+          _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i + 16)),
+          count128);
+      // packus works per 128-bit lane, restore the sample order afterwards.
+      const __m256i packed =
+          _mm256_permute4x64_epi64(_mm256_packus_epi16(lo, hi), 0xd8);
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), packed);
+    }
+  }
+#endif
+#if defined(__SSE2__)
+  {
+    const __m128i count128 = _mm_cvtsi32_si128(shift);
+    for (; i + 16 <= count; i += 16) {
+      const __m128i lo = _mm_srl_epi16(
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i)),
+          count128);
+      const __m128i hi = _mm_srl_epi16(
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 8)),
+          count128);
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i),
+                       _mm_packus_epi16(lo, hi));
+    }
+  }
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+  {
+    const int16x8_t right = vdupq_n_s16(static_cast<int16_t>(-shift));
+    for (; i + 16 <= count; i += 16) {
+      const uint16x8_t lo = vshlq_u16(vld1q_u16(src + i), right);
+      const uint16x8_t hi = vshlq_u16(vld1q_u16(src + i + 8), right);
+      vst1q_u8(dst + i, vcombine_u8(vqmovn_u16(lo), vqmovn_u16(hi)));
+    }
+  }
+#endif
+  for (; i < count; ++i) {
+    dst[i] = static_cast<uint8_t>(std::min(src[i] >> shift, 255));
+  }
+}
+
+void ConvertRowToMsbAligned(const uint16_t* src,
+                            uint16_t* dst,
+                            size_t count,
+                            int bit_depth) {
+  const int shift = 16 - bit_depth;
+  size_t i = 0;
+#if defined(__AVX2__)
+  {
+    const __m128i count128 = _mm_cvtsi32_si128(shift);
+    for (; i + 16 <= count; i += 16) {
+      const __m256i samples =
+          _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i),
+                          _mm256_sll_epi16(samples, count128));
+    }
+  }
+#endif
+#if defined(__SSE2__)
+  {
+    const __m128i count128 = _mm_cvtsi32_si128(shift);
+    for (; i + 8 <= count; i += 8) {
+      const __m128i samples =
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i),
+                       _mm_sll_epi16(samples, count128));
+    }
+  }
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+  {
+    const int16x8_t left = vdupq_n_s16(static_cast<int16_t>(shift));
+    for (; i + 8 <= count; i += 8) {
+      vst1q_u16(dst + i, vshlq_u16(vld1q_u16(src + i), left));
+    }
+  }
+#endif
+  for (; i < count; ++i) {
+    dst[i] = static_cast<uint16_t>(src[i] << shift);
+  }
+}
+
+void InterleaveRowToMsbAligned(const uint16_t* u,
+                               const uint16_t* v,
+                               uint16_t* uv,
+                               size_t count,
+                               int bit_depth) {
+  const int shift = 16 - bit_depth;
+  size_t i = 0;
+#if defined(__AVX2__)
+  {
+    const __m128i count128 = _mm_cvtsi32_si128(shift);
+    for (; i + 16 <= count; i += 16) {
+      const __m256i us = _mm256_sll_epi16(
+          _mm256_loadu_si256(reinterpret_cast<const __m256i*>(u + i)),
+          count128);
+      const __m256i vs = _mm256_sll_epi16(
+          _mm256_loadu_si256(reinterpret_cast<const __m256i*>(v + i)),
+          count128);
+      // unpack works per 128-bit lane: lo holds pairs 0-3 and 8-11, hi
+      // holds 4-7 and 12-15.
+      const __m256i lo = _mm256_unpacklo_epi16(us, vs);
+      const __m256i hi = _mm256_unpackhi_epi16(us, vs);
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(uv + 2 * i),
+                          _mm256_permute2x128_si256(lo, hi, 0x20));
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(uv + 2 * i + 16),
+                          _mm256_permute2x128_si256(lo, hi, 0x31));
+    }
+  }
+#endif
+#if defined(__SSE2__)
+  {
+    const __m128i count128 = _mm_cvtsi32_si128(shift);
+    for (; i + 8 <= count; i += 8) {
+      const __m128i us = _mm_sll_epi16(
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(u + i)), count128);
+      const __m128i vs = _mm_sll_epi16(
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(v + i)), count128);
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(uv + 2 * i),
+                       _mm_unpacklo_epi16(us, vs));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(uv + 2 * i + 8),
+                       _mm_unpackhi_epi16(us, vs));
+    }
+  }
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+  {
+    const int16x8_t left = vdupq_n_s16(static_cast<int16_t>(shift));
+    for (; i + 8 <= count; i += 8) {
+      uint16x8x2_t pairs;
+      pairs.val[0] = vshlq_u16(vld1q_u16(u + i), left);
+      pairs.val[1] = vshlq_u16(vld1q_u16(v + i), left);
+      vst2q_u16(uv + 2 * i, pairs);
+    }
+  }
+#endif
+  for (; i < count; ++i) {
+    uv[2 * i] = static_cast<uint16_t>(u[i] << shift);
+    uv[2 * i + 1] = static_cast<uint16_t>(v[i] << shift);
+  }
+}
+
+size_t YUV420PictureSize(PixelFormat format, int width, int height) {
+  if (width <= 0 || height <= 0) {
+    return 0;
+  }
+  const size_t luma = static_cast<size_t>(width) * height;
+  const size_t chroma =
+      static_cast<size_t>(ChromaSize(width)) * ChromaSize(height);
+  switch (format) {
+    case AVE_PIX_FMT_YUV420P:
+      return luma + 2 * chroma;
+    case AVE_PIX_FMT_YUV420P10LE:
+    case AVE_PIX_FMT_YUV420P12LE:
+    case AVE_PIX_FMT_P010LE:
+    case AVE_PIX_FMT_P016LE:
+      return 2 * (luma + 2 * chroma);
+    default:
+      return 0;
+  }
+}
+
+size_t ConvertHighBitDepthYUV420(const HighBitDepthYUV420& src,
+                                 PixelFormat format,
+                                 uint8_t* dst,
+                                 size_t dst_size) {
+  const size_t size = YUV420PictureSize(format, src.width, src.height);
+  if (size == 0 || size > dst_size || src.bit_depth < 9 ||
+      src.bit_depth > 16) {
+    return 0;
+  }
+
+  const int chroma_width = ChromaSize(src.width);
+  const int chroma_height = ChromaSize(src.height);
+  switch (format) {
+    case AVE_PIX_FMT_YUV420P: {
+      uint8_t* out = dst;
+      for (int p = 0; p < 3; ++p) {
+        const int width = p == 0 ? src.width : chroma_width;
+        const int height = p == 0 ? src.height : chroma_height;
+        for (int y = 0; y < height; ++y) {
+          ConvertRowTo8Bit(Row16(src.data[p], src.stride[p], y), out, width,
+                           src.bit_depth);
+          out += width;
+        }
+      }
+      break;
+    }
+    case AVE_PIX_FMT_YUV420P10LE:
+    case AVE_PIX_FMT_YUV420P12LE: {
+      uint8_t* out = dst;
+      for (int p = 0; p < 3; ++p) {
+        const int width = p == 0 ? src.width : chroma_width;
+        const int height = p == 0 ? src.height : chroma_height;
+        const size_t row_size = static_cast<size_t>(width) * 2;
+        for (int y = 0; y < height; ++y) {
+          std::memcpy(out, Row16(src.data[p], src.stride[p], y), row_size);
+          out += row_size;
+        }
+      }
+      break;
+    }
+    case AVE_PIX_FMT_P010LE:
+    case AVE_PIX_FMT_P016LE: {
+      auto* out = reinterpret_cast<uint16_t*>(dst);
+      for (int y = 0; y < src.height; ++y) {
+        ConvertRowToMsbAligned(Row16(src.data[0], src.stride[0], y), out,
+                               src.width, src.bit_depth);
+        out += src.width;
+      }
+      // The UV plane has the luma width: one U and one V per two pixels.
+      for (int y = 0; y < chroma_height; ++y) {
+        InterleaveRowToMsbAligned(Row16(src.data[1], src.stride[1], y),
+                                  Row16(src.data[2], src.stride[2], y), out,
+                                  chroma_width, src.bit_depth);
+        out += 2 * chroma_width;
+      }
+      break;
+    }
+    default:
+      return 0;
+  }
+  return size;
+}
+
+}  // namespace media
+}  // namespace ave
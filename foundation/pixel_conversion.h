@@ -0,0 +1,69 @@
+/*
+ * pixel_conversion.h
+ * Copyright (C) 2025 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#ifndef AVE_MEDIA_FOUNDATION_PIXEL_CONVERSION_H_
+#define AVE_MEDIA_FOUNDATION_PIXEL_CONVERSION_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "pixel_format.h"
+
+namespace ave {
+namespace media {
+
+// Conversions of high bit depth pictures, vectorized with SSE2, AVX2 or NEON
+// when the build targets them. Samples are native endian uint16_t holding
+// |bit_depth| (9 to 16) bits in the low bits, the layout FFmpeg decoders use
+// for YUV420P10/YUV420P12.
+
+// Row kernels.
+// dst[i] = src[i] >> (bit_depth - 8), saturated to 255.
+void ConvertRowTo8Bit(const uint16_t* src,
+                      uint8_t* dst,
+                      size_t count,
+                      int bit_depth);
+// dst[i] = src[i] << (16 - bit_depth), the MSB aligned layout of P010/P016.
+void ConvertRowToMsbAligned(const uint16_t* src,
+                            uint16_t* dst,
+                            size_t count,
+                            int bit_depth);
+// Interleaves |count| U and V samples into UVUV... and MSB aligns them.
+void InterleaveRowToMsbAligned(const uint16_t* u,
+                               const uint16_t* v,
+                               uint16_t* uv,
+                               size_t count,
+                               int bit_depth);
+
+// A planar 4:2:0 picture; strides are in bytes.
+struct HighBitDepthYUV420 {
+  const uint8_t* data[3] = {};
+  int stride[3] = {};
+  int width = 0;
+  int height = 0;
+  int bit_depth = 10;
+};
+
+// Bytes a tightly packed picture of |format| takes, 0 for formats the
+// conversions below do not produce.
+size_t YUV420PictureSize(PixelFormat format, int width, int height);
+
+// Converts |src| into a tightly packed picture of |format| in |dst|:
+//  AVE_PIX_FMT_YUV420P                      8 bit planar
+//  AVE_PIX_FMT_YUV420P10LE/P12LE            native depth planar, unchanged
+//  AVE_PIX_FMT_P010LE/P016LE                MSB aligned Y plane + UV plane
+// Returns the bytes written, or 0 if the format is not one of the above or
+// |dst_size| is too small.
+size_t ConvertHighBitDepthYUV420(const HighBitDepthYUV420& src,
+                                 PixelFormat format,
+                                 uint8_t* dst,
+                                 size_t dst_size);
+
+}  // namespace media
+}  // namespace ave
+
+#endif  // AVE_MEDIA_FOUNDATION_PIXEL_CONVERSION_H_
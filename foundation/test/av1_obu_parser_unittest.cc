@@ -0,0 +1,246 @@
+/*
+ * av1_obu_parser_unittest.cc
+ * Copyright (C) 2025 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#include "../av1/av1_obu_parser.h"
+
+#include <vector>
+
+#include "../media_meta.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace ave {
+namespace media {
+
+namespace {
+
+class BitWriter {
+ public:
+  void Write(uint32_t value, int bits) {
+    for (int i = bits - 1; i >= 0; --i) {
+      if (bit_pos_ == 0) {
+        bytes_.push_back(0);
+      }
+      bytes_.back() |= ((value >> i) & 1) << (7 - bit_pos_);
+      bit_pos_ = (bit_pos_ + 1) % 8;
+    }
+  }
+  // trailing_bits()
+  std::vector<uint8_t> Finish() {
+    Write(1, 1);
+    while (bit_pos_ != 0) {
+      Write(0, 1);
+    }
+    return bytes_;
+  }
+
+ private:
+  std::vector<uint8_t> bytes_;
+  int bit_pos_ = 0;
+};
+
+// 1920x1080, main profile, 10 bit, BT.2020 PQ, level 4.0.
+std::vector<uint8_t> MakeSequenceHeader() {
+  BitWriter w;
+  w.Write(0, 3);     // seq_profile
+  w.Write(0, 1);     // still_picture
+  w.Write(0, 1);     // reduced_still_picture_header
+  w.Write(0, 1);     // timing_info_present_flag
+  w.Write(0, 1);     // initial_display_delay_present_flag
+  w.Write(0, 5);     // operating_points_cnt_minus_1
+  w.Write(0, 12);    // operating_point_idc[0]
+  w.Write(8, 5);     // seq_level_idx[0]
+  w.Write(0, 1);     // seq_tier[0]
+  w.Write(10, 4);    // frame_width_bits_minus_1
+  w.Write(10, 4);    // frame_height_bits_minus_1
+  w.Write(1919, 11); // max_frame_width_minus_1
+  w.Write(1079, 11); // max_frame_height_minus_1
+  w.Write(0, 1);     // frame_id_numbers_present_flag
+  w.Write(0, 1);     // use_128x128_superblock
+  w.Write(1, 1);     // enable_filter_intra
+  w.Write(1, 1);     // enable_intra_edge_filter
+  w.Write(0, 4);     // interintra, masked, warped, dual_filter
+  w.Write(1, 1);     // enable_order_hint
+  w.Write(0, 2);     // enable_jnt_comp, enable_ref_frame_mvs
+  w.Write(1, 1);     // seq_choose_screen_content_tools
+  w.Write(1, 1);     // seq_choose_integer_mv
+  w.Write(6, 3);     // order_hint_bits_minus_1
+  w.Write(0, 1);     // enable_superres
+  w.Write(1, 1);     // enable_cdef
+  w.Write(1, 1);     // enable_restoration
+  w.Write(1, 1);     // high_bitdepth
+  w.Write(0, 1);     // mono_chrome
+  w.Write(1, 1);     // color_description_present_flag
+  w.Write(9, 8);     // color_primaries
+  w.Write(16, 8);    // transfer_characteristics
+  w.Write(9, 8);     // matrix_coefficients
+  w.Write(0, 1);     // color_range
+  w.Write(0, 2);     // chroma_sample_position
+  w.Write(0, 1);     // separate_uv_delta_q
+  w.Write(0, 1);     // film_grain_params_present
+  return w.Finish();
+}
+
+// Shown key frame of the stream above with frame_size_override_flag set.
+std::vector<uint8_t> MakeKeyFrameHeader(uint32_t width, uint32_t height) {
+  BitWriter w;
+  w.Write(0, 1);           // show_existing_frame
+  w.Write(0, 2);           // frame_type: KEY_FRAME
+  w.Write(1, 1);           // show_frame
+  w.Write(0, 1);           // disable_cdf_update
+  w.Write(0, 1);           // allow_screen_content_tools
+  w.Write(1, 1);           // frame_size_override_flag
+  w.Write(0, 7);           // order_hint
+  w.Write(width - 1, 11);  // frame_width_minus_1
+  w.Write(height - 1, 11); // frame_height_minus_1
+  w.Write(0, 1);           // render_and_frame_size_different
+  return w.Finish();
+}
+
+// Shown inter frame, sized from a reference when |frame_size_override|.
+std::vector<uint8_t> MakeInterFrameHeader(bool frame_size_override) {
+  BitWriter w;
+  w.Write(0, 1);  // show_existing_frame
+  w.Write(1, 2);  // frame_type: INTER_FRAME
+  w.Write(1, 1);  // show_frame
+  w.Write(0, 1);  // error_resilient_mode
+  w.Write(0, 1);  // disable_cdf_update
+  w.Write(0, 1);  // allow_screen_content_tools
+  w.Write(frame_size_override ? 1 : 0, 1);
+  w.Write(1, 7);  // order_hint
+  w.Write(7, 3);  // primary_ref_frame: PRIMARY_REF_NONE
+  w.Write(1, 8);  // refresh_frame_flags
+  return w.Finish();
+}
+
+void AppendObu(uint8_t type,
+               const std::vector<uint8_t>& payload,
+               std::vector<uint8_t>* out) {
+  out->push_back(static_cast<uint8_t>(type << 3) | 0x02);  // obu_has_size
+  out->push_back(static_cast<uint8_t>(payload.size()));
+  out->insert(out->end(), payload.begin(), payload.end());
+}
+
+}  // namespace
+
+TEST(Av1ObuParserTest, ParsesSequenceHeader) {
+  std::vector<uint8_t> payload = MakeSequenceHeader();
+  auto seq = Av1ObuParser::ParseSequenceHeader(payload);
+  ASSERT_TRUE(seq.has_value());
+  EXPECT_EQ(0, seq->seq_profile);
+  EXPECT_EQ(8, seq->seq_level_idx);
+  EXPECT_EQ(1920u, seq->max_frame_width);
+  EXPECT_EQ(1080u, seq->max_frame_height);
+  EXPECT_EQ(10, seq->bit_depth);
+  EXPECT_EQ(9, seq->color_primaries);
+  EXPECT_EQ(16, seq->transfer_characteristics);
+  EXPECT_TRUE(seq->subsampling_x);
+  EXPECT_TRUE(seq->subsampling_y);
+  EXPECT_EQ(7, seq->order_hint_bits);
+}
+
+TEST(Av1ObuParserTest, TruncatedSequenceHeaderFails) {
+  std::vector<uint8_t> payload = MakeSequenceHeader();
+  payload.resize(4);
+  EXPECT_FALSE(Av1ObuParser::ParseSequenceHeader(payload).has_value());
+}
+
+TEST(Av1BitstreamParserTest, DetectsKeyFrameTemporalUnit) {
+  std::vector<uint8_t> temporal_unit;
+  AppendObu(AV1::kObuTemporalDelimiter, {}, &temporal_unit);
+  AppendObu(AV1::kObuSequenceHeader, MakeSequenceHeader(), &temporal_unit);
+  // show_existing_frame = 0, frame_type = KEY_FRAME, show_frame = 1.
+  AppendObu(AV1::kObuFrame, {0x10, 0x00, 0x00}, &temporal_unit);
+
+  Av1BitstreamParser parser;
+  parser.ParseBitstream(temporal_unit);
+  EXPECT_TRUE(parser.StartsTemporalUnit());
+  EXPECT_TRUE(parser.SequenceHeaderChanged());
+  EXPECT_TRUE(parser.IsKeyFrame());
+  ASSERT_NE(nullptr, parser.GetSequenceHeader());
+  EXPECT_EQ(1920u, parser.GetSequenceHeader()->max_frame_width);
+
+  // A repeated sequence header is not a change; an inter frame is not key.
+  std::vector<uint8_t> delta_unit;
+  AppendObu(AV1::kObuTemporalDelimiter, {}, &delta_unit);
+  AppendObu(AV1::kObuSequenceHeader, MakeSequenceHeader(), &delta_unit);
+  // show_existing_frame = 0, frame_type = INTER_FRAME, show_frame = 1.
+  AppendObu(AV1::kObuFrame, {0x30, 0x00, 0x00}, &delta_unit);
+  parser.ParseBitstream(delta_unit);
+  EXPECT_FALSE(parser.SequenceHeaderChanged());
+  EXPECT_FALSE(parser.IsKeyFrame());
+  ASSERT_TRUE(parser.GetLastFrameHeader().has_value());
+  EXPECT_EQ(AV1::kInterFrame, *parser.GetLastFrameHeader()->frame_type);
+}
+
+TEST(Av1ObuParserTest, ParsesKeyFrameSize) {
+  auto seq = Av1ObuParser::ParseSequenceHeader(MakeSequenceHeader());
+  ASSERT_TRUE(seq.has_value());
+  auto header =
+      Av1ObuParser::ParseFrameHeader(MakeKeyFrameHeader(1280, 720), *seq);
+  ASSERT_TRUE(header.has_value());
+  EXPECT_EQ(AV1::kKeyFrame, *header->frame_type);
+  EXPECT_EQ(1280u, header->frame_width);
+  EXPECT_EQ(720u, header->frame_height);
+
+  // Without the override an inter frame has the maximum size.
+  header = Av1ObuParser::ParseFrameHeader(MakeInterFrameHeader(false), *seq);
+  ASSERT_TRUE(header.has_value());
+  EXPECT_EQ(1920u, header->frame_width);
+  EXPECT_EQ(1080u, header->frame_height);
+
+  header = Av1ObuParser::ParseFrameHeader(MakeInterFrameHeader(true), *seq);
+  ASSERT_TRUE(header.has_value());
+  EXPECT_EQ(0u, header->frame_width);
+}
+
+TEST(Av1ObuParserTest, TruncatedFrameHeaderKeepsFrameType) {
+  auto seq = Av1ObuParser::ParseSequenceHeader(MakeSequenceHeader());
+  ASSERT_TRUE(seq.has_value());
+  std::vector<uint8_t> payload = MakeKeyFrameHeader(1280, 720);
+  payload.resize(1);
+  auto header = Av1ObuParser::ParseFrameHeader(payload, *seq);
+  ASSERT_TRUE(header.has_value());
+  EXPECT_EQ(AV1::kKeyFrame, *header->frame_type);
+  EXPECT_EQ(0u, header->frame_width);
+}
+
+TEST(Av1BitstreamParserTest, MediaMetaUsesFrameSize) {
+  std::vector<uint8_t> temporal_unit;
+  AppendObu(AV1::kObuTemporalDelimiter, {}, &temporal_unit);
+  AppendObu(AV1::kObuSequenceHeader, MakeSequenceHeader(), &temporal_unit);
+  AppendObu(AV1::kObuFrameHeader, MakeKeyFrameHeader(1280, 720),
+            &temporal_unit);
+
+  Av1BitstreamParser parser;
+  parser.ParseBitstream(temporal_unit);
+  EXPECT_TRUE(parser.IsKeyFrame());
+  MediaMeta meta =
+      MediaMeta::Create(MediaType::VIDEO, MediaMeta::FormatType::kSample);
+  parser.FillMediaMeta(&meta);
+  EXPECT_EQ(1280, meta.width());
+  EXPECT_EQ(720, meta.height());
+
+  // An inter frame sized from a reference keeps the key frame size.
+  std::vector<uint8_t> delta_unit;
+  AppendObu(AV1::kObuTemporalDelimiter, {}, &delta_unit);
+  AppendObu(AV1::kObuFrameHeader, MakeInterFrameHeader(true), &delta_unit);
+  parser.ParseBitstream(delta_unit);
+  EXPECT_EQ(1280u, parser.frame_width());
+  EXPECT_EQ(720u, parser.frame_height());
+}
+
+TEST(Av1BitstreamParserTest, FrameWithoutSequenceHeaderIsIgnored) {
+  std::vector<uint8_t> temporal_unit;
+  AppendObu(AV1::kObuFrame, {0x10, 0x00}, &temporal_unit);
+  Av1BitstreamParser parser;
+  parser.ParseBitstream(temporal_unit);
+  EXPECT_FALSE(parser.IsKeyFrame());
+  EXPECT_EQ(nullptr, parser.GetSequenceHeader());
+}
+
+}  // namespace media
+}  // namespace ave
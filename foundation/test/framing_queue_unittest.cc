@@ -0,0 +1,92 @@
+/*
+ * framing_queue_unittest.cc
+ * Copyright (C) 2025 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#include "../framing_queue.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace ave {
+namespace media {
+
+namespace {
+
+// 640x480 8 bit 4:2:0 sequence header, main profile, level 3.0, no order
+// hints and screen content tools off, so frame headers stay short.
+const std::vector<uint8_t> kSequenceHeader = {
+    0x00, 0x00, 0x00, 0x24, 0xc4, 0xff, 0xdf, 0x00, 0x00, 0x02};
+// KEY_FRAME, show_frame, frame_size_override_flag with 320x240.
+const std::vector<uint8_t> kKeyFrameHeader = {0x15, 0x3f, 0x77, 0xa0};
+// INTER_FRAME, show_frame, no size override.
+const std::vector<uint8_t> kInterFrameHeader = {0x31, 0xc0, 0x60};
+
+void AppendObu(uint8_t type,
+               const std::vector<uint8_t>& payload,
+               std::vector<uint8_t>* out) {
+  out->push_back(static_cast<uint8_t>(type << 3) | 0x02);  // obu_has_size
+  out->push_back(static_cast<uint8_t>(payload.size()));
+  out->insert(out->end(), payload.begin(), payload.end());
+}
+
+// Two temporal units: sequence header and key frame, then an inter frame.
+std::vector<uint8_t> MakeAv1Stream() {
+  std::vector<uint8_t> stream;
+  AppendObu(AV1::kObuTemporalDelimiter, {}, &stream);
+  AppendObu(AV1::kObuSequenceHeader, kSequenceHeader, &stream);
+  AppendObu(AV1::kObuFrameHeader, kKeyFrameHeader, &stream);
+  AppendObu(AV1::kObuTemporalDelimiter, {}, &stream);
+  AppendObu(AV1::kObuFrameHeader, kInterFrameHeader, &stream);
+  return stream;
+}
+
+}  // namespace
+
+TEST(FramingQueueTest, SplitsAv1TemporalUnits) {
+  const std::vector<uint8_t> stream = MakeAv1Stream();
+  FramingQueue queue(FramingQueue::CodecType::kAV1);
+  // Feed a few bytes at a time so OBUs straddle PushData() calls.
+  for (size_t offset = 0; offset < stream.size(); offset += 3) {
+    const size_t size = std::min<size_t>(3, stream.size() - offset);
+    ASSERT_EQ(OK, queue.PushData(stream.data() + offset, size));
+  }
+
+  // The second temporal unit is only complete once the stream ends.
+  ASSERT_EQ(1u, queue.FrameCount());
+  queue.Flush();
+  ASSERT_EQ(2u, queue.FrameCount());
+
+  auto key_frame = queue.PopFrame();
+  ASSERT_NE(nullptr, key_frame);
+  // Temporal delimiter, sequence header and frame header OBUs.
+  EXPECT_EQ(2 + 2 + kSequenceHeader.size() + 2 + kKeyFrameHeader.size(),
+            key_frame->size());
+  EXPECT_EQ(PictureType::I, key_frame->meta()->picture_type());
+  EXPECT_EQ(320, key_frame->meta()->width());
+  EXPECT_EQ(240, key_frame->meta()->height());
+
+  auto inter_frame = queue.PopFrame();
+  ASSERT_NE(nullptr, inter_frame);
+  EXPECT_EQ(2 + 2 + kInterFrameHeader.size(), inter_frame->size());
+  EXPECT_NE(PictureType::I, inter_frame->meta()->picture_type());
+  EXPECT_EQ(640, inter_frame->meta()->width());
+  EXPECT_EQ(480, inter_frame->meta()->height());
+  EXPECT_EQ(nullptr, queue.PopFrame());
+}
+
+TEST(FramingQueueTest, RejectsAv1ObuWithoutSize) {
+  FramingQueue queue(FramingQueue::CodecType::kAV1);
+  // Temporal delimiter without obu_has_size_field.
+  const uint8_t obu[] = {AV1::kObuTemporalDelimiter << 3, 0x00};
+  EXPECT_EQ(OK, queue.PushData(obu, sizeof(obu)));
+  queue.Flush();
+  EXPECT_FALSE(queue.HasFrame());
+}
+
+}  // namespace media
+}  // namespace ave
@@ -0,0 +1,218 @@
+/*
+ * h265_bitstream_parser_unittest.cc
+ * Copyright (C) 2025 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#include "../h265/h265_bitstream_parser.h"
+
+#include <cstdint>
+#include <vector>
+
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace ave {
+namespace media {
+
+namespace {
+
+// Writes the RBSP of a NAL unit MSB first.
+class RbspWriter {
+ public:
+  void Bits(uint64_t value, int count) {
+    for (int i = count - 1; i >= 0; --i) {
+      Bit((value >> i) & 1);
+    }
+  }
+
+  void Ue(uint32_t value) {
+    const uint64_t code = static_cast<uint64_t>(value) + 1;
+    int length = 0;
+    while ((code >> length) > 1) {
+      ++length;
+    }
+    Bits(0, length);
+    Bits(code, length + 1);
+  }
+
+  void Se(int32_t value) {
+    Ue(value > 0 ? 2 * value - 1 : -2 * value);
+  }
+
+  // rbsp_trailing_bits(), then the NAL unit with its start code, header and
+  // emulation prevention bytes.
+  std::vector<uint8_t> Nal(uint8_t nal_type) {
+    Bit(1);
+    while (bit_count_ % 8 != 0) {
+      Bit(0);
+    }
+    std::vector<uint8_t> nal = {0, 0, 0, 1, static_cast<uint8_t>(nal_type << 1),
+                                0x01};
+    int zeros = 0;
+    for (uint8_t byte : rbsp_) {
+      if (zeros == 2 && byte <= 3) {
+        nal.push_back(3);
+        zeros = 0;
+      }
+      nal.push_back(byte);
+      zeros = byte == 0 ? zeros + 1 : 0;
+    }
+    return nal;
+  }
+
+ private:
+  void Bit(uint64_t bit) {
+    if (bit_count_ % 8 == 0) {
+      rbsp_.push_back(0);
+    }
+    rbsp_.back() |= static_cast<uint8_t>(bit << (7 - bit_count_ % 8));
+    ++bit_count_;
+  }
+
+  std::vector<uint8_t> rbsp_;
+  size_t bit_count_ = 0;
+};
+
+// 64x64 4:2:0 SPS with id 0 and the given luma/chroma bit depth.
+std::vector<uint8_t> MakeSps(uint32_t bit_depth_minus8) {
+  RbspWriter writer;
+  writer.Bits(0, 4);  // sps_video_parameter_set_id
+  writer.Bits(0, 3);  // sps_max_sub_layers_minus1
+  writer.Bits(1, 1);  // sps_temporal_id_nesting_flag
+  // profile_tier_level(): Main or Main 10, level 3.1.
+  writer.Bits(0, 2);
+  writer.Bits(0, 1);
+  writer.Bits(bit_depth_minus8 == 0 ? 1 : 2, 5);
+  writer.Bits(0x60000000, 32);
+  writer.Bits(1, 1);  // general_progressive_source_flag
+  writer.Bits(0, 1);  // general_interlaced_source_flag
+  writer.Bits(0, 1);  // general_non_packed_constraint_flag
+  writer.Bits(1, 1);  // general_frame_only_constraint_flag
+  writer.Bits(0, 7);
+  writer.Bits(0, 1);
+  writer.Bits(0, 35);
+  writer.Bits(0, 1);
+  writer.Bits(93, 8);  // general_level_idc
+  writer.Ue(0);        // sps_seq_parameter_set_id
+  writer.Ue(1);        // chroma_format_idc
+  writer.Ue(64);       // pic_width_in_luma_samples
+  writer.Ue(64);       // pic_height_in_luma_samples
+  writer.Bits(0, 1);   // conformance_window_flag
+  writer.Ue(bit_depth_minus8);  // bit_depth_luma_minus8
+  writer.Ue(bit_depth_minus8);  // bit_depth_chroma_minus8
+  writer.Ue(4);                 // log2_max_pic_order_cnt_lsb_minus4
+  writer.Bits(1, 1);  // sps_sub_layer_ordering_info_present_flag
+  writer.Ue(1);       // sps_max_dec_pic_buffering_minus1
+  writer.Ue(0);       // sps_max_num_reorder_pics
+  writer.Ue(0);       // sps_max_latency_increase_plus1
+  writer.Ue(0);       // log2_min_luma_coding_block_size_minus3
+  writer.Ue(1);       // log2_diff_max_min_luma_coding_block_size
+  writer.Ue(0);       // log2_min_luma_transform_block_size_minus2
+  writer.Ue(2);       // log2_diff_max_min_luma_transform_block_size
+  writer.Ue(0);       // max_transform_hierarchy_depth_inter
+  writer.Ue(0);       // max_transform_hierarchy_depth_intra
+  writer.Bits(0, 1);  // scaling_list_enabled_flag
+  writer.Bits(0, 1);  // amp_enabled_flag
+  writer.Bits(0, 1);  // sample_adaptive_offset_enabled_flag
+  writer.Bits(0, 1);  // pcm_enabled_flag
+  writer.Ue(0);       // num_short_term_ref_pic_sets
+  writer.Bits(0, 1);  // long_term_ref_pics_present_flag
+  writer.Bits(0, 1);  // sps_temporal_mvp_enabled_flag
+  writer.Bits(0, 1);  // strong_intra_smoothing_enabled_flag
+  writer.Bits(0, 1);  // vui_parameters_present_flag
+  writer.Bits(0, 1);  // sps_extension_present_flag
+  return writer.Nal(33);
+}
+
+// PPS with id 0 referring to SPS 0.
+std::vector<uint8_t> MakePps(int32_t init_qp_minus26) {
+  RbspWriter writer;
+  writer.Ue(0);       // pps_pic_parameter_set_id
+  writer.Ue(0);       // pps_seq_parameter_set_id
+  writer.Bits(0, 1);  // dependent_slice_segments_enabled_flag
+  writer.Bits(0, 1);  // output_flag_present_flag
+  writer.Bits(0, 3);  // num_extra_slice_header_bits
+  writer.Bits(0, 1);  // sign_data_hiding_enabled_flag
+  writer.Bits(0, 1);  // cabac_init_present_flag
+  writer.Ue(0);       // num_ref_idx_l0_default_active_minus1
+  writer.Ue(0);       // num_ref_idx_l1_default_active_minus1
+  writer.Se(init_qp_minus26);
+  writer.Bits(0, 1);  // constrained_intra_pred_flag
+  writer.Bits(0, 1);  // transform_skip_enabled_flag
+  writer.Bits(0, 1);  // cu_qp_delta_enabled_flag
+  writer.Se(0);       // pps_cb_qp_offset
+  writer.Se(0);       // pps_cr_qp_offset
+  writer.Bits(0, 1);  // pps_slice_chroma_qp_offsets_present_flag
+  writer.Bits(0, 1);  // weighted_pred_flag
+  writer.Bits(0, 1);  // weighted_bipred_flag
+  writer.Bits(0, 1);  // transquant_bypass_enabled_flag
+  writer.Bits(0, 1);  // tiles_enabled_flag
+  writer.Bits(0, 1);  // entropy_coding_sync_enabled_flag
+  writer.Bits(0, 1);  // pps_loop_filter_across_slices_enabled_flag
+  writer.Bits(0, 1);  // deblocking_filter_control_present_flag
+  writer.Bits(0, 1);  // pps_scaling_list_data_present_flag
+  writer.Bits(0, 1);  // lists_modification_present_flag
+  writer.Ue(0);       // log2_parallel_merge_level_minus2
+  writer.Bits(0, 1);  // slice_segment_header_extension_present_flag
+  writer.Bits(0, 1);  // pps_extension_present_flag
+  return writer.Nal(34);
+}
+
+// Header of the first I slice segment of an IDR_W_RADL picture using PPS 0.
+std::vector<uint8_t> MakeIdrSlice(int32_t slice_qp_delta) {
+  RbspWriter writer;
+  writer.Bits(1, 1);  // first_slice_segment_in_pic_flag
+  writer.Bits(0, 1);  // no_output_of_prior_pics_flag
+  writer.Ue(0);       // slice_pic_parameter_set_id
+  writer.Ue(2);       // slice_type: I
+  writer.Se(slice_qp_delta);
+  return writer.Nal(19);
+}
+
+}  // namespace
+
+TEST(H265BitstreamParserTest, ParsesSliceQp) {
+  H265BitstreamParser parser;
+  parser.ParseBitstream(MakeSps(0));
+  parser.ParseBitstream(MakePps(0));
+  parser.ParseBitstream(MakeIdrSlice(4));
+  ASSERT_TRUE(parser.GetLastSliceQp().has_value());
+  EXPECT_EQ(30, *parser.GetLastSliceQp());
+}
+
+// init_qp_minus26 = -30 is only valid with 10 bit luma, so the PPS is
+// accepted against SPS B and has to be rejected again once SPS A is back,
+// even though both SPSs are already in the cache by then.
+TEST(H265BitstreamParserTest, ReparsesCachedPpsWhenSpsChanges) {
+  const std::vector<uint8_t> sps_a = MakeSps(0);
+  const std::vector<uint8_t> sps_b = MakeSps(2);
+  const std::vector<uint8_t> pps_x = MakePps(-30);
+  const std::vector<uint8_t> pps_y = MakePps(0);
+
+  H265BitstreamParser parser;
+  parser.ParseBitstream(sps_a);
+  parser.ParseBitstream(sps_b);
+  parser.ParseBitstream(pps_x);
+  parser.ParseBitstream(MakeIdrSlice(10));
+  ASSERT_TRUE(parser.GetLastSliceQp().has_value());
+  EXPECT_EQ(6, *parser.GetLastSliceQp());
+
+  parser.ParseBitstream(pps_y);
+  parser.ParseBitstream(sps_a);
+  // Invalid against SPS A, PPS Y stays active.
+  parser.ParseBitstream(pps_x);
+  parser.ParseBitstream(MakeIdrSlice(10));
+  ASSERT_TRUE(parser.GetLastSliceQp().has_value());
+  EXPECT_EQ(36, *parser.GetLastSliceQp());
+
+  // Back on SPS B the PPS is valid again.
+  parser.ParseBitstream(sps_b);
+  parser.ParseBitstream(pps_x);
+  parser.ParseBitstream(MakeIdrSlice(10));
+  ASSERT_TRUE(parser.GetLastSliceQp().has_value());
+  EXPECT_EQ(6, *parser.GetLastSliceQp());
+}
+
+}  // namespace media
+}  // namespace ave
@@ -104,6 +104,8 @@ TEST_F(MediaFormatTest, VideoProperties) {
   // Test pixel format
   track_format_->SetPixelFormat(PixelFormat::AVE_PIX_FMT_YUV420P);
   EXPECT_EQ(track_format_->pixel_format(), PixelFormat::AVE_PIX_FMT_YUV420P);
+  sample_format_->SetPixelFormat(PixelFormat::AVE_PIX_FMT_P010LE);
+  EXPECT_EQ(sample_format_->pixel_format(), PixelFormat::AVE_PIX_FMT_P010LE);
 
   // Test picture type
   sample_format_->SetPictureType(PictureType::I);
@@ -0,0 +1,226 @@
+/*
+ * nal_bitstream_converter_unittest.cc
+ * Copyright (C) 2025 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#include "../nal_bitstream_converter.h"
+
+#include <cstring>
+#include <vector>
+
+#include "../media_errors.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace ave {
+namespace media {
+
+namespace {
+
+// A baseline level 3.0 SPS and PPS.
+const std::vector<uint8_t> kSps = {0x67, 0x42, 0xc0, 0x1e, 0xd9, 0x00, 0xa0,
+                                   0x47, 0xfe, 0xc8};
+const std::vector<uint8_t> kPps = {0x68, 0xce, 0x3c, 0x80};
+const std::vector<uint8_t> kIdr = {0x65, 0x88, 0x84, 0x00, 0x33, 0xff};
+const std::vector<uint8_t> kSlice = {0x41, 0x9a, 0x02, 0x04};
+
+std::shared_ptr<Buffer> MakeBuffer(const std::vector<uint8_t>& bytes) {
+  return Buffer::CreateAsCopy(bytes.data(), bytes.size());
+}
+
+void Append(std::vector<uint8_t>* out,
+            const std::vector<uint8_t>& prefix,
+            const std::vector<uint8_t>& nal) {
+  out->insert(out->end(), prefix.begin(), prefix.end());
+  out->insert(out->end(), nal.begin(), nal.end());
+}
+
+const std::vector<uint8_t> kLongStartCode = {0, 0, 0, 1};
+const std::vector<uint8_t> kShortStartCode = {0, 0, 1};
+
+std::vector<uint8_t> Length(size_t size) {
+  return {0, 0, static_cast<uint8_t>(size >> 8), static_cast<uint8_t>(size)};
+}
+
+}  // namespace
+
+TEST(NalBitstreamConverterTest, ConvertsLongStartCodesInPlace) {
+  std::vector<uint8_t> annexb;
+  Append(&annexb, kLongStartCode, kSps);
+  Append(&annexb, kLongStartCode, kPps);
+  Append(&annexb, kLongStartCode, kIdr);
+  auto buffer = MakeBuffer(annexb);
+  const Buffer* original = buffer.get();
+
+  NalBitstreamConverter converter(NalBitstreamConverter::Codec::kH264);
+  ASSERT_EQ(converter.AnnexBToLengthPrefixed(&buffer), OK);
+  EXPECT_EQ(buffer.get(), original);
+
+  std::vector<uint8_t> expected;
+  Append(&expected, Length(kSps.size()), kSps);
+  Append(&expected, Length(kPps.size()), kPps);
+  Append(&expected, Length(kIdr.size()), kIdr);
+  EXPECT_EQ(std::vector<uint8_t>(buffer->data(),
+                                 buffer->data() + buffer->size()),
+            expected);
+  EXPECT_TRUE(converter.ParameterSetsChanged());
+}
+
+TEST(NalBitstreamConverterTest, CopiesWhenShortStartCodesGrow) {
+  std::vector<uint8_t> annexb;
+  Append(&annexb, kShortStartCode, kSlice);
+  Append(&annexb, kShortStartCode, kSlice);
+  auto buffer = MakeBuffer(annexb);
+  const Buffer* original = buffer.get();
+
+  NalBitstreamConverter converter(NalBitstreamConverter::Codec::kH264);
+  ASSERT_EQ(converter.AnnexBToLengthPrefixed(&buffer), OK);
+  EXPECT_NE(buffer.get(), original);
+
+  std::vector<uint8_t> expected;
+  Append(&expected, Length(kSlice.size()), kSlice);
+  Append(&expected, Length(kSlice.size()), kSlice);
+  EXPECT_EQ(std::vector<uint8_t>(buffer->data(),
+                                 buffer->data() + buffer->size()),
+            expected);
+  EXPECT_FALSE(converter.ParameterSetsChanged());
+}
+
+TEST(NalBitstreamConverterTest, ShortStartCodeAfterLongOneFitsInPlace) {
+  // A leading zero_byte plus a 4-byte start code leave room for a later
+  // 3-byte one.
+  std::vector<uint8_t> annexb = {0};
+  Append(&annexb, kLongStartCode, kSlice);
+  Append(&annexb, kShortStartCode, kSlice);
+  auto buffer = MakeBuffer(annexb);
+  const Buffer* original = buffer.get();
+
+  NalBitstreamConverter converter(NalBitstreamConverter::Codec::kH264);
+  ASSERT_EQ(converter.AnnexBToLengthPrefixed(&buffer), OK);
+  EXPECT_EQ(buffer.get(), original);
+  ASSERT_EQ(buffer->size(), 2 * (4 + kSlice.size()));
+  EXPECT_EQ(memcmp(buffer->data() + 4 + kSlice.size() + 4, kSlice.data(),
+                   kSlice.size()),
+            0);
+}
+
+TEST(NalBitstreamConverterTest, LengthPrefixedToAnnexB) {
+  std::vector<uint8_t> avcc;
+  Append(&avcc, Length(kIdr.size()), kIdr);
+  Append(&avcc, Length(kSlice.size()), kSlice);
+  auto buffer = MakeBuffer(avcc);
+  const Buffer* original = buffer.get();
+
+  NalBitstreamConverter converter(NalBitstreamConverter::Codec::kH264);
+  ASSERT_EQ(converter.LengthPrefixedToAnnexB(&buffer), OK);
+  EXPECT_EQ(buffer.get(), original);
+  std::vector<uint8_t> expected;
+  Append(&expected, kLongStartCode, kIdr);
+  Append(&expected, kLongStartCode, kSlice);
+  EXPECT_EQ(std::vector<uint8_t>(buffer->data(),
+                                 buffer->data() + buffer->size()),
+            expected);
+
+  // Two byte lengths grow, so they are copied.
+  std::vector<uint8_t> short_lengths = {0, static_cast<uint8_t>(kIdr.size())};
+  short_lengths.insert(short_lengths.end(), kIdr.begin(), kIdr.end());
+  buffer = MakeBuffer(short_lengths);
+  ASSERT_EQ(converter.LengthPrefixedToAnnexB(&buffer, 2), OK);
+  expected.clear();
+  Append(&expected, kLongStartCode, kIdr);
+  EXPECT_EQ(std::vector<uint8_t>(buffer->data(),
+                                 buffer->data() + buffer->size()),
+            expected);
+
+  // A length running past the end is rejected.
+  buffer = MakeBuffer({0, 0, 0, 9, 0x65});
+  EXPECT_EQ(converter.LengthPrefixedToAnnexB(&buffer), ERROR_MALFORMED);
+}
+
+TEST(NalBitstreamConverterTest, BuildsAvcCFromCachedParameterSets) {
+  std::vector<uint8_t> annexb;
+  Append(&annexb, kLongStartCode, kSps);
+  Append(&annexb, kLongStartCode, kPps);
+  Append(&annexb, kLongStartCode, kIdr);
+
+  NalBitstreamConverter converter(NalBitstreamConverter::Codec::kH264);
+  EXPECT_EQ(converter.GetCodecConfigRecord(), nullptr);
+  auto buffer = MakeBuffer(annexb);
+  ASSERT_EQ(converter.AnnexBToLengthPrefixed(&buffer), OK);
+
+  std::shared_ptr<Buffer> avcc = converter.GetCodecConfigRecord();
+  ASSERT_NE(avcc, nullptr);
+  ASSERT_EQ(avcc->size(), 7 + 2 + kSps.size() + 2 + kPps.size());
+  const uint8_t* record = avcc->data();
+  EXPECT_EQ(record[0], 1);
+  EXPECT_EQ(record[1], 0x42);  // profile_idc
+  EXPECT_EQ(record[3], 0x1e);  // level_idc
+  EXPECT_EQ(record[4], 0xff);  // 4-byte lengths
+  EXPECT_EQ(record[5], 0xe1);  // one SPS
+  EXPECT_EQ(record[7], kSps.size());
+
+  // The same parameter sets again keep the cached record.
+  buffer = MakeBuffer(annexb);
+  ASSERT_EQ(converter.AnnexBToLengthPrefixed(&buffer), OK);
+  EXPECT_FALSE(converter.ParameterSetsChanged());
+  EXPECT_EQ(converter.GetCodecConfigRecord(), avcc);
+}
+
+TEST(NalBitstreamConverterTest, MergesParameterSetsAcrossAccessUnits) {
+  // pps_pic_parameter_set_id 1, otherwise like kPps.
+  const std::vector<uint8_t> pps1 = {0x68, 0x53, 0x8f, 0x20};
+  // pps_pic_parameter_set_id 0 with different contents.
+  const std::vector<uint8_t> pps0_update = {0x68, 0xce, 0x38, 0x80};
+
+  NalBitstreamConverter converter(NalBitstreamConverter::Codec::kH264);
+  auto convert = [&converter](const std::vector<uint8_t>& parameter_set) {
+    std::vector<uint8_t> annexb;
+    Append(&annexb, kLongStartCode, parameter_set);
+    Append(&annexb, kLongStartCode, kIdr);
+    auto buffer = MakeBuffer(annexb);
+    return converter.AnnexBToLengthPrefixed(&buffer);
+  };
+
+  // The SPS alone is not enough for a record.
+  ASSERT_EQ(convert(kSps), OK);
+  EXPECT_TRUE(converter.ParameterSetsChanged());
+  EXPECT_EQ(converter.GetCodecConfigRecord(), nullptr);
+
+  // The PPS in the next access unit keeps the SPS.
+  ASSERT_EQ(convert(kPps), OK);
+  EXPECT_TRUE(converter.ParameterSetsChanged());
+  std::shared_ptr<Buffer> avcc = converter.GetCodecConfigRecord();
+  ASSERT_NE(avcc, nullptr);
+  ASSERT_EQ(avcc->size(), 7 + 2 + kSps.size() + 2 + kPps.size());
+  EXPECT_EQ(avcc->data()[5], 0xe1);  // one SPS
+  EXPECT_EQ(avcc->data()[8 + kSps.size()], 1);  // one PPS
+
+  // The SPS repeated on its own changes nothing.
+  ASSERT_EQ(convert(kSps), OK);
+  EXPECT_FALSE(converter.ParameterSetsChanged());
+  EXPECT_EQ(converter.GetCodecConfigRecord(), avcc);
+
+  // Another PPS id is added.
+  ASSERT_EQ(convert(pps1), OK);
+  EXPECT_TRUE(converter.ParameterSetsChanged());
+  avcc = converter.GetCodecConfigRecord();
+  ASSERT_NE(avcc, nullptr);
+  ASSERT_EQ(avcc->size(),
+            7 + 2 + kSps.size() + 2 + kPps.size() + 2 + pps1.size());
+  EXPECT_EQ(avcc->data()[8 + kSps.size()], 2);
+
+  // A new PPS 0 replaces the old one in place.
+  ASSERT_EQ(convert(pps0_update), OK);
+  EXPECT_TRUE(converter.ParameterSetsChanged());
+  avcc = converter.GetCodecConfigRecord();
+  ASSERT_NE(avcc, nullptr);
+  const uint8_t* pps_array = avcc->data() + 8 + kSps.size();
+  ASSERT_EQ(pps_array[0], 2);
+  EXPECT_EQ(std::vector<uint8_t>(pps_array + 3, pps_array + 3 + 4),
+            pps0_update);
+  EXPECT_EQ(std::vector<uint8_t>(pps_array + 9, pps_array + 9 + 4), pps1);
+}
+
+}  // namespace media
+}  // namespace ave
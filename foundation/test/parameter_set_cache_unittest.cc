@@ -0,0 +1,79 @@
+/*
+ * parameter_set_cache_unittest.cc
+ * Copyright (C) 2025 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#include "../parameter_set_cache.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace ave {
+namespace media {
+
+namespace {
+
+constexpr uint8_t kSpsA[] = {0x67, 0x42, 0xc0, 0x1e, 0xda, 0x02, 0x80};
+constexpr uint8_t kSpsB[] = {0x67, 0x64, 0x00, 0x28, 0xac, 0xd9, 0x40};
+
+struct FakeState {
+  int id;
+};
+
+}  // namespace
+
+TEST(ParameterSetCacheTest, HashDependsOnContent) {
+  EXPECT_EQ(HashParameterSet(kSpsA), HashParameterSet(kSpsA));
+  EXPECT_NE(HashParameterSet(kSpsA), HashParameterSet(kSpsB));
+}
+
+TEST(ParameterSetCacheTest, ParsesOncePerDistinctParameterSet) {
+  ParameterSetCache<FakeState> cache;
+  int parse_count = 0;
+  auto parse = [&parse_count](std::span<const uint8_t> nal) {
+    ++parse_count;
+    return std::optional<FakeState>(FakeState{nal[1]});
+  };
+
+  bool hit = true;
+  const FakeState* state = cache.GetOrParse(kSpsA, parse, &hit);
+  ASSERT_NE(nullptr, state);
+  EXPECT_FALSE(hit);
+  EXPECT_EQ(0x42, state->id);
+
+  state = cache.GetOrParse(kSpsA, parse, &hit);
+  ASSERT_NE(nullptr, state);
+  EXPECT_TRUE(hit);
+  EXPECT_EQ(1, parse_count);
+
+  state = cache.GetOrParse(kSpsB, parse, &hit);
+  ASSERT_NE(nullptr, state);
+  EXPECT_FALSE(hit);
+  EXPECT_EQ(0x64, state->id);
+  EXPECT_EQ(2, parse_count);
+  EXPECT_EQ(2u, cache.size());
+}
+
+TEST(ParameterSetCacheTest, FailedParseIsNotCached) {
+  ParameterSetCache<FakeState> cache;
+  auto fail = [](std::span<const uint8_t>) {
+    return std::optional<FakeState>();
+  };
+  EXPECT_EQ(nullptr, cache.GetOrParse(kSpsA, fail));
+  EXPECT_EQ(0u, cache.size());
+}
+
+TEST(ParameterSetCacheTest, InvalidateAndEviction) {
+  ParameterSetCache<FakeState> cache(1);
+  cache.Insert(HashParameterSet(kSpsA), kSpsA, FakeState{1});
+  cache.Insert(HashParameterSet(kSpsB), kSpsB, FakeState{2});
+  EXPECT_EQ(nullptr, cache.Lookup(HashParameterSet(kSpsA), kSpsA));
+  ASSERT_NE(nullptr, cache.Lookup(HashParameterSet(kSpsB), kSpsB));
+
+  cache.Invalidate();
+  EXPECT_EQ(0u, cache.size());
+  EXPECT_EQ(nullptr, cache.Lookup(HashParameterSet(kSpsB), kSpsB));
+}
+
+}  // namespace media
+}  // namespace ave
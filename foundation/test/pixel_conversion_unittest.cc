@@ -0,0 +1,142 @@
+/*
+ * pixel_conversion_unittest.cc
+ * Copyright (C) 2025 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#include "media/foundation/pixel_conversion.h"
+
+#include <cstdint>
+#include <vector>
+
+#include "test/gtest.h"
+
+namespace ave {
+namespace media {
+
+namespace {
+
+// Long enough for every vector width plus a scalar tail.
+constexpr size_t kRowSize = 77;
+
+std::vector<uint16_t> MakeRow(size_t size, int bit_depth, uint16_t seed) {
+  std::vector<uint16_t> row(size);
+  const uint32_t max = (1u << bit_depth) - 1;
+  for (size_t i = 0; i < size; ++i) {
+    row[i] = static_cast<uint16_t>((seed + i * 37) % (max + 1));
+  }
+  return row;
+}
+
+}  // namespace
+
+TEST(PixelConversionTest, ConvertRowTo8Bit) {
+  for (const int bit_depth : {10, 12}) {
+    const std::vector<uint16_t> src = MakeRow(kRowSize, bit_depth, 3);
+    std::vector<uint8_t> dst(kRowSize);
+    ConvertRowTo8Bit(src.data(), dst.data(), src.size(), bit_depth);
+    for (size_t i = 0; i < src.size(); ++i) {
+      ASSERT_EQ(dst[i], src[i] >> (bit_depth - 8)) << "i=" << i;
+    }
+  }
+}
+
+TEST(PixelConversionTest, ConvertRowTo8BitSaturatesOutOfRangeSamples) {
+  std::vector<uint16_t> src(kRowSize, 0xffff);
+  std::vector<uint8_t> dst(kRowSize);
+  ConvertRowTo8Bit(src.data(), dst.data(), src.size(), 10);
+  for (const uint8_t sample : dst) {
+    ASSERT_EQ(sample, 255);
+  }
+}
+
+TEST(PixelConversionTest, ConvertRowToMsbAligned) {
+  const std::vector<uint16_t> src = MakeRow(kRowSize, 10, 5);
+  std::vector<uint16_t> dst(kRowSize);
+  ConvertRowToMsbAligned(src.data(), dst.data(), src.size(), 10);
+  for (size_t i = 0; i < src.size(); ++i) {
+    ASSERT_EQ(dst[i], src[i] << 6) << "i=" << i;
+  }
+}
+
+TEST(PixelConversionTest, InterleaveRowToMsbAligned) {
+  const std::vector<uint16_t> u = MakeRow(kRowSize, 12, 1);
+  const std::vector<uint16_t> v = MakeRow(kRowSize, 12, 900);
+  std::vector<uint16_t> uv(2 * kRowSize);
+  InterleaveRowToMsbAligned(u.data(), v.data(), uv.data(), kRowSize, 12);
+  for (size_t i = 0; i < kRowSize; ++i) {
+    ASSERT_EQ(uv[2 * i], u[i] << 4) << "i=" << i;
+    ASSERT_EQ(uv[2 * i + 1], v[i] << 4) << "i=" << i;
+  }
+}
+
+TEST(PixelConversionTest, ConvertPictureToEachFormat) {
+  // Odd size with padded strides, like a cropped decoder frame.
+  constexpr int kWidth = 35;
+  constexpr int kHeight = 5;
+  constexpr int kChromaWidth = 18;
+  constexpr int kChromaHeight = 3;
+  constexpr int kStride = 48 * 2;
+  std::vector<uint16_t> planes[3];
+  HighBitDepthYUV420 src;
+  src.width = kWidth;
+  src.height = kHeight;
+  src.bit_depth = 10;
+  for (int p = 0; p < 3; ++p) {
+    planes[p] = MakeRow(kStride / 2 * kHeight, 10, 100 * p);
+    src.data[p] = reinterpret_cast<const uint8_t*>(planes[p].data());
+    src.stride[p] = kStride;
+  }
+  auto sample = [&](int p, int x, int y) {
+    return planes[p][y * kStride / 2 + x];
+  };
+
+  std::vector<uint8_t> dst(
+      YUV420PictureSize(AVE_PIX_FMT_P010LE, kWidth, kHeight));
+  EXPECT_EQ(dst.size(), 2u * (kWidth * kHeight + 2 * kChromaWidth *
+                                                     kChromaHeight));
+  EXPECT_EQ(ConvertHighBitDepthYUV420(src, AVE_PIX_FMT_P010LE, dst.data(),
+                                      dst.size() - 1),
+            0u);
+
+  // 8 bit planar.
+  ASSERT_EQ(ConvertHighBitDepthYUV420(src, AVE_PIX_FMT_YUV420P, dst.data(),
+                                      dst.size()),
+            YUV420PictureSize(AVE_PIX_FMT_YUV420P, kWidth, kHeight));
+  EXPECT_EQ(dst[2 * kWidth + 7], sample(0, 7, 2) >> 2);
+  const uint8_t* v8 = dst.data() + kWidth * kHeight +
+                      kChromaWidth * kChromaHeight;
+  EXPECT_EQ(v8[kChromaWidth * 2 + 17], sample(2, 17, 2) >> 2);
+
+  // Native depth planar.
+  ASSERT_EQ(ConvertHighBitDepthYUV420(src, AVE_PIX_FMT_YUV420P10LE,
+                                      dst.data(), dst.size()),
+            dst.size());
+  const auto* y16 = reinterpret_cast<const uint16_t*>(dst.data());
+  EXPECT_EQ(y16[4 * kWidth + 34], sample(0, 34, 4));
+  const uint16_t* u16 = y16 + kWidth * kHeight;
+  EXPECT_EQ(u16[kChromaWidth + 5], sample(1, 5, 1));
+
+  // Semi-planar, MSB aligned.
+  ASSERT_EQ(ConvertHighBitDepthYUV420(src, AVE_PIX_FMT_P010LE, dst.data(),
+                                      dst.size()),
+            dst.size());
+  EXPECT_EQ(y16[3 * kWidth + 20], sample(0, 20, 3) << 6);
+  const uint16_t* uv = y16 + kWidth * kHeight;
+  EXPECT_EQ(uv[2 * kChromaWidth * 2 + 2 * 17], sample(1, 17, 2) << 6);
+  EXPECT_EQ(uv[2 * kChromaWidth * 2 + 2 * 17 + 1], sample(2, 17, 2) << 6);
+}
+
+TEST(PixelConversionTest, RejectsUnsupportedFormats) {
+  HighBitDepthYUV420 src;
+  src.width = 2;
+  src.height = 2;
+  uint8_t dst[64];
+  EXPECT_EQ(YUV420PictureSize(AVE_PIX_FMT_NV12, 2, 2), 0u);
+  EXPECT_EQ(ConvertHighBitDepthYUV420(src, AVE_PIX_FMT_NV12, dst, sizeof(dst)),
+            0u);
+}
+
+}  // namespace media
+}  // namespace ave
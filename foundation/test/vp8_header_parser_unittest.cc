@@ -0,0 +1,52 @@
+/*
+ * vp8_header_parser_unittest.cc
+ * Copyright (C) 2025 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#include "../vp8/vp8_header_parser.h"
+
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace ave {
+namespace media {
+
+TEST(Vp8HeaderParserTest, ParsesKeyFrame) {
+  // Key frame, version 0, shown, first_part_size 0x123; 640x480 with
+  // horizontal scale 1.
+  const uint32_t tag = (0x123 << 5) | (1 << 4);
+  const uint8_t frame[] = {static_cast<uint8_t>(tag),
+                           static_cast<uint8_t>(tag >> 8),
+                           static_cast<uint8_t>(tag >> 16),
+                           0x9d,
+                           0x01,
+                           0x2a,
+                           0x80,
+                           0x42,
+                           0xe0,
+                           0x01};
+  std::optional<VP8::FrameHeader> header = VP8::ParseFrameHeader(frame);
+  ASSERT_TRUE(header);
+  EXPECT_TRUE(header->key_frame);
+  EXPECT_TRUE(header->show_frame);
+  EXPECT_EQ(header->first_part_size, 0x123u);
+  EXPECT_EQ(header->width, 640);
+  EXPECT_EQ(header->horizontal_scale, 1);
+  EXPECT_EQ(header->height, 480);
+  EXPECT_EQ(header->vertical_scale, 0);
+}
+
+TEST(Vp8HeaderParserTest, InterFrameNeedsOnlyTag) {
+  const uint8_t frame[] = {0x01, 0x00, 0x00};
+  std::optional<VP8::FrameHeader> header = VP8::ParseFrameHeader(frame);
+  ASSERT_TRUE(header);
+  EXPECT_FALSE(header->key_frame);
+
+  // A key frame without the start code is rejected.
+  const uint8_t bad[] = {0x00, 0x00, 0x00, 0x9d, 0x01, 0x2b, 0, 0, 0, 0};
+  EXPECT_FALSE(VP8::ParseFrameHeader(bad));
+}
+
+}  // namespace media
+}  // namespace ave
@@ -0,0 +1,156 @@
+/*
+ * vp9_uncompressed_header_parser_unittest.cc
+ * Copyright (C) 2025 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#include "../vp9/vp9_uncompressed_header_parser.h"
+
+#include <vector>
+
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace ave {
+namespace media {
+
+namespace {
+
+class BitWriter {
+ public:
+  void Write(uint32_t value, int bits) {
+    for (int i = bits - 1; i >= 0; --i) {
+      if (bit_pos_ == 0) {
+        bytes_.push_back(0);
+      }
+      bytes_.back() |= ((value >> i) & 1) << (7 - bit_pos_);
+      bit_pos_ = (bit_pos_ + 1) % 8;
+    }
+  }
+  std::vector<uint8_t> bytes() const { return bytes_; }
+
+ private:
+  std::vector<uint8_t> bytes_;
+  int bit_pos_ = 0;
+};
+
+// Profile 2 (10 bit 4:2:0) BT.2020 key frame, 1280x720.
+std::vector<uint8_t> MakeKeyFrame() {
+  BitWriter w;
+  w.Write(2, 2);          // frame_marker
+  w.Write(0, 1);          // profile_low_bit
+  w.Write(1, 1);          // profile_high_bit
+  w.Write(0, 1);          // show_existing_frame
+  w.Write(0, 1);          // frame_type (KEY_FRAME)
+  w.Write(1, 1);          // show_frame
+  w.Write(0, 1);          // error_resilient_mode
+  w.Write(0x498342, 24);  // frame_sync_code
+  w.Write(0, 1);          // ten_or_twelve_bit
+  w.Write(VP9::kCsBt2020, 3);
+  w.Write(0, 1);          // color_range
+  w.Write(1279, 16);      // frame_width_minus_1
+  w.Write(719, 16);       // frame_height_minus_1
+  w.Write(0, 1);          // render_and_frame_size_different
+  w.Write(0, 8);          // start of the rest of the header
+  return w.bytes();
+}
+
+// Profile 0 shown inter frame that copies its size from LAST and refreshes
+// no reference buffer.
+std::vector<uint8_t> MakeNonReferenceInterFrame() {
+  BitWriter w;
+  w.Write(2, 2);  // frame_marker
+  w.Write(0, 2);  // profile
+  w.Write(0, 1);  // show_existing_frame
+  w.Write(1, 1);  // frame_type (NON_KEY_FRAME)
+  w.Write(1, 1);  // show_frame
+  w.Write(0, 1);  // error_resilient_mode
+  w.Write(0, 2);  // reset_frame_context
+  w.Write(0, 8);  // refresh_frame_flags
+  for (int i = 0; i < 3; ++i) {
+    w.Write(i, 3);  // ref_frame_idx
+    w.Write(0, 1);  // ref_frame_sign_bias
+  }
+  w.Write(1, 1);  // found_ref
+  w.Write(0, 1);  // render_and_frame_size_different
+  w.Write(0, 8);
+  return w.bytes();
+}
+
+}  // namespace
+
+TEST(Vp9UncompressedHeaderParserTest, ParsesKeyFrame) {
+  const std::vector<uint8_t> frame = MakeKeyFrame();
+  std::optional<VP9::UncompressedHeader> header =
+      VP9::ParseUncompressedHeader(frame);
+  ASSERT_TRUE(header);
+  EXPECT_TRUE(header->key_frame);
+  EXPECT_TRUE(header->show_frame);
+  EXPECT_EQ(header->profile, 2);
+  EXPECT_EQ(header->bit_depth, 10);
+  EXPECT_EQ(header->color_space, VP9::kCsBt2020);
+  EXPECT_EQ(header->frame_width, 1280);
+  EXPECT_EQ(header->frame_height, 720);
+  EXPECT_EQ(header->render_width, 1280);
+  EXPECT_EQ(header->refresh_frame_flags, 0xff);
+
+  const ColorSpace color_space = VP9::GetColorSpace(*header);
+  EXPECT_EQ(color_space.matrix(), ColorSpace::MatrixID::kBT2020_NCL);
+  EXPECT_EQ(color_space.range(), ColorSpace::RangeID::kLimited);
+}
+
+TEST(Vp9UncompressedHeaderParserTest, ParsesInterFrameWithRefSize) {
+  const std::vector<uint8_t> frame = MakeNonReferenceInterFrame();
+  std::optional<VP9::UncompressedHeader> header =
+      VP9::ParseUncompressedHeader(frame);
+  ASSERT_TRUE(header);
+  EXPECT_FALSE(header->key_frame);
+  EXPECT_FALSE(header->has_color_config);
+  EXPECT_EQ(header->refresh_frame_flags, 0);
+  EXPECT_EQ(header->found_ref, 0);
+  EXPECT_EQ(header->frame_width, 0);
+}
+
+TEST(Vp9UncompressedHeaderParserTest, RejectsBadSyncCode) {
+  std::vector<uint8_t> frame = MakeKeyFrame();
+  frame[2] ^= 0x10;
+  EXPECT_FALSE(VP9::ParseUncompressedHeader(frame));
+}
+
+TEST(Vp9UncompressedHeaderParserTest, ParsesShowExistingFrame) {
+  // frame_marker, profile 0, show_existing_frame, frame_to_show_map_idx 5.
+  const uint8_t frame[] = {0b1000'1101};
+  std::optional<VP9::UncompressedHeader> header =
+      VP9::ParseUncompressedHeader(frame);
+  ASSERT_TRUE(header);
+  EXPECT_TRUE(header->show_existing_frame);
+  EXPECT_EQ(header->frame_to_show_map_idx, 5);
+}
+
+TEST(Vp9UncompressedHeaderParserTest, SplitsSuperframe) {
+  std::vector<uint8_t> data(300 + 5, 0xaa);
+  // Two frames, two bytes per size: marker 0b110'01'001.
+  const uint8_t marker = 0xc9;
+  const uint8_t index[] = {marker, 0x2c, 0x01, 0x05, 0x00, marker};
+  data.insert(data.end(), std::begin(index), std::end(index));
+
+  std::vector<std::span<const uint8_t>> frames = VP9::ParseSuperframe(data);
+  ASSERT_EQ(frames.size(), 2u);
+  EXPECT_EQ(frames[0].size(), 300u);
+  EXPECT_EQ(frames[1].size(), 5u);
+  EXPECT_EQ(frames[1].data(), data.data() + 300);
+}
+
+TEST(Vp9UncompressedHeaderParserTest, SuperframeWithoutIndexIsOneFrame) {
+  const std::vector<uint8_t> data = MakeKeyFrame();
+  std::vector<std::span<const uint8_t>> frames = VP9::ParseSuperframe(data);
+  ASSERT_EQ(frames.size(), 1u);
+  EXPECT_EQ(frames[0].size(), data.size());
+
+  // An index claiming more data than present is rejected.
+  const uint8_t bad[] = {0x00, 0xc0, 0xff, 0xc0};
+  EXPECT_TRUE(VP9::ParseSuperframe(bad).empty());
+}
+
+}  // namespace media
+}  // namespace ave
@@ -0,0 +1,66 @@
+/*
+ * vp8_header_parser.cc
+ * Copyright (C) 2025 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#include "media/foundation/vp8/vp8_header_parser.h"
+
+#include "media/foundation/color_space.h"
+#include "media/foundation/media_meta.h"
+
+namespace ave {
+namespace media {
+namespace VP8 {
+
+namespace {
+
+constexpr uint8_t kStartCode[] = {0x9d, 0x01, 0x2a};
+
+}  // namespace
+
+std::optional<FrameHeader> ParseFrameHeader(std::span<const uint8_t> data) {
+  if (data.size() < kFrameTagSize) {
+    return std::nullopt;
+  }
+
+  FrameHeader header;
+  const uint32_t tag = data[0] | (data[1] << 8) | (data[2] << 16);
+  header.key_frame = (tag & 0x01) == 0;
+  header.version = (tag >> 1) & 0x07;
+  header.show_frame = (tag >> 4) & 0x01;
+  header.first_part_size = (tag >> 5) & 0x7ffff;
+  if (!header.key_frame) {
+    return header;
+  }
+
+  if (data.size() < kKeyFrameHeaderSize || data[3] != kStartCode[0] ||
+      data[4] != kStartCode[1] || data[5] != kStartCode[2]) {
+    return std::nullopt;
+  }
+  const uint16_t width = data[6] | (data[7] << 8);
+  const uint16_t height = data[8] | (data[9] << 8);
+  header.width = width & 0x3fff;
+  header.horizontal_scale = width >> 14;
+  header.height = height & 0x3fff;
+  header.vertical_scale = height >> 14;
+  return header;
+}
+
+void FillMediaMeta(const FrameHeader& header, MediaMeta* meta) {
+  if (!header.key_frame) {
+    return;
+  }
+  meta->SetWidth(header.width);
+  meta->SetHeight(header.height);
+  meta->SetCodecProfile(header.version);
+  meta->SetPixelFormat(AVE_PIX_FMT_YUV420P);
+  meta->SetColorSpace(ColorSpace(
+      ColorSpace::PrimaryID::kSMPTE170M, ColorSpace::TransferID::kSMPTE170M,
+      ColorSpace::MatrixID::kSMPTE170M, ColorSpace::RangeID::kLimited));
+}
+
+}  // namespace VP8
+}  // namespace media
+}  // namespace ave
@@ -0,0 +1,55 @@
+/*
+ * vp8_header_parser.h
+ * Copyright (C) 2025 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#ifndef AVE_MEDIA_FOUNDATION_VP8_VP8_HEADER_PARSER_H_
+#define AVE_MEDIA_FOUNDATION_VP8_VP8_HEADER_PARSER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <optional>
+#include <span>
+
+namespace ave {
+namespace media {
+
+class MediaMeta;
+
+namespace VP8 {
+
+// Size of the frame tag, and of the tag plus the key frame start code and
+// dimensions.
+constexpr size_t kFrameTagSize = 3;
+constexpr size_t kKeyFrameHeaderSize = 10;
+
+// The uncompressed data chunk at the start of every VP8 frame, RFC 6386
+// section 9.1. Everything after it is boolean coded and needs a decoder.
+struct FrameHeader {
+  bool key_frame = false;
+  uint8_t version = 0;
+  bool show_frame = true;
+  uint32_t first_part_size = 0;
+  // Only present on key frames.
+  uint16_t width = 0;
+  uint16_t height = 0;
+  uint8_t horizontal_scale = 0;
+  uint8_t vertical_scale = 0;
+};
+
+// Parses the frame tag and, for key frames, the start code and dimensions.
+// Returns nullopt if |data| is too short or the start code is wrong.
+std::optional<FrameHeader> ParseFrameHeader(std::span<const uint8_t> data);
+
+// Copies the dimensions of a key frame header into |meta|. VP8 is always
+// 8-bit 4:2:0 BT.601.
+void FillMediaMeta(const FrameHeader& header, MediaMeta* meta);
+
+}  // namespace VP8
+}  // namespace media
+}  // namespace ave
+
+#endif  // AVE_MEDIA_FOUNDATION_VP8_VP8_HEADER_PARSER_H_
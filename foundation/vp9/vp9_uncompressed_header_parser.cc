@@ -0,0 +1,288 @@
+/*
+ * vp9_uncompressed_header_parser.cc
+ * Copyright (C) 2025 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#include "media/foundation/vp9/vp9_uncompressed_header_parser.h"
+
+#include "base/buffer/bitstream_reader.h"
+#include "base/logging.h"
+#include "media/foundation/media_meta.h"
+
+namespace ave {
+namespace media {
+namespace VP9 {
+
+namespace {
+
+constexpr uint8_t kFrameMarker = 2;
+constexpr uint32_t kSyncCode = 0x498342;
+constexpr uint8_t kNumRefsPerFrame = 3;
+constexpr uint8_t kSuperframeMarkerMask = 0xe0;
+constexpr uint8_t kSuperframeMarker = 0xc0;
+
+bool ReadSyncCode(base::BitstreamReader& reader) {
+  return reader.ReadBits(24) == kSyncCode && reader.Ok();
+}
+
+// color_config(), section 6.2.2.
+void ReadColorConfig(base::BitstreamReader& reader,
+                     UncompressedHeader* header) {
+  header->has_color_config = true;
+  if (header->profile >= 2) {
+    header->bit_depth = reader.Read<bool>() ? 12 : 10;
+  } else {
+    header->bit_depth = 8;
+  }
+  header->color_space = static_cast<ColorSpaceType>(reader.ReadBits(3));
+  const bool odd_profile = header->profile == 1 || header->profile == 3;
+  if (header->color_space != kCsRgb) {
+    header->color_range = reader.Read<bool>();
+    if (odd_profile) {
+      header->subsampling_x = reader.Read<bool>();
+      header->subsampling_y = reader.Read<bool>();
+      reader.ConsumeBits(1);  // reserved_zero
+    } else {
+      header->subsampling_x = true;
+      header->subsampling_y = true;
+    }
+  } else {
+    header->color_range = true;
+    if (odd_profile) {
+      header->subsampling_x = false;
+      header->subsampling_y = false;
+      reader.ConsumeBits(1);  // reserved_zero
+    }
+  }
+}
+
+// frame_size(), section 6.2.5.
+void ReadFrameSize(base::BitstreamReader& reader, UncompressedHeader* header) {
+  header->frame_width = reader.Read<uint16_t>() + 1;
+  header->frame_height = reader.Read<uint16_t>() + 1;
+}
+
+// render_size(), section 6.2.6.
+void ReadRenderSize(base::BitstreamReader& reader,
+                    UncompressedHeader* header) {
+  if (reader.Read<bool>()) {
+    header->render_width = reader.Read<uint16_t>() + 1;
+    header->render_height = reader.Read<uint16_t>() + 1;
+  } else {
+    header->render_width = header->frame_width;
+    header->render_height = header->frame_height;
+  }
+}
+
+PixelFormat Vp9PixelFormat(const UncompressedHeader& header) {
+  if (header.subsampling_x && header.subsampling_y) {
+    switch (header.bit_depth) {
+      case 10:
+        return AVE_PIX_FMT_YUV420P10LE;
+      case 12:
+        return AVE_PIX_FMT_YUV420P12LE;
+      default:
+        return AVE_PIX_FMT_YUV420P;
+    }
+  }
+  if (header.subsampling_x) {
+    switch (header.bit_depth) {
+      case 10:
+        return AVE_PIX_FMT_YUV422P10LE;
+      case 12:
+        return AVE_PIX_FMT_YUV422P12LE;
+      default:
+        return AVE_PIX_FMT_YUV422P;
+    }
+  }
+  switch (header.bit_depth) {
+    case 10:
+      return AVE_PIX_FMT_YUV444P10LE;
+    case 12:
+      return AVE_PIX_FMT_YUV444P12LE;
+    default:
+      return AVE_PIX_FMT_YUV444P;
+  }
+}
+
+}  // namespace
+
+// uncompressed_header(), section 6.2.
+std::optional<UncompressedHeader> ParseUncompressedHeader(
+    std::span<const uint8_t> data) {
+  base::BitstreamReader reader(data);
+  UncompressedHeader header;
+
+  if (reader.ReadBits(2) != kFrameMarker) {
+    return std::nullopt;
+  }
+  const uint8_t profile_low_bit = reader.ReadBit();
+  const uint8_t profile_high_bit = reader.ReadBit();
+  header.profile = static_cast<uint8_t>((profile_high_bit << 1) |
+                                        profile_low_bit);
+  if (header.profile == 3) {
+    reader.ConsumeBits(1);  // reserved_zero
+  }
+
+  header.show_existing_frame = reader.Read<bool>();
+  if (header.show_existing_frame) {
+    header.frame_to_show_map_idx = static_cast<uint8_t>(reader.ReadBits(3));
+    return reader.Ok() ? std::optional(header) : std::nullopt;
+  }
+
+  header.key_frame = !reader.Read<bool>();
+  header.show_frame = reader.Read<bool>();
+  header.error_resilient_mode = reader.Read<bool>();
+
+  if (header.key_frame) {
+    if (!ReadSyncCode(reader)) {
+      AVE_LOG(LS_WARNING) << "Invalid VP9 sync code.";
+      return std::nullopt;
+    }
+    ReadColorConfig(reader, &header);
+    ReadFrameSize(reader, &header);
+    ReadRenderSize(reader, &header);
+    header.refresh_frame_flags = 0xff;
+    return reader.Ok() ? std::optional(header) : std::nullopt;
+  }
+
+  header.intra_only = header.show_frame ? false : reader.Read<bool>();
+  if (!header.error_resilient_mode) {
+    reader.ConsumeBits(2);  // reset_frame_context
+  }
+
+  if (header.intra_only) {
+    if (!ReadSyncCode(reader)) {
+      AVE_LOG(LS_WARNING) << "Invalid VP9 sync code.";
+      return std::nullopt;
+    }
+    if (header.profile > 0) {
+      ReadColorConfig(reader, &header);
+    } else {
+      header.has_color_config = true;
+      header.bit_depth = 8;
+      header.color_space = kCsBt601;
+      header.subsampling_x = true;
+      header.subsampling_y = true;
+    }
+    header.refresh_frame_flags = reader.Read<uint8_t>();
+    ReadFrameSize(reader, &header);
+    ReadRenderSize(reader, &header);
+    return reader.Ok() ? std::optional(header) : std::nullopt;
+  }
+
+  header.refresh_frame_flags = reader.Read<uint8_t>();
+  for (uint8_t i = 0; i < kNumRefsPerFrame; ++i) {
+    reader.ConsumeBits(3 + 1);  // ref_frame_idx, ref_frame_sign_bias
+  }
+  // frame_size_with_refs(), section 6.2.6.
+  for (uint8_t i = 0; i < kNumRefsPerFrame; ++i) {
+    if (reader.Read<bool>()) {
+      header.found_ref = i;
+      break;
+    }
+  }
+  if (!header.found_ref) {
+    ReadFrameSize(reader, &header);
+  }
+  ReadRenderSize(reader, &header);
+  return reader.Ok() ? std::optional(header) : std::nullopt;
+}
+
+// superframe_index(), annex B.
+std::vector<std::span<const uint8_t>> ParseSuperframe(
+    std::span<const uint8_t> data) {
+  std::vector<std::span<const uint8_t>> frames;
+  if (data.empty()) {
+    return frames;
+  }
+
+  const uint8_t marker = data.back();
+  if ((marker & kSuperframeMarkerMask) != kSuperframeMarker) {
+    frames.push_back(data);
+    return frames;
+  }
+  const size_t frames_in_superframe = (marker & 0x07) + 1;
+  const size_t bytes_per_framesize = ((marker >> 3) & 0x03) + 1;
+  const size_t index_size = 2 + bytes_per_framesize * frames_in_superframe;
+  if (data.size() < index_size || data[data.size() - index_size] != marker) {
+    // The last byte only looks like a marker; it is frame data.
+    frames.push_back(data);
+    return frames;
+  }
+
+  const uint8_t* index = data.data() + data.size() - index_size + 1;
+  const size_t payload_size = data.size() - index_size;
+  size_t offset = 0;
+  frames.reserve(frames_in_superframe);
+  for (size_t i = 0; i < frames_in_superframe; ++i) {
+    size_t frame_size = 0;
+    for (size_t b = 0; b < bytes_per_framesize; ++b) {
+      frame_size |= static_cast<size_t>(*index++) << (b * 8);
+    }
+    if (frame_size > payload_size - offset) {
+      AVE_LOG(LS_WARNING) << "VP9 superframe index exceeds the data.";
+      frames.clear();
+      return frames;
+    }
+    // A zero sized entry carries no frame; skip it.
+    if (frame_size > 0) {
+      frames.push_back(data.subspan(offset, frame_size));
+    }
+    offset += frame_size;
+  }
+  return frames;
+}
+
+ColorSpace GetColorSpace(const UncompressedHeader& header) {
+  using PrimaryID = ColorSpace::PrimaryID;
+  using TransferID = ColorSpace::TransferID;
+  using MatrixID = ColorSpace::MatrixID;
+  const ColorSpace::RangeID range = header.color_range
+                                        ? ColorSpace::RangeID::kFull
+                                        : ColorSpace::RangeID::kLimited;
+  switch (header.color_space) {
+    case kCsBt601:
+    case kCsSmpte170:
+      return ColorSpace(PrimaryID::kSMPTE170M, TransferID::kSMPTE170M,
+                        MatrixID::kSMPTE170M, range);
+    case kCsBt709:
+      return ColorSpace(PrimaryID::kBT709, TransferID::kBT709,
+                        MatrixID::kBT709, range);
+    case kCsSmpte240:
+      return ColorSpace(PrimaryID::kSMPTE240M, TransferID::kSMPTE240M,
+                        MatrixID::kSMPTE240M, range);
+    case kCsBt2020:
+      return ColorSpace(PrimaryID::kBT2020,
+                        header.bit_depth == 12 ? TransferID::kBT2020_12
+                                               : TransferID::kBT2020_10,
+                        MatrixID::kBT2020_NCL, range);
+    case kCsRgb:
+      return ColorSpace(PrimaryID::kBT709, TransferID::kIEC61966_2_1,
+                        MatrixID::kRGB, range);
+    default: {
+      ColorSpace color_space;
+      color_space.set_range_from_uint8(static_cast<uint8_t>(range));
+      return color_space;
+    }
+  }
+}
+
+void FillMediaMeta(const UncompressedHeader& header, MediaMeta* meta) {
+  if (header.frame_width > 0 && header.frame_height > 0) {
+    meta->SetWidth(header.frame_width);
+    meta->SetHeight(header.frame_height);
+  }
+  if (!header.has_color_config) {
+    return;
+  }
+  meta->SetCodecProfile(header.profile);
+  meta->SetPixelFormat(Vp9PixelFormat(header));
+  meta->SetColorSpace(GetColorSpace(header));
+}
+
+}  // namespace VP9
+}  // namespace media
+}  // namespace ave
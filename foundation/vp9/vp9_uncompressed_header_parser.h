@@ -0,0 +1,93 @@
+/*
+ * vp9_uncompressed_header_parser.h
+ * Copyright (C) 2025 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#ifndef AVE_MEDIA_FOUNDATION_VP9_VP9_UNCOMPRESSED_HEADER_PARSER_H_
+#define AVE_MEDIA_FOUNDATION_VP9_VP9_UNCOMPRESSED_HEADER_PARSER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <optional>
+#include <span>
+#include <vector>
+
+#include "media/foundation/color_space.h"
+
+namespace ave {
+namespace media {
+
+class MediaMeta;
+
+namespace VP9 {
+
+// color_space, VP9 bitstream spec section 7.2.2.
+enum ColorSpaceType : uint8_t {
+  kCsUnknown = 0,
+  kCsBt601 = 1,
+  kCsBt709 = 2,
+  kCsSmpte170 = 3,
+  kCsSmpte240 = 4,
+  kCsBt2020 = 5,
+  kCsReserved = 6,
+  kCsRgb = 7,
+};
+
+// The part of uncompressed_header() (spec section 6.2) that describes the
+// frame, up to and including the frame size. Enough to tell key frames,
+// hidden frames and re-shown frames apart, and to describe the stream.
+struct UncompressedHeader {
+  uint8_t profile = 0;
+  bool show_existing_frame = false;
+  // Valid when |show_existing_frame| is set.
+  uint8_t frame_to_show_map_idx = 0;
+  bool key_frame = false;
+  bool show_frame = true;
+  bool error_resilient_mode = false;
+  bool intra_only = false;
+  uint8_t refresh_frame_flags = 0;
+
+  // color_config(). Only present on key frames and, for profile > 0, on
+  // intra-only frames.
+  bool has_color_config = false;
+  uint8_t bit_depth = 8;
+  ColorSpaceType color_space = kCsUnknown;
+  bool color_range = false;
+  bool subsampling_x = true;
+  bool subsampling_y = true;
+
+  // frame_size(). Inter frames may copy the size of a reference frame
+  // instead, in which case these stay 0 and |found_ref| is set.
+  uint16_t frame_width = 0;
+  uint16_t frame_height = 0;
+  std::optional<uint8_t> found_ref;
+  uint16_t render_width = 0;
+  uint16_t render_height = 0;
+};
+
+// Parses the start of the uncompressed header of a single frame (not a
+// superframe). Returns nullopt on a bad frame marker, sync code or truncated
+// data.
+std::optional<UncompressedHeader> ParseUncompressedHeader(
+    std::span<const uint8_t> data);
+
+// Splits |data| using the superframe index (spec annex B). Data without a
+// valid index is returned as a single frame. Returns an empty vector if the
+// index claims more bytes than there are.
+std::vector<std::span<const uint8_t>> ParseSuperframe(
+    std::span<const uint8_t> data);
+
+ColorSpace GetColorSpace(const UncompressedHeader& header);
+
+// Copies dimensions, profile, pixel format and color description of a frame
+// carrying color_config() into |meta|.
+void FillMediaMeta(const UncompressedHeader& header, MediaMeta* meta);
+
+}  // namespace VP9
+}  // namespace media
+}  // namespace ave
+
+#endif  // AVE_MEDIA_FOUNDATION_VP9_VP9_UNCOMPRESSED_HEADER_PARSER_H_
@@ -22,6 +22,7 @@
 
 extern "C" {
 #include <libavcodec/avcodec.h>
+#include <libavutil/mastering_display_metadata.h>
 }
 
 namespace ave {
@@ -194,6 +195,80 @@ AVPixelFormat ConvertToFFmpegPixelFormat(PixelFormat pixel_format) {
   return AV_PIX_FMT_NONE;
 }
 
+ColorSpace ExtractColorSpaceFromFrame(const AVFrame* frame) {
+  // The FFmpeg enums use the T-REC H.273 code points ColorSpace uses, the
+  // setters reject anything outside of them.
+  ColorSpace color_space;
+  color_space.set_primaries_from_uint8(
+      static_cast<uint8_t>(frame->color_primaries));
+  color_space.set_transfer_from_uint8(static_cast<uint8_t>(frame->color_trc));
+  color_space.set_matrix_from_uint8(static_cast<uint8_t>(frame->colorspace));
+  color_space.set_range_from_uint8(static_cast<uint8_t>(frame->color_range));
+
+  switch (frame->chroma_location) {
+    case AVCHROMA_LOC_LEFT:
+      color_space.set_chroma_siting_horizontal_from_uint8(
+          static_cast<uint8_t>(ColorSpace::ChromaSiting::kCollocated));
+      color_space.set_chroma_siting_vertical_from_uint8(
+          static_cast<uint8_t>(ColorSpace::ChromaSiting::kHalf));
+      break;
+    case AVCHROMA_LOC_CENTER:
+      color_space.set_chroma_siting_horizontal_from_uint8(
+          static_cast<uint8_t>(ColorSpace::ChromaSiting::kHalf));
+      color_space.set_chroma_siting_vertical_from_uint8(
+          static_cast<uint8_t>(ColorSpace::ChromaSiting::kHalf));
+      break;
+    case AVCHROMA_LOC_TOPLEFT:
+      color_space.set_chroma_siting_horizontal_from_uint8(
+          static_cast<uint8_t>(ColorSpace::ChromaSiting::kCollocated));
+      color_space.set_chroma_siting_vertical_from_uint8(
+          static_cast<uint8_t>(ColorSpace::ChromaSiting::kCollocated));
+      break;
+    default:
+      break;
+  }
+
+  const AVFrameSideData* mastering =
+      av_frame_get_side_data(frame, AV_FRAME_DATA_MASTERING_DISPLAY_METADATA);
+  const AVFrameSideData* light_level =
+      av_frame_get_side_data(frame, AV_FRAME_DATA_CONTENT_LIGHT_LEVEL);
+  if (!mastering && !light_level) {
+    return color_space;
+  }
+
+  HdrMetadata hdr;
+  if (mastering) {
+    const auto* display =
+        reinterpret_cast<const AVMasteringDisplayMetadata*>(mastering->data);
+    auto& meta = hdr.mastering_metadata;
+    if (display->has_primaries) {
+      // display_primaries is in R, G, B order.
+      HdrMasteringMetadata::Chromaticity* primaries[] = {
+          &meta.primary_r, &meta.primary_g, &meta.primary_b};
+      for (int i = 0; i < 3; ++i) {
+        primaries[i]->x =
+            static_cast<float>(av_q2d(display->display_primaries[i][0]));
+        primaries[i]->y =
+            static_cast<float>(av_q2d(display->display_primaries[i][1]));
+      }
+      meta.white_point.x = static_cast<float>(av_q2d(display->white_point[0]));
+      meta.white_point.y = static_cast<float>(av_q2d(display->white_point[1]));
+    }
+    if (display->has_luminance) {
+      meta.luminance_max = static_cast<float>(av_q2d(display->max_luminance));
+      meta.luminance_min = static_cast<float>(av_q2d(display->min_luminance));
+    }
+  }
+  if (light_level) {
+    const auto* level =
+        reinterpret_cast<const AVContentLightMetadata*>(light_level->data);
+    hdr.max_content_light_level = static_cast<int32_t>(level->MaxCLL);
+    hdr.max_frame_average_light_level = static_cast<int32_t>(level->MaxFALL);
+  }
+  color_space.set_hdr_metadata(&hdr);
+  return color_space;
+}
+
 ChannelLayout ChannelLayoutToAveChannelLayout(uint64_t layout, int channels) {
   switch (layout) {
     case AV_CH_LAYOUT_MONO:
@@ -48,6 +48,10 @@ const char* AVCodecId2Mime(AVCodecID codec_id);
 AVPixelFormat ConvertToFFmpegPixelFormat(PixelFormat pixel_format);
 PixelFormat ConvertFromFFmpegPixelFormat(AVPixelFormat pixel_format);
 
+// color space of a decoded frame, with the mastering display and content
+// light level side data as HDR metadata
+ColorSpace ExtractColorSpaceFromFrame(const AVFrame* frame);
+
 // avstream
 void ExtractMetaFromAudioStream(const AVStream* audio_stream,
                                 std::shared_ptr<MediaMeta>& meta);
@@ -10,6 +10,7 @@
 
 #include "es_queue.h"
 
+#include <algorithm>
 #include <cstring>
 #include <vector>
 
@@ -22,6 +23,7 @@
 #include "foundation/media_defs.h"
 #include "foundation/media_frame.h"
 #include "foundation/media_meta.h"
+#include "foundation/parameter_set_cache.h"
 
 namespace ave {
 namespace media {
@@ -561,7 +563,7 @@ std::shared_ptr<MediaMeta> ESQueue::GetFormat() {
 
 void ESQueue::Clear(bool clear_format) {
   if (buffer_ != nullptr) {
-    buffer_->setRange(0, 0);
+    ConsumeBytes(buffer_->size());
   }
 
   range_infos_.clear();
@@ -571,6 +573,7 @@ void ESQueue::Clear(bool clear_format) {
     format_ = nullptr;
     avc_sps_.reset();
     avc_pps_.reset();
+    avc_format_hash_.reset();
     latm_stream_mux_read_ = false;
     latm_num_subframes_ = 0;
     latm_frame_length_type_ = 0;
@@ -596,31 +599,9 @@ status_t ESQueue::AppendData(const void* data,
                              int64_t time_us,
                              int32_t payload_offset,
                              uint32_t pes_scrambling_control) {
-  const size_t current_size = buffer_ != nullptr ? buffer_->size() : 0;
-
-  if (buffer_ == nullptr || current_size + size > buffer_->capacity()) {
-    size_t new_capacity = buffer_ != nullptr ? buffer_->capacity() : 0;
-
-    while (new_capacity < current_size + size) {
-      if (new_capacity < 8192) {
-        new_capacity = 8192;
-      } else if (new_capacity < 2 * 1024 * 1024) {
-        new_capacity *= 2;
-      } else {
-        new_capacity += 1024 * 1024;
-      }
-    }
-
-    auto new_buffer = std::make_shared<Buffer>(new_capacity);
-    new_buffer->setRange(0, current_size);
-    if (buffer_ != nullptr) {
-      memcpy(new_buffer->data(), buffer_->data(), current_size);
-    }
-    buffer_ = new_buffer;
-  }
-
+  EnsureAppendCapacity(size);
   memcpy(buffer_->data() + buffer_->size(), data, size);
-  buffer_->setRange(0, buffer_->size() + size);
+  buffer_->setRange(buffer_->offset(), buffer_->size() + size);
 
   RangeInfo info;
   info.timestamp_us_ = time_us;
@@ -633,6 +614,76 @@ status_t ESQueue::AppendData(const void* data,
   return OK;
 }
 
+status_t ESQueue::AppendPESContinuation(const void* data, size_t size) {
+  if (range_infos_.empty()) {
+    // The PES start was dropped by Clear(); keep the bytes untimed.
+    return AppendData(data, size, -1);
+  }
+
+  EnsureAppendCapacity(size);
+  memcpy(buffer_->data() + buffer_->size(), data, size);
+  buffer_->setRange(buffer_->offset(), buffer_->size() + size);
+  range_infos_.back().length_ += size;
+
+  return OK;
+}
+
+void ESQueue::DropTrailingData(size_t size) {
+  if (buffer_ == nullptr) {
+    return;
+  }
+
+  size = std::min(size, buffer_->size());
+  buffer_->setRange(buffer_->offset(), buffer_->size() - size);
+
+  while (size > 0 && !range_infos_.empty()) {
+    RangeInfo& info = range_infos_.back();
+    if (info.length_ > size) {
+      info.length_ -= size;
+      break;
+    }
+    size -= info.length_;
+    range_infos_.pop_back();
+  }
+}
+
+void ESQueue::EnsureAppendCapacity(size_t size) {
+  const size_t unread_size = buffer_ != nullptr ? buffer_->size() : 0;
+
+  if (buffer_ != nullptr &&
+      buffer_->offset() + unread_size + size <= buffer_->capacity()) {
+    return;
+  }
+
+  if (buffer_ != nullptr && buffer_.use_count() == 1 &&
+      unread_size + size <= buffer_->capacity()) {
+    // No access unit refers to the consumed bytes, so reuse them. This
+    // happens once per buffer fill instead of once per access unit.
+    memmove(buffer_->base(), buffer_->data(), unread_size);
+    buffer_->setRange(0, unread_size);
+    return;
+  }
+
+  size_t new_capacity = buffer_ != nullptr ? buffer_->capacity() : 0;
+
+  while (new_capacity < unread_size + size) {
+    if (new_capacity < 8192) {
+      new_capacity = 8192;
+    } else if (new_capacity < 2 * 1024 * 1024) {
+      new_capacity *= 2;
+    } else {
+      new_capacity += 1024 * 1024;
+    }
+  }
+
+  auto new_buffer = std::make_shared<Buffer>(new_capacity);
+  new_buffer->setRange(0, unread_size);
+  if (buffer_ != nullptr) {
+    memcpy(new_buffer->data(), buffer_->data(), unread_size);
+  }
+  buffer_ = new_buffer;
+}
+
 void ESQueue::SignalEOS() {
   eos_reached_ = true;
 }
@@ -646,7 +697,7 @@ std::shared_ptr<MediaFrame> ESQueue::DequeueAccessUnit(bool force_flush) {
     RangeInfo info = range_infos_.front();
     range_infos_.pop_front();
 
-    auto access_unit = MediaFrame::CreateSharedAsCopy(
+    auto access_unit = CreateFrameSlice(
         buffer_->data(), info.length_,
         (mode_ == Mode::H264 || mode_ == Mode::HEVC ||
          mode_ == Mode::MPEG_VIDEO || mode_ == Mode::MPEG4_VIDEO)
@@ -657,9 +708,7 @@ std::shared_ptr<MediaFrame> ESQueue::DequeueAccessUnit(bool force_flush) {
       access_unit->SetPts(base::Timestamp::Micros(info.timestamp_us_));
     }
 
-    memmove(buffer_->data(), buffer_->data() + info.length_,
-            buffer_->size() - info.length_);
-    buffer_->setRange(0, buffer_->size() - info.length_);
+    ConsumeBytes(info.length_);
 
     return access_unit;
   }
@@ -695,6 +744,21 @@ std::shared_ptr<MediaFrame> ESQueue::DequeueAccessUnit(bool force_flush) {
   }
 }
 
+void ESQueue::ConsumeBytes(size_t size) {
+  buffer_->setRange(buffer_->offset() + size, buffer_->size() - size);
+}
+
+std::shared_ptr<MediaFrame> ESQueue::CreateFrameSlice(const uint8_t* data,
+                                                      size_t size,
+                                                      MediaType media_type) {
+  // The deleter holds a reference to buffer_ for as long as the slice lives.
+  std::shared_ptr<Buffer> slice(new Buffer(const_cast<uint8_t*>(data), size),
+                                [buffer = buffer_](Buffer* b) { delete b; });
+  auto frame = MediaFrame::CreateShared(0, media_type);
+  frame->buffer() = std::move(slice);
+  return frame;
+}
+
 int64_t ESQueue::FetchTimestamp(size_t size,
                                 int32_t* pes_offset,
                                 int32_t* pes_scrambling_control) {
@@ -750,6 +814,11 @@ std::shared_ptr<MediaFrame> ESQueue::DequeueAccessUnitH264(bool force_flush) {
     if (!avc_sps_ || !avc_pps_) {
       return;
     }
+    const uint64_t format_hash =
+        CombineParameterSetHashes(avc_sps_hash_, avc_pps_hash_);
+    if (format_ && avc_format_hash_ == format_hash) {
+      return;
+    }
 
     std::vector<uint8_t> codec_config;
     codec_config.reserve(sizeof(kStartCode) * 2 + avc_sps_->size() +
@@ -791,6 +860,7 @@ std::shared_ptr<MediaFrame> ESQueue::DequeueAccessUnitH264(bool force_flush) {
       format_->SetSampleAspectRatio(
           {static_cast<int16_t>(sar_width), static_cast<int16_t>(sar_height)});
     }
+    avc_format_hash_ = format_hash;
     AVE_LOG(LS_VERBOSE) << "ESQueue H264 format ready: width="
                         << format_->width() << " height=" << format_->height()
                         << " csd_size=" << csd->size();
@@ -816,20 +886,36 @@ std::shared_ptr<MediaFrame> ESQueue::DequeueAccessUnitH264(bool force_flush) {
     }
 
     size_t access_unit_size = 0;
+    // Whether the buffer already holds the access unit as it is emitted:
+    // NAL units back to back, each behind a 4-byte start code.
+    bool contiguous = static_cast<size_t>(nal_units.front().data -
+                                          buffer_data) >= sizeof(kStartCode);
+    const uint8_t* const au_start =
+        nal_units.front().data - (contiguous ? sizeof(kStartCode) : 0);
+    const uint8_t* expected = au_start;
     for (const auto& nal : nal_units) {
       access_unit_size += sizeof(kStartCode) + nal.size;
+      contiguous = contiguous && nal.data - sizeof(kStartCode) == expected &&
+                   memcmp(expected, kStartCode, sizeof(kStartCode)) == 0;
+      expected = nal.data + nal.size;
     }
 
-    auto access_unit =
-        MediaFrame::CreateShared(access_unit_size, MediaType::VIDEO);
-    uint8_t* out = access_unit->data();
-    for (const auto& nal : nal_units) {
-      memcpy(out, kStartCode, sizeof(kStartCode));
-      out += sizeof(kStartCode);
-      memcpy(out, nal.data, nal.size);
-      out += nal.size;
+    std::shared_ptr<MediaFrame> access_unit;
+    if (contiguous) {
+      access_unit =
+          CreateFrameSlice(au_start, access_unit_size, MediaType::VIDEO);
+    } else {
+      access_unit =
+          MediaFrame::CreateShared(access_unit_size, MediaType::VIDEO);
+      uint8_t* out = access_unit->data();
+      for (const auto& nal : nal_units) {
+        memcpy(out, kStartCode, sizeof(kStartCode));
+        out += sizeof(kStartCode);
+        memcpy(out, nal.data, nal.size);
+        out += nal.size;
+      }
+      access_unit->setRange(0, access_unit_size);
     }
-    access_unit->setRange(0, access_unit_size);
 
     int64_t time_us = FetchTimestamp(consumed_size);
     if (time_us >= 0) {
@@ -839,9 +925,7 @@ std::shared_ptr<MediaFrame> ESQueue::DequeueAccessUnitH264(bool force_flush) {
         << "ESQueue H264 AU: pts_us=" << time_us << " size=" << access_unit_size
         << " nal_count=" << nal_units.size();
 
-    memmove(buffer_->data(), buffer_->data() + consumed_size,
-            buffer_size - consumed_size);
-    buffer_->setRange(0, buffer_size - consumed_size);
+    ConsumeBytes(consumed_size);
 
     maybe_update_format();
 
@@ -899,11 +983,19 @@ std::shared_ptr<MediaFrame> ESQueue::DequeueAccessUnitH264(bool force_flush) {
 
     nal_units.push_back(H264NalUnit{nal_start, nal_size, nal_type});
     if (nal_type == 7) {
-      avc_sps_ = Buffer::CreateAsCopy(nal_start, nal_size);
-      AVE_LOG(LS_VERBOSE) << "ESQueue H264 saw SPS size=" << nal_size;
+      const uint64_t hash = HashParameterSet({nal_start, nal_size});
+      if (!avc_sps_ || hash != avc_sps_hash_) {
+        avc_sps_ = Buffer::CreateAsCopy(nal_start, nal_size);
+        avc_sps_hash_ = hash;
+        AVE_LOG(LS_VERBOSE) << "ESQueue H264 saw SPS size=" << nal_size;
+      }
     } else if (nal_type == 8) {
-      avc_pps_ = Buffer::CreateAsCopy(nal_start, nal_size);
-      AVE_LOG(LS_VERBOSE) << "ESQueue H264 saw PPS size=" << nal_size;
+      const uint64_t hash = HashParameterSet({nal_start, nal_size});
+      if (!avc_pps_ || hash != avc_pps_hash_) {
+        avc_pps_ = Buffer::CreateAsCopy(nal_start, nal_size);
+        avc_pps_hash_ = hash;
+        AVE_LOG(LS_VERBOSE) << "ESQueue H264 saw PPS size=" << nal_size;
+      }
     }
 
     if (IsH264VclNal(nal_type)) {
@@ -969,15 +1061,13 @@ std::shared_ptr<MediaFrame> ESQueue::DequeueAccessUnitAAC() {
       }
 
       auto access_unit =
-          CreateFrameCopy(data + offset, frame_length, MediaType::AUDIO);
+          CreateFrameSlice(data + offset, frame_length, MediaType::AUDIO);
       if (time_us >= 0) {
         access_unit->SetPts(base::Timestamp::Micros(time_us));
         access_unit->SetDuration(base::TimeDelta::Micros(frame_duration_us));
       }
 
-      memmove(buffer_->data(), buffer_->data() + offset + frame_length,
-              size - offset - frame_length);
-      buffer_->setRange(0, size - offset - frame_length);
+      ConsumeBytes(offset + frame_length);
 
       if (!format_) {
         format_ = MediaMeta::CreatePtr(MediaType::AUDIO,
@@ -1122,9 +1212,7 @@ std::shared_ptr<MediaFrame> ESQueue::DequeueAccessUnitLATM() {
       access_unit->SetPts(base::Timestamp::Micros(time_us));
     }
 
-    memmove(buffer_->data(), buffer_->data() + offset + frame_size,
-            size - offset - frame_size);
-    buffer_->setRange(0, size - offset - frame_size);
+    ConsumeBytes(offset + frame_size);
 
     access_unit->SetMime(MEDIA_MIMETYPE_AUDIO_AAC);
     access_unit->SetSampleRate(format_->sample_rate());
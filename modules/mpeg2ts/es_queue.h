@@ -12,13 +12,15 @@
 #define MODULES_MPEG2TS_ES_QUEUE_H
 
 #include <cstdint>
-#include <list>
 #include <memory>
+#include <optional>
 #include <vector>
 
 #include "base/constructor_magic.h"
 #include "foundation/buffer.h"
 #include "foundation/media_errors.h"
+#include "foundation/media_utils.h"
+#include "ring_queue.h"
 
 namespace ave {
 namespace media {
@@ -65,6 +67,13 @@ class ESQueue {
                       int32_t payload_offset = 0,
                       uint32_t pes_scrambling_control = 0);
 
+  // Appends more payload of the PES whose first bytes were passed to the
+  // last AppendData() call, so the PES keeps a single timestamp range.
+  status_t AppendPESContinuation(const void* data, size_t size);
+
+  // Removes the last |size| appended bytes, e.g. a PES that lost packets.
+  void DropTrailingData(size_t size);
+
   void SignalEOS();
   void Clear(bool clear_format);
 
@@ -90,8 +99,13 @@ class ESQueue {
   uint32_t flags_;
   bool eos_reached_;
 
+  // Unread ES data is buffer_'s range; consuming bytes only moves the range
+  // start. Access units that are contiguous in buffer_ are emitted as slices
+  // that keep it alive, so consumed bytes are never overwritten: AppendData()
+  // compacts in place only while no slice is outstanding and otherwise
+  // moves the unread tail to a new buffer.
   std::shared_ptr<Buffer> buffer_;
-  std::list<RangeInfo> range_infos_;
+  RingQueue<RangeInfo> range_infos_;
 
   int32_t ca_system_id_;
   std::vector<uint8_t> cas_session_id_;
@@ -99,6 +113,11 @@ class ESQueue {
   std::shared_ptr<MediaMeta> format_;
   std::shared_ptr<Buffer> avc_sps_;
   std::shared_ptr<Buffer> avc_pps_;
+  // Hashes of the raw SPS/PPS above and of the pair format_ was built from,
+  // so repeated parameter sets only cost a hash compare.
+  uint64_t avc_sps_hash_ = 0;
+  uint64_t avc_pps_hash_ = 0;
+  std::optional<uint64_t> avc_format_hash_;
 
   bool latm_stream_mux_read_ = false;
   uint32_t latm_num_subframes_ = 0;
@@ -128,6 +147,17 @@ class ESQueue {
   std::shared_ptr<MediaFrame> DequeueAccessUnitPCMAudio();
   std::shared_ptr<MediaFrame> DequeueAccessUnitMetadata();
 
+  // Makes room for |size| more bytes after the unread data.
+  void EnsureAppendCapacity(size_t size);
+
+  // Drops |size| bytes from the front of the unread data.
+  void ConsumeBytes(size_t size);
+
+  // Returns a frame sharing |size| bytes of buffer_ at |data|.
+  std::shared_ptr<MediaFrame> CreateFrameSlice(const uint8_t* data,
+                                               size_t size,
+                                               MediaType media_type);
+
   // consume a logical (compressed) access unit of size "size",
   // returns its timestamp in us (or -1 if no time information).
   int64_t FetchTimestamp(size_t size,
@@ -9,6 +9,8 @@
 
 #include <fstream>
 #include <iostream>
+#include <span>
+#include <vector>
 
 #include "base/logging.h"
 #include "foundation/media_frame.h"
@@ -33,55 +35,56 @@ int main(int argc, char** argv) {
   // Create parser
   auto parser = std::make_shared<TSParser>();
 
-  // Buffer for TS packets (188 bytes each)
-  constexpr size_t kTSPacketSize = 188;
-  uint8_t packet[kTSPacketSize];
+  // Read the file in large chunks; FeedTSBuffer() splits them into packets
+  // and carries partial packets over to the next chunk.
+  constexpr size_t kChunkSize = 1 << 20;
+  std::vector<uint8_t> chunk(kChunkSize);
 
-  size_t packet_count = 0;
+  size_t offset = 0;
   size_t video_frames = 0;
   size_t audio_frames = 0;
 
-  // Read and parse TS packets
-  while (file.read(reinterpret_cast<char*>(packet), kTSPacketSize)) {
-    TSParser::SyncEvent event(packet_count * kTSPacketSize);
-    status_t err = parser->FeedTSPacket(packet, kTSPacketSize, &event);
+  while (file) {
+    file.read(reinterpret_cast<char*>(chunk.data()), kChunkSize);
+    const size_t size = static_cast<size_t>(file.gcount());
+    if (size == 0) {
+      break;
+    }
 
+    TSParser::SyncEvent event(offset);
+    status_t err = parser->FeedTSBuffer(std::span(chunk.data(), size), &event);
     if (err != OK) {
-      AVE_LOG(LS_ERROR) << "Failed to parse TS packet " << packet_count
+      AVE_LOG(LS_ERROR) << "Malformed TS packets in chunk at offset " << offset
                         << ": error=" << err;
-      continue;
     }
 
     if (event.HasReturnedData()) {
-      AVE_LOG(LS_INFO) << "Sync event at packet " << packet_count
+      AVE_LOG(LS_INFO) << "Sync event in chunk at offset " << offset
                        << ", type=" << static_cast<int>(event.GetType())
                        << ", time=" << event.GetTimeUs() << " us";
     }
 
-    ++packet_count;
-
-    // Periodically check for available data
-    if (packet_count % 100 == 0) {
-      // Check for video
-      auto video_source = parser->GetSource(TSParser::VIDEO);
-      if (video_source) {
-        std::shared_ptr<MediaFrame> frame;
-        while (video_source->Read(frame, nullptr) == OK) {
-          ++video_frames;
-          AVE_LOG(LS_VERBOSE) << "Got video frame: size=" << frame->size()
-                              << ", pts=" << frame->pts().us();
-        }
+    offset += size;
+
+    // Check for video
+    auto video_source = parser->GetSource(TSParser::VIDEO);
+    if (video_source) {
+      std::shared_ptr<MediaFrame> frame;
+      while (video_source->Read(frame, nullptr) == OK) {
+        ++video_frames;
+        AVE_LOG(LS_VERBOSE) << "Got video frame: size=" << frame->size()
+                            << ", pts=" << frame->pts().us();
       }
+    }
 
-      // Check for audio
-      auto audio_source = parser->GetSource(TSParser::AUDIO);
-      if (audio_source) {
-        std::shared_ptr<MediaFrame> frame;
-        while (audio_source->Read(frame, nullptr) == OK) {
-          ++audio_frames;
-          AVE_LOG(LS_VERBOSE) << "Got audio frame: size=" << frame->size()
-                              << ", pts=" << frame->pts().us();
-        }
+    // Check for audio
+    auto audio_source = parser->GetSource(TSParser::AUDIO);
+    if (audio_source) {
+      std::shared_ptr<MediaFrame> frame;
+      while (audio_source->Read(frame, nullptr) == OK) {
+        ++audio_frames;
+        AVE_LOG(LS_VERBOSE) << "Got audio frame: size=" << frame->size()
+                            << ", pts=" << frame->pts().us();
       }
     }
   }
@@ -108,7 +111,10 @@ int main(int argc, char** argv) {
 
   // Print statistics
   std::cout << "\n=== MPEG2-TS Parsing Statistics ===" << std::endl;
-  std::cout << "Total TS packets: " << packet_count << std::endl;
+  const auto& stats = parser->GetFeedStats();
+  std::cout << "Total TS packets: " << stats.num_packets << std::endl;
+  std::cout << "Resyncs: " << stats.num_resyncs << " ("
+            << stats.num_skipped_bytes << " bytes skipped)" << std::endl;
   std::cout << "Video frames: " << video_frames << std::endl;
   std::cout << "Audio frames: " << audio_frames << std::endl;
   std::cout << "Has video source: "
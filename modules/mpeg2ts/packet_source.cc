@@ -10,6 +10,8 @@
 
 #include "packet_source.h"
 
+#include <utility>
+
 #include "base/logging.h"
 #include "foundation/media_defs.h"
 #include "foundation/media_frame.h"
@@ -27,7 +29,10 @@ PacketSource::PacketSource(std::shared_ptr<MediaMeta> meta)
       last_queued_time_us_(0),
       eos_result_(OK),
       latest_enqueued_meta_(nullptr),
-      latest_dequeued_meta_(nullptr) {
+      latest_dequeued_meta_(nullptr),
+      buffered_bytes_(0),
+      buffered_duration_us_(0),
+      full_(false) {
   SetFormat(meta);
   discontinuity_segments_.push_back(DiscontinuitySegment());
 }
@@ -35,6 +40,11 @@ PacketSource::PacketSource(std::shared_ptr<MediaMeta> meta)
 PacketSource::~PacketSource() {}
 
 void PacketSource::SetFormat(std::shared_ptr<MediaMeta> meta) {
+  std::scoped_lock lock(lock_);
+  SetFormatLocked(std::move(meta));
+}
+
+void PacketSource::SetFormatLocked(std::shared_ptr<MediaMeta> meta) {
   is_audio_ = false;
   is_video_ = false;
 
@@ -52,6 +62,19 @@ void PacketSource::SetFormat(std::shared_ptr<MediaMeta> meta) {
   }
 }
 
+void PacketSource::SetBufferLimits(const BufferLimits& limits,
+                                   BackpressureCallback callback) {
+  std::scoped_lock lock(lock_);
+  limits_ = limits;
+  backpressure_callback_ = std::move(callback);
+  UpdateBackpressure();
+}
+
+bool PacketSource::IsBufferFull() {
+  std::scoped_lock lock(lock_);
+  return full_;
+}
+
 status_t PacketSource::Start(std::shared_ptr<Message> /* params */) {
   return OK;
 }
@@ -67,10 +90,11 @@ std::shared_ptr<MediaMeta> PacketSource::GetFormat() {
   }
 
   // Search for format in buffered frames
-  for (auto& entry : queue_) {
+  for (size_t i = 0; i < queue_.size(); ++i) {
+    const QueueEntry& entry = queue_[i];
     if (!entry.IsDiscontinuity() && entry.frame_ && entry.frame_->size() > 0) {
       // Frames with data should have format information
-      SetFormat(std::make_shared<MediaMeta>(*entry.frame_));
+      SetFormatLocked(std::make_shared<MediaMeta>(*entry.frame_));
       return format_;
     }
   }
@@ -85,32 +109,53 @@ status_t PacketSource::DequeueAccessUnit(std::shared_ptr<MediaFrame>& frame) {
     condition_.wait(lock);
   }
 
-  if (!queue_.empty()) {
-    QueueEntry entry = queue_.front();
-    queue_.pop_front();
-    frame = entry.frame_;
+  return DequeueLocked(frame);
+}
 
-    if (entry.IsDiscontinuity()) {
-      if (WasFormatChange(static_cast<int32_t>(entry.discontinuity_type_))) {
-        format_ = nullptr;
-      }
+status_t PacketSource::TryDequeueAccessUnit(
+    std::shared_ptr<MediaFrame>& frame) {
+  frame = nullptr;
 
-      discontinuity_segments_.pop_front();
-      return INFO_DISCONTINUITY;
-    }
+  std::scoped_lock lock(lock_);
+  if (eos_result_ == OK && queue_.empty()) {
+    return E_AGAIN;
+  }
+
+  return DequeueLocked(frame);
+}
 
-    DiscontinuitySegment& seg = discontinuity_segments_.front();
+status_t PacketSource::DequeueLocked(std::shared_ptr<MediaFrame>& frame) {
+  if (queue_.empty()) {
+    return eos_result_;
+  }
+
+  QueueEntry entry = std::move(queue_.front());
+  queue_.pop_front();
+  frame = std::move(entry.frame_);
 
-    int64_t time_us = frame->pts().us_or(-1);
-    latest_dequeued_meta_ = std::make_shared<MediaMeta>(*frame);
-    if (time_us > seg.max_deque_time_us_) {
-      seg.max_deque_time_us_ = time_us;
+  if (entry.IsDiscontinuity()) {
+    if (WasFormatChange(static_cast<int32_t>(entry.discontinuity_type_))) {
+      format_ = nullptr;
     }
 
-    return OK;
+    buffered_duration_us_ -= discontinuity_segments_.front().DurationUs();
+    discontinuity_segments_.pop_front();
+    UpdateBackpressure();
+    return INFO_DISCONTINUITY;
   }
 
-  return eos_result_;
+  DiscontinuitySegment& seg = discontinuity_segments_.front();
+
+  int64_t time_us = frame->pts().us_or(-1);
+  latest_dequeued_meta_ = std::make_shared<MediaMeta>(*frame);
+  if (time_us > seg.max_deque_time_us_) {
+    buffered_duration_us_ -= time_us - seg.max_deque_time_us_;
+    seg.max_deque_time_us_ = time_us;
+  }
+
+  buffered_bytes_ -= frame->size();
+  UpdateBackpressure();
+  return OK;
 }
 
 status_t PacketSource::Read(std::shared_ptr<MediaFrame>& frame,
@@ -140,21 +185,25 @@ void PacketSource::QueueAccessUnit(std::shared_ptr<MediaFrame> frame) {
   std::scoped_lock lock(lock_);
   queue_.push_back(QueueEntry{.frame_ = frame});
   condition_.notify_one();
+  buffered_bytes_ += frame->size();
 
   int64_t last_queued_time_us = frame->pts().us_or(-1);
   if (last_queued_time_us >= 0) {
     last_queued_time_us_ = last_queued_time_us;
 
     DiscontinuitySegment& tail_seg = discontinuity_segments_.back();
+    const int64_t tail_duration_us = tail_seg.DurationUs();
     if (last_queued_time_us > tail_seg.max_enque_time_us_) {
       tail_seg.max_enque_time_us_ = last_queued_time_us;
     }
     if (tail_seg.max_deque_time_us_ < 0) {
       tail_seg.max_deque_time_us_ = last_queued_time_us;
     }
+    buffered_duration_us_ += tail_seg.DurationUs() - tail_duration_us;
   }
 
   latest_enqueued_meta_ = std::make_shared<MediaMeta>(*frame);
+  UpdateBackpressure();
 }
 
 void PacketSource::QueueDiscontinuity(DiscontinuityType type,
@@ -169,6 +218,9 @@ void PacketSource::QueueDiscontinuity(DiscontinuityType type,
     for (auto& seg : discontinuity_segments_) {
       seg.Clear();
     }
+    buffered_bytes_ = 0;
+    buffered_duration_us_ = 0;
+    UpdateBackpressure();
   }
 
   eos_result_ = OK;
@@ -225,7 +277,8 @@ bool PacketSource::HasDataBufferAvailable(status_t* final_result) {
     return false;
   }
 
-  for (const auto& entry : queue_) {
+  for (size_t i = 0; i < queue_.size(); ++i) {
+    const QueueEntry& entry = queue_[i];
     if (!entry.IsDiscontinuity() && entry.frame_ && entry.frame_->size() > 0) {
       return true;
     }
@@ -252,13 +305,12 @@ size_t PacketSource::GetAvailableBufferCount(status_t* final_result) {
 int64_t PacketSource::GetBufferedDurationUs(status_t* final_result) {
   std::scoped_lock lock(lock_);
   *final_result = eos_result_;
+  return buffered_duration_us_;
+}
 
-  int64_t duration_us = 0;
-  for (const auto& seg : discontinuity_segments_) {
-    duration_us += (seg.max_enque_time_us_ - seg.max_deque_time_us_);
-  }
-
-  return duration_us;
+size_t PacketSource::GetBufferedBytes() {
+  std::scoped_lock lock(lock_);
+  return buffered_bytes_;
 }
 
 status_t PacketSource::NextBufferTime(int64_t* time_us) {
@@ -313,6 +365,33 @@ void PacketSource::Clear() {
   latest_dequeued_meta_ = nullptr;
   discontinuity_segments_.clear();
   discontinuity_segments_.push_back(DiscontinuitySegment());
+  buffered_bytes_ = 0;
+  buffered_duration_us_ = 0;
+  UpdateBackpressure();
+}
+
+void PacketSource::UpdateBackpressure() {
+  const bool bytes_bounded = limits_.high_watermark_bytes > 0;
+  const bool time_bounded = limits_.high_watermark_us > 0;
+
+  bool full = false;
+  if (full_) {
+    full = (bytes_bounded &&
+            buffered_bytes_ > limits_.low_watermark_bytes) ||
+           (time_bounded && buffered_duration_us_ > limits_.low_watermark_us);
+  } else {
+    full = (bytes_bounded &&
+            buffered_bytes_ >= limits_.high_watermark_bytes) ||
+           (time_bounded && buffered_duration_us_ >= limits_.high_watermark_us);
+  }
+  if (full == full_) {
+    return;
+  }
+
+  full_ = full;
+  if (backpressure_callback_) {
+    backpressure_callback_(full);
+  }
 }
 
 }  // namespace mpeg2ts
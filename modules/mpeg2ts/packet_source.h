@@ -12,6 +12,9 @@
 #define MODULES_MPEG2TS_PACKET_SOURCE_H
 
 #include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
 #include <list>
 #include <memory>
 #include <mutex>
@@ -20,6 +23,7 @@
 #include "foundation/media_errors.h"
 #include "foundation/media_source.h"
 #include "foundation/message.h"
+#include "ring_queue.h"
 
 namespace ave {
 namespace media {
@@ -47,11 +51,34 @@ enum class DiscontinuityType : int32_t {
 
 class PacketSource : public MediaSource {
  public:
+  // Bounds on what the source buffers. A zero high watermark leaves that
+  // measure unbounded. The source turns full once any bounded measure
+  // reaches its high watermark, and stops being full once every bounded
+  // measure dropped to its low watermark.
+  struct BufferLimits {
+    size_t high_watermark_bytes = 0;
+    size_t low_watermark_bytes = 0;
+    int64_t high_watermark_us = 0;
+    int64_t low_watermark_us = 0;
+  };
+
+  // Called with true when the source turns full and with false when it
+  // drained to the low watermarks. It runs on the thread that queued or
+  // dequeued, with the source locked, so it must not call back into it.
+  using BackpressureCallback = std::function<void(bool full)>;
+
   explicit PacketSource(std::shared_ptr<MediaMeta> meta);
   virtual ~PacketSource();
 
   void SetFormat(std::shared_ptr<MediaMeta> meta);
 
+  // Bounds the source. Queueing never blocks or drops, the feeder is
+  // expected to pause while the source is full.
+  void SetBufferLimits(const BufferLimits& limits,
+                       BackpressureCallback callback);
+
+  bool IsBufferFull();
+
   status_t Start(std::shared_ptr<Message> params) override;
   status_t Stop() override;
   std::shared_ptr<MediaMeta> GetFormat() override;
@@ -74,6 +101,9 @@ class PacketSource : public MediaSource {
   // presentation timestamps since the last discontinuity (if any).
   int64_t GetBufferedDurationUs(status_t* final_result);
 
+  // Returns the payload bytes of the queued access units.
+  size_t GetBufferedBytes();
+
   status_t NextBufferTime(int64_t* time_us);
 
   void QueueAccessUnit(std::shared_ptr<MediaFrame> frame);
@@ -84,8 +114,13 @@ class PacketSource : public MediaSource {
 
   void SignalEOS(status_t result);
 
+  // Waits until an access unit, a discontinuity or the end of stream is
+  // available.
   status_t DequeueAccessUnit(std::shared_ptr<MediaFrame>& frame);
 
+  // Like DequeueAccessUnit() but returns E_AGAIN instead of waiting.
+  status_t TryDequeueAccessUnit(std::shared_ptr<MediaFrame>& frame);
+
   bool IsFinished(int64_t duration) const;
 
   void Enable(bool enable);
@@ -101,6 +136,10 @@ class PacketSource : public MediaSource {
     DiscontinuitySegment() : max_deque_time_us_(-1), max_enque_time_us_(-1) {}
 
     void Clear() { max_deque_time_us_ = max_enque_time_us_ = -1; }
+
+    int64_t DurationUs() const {
+      return max_enque_time_us_ - max_deque_time_us_;
+    }
   };
 
   struct QueueEntry {
@@ -121,15 +160,30 @@ class PacketSource : public MediaSource {
   bool enabled_;
   std::shared_ptr<MediaMeta> format_;
   int64_t last_queued_time_us_;
-  std::list<QueueEntry> queue_;
+  RingQueue<QueueEntry> queue_;
   status_t eos_result_;
   std::shared_ptr<MediaMeta> latest_enqueued_meta_;
   std::shared_ptr<MediaMeta> latest_dequeued_meta_;
 
   std::list<DiscontinuitySegment> discontinuity_segments_;
 
+  // Kept up to date on every queue change so the buffered amount is known
+  // without walking the queue. |buffered_duration_us_| is the sum of the
+  // segment durations.
+  size_t buffered_bytes_;
+  int64_t buffered_duration_us_;
+
+  BufferLimits limits_;
+  BackpressureCallback backpressure_callback_;
+  bool full_;
+
   bool WasFormatChange(int32_t discontinuity_type) const;
 
+  // These are called with |lock_| held.
+  void SetFormatLocked(std::shared_ptr<MediaMeta> meta);
+  status_t DequeueLocked(std::shared_ptr<MediaFrame>& frame);
+  void UpdateBackpressure();
+
   AVE_DISALLOW_COPY_AND_ASSIGN(PacketSource);
 };
 
@@ -0,0 +1,106 @@
+/*
+ * ring_queue.h
+ * Copyright (C) 2025 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#ifndef MODULES_MPEG2TS_RING_QUEUE_H
+#define MODULES_MPEG2TS_RING_QUEUE_H
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include "base/checks.h"
+
+namespace ave {
+namespace media {
+namespace mpeg2ts {
+
+// Queue of small values in a power-of-two ring that only grows, so a steady
+// push/pop pattern allocates nothing. Popped slots are reset so owning
+// values are released right away. Not thread safe.
+template <typename T>
+class RingQueue {
+ public:
+  explicit RingQueue(size_t initial_capacity = 16) {
+    size_t capacity = 1;
+    while (capacity < initial_capacity) {
+      capacity <<= 1;
+    }
+    items_.resize(capacity);
+  }
+
+  bool empty() const { return size_ == 0; }
+  size_t size() const { return size_; }
+
+  T& front() {
+    AVE_DCHECK(!empty());
+    return items_[head_];
+  }
+  const T& front() const {
+    AVE_DCHECK(!empty());
+    return items_[head_];
+  }
+
+  T& back() {
+    AVE_DCHECK(!empty());
+    return items_[(head_ + size_ - 1) & (items_.size() - 1)];
+  }
+
+  // |index| counts from the front.
+  const T& operator[](size_t index) const {
+    AVE_DCHECK_LT(index, size_);
+    return items_[(head_ + index) & (items_.size() - 1)];
+  }
+
+  void push_back(T item) {
+    if (size_ == items_.size()) {
+      Grow();
+    }
+    items_[(head_ + size_) & (items_.size() - 1)] = std::move(item);
+    ++size_;
+  }
+
+  void pop_front() {
+    AVE_DCHECK(!empty());
+    items_[head_] = T();
+    head_ = (head_ + 1) & (items_.size() - 1);
+    --size_;
+  }
+
+  void pop_back() {
+    AVE_DCHECK(!empty());
+    back() = T();
+    --size_;
+  }
+
+  void clear() {
+    while (!empty()) {
+      pop_back();
+    }
+    head_ = 0;
+    size_ = 0;
+  }
+
+ private:
+  void Grow() {
+    std::vector<T> items(items_.size() * 2);
+    for (size_t i = 0; i < size_; ++i) {
+      items[i] = std::move(items_[(head_ + i) & (items_.size() - 1)]);
+    }
+    items_ = std::move(items);
+    head_ = 0;
+  }
+
+  std::vector<T> items_;
+  size_t head_ = 0;
+  size_t size_ = 0;
+};
+
+}  // namespace mpeg2ts
+}  // namespace media
+}  // namespace ave
+
+#endif  // MODULES_MPEG2TS_RING_QUEUE_H
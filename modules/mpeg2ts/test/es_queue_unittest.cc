@@ -0,0 +1,183 @@
+/*
+ * es_queue_unittest.cc
+ * Copyright (C) 2025 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#include "media/modules/mpeg2ts/es_queue.h"
+
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "media/foundation/media_frame.h"
+#include "media/modules/mpeg2ts/ring_queue.h"
+#include "test/gtest.h"
+
+namespace ave {
+namespace media {
+namespace mpeg2ts {
+
+namespace {
+
+// AAC LC, 44.1 kHz, stereo ADTS frame of |size| bytes filled with |fill|.
+std::vector<uint8_t> MakeAdtsFrame(size_t size, uint8_t fill) {
+  std::vector<uint8_t> frame = {0xff,
+                                0xf1,
+                                0x50,
+                                0x80,
+                                static_cast<uint8_t>((size >> 3) & 0xff),
+                                static_cast<uint8_t>(((size & 0x07) << 5) |
+                                                     0x1f),
+                                0xfc};
+  frame.resize(size, fill);
+  return frame;
+}
+
+// Access unit delimiter followed by a slice with first_mb_in_slice = 0.
+std::vector<uint8_t> MakeH264AccessUnit(size_t start_code_size,
+                                        uint8_t fill) {
+  std::vector<uint8_t> au;
+  for (uint8_t nal_header : {0x09, 0x65}) {
+    au.insert(au.end(), start_code_size - 1, 0x00);
+    au.push_back(0x01);
+    au.push_back(nal_header);
+    if (nal_header == 0x09) {
+      au.push_back(0xf0);
+    } else {
+      au.push_back(0x88);
+      au.insert(au.end(), 100, fill);
+    }
+  }
+  return au;
+}
+
+}  // namespace
+
+TEST(RingQueueTest, GrowsAndWrapsAround) {
+  RingQueue<int> queue(4);
+  int next_push = 0;
+  int next_pop = 0;
+  for (int round = 0; round < 10; ++round) {
+    for (int i = 0; i < round + 3; ++i) {
+      queue.push_back(next_push++);
+    }
+    for (int i = 0; i < 2; ++i) {
+      ASSERT_FALSE(queue.empty());
+      EXPECT_EQ(queue.front(), next_pop++);
+      queue.pop_front();
+    }
+  }
+  EXPECT_EQ(queue.size(), static_cast<size_t>(next_push - next_pop));
+  while (!queue.empty()) {
+    EXPECT_EQ(queue.front(), next_pop++);
+    queue.pop_front();
+  }
+  queue.clear();
+  EXPECT_TRUE(queue.empty());
+}
+
+TEST(ESQueueTest, AacFramesShareTheQueueBuffer) {
+  ESQueue queue(ESQueue::Mode::AAC);
+  std::vector<uint8_t> pes;
+  for (uint8_t i = 0; i < 3; ++i) {
+    const auto frame = MakeAdtsFrame(200, i);
+    pes.insert(pes.end(), frame.begin(), frame.end());
+  }
+  ASSERT_EQ(queue.AppendData(pes.data(), pes.size(), 0), OK);
+
+  auto first = queue.DequeueAccessUnit();
+  auto second = queue.DequeueAccessUnit();
+  ASSERT_TRUE(first && second);
+  EXPECT_EQ(first->size(), 200u);
+  EXPECT_EQ(second->size(), 200u);
+  // Zero-copy: the frames are adjacent slices of the same memory.
+  EXPECT_EQ(second->data(), first->data() + first->size());
+  EXPECT_EQ(second->data()[100], 1);
+}
+
+TEST(ESQueueTest, PESContinuationKeepsOneTimestampRange) {
+  ESQueue queue(ESQueue::Mode::AAC);
+  std::vector<uint8_t> pes;
+  for (uint8_t i = 0; i < 2; ++i) {
+    const auto frame = MakeAdtsFrame(300, i);
+    pes.insert(pes.end(), frame.begin(), frame.end());
+  }
+  // The second half of the PES arrives separately and a second PES loses
+  // its tail.
+  ASSERT_EQ(queue.AppendData(pes.data(), 184, 1000), OK);
+  ASSERT_EQ(queue.AppendPESContinuation(pes.data() + 184, pes.size() - 184),
+            OK);
+  ASSERT_EQ(queue.AppendData(pes.data(), 184, 5000), OK);
+  queue.DropTrailingData(184);
+
+  auto first = queue.DequeueAccessUnit();
+  auto second = queue.DequeueAccessUnit();
+  ASSERT_TRUE(first && second);
+  EXPECT_EQ(first->size(), 300u);
+  EXPECT_EQ(first->pts().us(), 1000);
+  EXPECT_EQ(second->size(), 300u);
+  EXPECT_EQ(second->data()[299], 1);
+  EXPECT_EQ(queue.DequeueAccessUnit(), nullptr);
+}
+
+TEST(ESQueueTest, EmittedFramesSurviveLaterAppends) {
+  ESQueue queue(ESQueue::Mode::AAC);
+  std::vector<std::shared_ptr<MediaFrame>> frames;
+  // Enough data to outgrow the queue buffer several times while every
+  // frame is still referenced.
+  for (size_t i = 0; i < 400; ++i) {
+    const auto frame = MakeAdtsFrame(150 + i % 50, static_cast<uint8_t>(i));
+    ASSERT_EQ(queue.AppendData(frame.data(), frame.size(), -1), OK);
+    while (auto access_unit = queue.DequeueAccessUnit()) {
+      frames.push_back(access_unit);
+    }
+  }
+  ASSERT_EQ(frames.size(), 400u);
+  for (size_t i = 0; i < frames.size(); ++i) {
+    ASSERT_EQ(frames[i]->size(), 150 + i % 50);
+    EXPECT_EQ(frames[i]->data()[0], 0xff);
+    EXPECT_EQ(frames[i]->data()[frames[i]->size() - 1],
+              static_cast<uint8_t>(i));
+  }
+}
+
+TEST(ESQueueTest, H264AccessUnitIsSliceWithFourByteStartCodes) {
+  ESQueue queue(ESQueue::Mode::H264);
+  std::vector<uint8_t> es;
+  for (uint8_t i = 0; i < 3; ++i) {
+    const auto au = MakeH264AccessUnit(4, i);
+    es.insert(es.end(), au.begin(), au.end());
+  }
+  ASSERT_EQ(queue.AppendData(es.data(), es.size(), 0), OK);
+
+  const auto expected = MakeH264AccessUnit(4, 0);
+  auto first = queue.DequeueAccessUnit();
+  auto second = queue.DequeueAccessUnit();
+  ASSERT_TRUE(first && second);
+  ASSERT_EQ(first->size(), expected.size());
+  EXPECT_EQ(memcmp(first->data(), expected.data(), expected.size()), 0);
+  EXPECT_EQ(second->data(), first->data() + first->size());
+}
+
+TEST(ESQueueTest, H264AccessUnitWithShortStartCodesIsRewritten) {
+  ESQueue queue(ESQueue::Mode::H264);
+  std::vector<uint8_t> es;
+  for (uint8_t i = 0; i < 3; ++i) {
+    const auto au = MakeH264AccessUnit(3, i);
+    es.insert(es.end(), au.begin(), au.end());
+  }
+  ASSERT_EQ(queue.AppendData(es.data(), es.size(), 0), OK);
+
+  const auto expected = MakeH264AccessUnit(4, 1);
+  auto first = queue.DequeueAccessUnit();
+  auto second = queue.DequeueAccessUnit();
+  ASSERT_TRUE(first && second);
+  ASSERT_EQ(second->size(), expected.size());
+  EXPECT_EQ(memcmp(second->data(), expected.data(), expected.size()), 0);
+}
+
+}  // namespace mpeg2ts
+}  // namespace media
+}  // namespace ave
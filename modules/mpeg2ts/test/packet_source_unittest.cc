@@ -0,0 +1,146 @@
+/*
+ * packet_source_unittest.cc
+ * Copyright (C) 2025 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#include "media/modules/mpeg2ts/packet_source.h"
+
+#include <memory>
+#include <vector>
+
+#include "media/foundation/media_frame.h"
+#include "test/gtest.h"
+
+namespace ave {
+namespace media {
+namespace mpeg2ts {
+
+namespace {
+
+std::shared_ptr<MediaFrame> MakeFrame(size_t size, int64_t pts_us) {
+  auto frame = MediaFrame::CreateShared(size, MediaType::AUDIO);
+  frame->setRange(0, size);
+  frame->SetPts(base::Timestamp::Micros(pts_us));
+  return frame;
+}
+
+}  // namespace
+
+TEST(PacketSourceTest, TryDequeueDoesNotWait) {
+  PacketSource source(nullptr);
+  std::shared_ptr<MediaFrame> frame;
+  EXPECT_EQ(source.TryDequeueAccessUnit(frame), E_AGAIN);
+
+  source.QueueAccessUnit(MakeFrame(100, 0));
+  ASSERT_EQ(source.TryDequeueAccessUnit(frame), OK);
+  EXPECT_EQ(frame->size(), 100u);
+
+  source.SignalEOS(ERROR_END_OF_STREAM);
+  EXPECT_EQ(source.TryDequeueAccessUnit(frame), ERROR_END_OF_STREAM);
+}
+
+TEST(PacketSourceTest, TracksBufferedBytesAndDuration) {
+  PacketSource source(nullptr);
+  status_t final_result = OK;
+  for (int64_t i = 0; i < 4; ++i) {
+    source.QueueAccessUnit(MakeFrame(100, i * 20000));
+  }
+  EXPECT_EQ(source.GetBufferedBytes(), 400u);
+  EXPECT_EQ(source.GetBufferedDurationUs(&final_result), 60000);
+
+  std::shared_ptr<MediaFrame> frame;
+  ASSERT_EQ(source.DequeueAccessUnit(frame), OK);
+  ASSERT_EQ(source.DequeueAccessUnit(frame), OK);
+  EXPECT_EQ(source.GetBufferedBytes(), 200u);
+  EXPECT_EQ(source.GetBufferedDurationUs(&final_result), 40000);
+
+  // The duration restarts after the discontinuity and adds up over both
+  // segments.
+  source.QueueDiscontinuity(DiscontinuityType::TIME, nullptr, false);
+  source.QueueAccessUnit(MakeFrame(50, 1000000));
+  source.QueueAccessUnit(MakeFrame(50, 1030000));
+  EXPECT_EQ(source.GetBufferedBytes(), 300u);
+  EXPECT_EQ(source.GetBufferedDurationUs(&final_result), 70000);
+
+  ASSERT_EQ(source.DequeueAccessUnit(frame), OK);
+  ASSERT_EQ(source.DequeueAccessUnit(frame), OK);
+  EXPECT_EQ(source.DequeueAccessUnit(frame), INFO_DISCONTINUITY);
+  EXPECT_EQ(source.GetBufferedDurationUs(&final_result), 30000);
+
+  source.QueueDiscontinuity(DiscontinuityType::TIME, nullptr, true);
+  EXPECT_EQ(source.GetBufferedBytes(), 0u);
+  EXPECT_EQ(source.GetBufferedDurationUs(&final_result), 0);
+}
+
+TEST(PacketSourceTest, ByteWatermarksSignalBackpressure) {
+  PacketSource source(nullptr);
+  std::vector<bool> events;
+  source.SetBufferLimits({.high_watermark_bytes = 300,
+                          .low_watermark_bytes = 100},
+                         [&events](bool full) { events.push_back(full); });
+
+  source.QueueAccessUnit(MakeFrame(100, 0));
+  source.QueueAccessUnit(MakeFrame(100, 10000));
+  EXPECT_FALSE(source.IsBufferFull());
+  source.QueueAccessUnit(MakeFrame(100, 20000));
+  EXPECT_TRUE(source.IsBufferFull());
+  source.QueueAccessUnit(MakeFrame(100, 30000));
+  EXPECT_EQ(events, std::vector<bool>({true}));
+
+  // Stays full until drained down to the low watermark.
+  std::shared_ptr<MediaFrame> frame;
+  ASSERT_EQ(source.DequeueAccessUnit(frame), OK);
+  ASSERT_EQ(source.DequeueAccessUnit(frame), OK);
+  EXPECT_TRUE(source.IsBufferFull());
+  ASSERT_EQ(source.DequeueAccessUnit(frame), OK);
+  EXPECT_FALSE(source.IsBufferFull());
+  EXPECT_EQ(events, std::vector<bool>({true, false}));
+}
+
+TEST(PacketSourceTest, DurationWatermarksSignalBackpressure) {
+  PacketSource source(nullptr);
+  std::vector<bool> events;
+  source.SetBufferLimits({.high_watermark_us = 100000,
+                          .low_watermark_us = 40000},
+                         [&events](bool full) { events.push_back(full); });
+
+  for (int64_t i = 0; i <= 5; ++i) {
+    source.QueueAccessUnit(MakeFrame(10, i * 20000));
+  }
+  EXPECT_TRUE(source.IsBufferFull());
+
+  std::shared_ptr<MediaFrame> frame;
+  for (int i = 0; i < 3; ++i) {
+    ASSERT_EQ(source.TryDequeueAccessUnit(frame), OK);
+  }
+  EXPECT_TRUE(source.IsBufferFull());
+  ASSERT_EQ(source.TryDequeueAccessUnit(frame), OK);
+  EXPECT_FALSE(source.IsBufferFull());
+
+  // Clearing the source releases the feeder too.
+  for (int64_t i = 6; i <= 12; ++i) {
+    source.QueueAccessUnit(MakeFrame(10, i * 20000));
+  }
+  EXPECT_TRUE(source.IsBufferFull());
+  source.Clear();
+  EXPECT_FALSE(source.IsBufferFull());
+  EXPECT_EQ(events, std::vector<bool>({true, false, true, false}));
+}
+
+TEST(PacketSourceTest, DequeuedFramesAreReleased) {
+  PacketSource source(nullptr);
+  auto queued = MakeFrame(10, 0);
+  std::weak_ptr<MediaFrame> weak = queued;
+  source.QueueAccessUnit(std::move(queued));
+
+  std::shared_ptr<MediaFrame> frame;
+  ASSERT_EQ(source.DequeueAccessUnit(frame), OK);
+  frame = nullptr;
+  EXPECT_TRUE(weak.expired());
+}
+
+}  // namespace mpeg2ts
+}  // namespace media
+}  // namespace ave
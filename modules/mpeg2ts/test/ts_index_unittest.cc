@@ -0,0 +1,358 @@
+/*
+ * ts_index_unittest.cc
+ * Copyright (C) 2025 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#include "media/modules/mpeg2ts/ts_index.h"
+
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "media/foundation/media_errors.h"
+#include "media/foundation/media_frame.h"
+#include "media/modules/mpeg2ts/packet_source.h"
+#include "media/modules/mpeg2ts/ts_file_source.h"
+#include "media/modules/mpeg2ts/ts_parser.h"
+#include "media/modules/mpeg2ts/ts_sync.h"
+#include "media/modules/mpeg2ts/ts_writer.h"
+#include "test/gtest.h"
+
+namespace ave {
+namespace media {
+namespace mpeg2ts {
+
+namespace {
+
+constexpr size_t kNumVideoFrames = 100;
+constexpr size_t kKeyFrameInterval = 10;
+constexpr int64_t kFrameDurationUs = 40000;
+// Timestamps start here, so index times are not absolute times.
+constexpr int64_t kStartTimeUs = 10000000;
+
+// Baseline 320x240 SPS and a matching PPS.
+constexpr uint8_t kSps[] = {0x00, 0x00, 0x00, 0x01, 0x67, 0x42,
+                            0xc0, 0x1e, 0xda, 0x05, 0x07, 0xe4};
+constexpr uint8_t kPps[] = {0x00, 0x00, 0x00, 0x01, 0x68, 0xce, 0x3c, 0x80};
+
+std::vector<uint8_t> MakeH264AccessUnit(bool idr, size_t size) {
+  std::vector<uint8_t> au;
+  if (idr) {
+    au.insert(au.end(), std::begin(kSps), std::end(kSps));
+    au.insert(au.end(), std::begin(kPps), std::end(kPps));
+  }
+  au.insert(au.end(), {0x00, 0x00, 0x00, 0x01,
+                       static_cast<uint8_t>(idr ? 0x65 : 0x41), 0x88});
+  au.resize(au.size() + size, 0x5a);
+  return au;
+}
+
+std::vector<uint8_t> MakeAdtsFrame(size_t size) {
+  std::vector<uint8_t> frame = {0xff,
+                                0xf1,
+                                0x50,
+                                0x80,
+                                static_cast<uint8_t>((size >> 3) & 0xff),
+                                static_cast<uint8_t>(((size & 0x07) << 5) |
+                                                     0x1f),
+                                0xfc};
+  frame.resize(size, 0x11);
+  return frame;
+}
+
+// H.264 at 25 fps with an IDR picture every 10 frames, and AAC.
+std::vector<uint8_t> MakeStream() {
+  TSWriter writer;
+  size_t video = 0;
+  size_t audio = 0;
+  EXPECT_EQ(writer.AddStream(TSParser::STREAMTYPE_H264, &video), OK);
+  EXPECT_EQ(writer.AddStream(TSParser::STREAMTYPE_MPEG2_AUDIO_ADTS, &audio),
+            OK);
+  int64_t audio_time_us = 0;
+  for (size_t i = 0; i < kNumVideoFrames; ++i) {
+    const int64_t time_us = static_cast<int64_t>(i) * kFrameDurationUs;
+    while (audio_time_us <= time_us) {
+      EXPECT_EQ(writer.WriteAccessUnit(audio, MakeAdtsFrame(300),
+                                       kStartTimeUs + audio_time_us, -1,
+                                       true),
+                OK);
+      audio_time_us += 23220;
+    }
+    const bool idr = i % kKeyFrameInterval == 0;
+    EXPECT_EQ(writer.WriteAccessUnit(video,
+                                     MakeH264AccessUnit(idr, 300 + 97 * i),
+                                     kStartTimeUs + time_us, -1, idr),
+              OK);
+  }
+  writer.Flush();
+
+  std::vector<std::shared_ptr<Buffer>> blocks;
+  writer.TakeBlocks(&blocks);
+  std::vector<uint8_t> ts;
+  for (const auto& block : blocks) {
+    ts.insert(ts.end(), block->data(), block->data() + block->size());
+  }
+  return ts;
+}
+
+// Repacks 188-byte packets into M2TS packets with zero arrival time
+// stamps, or into 204-byte ones with the parity filled with sync bytes.
+std::vector<uint8_t> Restride(const std::vector<uint8_t>& ts, size_t stride) {
+  std::vector<uint8_t> out;
+  for (size_t offset = 0; offset < ts.size(); offset += kTSPacketSize) {
+    if (stride == kM2TSPacketSize) {
+      out.insert(out.end(), kM2TSHeaderSize, 0x00);
+    }
+    out.insert(out.end(), ts.begin() + offset,
+               ts.begin() + offset + kTSPacketSize);
+    if (stride == kRSPacketSize) {
+      out.insert(out.end(), kRSPacketSize - kTSPacketSize, kTSSyncByte);
+    }
+  }
+  return out;
+}
+
+std::string WriteTempFile(const std::string& name,
+                          const std::vector<uint8_t>& data) {
+  const auto path = std::filesystem::temp_directory_path() / name;
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  file.write(reinterpret_cast<const char*>(data.data()), data.size());
+  return path.string();
+}
+
+}  // namespace
+
+TEST(TSIndexTest, IndexesKeyFrames) {
+  const auto ts = MakeStream();
+  std::shared_ptr<TSIndex> index;
+  ASSERT_EQ(TSIndex::Build(ts, TSIndex::BuildOptions(), &index), OK);
+
+  const auto& entries = index->entries();
+  ASSERT_EQ(entries.size(), kNumVideoFrames / kKeyFrameInterval);
+  for (size_t i = 0; i < entries.size(); ++i) {
+    EXPECT_EQ(entries[i].time_us,
+              static_cast<int64_t>(i * kKeyFrameInterval) * kFrameDurationUs);
+    // The PES starts at a video packet.
+    const uint8_t* packet = ts.data() + entries[i].offset;
+    EXPECT_EQ(packet[0], kTSSyncByte);
+    EXPECT_EQ(packet[1] & 0x40, 0x40);
+    EXPECT_EQ(((packet[1] & 0x1f) << 8) | packet[2], 0x100);
+    EXPECT_GE(entries[i].pcr, 0);
+  }
+  EXPECT_EQ(index->first_pts_us(), kStartTimeUs);
+  EXPECT_EQ(index->duration_us(),
+            static_cast<int64_t>(kNumVideoFrames - 1) * kFrameDurationUs);
+  EXPECT_EQ(index->file_size(), static_cast<int64_t>(ts.size()));
+}
+
+TEST(TSIndexTest, ParallelChunksMatchSingleScan) {
+  const auto ts = MakeStream();
+  std::shared_ptr<TSIndex> single;
+  TSIndex::BuildOptions options;
+  options.num_threads = 1;
+  options.chunk_size = ts.size();
+  ASSERT_EQ(TSIndex::Build(ts, options, &single), OK);
+
+  // Chunks much smaller than an access unit start in the middle of PES
+  // packets and end before their first slice.
+  std::shared_ptr<TSIndex> parallel;
+  options.num_threads = 4;
+  options.chunk_size = 7 * kTSPacketSize;
+  ASSERT_EQ(TSIndex::Build(ts, options, &parallel), OK);
+
+  ASSERT_EQ(parallel->entries().size(), single->entries().size());
+  for (size_t i = 0; i < single->entries().size(); ++i) {
+    EXPECT_EQ(parallel->entries()[i].offset, single->entries()[i].offset);
+    EXPECT_EQ(parallel->entries()[i].time_us, single->entries()[i].time_us);
+    EXPECT_EQ(parallel->entries()[i].pcr, single->entries()[i].pcr);
+  }
+  EXPECT_EQ(parallel->duration_us(), single->duration_us());
+}
+
+TEST(TSIndexTest, IndexesM2TSAndRSPackets) {
+  const auto ts = MakeStream();
+  std::shared_ptr<TSIndex> reference;
+  ASSERT_EQ(TSIndex::Build(ts, TSIndex::BuildOptions(), &reference), OK);
+
+  for (const size_t stride : {kM2TSPacketSize, kRSPacketSize}) {
+    SCOPED_TRACE(stride);
+    const auto data = Restride(ts, stride);
+    std::shared_ptr<TSIndex> index;
+    TSIndex::BuildOptions options;
+    options.num_threads = 4;
+    options.chunk_size = 7 * stride;
+    ASSERT_EQ(TSIndex::Build(data, options, &index), OK);
+
+    ASSERT_EQ(index->entries().size(), reference->entries().size());
+    for (size_t i = 0; i < index->entries().size(); ++i) {
+      const auto& entry = index->entries()[i];
+      const auto& expected = reference->entries()[i];
+      // Entries point at the whole packet, M2TS header included.
+      EXPECT_EQ(entry.offset,
+                expected.offset / static_cast<int64_t>(kTSPacketSize) *
+                    static_cast<int64_t>(stride));
+      EXPECT_EQ(entry.time_us, expected.time_us);
+      EXPECT_EQ(entry.pcr, expected.pcr);
+    }
+    EXPECT_EQ(index->duration_us(), reference->duration_us());
+  }
+}
+
+TEST(TSIndexTest, FindSyncPoint) {
+  const auto ts = MakeStream();
+  std::shared_ptr<TSIndex> index;
+  ASSERT_EQ(TSIndex::Build(ts, TSIndex::BuildOptions(), &index), OK);
+
+  using ReadOptions = MediaSource::ReadOptions;
+  EXPECT_EQ(index->FindSyncPoint(1300000, ReadOptions::SEEK_PREVIOUS_SYNC)
+                ->time_us,
+            1200000);
+  EXPECT_EQ(index->FindSyncPoint(1200000, ReadOptions::SEEK_PREVIOUS_SYNC)
+                ->time_us,
+            1200000);
+  EXPECT_EQ(
+      index->FindSyncPoint(1300000, ReadOptions::SEEK_NEXT_SYNC)->time_us,
+      1600000);
+  EXPECT_EQ(
+      index->FindSyncPoint(1500000, ReadOptions::SEEK_CLOSEST_SYNC)->time_us,
+      1600000);
+  EXPECT_EQ(index->FindSyncPoint(-1, ReadOptions::SEEK_PREVIOUS_SYNC)->time_us,
+            0);
+  EXPECT_EQ(
+      index->FindSyncPoint(99000000, ReadOptions::SEEK_NEXT_SYNC)->time_us,
+      3600000);
+}
+
+TEST(TSIndexTest, SidecarRoundTrip) {
+  const std::string path = WriteTempFile("ts_index_sidecar.ts", MakeStream());
+  const std::string sidecar_path = TSIndex::SidecarPath(path);
+  std::filesystem::remove(sidecar_path);
+
+  std::shared_ptr<TSIndex> built;
+  ASSERT_EQ(TSIndex::LoadOrBuild(path, TSIndex::BuildOptions(), &built), OK);
+  ASSERT_TRUE(std::filesystem::exists(sidecar_path));
+
+  std::shared_ptr<TSIndex> loaded;
+  ASSERT_EQ(TSIndex::Load(sidecar_path, built->file_size(), &loaded), OK);
+  ASSERT_EQ(loaded->entries().size(), built->entries().size());
+  for (size_t i = 0; i < built->entries().size(); ++i) {
+    EXPECT_EQ(loaded->entries()[i].offset, built->entries()[i].offset);
+    EXPECT_EQ(loaded->entries()[i].time_us, built->entries()[i].time_us);
+    EXPECT_EQ(loaded->entries()[i].pcr, built->entries()[i].pcr);
+  }
+  EXPECT_EQ(loaded->duration_us(), built->duration_us());
+  EXPECT_EQ(loaded->first_pts_us(), built->first_pts_us());
+
+  // A sidecar of another version of the file is rejected.
+  EXPECT_EQ(TSIndex::Load(sidecar_path, built->file_size() + kTSPacketSize,
+                          &loaded),
+            ERROR_MALFORMED);
+
+  std::filesystem::remove(sidecar_path);
+  std::filesystem::remove(path);
+}
+
+TEST(TSIndexTest, TSParserSeeksToPreviousSync) {
+  const auto ts = MakeStream();
+  std::shared_ptr<TSIndex> index;
+  ASSERT_EQ(TSIndex::Build(ts, TSIndex::BuildOptions(), &index), OK);
+
+  TSParser parser;
+  EXPECT_EQ(parser.SeekTo(0, MediaSource::ReadOptions::SEEK_PREVIOUS_SYNC,
+                          nullptr),
+            ERROR_UNSUPPORTED);
+  parser.SetIndex(index);
+  EXPECT_EQ(parser.GetDurationUs(), index->duration_us());
+
+  // Parse the first second, then jump into the middle of a GOP.
+  ASSERT_EQ(parser.FeedTSBuffer(std::span(ts.data(), ts.size() / 4)), OK);
+  int64_t offset = 0;
+  int64_t sync_time_us = 0;
+  ASSERT_EQ(parser.SeekTo(2500000, MediaSource::ReadOptions::SEEK_PREVIOUS_SYNC,
+                          &offset, &sync_time_us),
+            OK);
+  EXPECT_EQ(sync_time_us, 2400000);
+  ASSERT_EQ(parser.FeedTSBuffer(std::span(ts.data() + offset,
+                                          ts.size() - offset)),
+            OK);
+  parser.SignalEOS(ERROR_END_OF_STREAM);
+
+  auto source = parser.GetSource(TSParser::VIDEO);
+  ASSERT_TRUE(source);
+  std::shared_ptr<MediaFrame> frame;
+  ASSERT_EQ(source->DequeueAccessUnit(frame), OK);
+  EXPECT_EQ(frame->pts().us(), 2400000);
+}
+
+TEST(TSIndexTest, TSFileSourceSeeksAndReportsDuration) {
+  const std::string path = WriteTempFile("ts_file_source.ts", MakeStream());
+  std::filesystem::remove(TSIndex::SidecarPath(path));
+
+  TSFileSource file_source(path);
+  ASSERT_EQ(file_source.Init(), OK);
+  EXPECT_EQ(file_source.GetDurationUs(),
+            static_cast<int64_t>(kNumVideoFrames - 1) * kFrameDurationUs);
+  auto video = file_source.GetTrack(TSParser::VIDEO);
+  ASSERT_TRUE(video);
+
+  std::shared_ptr<MediaFrame> frame;
+  ASSERT_EQ(video->Read(frame, nullptr), OK);
+  EXPECT_EQ(frame->pts().us(), 0);
+
+  MediaSource::ReadOptions options;
+  options.SetSeekTo(3000000, MediaSource::ReadOptions::SEEK_PREVIOUS_SYNC);
+  ASSERT_EQ(video->Read(frame, &options), OK);
+  EXPECT_EQ(frame->pts().us(), 2800000);
+
+  size_t num_frames = 1;
+  while (video->Read(frame, nullptr) == OK) {
+    ++num_frames;
+  }
+  EXPECT_EQ(num_frames, kNumVideoFrames - 70);
+
+  std::filesystem::remove(TSIndex::SidecarPath(path));
+  std::filesystem::remove(path);
+}
+
+TEST(TSIndexTest, TSFileSourceOpensM2TS) {
+  const std::string path =
+      WriteTempFile("ts_file_source.m2ts", Restride(MakeStream(), kM2TSPacketSize));
+  std::filesystem::remove(TSIndex::SidecarPath(path));
+
+  TSFileSource file_source(path);
+  ASSERT_EQ(file_source.Init(), OK);
+  EXPECT_EQ(file_source.GetDurationUs(),
+            static_cast<int64_t>(kNumVideoFrames - 1) * kFrameDurationUs);
+  auto video = file_source.GetTrack(TSParser::VIDEO);
+  ASSERT_TRUE(video);
+
+  std::shared_ptr<MediaFrame> frame;
+  MediaSource::ReadOptions options;
+  options.SetSeekTo(3000000, MediaSource::ReadOptions::SEEK_PREVIOUS_SYNC);
+  ASSERT_EQ(video->Read(frame, &options), OK);
+  EXPECT_EQ(frame->pts().us(), 2800000);
+
+  std::filesystem::remove(TSIndex::SidecarPath(path));
+  std::filesystem::remove(path);
+}
+
+TEST(TSIndexTest, TSFileSourceRejectsMissingAndEmptyFiles) {
+  TSFileSource missing(
+      (std::filesystem::temp_directory_path() / "ts_file_source_missing.ts")
+          .string());
+  EXPECT_EQ(missing.Init(), ERROR_IO);
+
+  const std::string path = WriteTempFile("ts_file_source_empty.ts", {});
+  TSFileSource empty(path);
+  EXPECT_EQ(empty.Init(), ERROR_MALFORMED);
+  std::filesystem::remove(path);
+}
+
+}  // namespace mpeg2ts
+}  // namespace media
+}  // namespace ave
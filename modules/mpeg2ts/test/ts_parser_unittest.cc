@@ -0,0 +1,570 @@
+/*
+ * ts_parser_unittest.cc
+ * Copyright (C) 2025 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#include "media/modules/mpeg2ts/ts_parser.h"
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include "media/foundation/media_errors.h"
+#include "media/foundation/media_frame.h"
+#include "media/modules/mpeg2ts/packet_source.h"
+#include "media/modules/mpeg2ts/ts_sync.h"
+#include "test/gtest.h"
+
+namespace ave {
+namespace media {
+namespace mpeg2ts {
+
+namespace {
+
+constexpr unsigned kPmtPid = 0x1000;
+constexpr unsigned kAudioPid = 0x101;
+constexpr size_t kNumAudioFrames = 40;
+
+// Appends one packet carrying |payload| (at most 184 bytes), padded with
+// adaptation field stuffing.
+void AppendPacket(unsigned pid,
+                  bool payload_unit_start,
+                  uint8_t* continuity_counter,
+                  std::span<const uint8_t> payload,
+                  std::vector<uint8_t>* out) {
+  const size_t offset = out->size();
+  out->resize(offset + kTSPacketSize, 0xff);
+  uint8_t* packet = out->data() + offset;
+  const size_t stuffing = kTSPacketSize - 4 - payload.size();
+  packet[0] = kTSSyncByte;
+  packet[1] = (payload_unit_start ? 0x40 : 0x00) | ((pid >> 8) & 0x1f);
+  packet[2] = pid & 0xff;
+  packet[3] = (stuffing > 0 ? 0x30 : 0x10) | (*continuity_counter & 0x0f);
+  *continuity_counter = (*continuity_counter + 1) & 0x0f;
+  if (stuffing > 0) {
+    packet[4] = static_cast<uint8_t>(stuffing - 1);
+    if (stuffing > 1) {
+      packet[5] = 0x00;
+    }
+  }
+  memcpy(packet + 4 + stuffing, payload.data(), payload.size());
+}
+
+// The parser does not check CRC_32, so it is left zero.
+std::vector<uint8_t> MakeSection(std::vector<uint8_t> section) {
+  section.insert(section.begin(), 0x00);  // pointer_field
+  section.insert(section.end(), 4, 0x00);
+  return section;
+}
+
+// PAT, and for each program a PMT and an ADTS stream of |kNumAudioFrames|
+// frames, one PES each. Program |p| is numbered p + 1 and its frames are
+// 10 * p bytes longer than those of program 0. The first packet of every
+// PES carries at most |first_payload_size| bytes. Only every
+// |pts_interval|-th PES carries a PTS.
+std::vector<uint8_t> MakeAudioStream(size_t num_programs = 1,
+                                     size_t first_payload_size = 184,
+                                     size_t pts_interval = 1) {
+  std::vector<uint8_t> ts;
+  uint8_t pat_cc = 0;
+  std::vector<uint8_t> pmt_cc(num_programs, 0);
+  std::vector<uint8_t> audio_cc(num_programs, 0);
+
+  std::vector<uint8_t> pat = {
+      0x00, 0xb0, static_cast<uint8_t>(9 + 4 * num_programs), 0x00, 0x01,
+      0xc1, 0x00, 0x00};
+  for (size_t p = 0; p < num_programs; ++p) {
+    const unsigned pmt_pid = kPmtPid + p;
+    pat.insert(pat.end(), {0x00, static_cast<uint8_t>(p + 1),
+                           static_cast<uint8_t>(0xe0 | (pmt_pid >> 8)),
+                           static_cast<uint8_t>(pmt_pid & 0xff)});
+  }
+  AppendPacket(0, true, &pat_cc, MakeSection(pat), &ts);
+
+  for (size_t p = 0; p < num_programs; ++p) {
+    const uint8_t audio_pid_hi = 0xe0 | ((kAudioPid + p) >> 8);
+    const uint8_t audio_pid_lo = (kAudioPid + p) & 0xff;
+    const auto pmt = MakeSection(
+        {0x02, 0xb0, 18, 0x00, static_cast<uint8_t>(p + 1), 0xc1, 0x00, 0x00,
+         audio_pid_hi, audio_pid_lo, 0xf0, 0x00,
+         TSParser::STREAMTYPE_MPEG2_AUDIO_ADTS, audio_pid_hi, audio_pid_lo,
+         0xf0, 0x00});
+    AppendPacket(kPmtPid + p, true, &pmt_cc[p], pmt, &ts);
+  }
+
+  for (size_t i = 0; i < kNumAudioFrames; ++i) {
+    for (size_t p = 0; p < num_programs; ++p) {
+      // AAC LC, 44.1 kHz, stereo.
+      const size_t frame_size = 7 + 300 + 10 * p;
+      std::vector<uint8_t> pes = {0x00, 0x00, 0x01, 0xc0, 0x00, 0x00,
+                                  0x80, 0x00, 0x00};
+      if (i % pts_interval == 0) {
+        pes[7] = 0x80;
+        pes[8] = 0x05;
+        const uint64_t pts = i * 1920;
+        pes.push_back(0x21 | ((pts >> 29) & 0x0e));
+        pes.push_back((pts >> 22) & 0xff);
+        pes.push_back(0x01 | ((pts >> 14) & 0xfe));
+        pes.push_back((pts >> 7) & 0xff);
+        pes.push_back(0x01 | ((pts << 1) & 0xfe));
+      }
+      pes.insert(pes.end(),
+                 {0xff, 0xf1, 0x50, 0x80,
+                  static_cast<uint8_t>((frame_size >> 3) & 0xff),
+                  static_cast<uint8_t>(((frame_size & 0x07) << 5) | 0x1f),
+                  0xfc});
+      pes.insert(pes.end(), frame_size - 7, static_cast<uint8_t>(i));
+
+      for (size_t offset = 0; offset < pes.size();) {
+        const size_t size = std::min<size_t>(
+            offset == 0 ? first_payload_size : 184, pes.size() - offset);
+        AppendPacket(kAudioPid + p, offset == 0, &audio_cc[p],
+                     std::span(pes.data() + offset, size), &ts);
+        offset += size;
+      }
+    }
+  }
+  return ts;
+}
+
+// Returns a packet on |pid| with only an adaptation field carrying |pcr|
+// in 27 MHz ticks.
+std::vector<uint8_t> MakePCRPacket(unsigned pid, uint64_t pcr) {
+  std::vector<uint8_t> packet(kTSPacketSize, 0xff);
+  const uint64_t base = pcr / 300;
+  const unsigned extension = pcr % 300;
+  packet[0] = kTSSyncByte;
+  packet[1] = (pid >> 8) & 0x1f;
+  packet[2] = pid & 0xff;
+  packet[3] = 0x20;
+  packet[4] = kTSPacketSize - 5;
+  packet[5] = 0x10;
+  packet[6] = (base >> 25) & 0xff;
+  packet[7] = (base >> 17) & 0xff;
+  packet[8] = (base >> 9) & 0xff;
+  packet[9] = (base >> 1) & 0xff;
+  packet[10] = ((base & 0x01) << 7) | 0x7e | ((extension >> 8) & 0x01);
+  packet[11] = extension & 0xff;
+  return packet;
+}
+
+// Repacks 188-byte packets into |stride|-byte ones. M2TS arrival time
+// stamps start at |first_ats| and grow by |ats_step|, wrapping at 30 bits.
+// The Reed-Solomon parity is filled with sync bytes.
+std::vector<uint8_t> Restride(const std::vector<uint8_t>& ts,
+                              size_t stride,
+                              uint32_t first_ats = 0,
+                              uint32_t ats_step = 0) {
+  std::vector<uint8_t> out;
+  uint32_t ats = first_ats;
+  for (size_t offset = 0; offset < ts.size(); offset += kTSPacketSize) {
+    if (stride == kM2TSPacketSize) {
+      out.insert(out.end(), {static_cast<uint8_t>((ats >> 24) & 0x3f),
+                             static_cast<uint8_t>(ats >> 16),
+                             static_cast<uint8_t>(ats >> 8),
+                             static_cast<uint8_t>(ats)});
+      ats = (ats + ats_step) & 0x3fffffff;
+    }
+    out.insert(out.end(), ts.begin() + offset,
+               ts.begin() + offset + kTSPacketSize);
+    if (stride == kRSPacketSize) {
+      out.insert(out.end(), kRSPacketSize - kTSPacketSize, kTSSyncByte);
+    }
+  }
+  return out;
+}
+
+size_t DrainAudioFrames(TSParser* parser) {
+  parser->SignalEOS(ERROR_END_OF_STREAM);
+  auto source = parser->GetSource(TSParser::AUDIO);
+  if (!source) {
+    return 0;
+  }
+  size_t count = 0;
+  std::shared_ptr<MediaFrame> frame;
+  status_t final_result = OK;
+  while (source->HasBufferAvailable(&final_result) &&
+         source->DequeueAccessUnit(frame) == OK) {
+    ++count;
+  }
+  return count;
+}
+
+struct AccessUnitRecord {
+  status_t status;
+  int64_t pts_us;
+  std::vector<uint8_t> data;
+
+  bool operator==(const AccessUnitRecord&) const = default;
+};
+
+// Returns what the audio stream of each of the first |num_programs|
+// programs holds, in order.
+std::vector<std::vector<AccessUnitRecord>> DrainPrograms(
+    TSParser* parser,
+    size_t num_programs) {
+  std::vector<std::vector<AccessUnitRecord>> programs(num_programs);
+  for (size_t p = 0; p < num_programs; ++p) {
+    parser->SetProgramFilter({static_cast<unsigned>(p + 1)});
+    auto source = parser->GetSource(TSParser::AUDIO);
+    if (!source) {
+      continue;
+    }
+    std::shared_ptr<MediaFrame> frame;
+    status_t err = OK;
+    while ((err = source->TryDequeueAccessUnit(frame)) == OK ||
+           err == INFO_DISCONTINUITY) {
+      programs[p].push_back(
+          {err, frame->pts().us_or(-1),
+           std::vector<uint8_t>(frame->data(), frame->data() + frame->size())});
+    }
+  }
+  return programs;
+}
+
+}  // namespace
+
+TEST(TSSyncTest, FindSyncByte) {
+  std::vector<uint8_t> data(100, 0x00);
+  EXPECT_EQ(FindSyncByte(data.data(), data.size()), data.size());
+  data[37] = kTSSyncByte;
+  data[90] = kTSSyncByte;
+  EXPECT_EQ(FindSyncByte(data.data(), data.size()), 37u);
+  EXPECT_EQ(FindSyncByte(data.data() + 38, data.size() - 38), 52u);
+  data[3] = kTSSyncByte;
+  EXPECT_EQ(FindSyncByte(data.data(), data.size()), 3u);
+}
+
+TEST(TSSyncTest, CountSyncedPackets) {
+  std::vector<uint8_t> data(20 * kTSPacketSize, 0x00);
+  for (size_t i = 0; i < 20; ++i) {
+    data[i * kTSPacketSize] = kTSSyncByte;
+  }
+  EXPECT_EQ(CountSyncedPackets(data.data(), 20), 20u);
+  data[13 * kTSPacketSize] = 0x48;
+  EXPECT_EQ(CountSyncedPackets(data.data(), 20), 13u);
+  data[2 * kTSPacketSize] = 0x00;
+  EXPECT_EQ(CountSyncedPackets(data.data(), 20), 2u);
+}
+
+TEST(TSSyncTest, FindPacketStartSkipsLoneSyncBytes) {
+  std::vector<uint8_t> data(10 + 3 * kTSPacketSize, 0x00);
+  data[2] = kTSSyncByte;
+  for (size_t i = 0; i < 3; ++i) {
+    data[10 + i * kTSPacketSize] = kTSSyncByte;
+  }
+  EXPECT_EQ(FindPacketStart(data.data(), data.size()), 10u);
+}
+
+TEST(TSSyncTest, DetectPacketStride) {
+  const auto ts = MakeAudioStream();
+  EXPECT_EQ(DetectPacketStride(ts.data(), ts.size()), kTSPacketSize);
+  const auto m2ts = Restride(ts, kM2TSPacketSize);
+  EXPECT_EQ(DetectPacketStride(m2ts.data(), m2ts.size()), kM2TSPacketSize);
+  const auto rs = Restride(ts, kRSPacketSize);
+  EXPECT_EQ(DetectPacketStride(rs.data(), rs.size()), kRSPacketSize);
+
+  // Leading garbage is skipped; two packets are too few to tell.
+  std::vector<uint8_t> garbage(50, 0x47);
+  garbage.insert(garbage.end(), m2ts.begin(), m2ts.end());
+  EXPECT_EQ(DetectPacketStride(garbage.data(), garbage.size()),
+            kM2TSPacketSize);
+  EXPECT_EQ(DetectPacketStride(ts.data(), 2 * kTSPacketSize), 0u);
+}
+
+TEST(TSParserTest, FeedTSBufferMatchesFeedTSPacket) {
+  const auto ts = MakeAudioStream();
+
+  TSParser packet_parser;
+  for (size_t offset = 0; offset < ts.size(); offset += kTSPacketSize) {
+    EXPECT_EQ(packet_parser.FeedTSPacket(ts.data() + offset, kTSPacketSize),
+              OK);
+  }
+  EXPECT_EQ(DrainAudioFrames(&packet_parser), kNumAudioFrames);
+
+  TSParser buffer_parser;
+  EXPECT_EQ(buffer_parser.FeedTSBuffer(ts), OK);
+  EXPECT_EQ(DrainAudioFrames(&buffer_parser), kNumAudioFrames);
+  EXPECT_EQ(buffer_parser.GetFeedStats().num_packets,
+            ts.size() / kTSPacketSize);
+  EXPECT_EQ(buffer_parser.GetFeedStats().num_resyncs, 0u);
+}
+
+TEST(TSParserTest, FeedTSBufferCarriesPartialPackets) {
+  const auto ts = MakeAudioStream();
+
+  // Chunk sizes that are not multiples of the packet size, including ones
+  // smaller than a packet.
+  TSParser parser;
+  const size_t chunk_sizes[] = {1, 100, 187, 189, 1316, 7};
+  size_t offset = 0;
+  for (size_t i = 0; offset < ts.size(); ++i) {
+    const size_t size =
+        std::min(chunk_sizes[i % std::size(chunk_sizes)], ts.size() - offset);
+    EXPECT_EQ(parser.FeedTSBuffer(std::span(ts.data() + offset, size)), OK);
+    offset += size;
+  }
+  EXPECT_EQ(DrainAudioFrames(&parser), kNumAudioFrames);
+  EXPECT_EQ(parser.GetFeedStats().num_packets, ts.size() / kTSPacketSize);
+  EXPECT_EQ(parser.GetFeedStats().num_skipped_bytes, 0u);
+}
+
+TEST(TSParserTest, FeedTSBufferResyncsAfterGarbage) {
+  auto ts = MakeAudioStream();
+  const size_t num_packets = ts.size() / kTSPacketSize;
+  // Leading garbage, including a lone sync byte, and junk between two audio
+  // packets. Resync needs three packets in a row, so the junk is kept away
+  // from the start.
+  const std::vector<uint8_t> garbage = {0x00, kTSSyncByte, 0x12, 0x34, 0x56};
+  ts.insert(ts.begin() + 10 * kTSPacketSize, garbage.begin(), garbage.end());
+  ts.insert(ts.begin(), garbage.begin(), garbage.end());
+
+  TSParser parser;
+  EXPECT_EQ(parser.FeedTSBuffer(ts), OK);
+  EXPECT_EQ(parser.GetFeedStats().num_resyncs, 2u);
+  EXPECT_EQ(parser.GetFeedStats().num_skipped_bytes, 2 * garbage.size());
+  EXPECT_EQ(parser.GetFeedStats().num_packets, num_packets);
+  EXPECT_EQ(DrainAudioFrames(&parser), kNumAudioFrames);
+}
+
+TEST(TSParserTest, PESHeaderSplitAcrossPackets) {
+  // 4 bytes end the first packet inside the start code, 12 inside the PTS.
+  for (size_t first_payload_size : {4, 12}) {
+    const auto ts = MakeAudioStream(1, first_payload_size);
+
+    TSParser parser;
+    EXPECT_EQ(parser.FeedTSBuffer(ts), OK);
+    parser.SignalEOS(ERROR_END_OF_STREAM);
+    auto source = parser.GetSource(TSParser::AUDIO);
+    ASSERT_TRUE(source);
+    size_t count = 0;
+    std::shared_ptr<MediaFrame> frame;
+    status_t final_result = OK;
+    while (source->HasBufferAvailable(&final_result) &&
+           source->DequeueAccessUnit(frame) == OK) {
+      EXPECT_EQ(frame->size(), 307u);
+      EXPECT_EQ(frame->pts().us(),
+                static_cast<int64_t>(count * 1920 * 1000000 / 90000));
+      ++count;
+    }
+    EXPECT_EQ(count, kNumAudioFrames);
+  }
+}
+
+TEST(TSParserTest, LostPacketDropsOnlyItsPES) {
+  auto ts = MakeAudioStream();
+  // PAT and PMT come first, then two packets per PES; drop the second
+  // packet of PES 5.
+  const size_t lost_packet = 2 + 2 * 5 + 1;
+  ts.erase(ts.begin() + lost_packet * kTSPacketSize,
+           ts.begin() + (lost_packet + 1) * kTSPacketSize);
+
+  TSParser parser;
+  EXPECT_EQ(parser.FeedTSBuffer(ts), OK);
+  parser.SignalEOS(ERROR_END_OF_STREAM);
+  auto source = parser.GetSource(TSParser::AUDIO);
+  ASSERT_TRUE(source);
+  std::vector<uint8_t> fills;
+  std::shared_ptr<MediaFrame> frame;
+  status_t final_result = OK;
+  while (source->HasBufferAvailable(&final_result) &&
+         source->DequeueAccessUnit(frame) == OK) {
+    EXPECT_EQ(frame->size(), 307u);
+    fills.push_back(frame->data()[frame->size() - 1]);
+  }
+  ASSERT_EQ(fills.size(), kNumAudioFrames - 1);
+  EXPECT_EQ(fills[4], 4);
+  EXPECT_EQ(fills[5], 6);
+}
+
+TEST(TSParserTest, ParsesEveryProgramByDefault) {
+  const auto ts = MakeAudioStream(3);
+
+  TSParser parser;
+  EXPECT_EQ(parser.FeedTSBuffer(ts), OK);
+  EXPECT_TRUE(parser.HasSource(TSParser::AUDIO));
+  // GetSource() returns the first program's stream.
+  parser.SignalEOS(ERROR_END_OF_STREAM);
+  auto source = parser.GetSource(TSParser::AUDIO);
+  ASSERT_TRUE(source);
+  std::shared_ptr<MediaFrame> frame;
+  ASSERT_EQ(source->DequeueAccessUnit(frame), OK);
+  EXPECT_EQ(frame->size(), 307u);
+}
+
+TEST(TSParserTest, ProgramFilterDropsOtherPrograms) {
+  const auto ts = MakeAudioStream(3);
+
+  TSParser parser;
+  parser.SetProgramFilter({2});
+  EXPECT_EQ(parser.FeedTSBuffer(ts), OK);
+  parser.SignalEOS(ERROR_END_OF_STREAM);
+  auto source = parser.GetSource(TSParser::AUDIO);
+  ASSERT_TRUE(source);
+  size_t count = 0;
+  std::shared_ptr<MediaFrame> frame;
+  status_t final_result = OK;
+  while (source->HasBufferAvailable(&final_result) &&
+         source->DequeueAccessUnit(frame) == OK) {
+    EXPECT_EQ(frame->size(), 317u);
+    ++count;
+  }
+  EXPECT_EQ(count, kNumAudioFrames);
+}
+
+TEST(TSParserTest, ProgramFilterWithUnknownProgram) {
+  const auto ts = MakeAudioStream(2);
+
+  TSParser parser;
+  parser.SetProgramFilter({7});
+  EXPECT_EQ(parser.FeedTSBuffer(ts), OK);
+  EXPECT_FALSE(parser.HasSource(TSParser::AUDIO));
+  EXPECT_EQ(parser.GetSource(TSParser::AUDIO), nullptr);
+}
+
+TEST(TSParserTest, WorkersKeepPerStreamOrder) {
+  constexpr size_t kNumPrograms = 5;
+  constexpr size_t kDatagramSize = 7 * kTSPacketSize;
+  const auto ts = MakeAudioStream(kNumPrograms);
+  const size_t discontinuity_offset = ts.size() / 2 / kDatagramSize *
+                                      kDatagramSize;
+
+  auto demux = [&](size_t num_workers) {
+    TSParser parser;
+    EXPECT_EQ(parser.SetNumWorkers(num_workers), OK);
+    for (size_t offset = 0; offset < ts.size(); offset += kDatagramSize) {
+      if (offset == discontinuity_offset) {
+        parser.SignalDiscontinuity(DiscontinuityType::TIME, nullptr);
+      }
+      const size_t size = std::min(kDatagramSize, ts.size() - offset);
+      EXPECT_EQ(parser.FeedTSBuffer(std::span(ts.data() + offset, size)), OK);
+    }
+    parser.SignalEOS(ERROR_END_OF_STREAM);
+    return DrainPrograms(&parser, kNumPrograms);
+  };
+
+  const auto expected = demux(0);
+  for (size_t p = 0; p < kNumPrograms; ++p) {
+    // The PES cut by the discontinuity is dropped.
+    ASSERT_EQ(expected[p].size(), kNumAudioFrames);
+    EXPECT_EQ(std::count_if(expected[p].begin(), expected[p].end(),
+                            [](const AccessUnitRecord& record) {
+                              return record.status == INFO_DISCONTINUITY;
+                            }),
+              1);
+    EXPECT_EQ(expected[p].front().data.size(), 307 + 10 * p);
+  }
+  EXPECT_EQ(demux(2), expected);
+  EXPECT_EQ(demux(kNumPrograms + 1), expected);
+}
+
+TEST(TSParserTest, SetNumWorkersOnlyBeforeFeeding) {
+  const auto ts = MakeAudioStream(2);
+
+  TSParser parser;
+  EXPECT_EQ(parser.FeedTSBuffer(ts), OK);
+  EXPECT_EQ(parser.SetNumWorkers(2), INVALID_OPERATION);
+  EXPECT_EQ(DrainAudioFrames(&parser), kNumAudioFrames);
+}
+
+TEST(TSParserTest, FeedTSBufferHandlesM2TSAndRSPackets) {
+  const auto ts = MakeAudioStream();
+  const size_t num_packets = ts.size() / kTSPacketSize;
+  // 100 us per packet, wrapping the 30-bit arrival time stamp on the way.
+  const uint32_t first_ats = (1u << 30) - 10 * 2700;
+
+  for (const size_t stride : {kM2TSPacketSize, kRSPacketSize}) {
+    const auto data = Restride(ts, stride, first_ats, 2700);
+    TSParser parser;
+    // Feed sizes that split packets and headers.
+    constexpr size_t kFeedSize = 1001;
+    for (size_t offset = 0; offset < data.size(); offset += kFeedSize) {
+      const size_t size = std::min(kFeedSize, data.size() - offset);
+      EXPECT_EQ(parser.FeedTSBuffer(std::span(data.data() + offset, size)),
+                OK);
+    }
+    EXPECT_EQ(parser.GetPacketStride(), stride);
+    EXPECT_EQ(parser.GetFeedStats().num_packets, num_packets);
+    EXPECT_EQ(parser.GetFeedStats().num_resyncs, 0u);
+    EXPECT_EQ(DrainAudioFrames(&parser), kNumAudioFrames);
+    EXPECT_EQ(parser.GetArrivalTimeUs(),
+              stride == kM2TSPacketSize
+                  ? static_cast<int64_t>(num_packets - 1) * 100
+                  : -1);
+  }
+}
+
+TEST(TSParserTest, PESWithoutPTSIsTimedFromArrivalClock) {
+  // Every other PES lacks a PTS; 1 ms per packet and two packets per PES.
+  const auto ts = MakeAudioStream(1, 184, 2);
+  const auto m2ts = Restride(ts, kM2TSPacketSize, 0, 27000);
+
+  TSParser parser;
+  ASSERT_EQ(parser.FeedTSBuffer(m2ts), OK);
+  parser.SignalEOS(ERROR_END_OF_STREAM);
+  const auto recovered = DrainPrograms(&parser, 1)[0];
+  ASSERT_EQ(recovered.size(), kNumAudioFrames);
+  for (size_t i = 1; i < kNumAudioFrames; i += 2) {
+    EXPECT_EQ(recovered[i].pts_us, recovered[i - 1].pts_us + 2000) << i;
+  }
+
+  // A PCR on the PCR PID turns recovery off; times then match the 188-byte
+  // stream, which has no arrival clock.
+  TSParser plain_parser;
+  ASSERT_EQ(plain_parser.FeedTSBuffer(ts), OK);
+  plain_parser.SignalEOS(ERROR_END_OF_STREAM);
+  const auto plain = DrainPrograms(&plain_parser, 1)[0];
+
+  auto with_pcr = ts;
+  const auto pcr = MakePCRPacket(kAudioPid, 0);
+  with_pcr.insert(with_pcr.begin() + 2 * kTSPacketSize, pcr.begin(),
+                  pcr.end());
+  TSParser pcr_parser;
+  ASSERT_EQ(pcr_parser.FeedTSBuffer(
+                Restride(with_pcr, kM2TSPacketSize, 0, 27000)),
+            OK);
+  pcr_parser.SignalEOS(ERROR_END_OF_STREAM);
+  const auto timed_by_pcr = DrainPrograms(&pcr_parser, 1)[0];
+  ASSERT_EQ(plain.size(), kNumAudioFrames);
+  EXPECT_NE(plain[1].pts_us, recovered[1].pts_us);
+  EXPECT_EQ(timed_by_pcr, plain);
+}
+
+TEST(TSParserTest, ShortFirstFeedWaitsForStrideDetection) {
+  const auto ts = MakeAudioStream();
+  const auto m2ts = Restride(ts, kM2TSPacketSize);
+
+  // Two packets are too few to tell the stride.
+  TSParser parser;
+  const size_t first_size = 2 * kM2TSPacketSize;
+  EXPECT_EQ(parser.FeedTSBuffer(std::span(m2ts.data(), first_size)), OK);
+  EXPECT_EQ(parser.GetPacketStride(), 0u);
+  EXPECT_EQ(parser.GetFeedStats().num_packets, 0u);
+
+  EXPECT_EQ(parser.FeedTSBuffer(std::span(m2ts.data() + first_size,
+                                          m2ts.size() - first_size)),
+            OK);
+  EXPECT_EQ(parser.GetPacketStride(), kM2TSPacketSize);
+  EXPECT_EQ(parser.GetFeedStats().num_packets, ts.size() / kTSPacketSize);
+  EXPECT_EQ(parser.GetFeedStats().num_resyncs, 0u);
+  EXPECT_EQ(DrainAudioFrames(&parser), kNumAudioFrames);
+}
+
+TEST(TSParserTest, StreamTooShortForStrideDetectionIsParsedAtEOS) {
+  const auto ts = MakeAudioStream();
+
+  TSParser parser;
+  EXPECT_EQ(parser.FeedTSBuffer(std::span(ts.data(), 2 * kTSPacketSize)), OK);
+  EXPECT_EQ(parser.GetFeedStats().num_packets, 0u);
+  parser.SignalEOS(ERROR_END_OF_STREAM);
+  EXPECT_EQ(parser.GetPacketStride(), kTSPacketSize);
+  EXPECT_EQ(parser.GetFeedStats().num_packets, 2u);
+}
+
+}  // namespace mpeg2ts
+}  // namespace media
+}  // namespace ave
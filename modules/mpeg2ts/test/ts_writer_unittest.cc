@@ -0,0 +1,270 @@
+/*
+ * ts_writer_unittest.cc
+ * Copyright (C) 2025 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#include "media/modules/mpeg2ts/ts_writer.h"
+
+#include <map>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include "media/foundation/buffer.h"
+#include "media/foundation/media_errors.h"
+#include "media/foundation/media_frame.h"
+#include "media/modules/mpeg2ts/packet_source.h"
+#include "media/modules/mpeg2ts/ts_parser.h"
+#include "media/modules/mpeg2ts/ts_sync.h"
+#include "test/gtest.h"
+
+namespace ave {
+namespace media {
+namespace mpeg2ts {
+
+namespace {
+
+// Baseline 320x240 SPS and a matching PPS.
+constexpr uint8_t kSps[] = {0x00, 0x00, 0x00, 0x01, 0x67, 0x42,
+                            0xc0, 0x1e, 0xda, 0x05, 0x07, 0xe4};
+constexpr uint8_t kPps[] = {0x00, 0x00, 0x00, 0x01, 0x68, 0xce, 0x3c, 0x80};
+
+// AAC LC, 44.1 kHz, stereo ADTS frame of |size| bytes filled with |fill|.
+std::vector<uint8_t> MakeAdtsFrame(size_t size, uint8_t fill) {
+  std::vector<uint8_t> frame = {0xff,
+                                0xf1,
+                                0x50,
+                                0x80,
+                                static_cast<uint8_t>((size >> 3) & 0xff),
+                                static_cast<uint8_t>(((size & 0x07) << 5) |
+                                                     0x1f),
+                                0xfc};
+  frame.resize(size, fill);
+  return frame;
+}
+
+// One slice with first_mb_in_slice = 0, preceded by SPS and PPS for IDR
+// pictures.
+std::vector<uint8_t> MakeH264AccessUnit(bool idr, size_t size, uint8_t fill) {
+  std::vector<uint8_t> au;
+  if (idr) {
+    au.insert(au.end(), std::begin(kSps), std::end(kSps));
+    au.insert(au.end(), std::begin(kPps), std::end(kPps));
+  }
+  au.insert(au.end(), {0x00, 0x00, 0x00, 0x01,
+                       static_cast<uint8_t>(idr ? 0x65 : 0x41), 0x88});
+  au.resize(au.size() + size, fill);
+  return au;
+}
+
+std::vector<std::shared_ptr<Buffer>> TakeAllBlocks(TSWriter* writer) {
+  writer->Flush();
+  std::vector<std::shared_ptr<Buffer>> blocks;
+  writer->TakeBlocks(&blocks);
+  return blocks;
+}
+
+std::vector<std::shared_ptr<MediaFrame>> Demux(
+    const std::vector<std::shared_ptr<Buffer>>& blocks,
+    TSParser::SourceType type) {
+  TSParser parser;
+  for (const auto& block : blocks) {
+    EXPECT_EQ(parser.FeedTSBuffer(std::span(block->data(), block->size())),
+              OK);
+  }
+  EXPECT_EQ(parser.GetFeedStats().num_resyncs, 0u);
+  parser.SignalEOS(ERROR_END_OF_STREAM);
+
+  std::vector<std::shared_ptr<MediaFrame>> frames;
+  auto source = parser.GetSource(type);
+  if (!source) {
+    return frames;
+  }
+  std::shared_ptr<MediaFrame> frame;
+  status_t final_result = OK;
+  while (source->HasBufferAvailable(&final_result) &&
+         source->DequeueAccessUnit(frame) == OK) {
+    frames.push_back(frame);
+  }
+  return frames;
+}
+
+}  // namespace
+
+TEST(TSWriterTest, RejectsUnsupportedStreamsAndLateAdds) {
+  TSWriter writer;
+  size_t index = 0;
+  EXPECT_EQ(writer.AddStream(TSParser::STREAMTYPE_MPEG2_VIDEO, &index),
+            ERROR_UNSUPPORTED);
+  ASSERT_EQ(writer.AddStream(TSParser::STREAMTYPE_MPEG2_AUDIO_ADTS, &index),
+            OK);
+  EXPECT_EQ(writer.WriteAccessUnit(index + 1, MakeAdtsFrame(100, 0), 0, -1,
+                                   true),
+            BAD_VALUE);
+  EXPECT_EQ(writer.WriteAccessUnit(index, MakeAdtsFrame(100, 0), 0, -1, true),
+            OK);
+  EXPECT_EQ(writer.AddStream(TSParser::STREAMTYPE_AC3, &index),
+            INVALID_OPERATION);
+}
+
+TEST(TSWriterTest, PacksWholePacketsIntoBlocks) {
+  TSWriter::Options options;
+  options.packets_per_block = 7;
+  TSWriter writer(options);
+  size_t audio = 0;
+  ASSERT_EQ(writer.AddStream(TSParser::STREAMTYPE_MPEG2_AUDIO_ADTS, &audio),
+            OK);
+  for (size_t i = 0; i < 50; ++i) {
+    ASSERT_EQ(writer.WriteAccessUnit(audio, MakeAdtsFrame(100 + 37 * i, 0),
+                                     i * 23220, -1, true),
+              OK);
+  }
+  const auto blocks = TakeAllBlocks(&writer);
+  ASSERT_FALSE(blocks.empty());
+
+  std::map<unsigned, unsigned> continuity_counters;
+  for (size_t b = 0; b < blocks.size(); ++b) {
+    const auto& block = blocks[b];
+    ASSERT_EQ(block->size() % kTSPacketSize, 0u);
+    if (b + 1 < blocks.size()) {
+      EXPECT_EQ(block->size(), 7 * kTSPacketSize);
+    }
+    for (size_t offset = 0; offset < block->size(); offset += kTSPacketSize) {
+      const uint8_t* packet = block->data() + offset;
+      ASSERT_EQ(packet[0], kTSSyncByte);
+      const unsigned pid = ((packet[1] & 0x1f) << 8) | packet[2];
+      const unsigned continuity_counter = packet[3] & 0x0f;
+      auto it = continuity_counters.find(pid);
+      if (it != continuity_counters.end()) {
+        EXPECT_EQ(continuity_counter, (it->second + 1) & 0x0f);
+      }
+      continuity_counters[pid] = continuity_counter;
+    }
+  }
+  // PAT, PMT and the audio stream.
+  EXPECT_EQ(continuity_counters.size(), 3u);
+}
+
+TEST(TSWriterTest, AacRoundTripsThroughTSParser) {
+  TSWriter writer;
+  size_t audio = 0;
+  ASSERT_EQ(writer.AddStream(TSParser::STREAMTYPE_MPEG2_AUDIO_ADTS, &audio),
+            OK);
+  std::vector<std::vector<uint8_t>> input;
+  for (size_t i = 0; i < 40; ++i) {
+    // Sizes around the packet payload size exercise the stuffing paths.
+    input.push_back(MakeAdtsFrame(150 + 17 * i, static_cast<uint8_t>(i)));
+    ASSERT_EQ(writer.WriteAccessUnit(audio, input.back(), i * 23220, -1, true),
+              OK);
+  }
+
+  const auto frames = Demux(TakeAllBlocks(&writer), TSParser::AUDIO);
+  ASSERT_EQ(frames.size(), input.size());
+  for (size_t i = 0; i < frames.size(); ++i) {
+    ASSERT_EQ(frames[i]->size(), input[i].size());
+    EXPECT_EQ(std::vector<uint8_t>(frames[i]->data(),
+                                   frames[i]->data() + frames[i]->size()),
+              input[i]);
+    // ESQueue derives AAC timestamps from the sample count, 1024 / 44.1 kHz.
+    EXPECT_NEAR(frames[i]->pts().us(), static_cast<int64_t>(i * 23220), 10);
+  }
+}
+
+TEST(TSWriterTest, H264AndAacRoundTripThroughTSParser) {
+  TSWriter writer;
+  size_t video = 0;
+  size_t audio = 0;
+  ASSERT_EQ(writer.AddStream(TSParser::STREAMTYPE_H264, &video), OK);
+  ASSERT_EQ(writer.AddStream(TSParser::STREAMTYPE_MPEG2_AUDIO_ADTS, &audio),
+            OK);
+
+  constexpr size_t kNumVideoFrames = 30;
+  std::vector<size_t> video_sizes;
+  int64_t audio_pts = 0;
+  size_t num_audio_frames = 0;
+  for (size_t i = 0; i < kNumVideoFrames; ++i) {
+    const int64_t video_pts = static_cast<int64_t>(i) * 40000;
+    while (audio_pts <= video_pts) {
+      ASSERT_EQ(writer.WriteAccessUnit(audio, MakeAdtsFrame(300, 0),
+                                       audio_pts, -1, true),
+                OK);
+      audio_pts += 21333;
+      ++num_audio_frames;
+    }
+    const bool idr = i % 10 == 0;
+    const auto au = MakeH264AccessUnit(idr, 500 + 401 * i, 0x5a);
+    video_sizes.push_back(au.size());
+    // Decode order ahead of presentation, as with B-frames.
+    ASSERT_EQ(writer.WriteAccessUnit(video, au, video_pts + 80000, video_pts,
+                                     idr),
+              OK);
+  }
+  const auto blocks = TakeAllBlocks(&writer);
+
+  const auto video_frames = Demux(blocks, TSParser::VIDEO);
+  ASSERT_EQ(video_frames.size(), kNumVideoFrames);
+  for (size_t i = 0; i < video_frames.size(); ++i) {
+    // The writer prefixes an access unit delimiter.
+    EXPECT_EQ(video_frames[i]->size(), video_sizes[i] + 6);
+    EXPECT_EQ(video_frames[i]->pts().us(),
+              static_cast<int64_t>(i) * 40000 + 80000);
+  }
+  EXPECT_EQ(Demux(blocks, TSParser::AUDIO).size(), num_audio_frames);
+}
+
+TEST(TSWriterTest, MarksKeyFramesAndCarriesPCR) {
+  TSWriter writer;
+  size_t video = 0;
+  ASSERT_EQ(writer.AddStream(TSParser::STREAMTYPE_H264, &video), OK);
+  for (size_t i = 0; i < 10; ++i) {
+    ASSERT_EQ(writer.WriteAccessUnit(video, MakeH264AccessUnit(i == 0, 50, 0),
+                                     i * 40000, -1, i == 0),
+              OK);
+  }
+
+  size_t num_pcrs = 0;
+  size_t num_random_access = 0;
+  for (const auto& block : TakeAllBlocks(&writer)) {
+    for (size_t offset = 0; offset < block->size(); offset += kTSPacketSize) {
+      const uint8_t* packet = block->data() + offset;
+      const unsigned pid = ((packet[1] & 0x1f) << 8) | packet[2];
+      if (pid != 0x100 || (packet[3] & 0x20) == 0 || packet[4] == 0) {
+        continue;
+      }
+      num_pcrs += (packet[5] & 0x10) != 0;
+      num_random_access += (packet[5] & 0x40) != 0;
+    }
+  }
+  // Default PCR interval is 40 ms.
+  EXPECT_EQ(num_pcrs, 10u);
+  EXPECT_EQ(num_random_access, 1u);
+}
+
+TEST(TSWriterTest, ReusesBlocksReleasedByCaller) {
+  TSWriter::Options options;
+  options.num_preallocated_blocks = 2;
+  TSWriter writer(options);
+  size_t audio = 0;
+  ASSERT_EQ(writer.AddStream(TSParser::STREAMTYPE_MPEG2_AUDIO_ADTS, &audio),
+            OK);
+
+  ASSERT_EQ(writer.WriteAccessUnit(audio, MakeAdtsFrame(100, 0), 0, -1, true),
+            OK);
+  auto blocks = TakeAllBlocks(&writer);
+  ASSERT_EQ(blocks.size(), 1u);
+  const uint8_t* first_block = blocks[0]->base();
+  blocks.clear();
+
+  ASSERT_EQ(
+      writer.WriteAccessUnit(audio, MakeAdtsFrame(100, 1), 23220, -1, true),
+      OK);
+  blocks = TakeAllBlocks(&writer);
+  ASSERT_EQ(blocks.size(), 1u);
+  EXPECT_EQ(blocks[0]->base(), first_block);
+}
+
+}  // namespace mpeg2ts
+}  // namespace media
+}  // namespace ave
@@ -0,0 +1,218 @@
+/*
+ * ts_file_source.cc
+ * Copyright (C) 2025 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#include "ts_file_source.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include "base/logging.h"
+#include "packet_source.h"
+
+namespace ave {
+namespace media {
+namespace mpeg2ts {
+
+class TSFileSource::Track : public MediaSource {
+ public:
+  Track(TSFileSource* owner, std::shared_ptr<PacketSource> source)
+      : owner_(owner), source_(std::move(source)) {}
+
+  status_t Start(std::shared_ptr<Message> /* params */) override { return OK; }
+
+  status_t Stop() override { return OK; }
+
+  std::shared_ptr<MediaMeta> GetFormat() override {
+    return source_->GetFormat();
+  }
+
+  status_t Read(std::shared_ptr<MediaFrame>& frame,
+                const ReadOptions* options) override {
+    int64_t seek_time_us = 0;
+    ReadOptions::SeekMode mode = ReadOptions::SEEK_CLOSEST_SYNC;
+    if (options != nullptr && options->GetSeekTo(&seek_time_us, &mode)) {
+      const status_t err = owner_->SeekTo(seek_time_us, mode);
+      if (err != OK) {
+        return err;
+      }
+    }
+    return owner_->ReadAccessUnit(source_, frame);
+  }
+
+ private:
+  TSFileSource* owner_;
+  std::shared_ptr<PacketSource> source_;
+};
+
+TSFileSource::TSFileSource(std::string path, uint32_t parser_flags)
+    : path_(std::move(path)),
+      read_offset_(0),
+      readahead_end_(0),
+      eos_(false),
+      parser_(parser_flags) {}
+
+TSFileSource::~TSFileSource() {
+  if (!file_.empty()) {
+    munmap(const_cast<uint8_t*>(file_.data()), file_.size());
+  }
+}
+
+status_t TSFileSource::Init(const TSIndex::BuildOptions& options) {
+  std::scoped_lock lock(lock_);
+  status_t err = MapFile();
+  if (err != OK) {
+    return err;
+  }
+
+  err = TSIndex::LoadOrBuild(path_, file_, options, &index_);
+  if (err != OK) {
+    AVE_LOG(LS_ERROR) << "Cannot index " << path_ << ", err=" << err;
+    return err;
+  }
+  parser_.SetIndex(index_);
+
+  // Tracks exist once the PMT was parsed.
+  while (!parser_.HasSource(TSParser::VIDEO) &&
+         !parser_.HasSource(TSParser::AUDIO)) {
+    const status_t feed_err = FeedNextChunk();
+    if (feed_err != OK) {
+      return feed_err == ERROR_END_OF_STREAM ? ERROR_MALFORMED : feed_err;
+    }
+  }
+  return OK;
+}
+
+int64_t TSFileSource::GetDurationUs() const {
+  return index_ ? index_->duration_us() : -1;
+}
+
+std::shared_ptr<MediaSource> TSFileSource::GetTrack(TSParser::SourceType type) {
+  std::scoped_lock lock(lock_);
+  if (type >= TSParser::NUM_SOURCE_TYPES) {
+    return nullptr;
+  }
+  if (!tracks_[type]) {
+    auto source = parser_.GetSource(type);
+    if (!source) {
+      return nullptr;
+    }
+    tracks_[type] = std::make_shared<Track>(this, source);
+  }
+  return tracks_[type];
+}
+
+status_t TSFileSource::ReadAccessUnit(
+    const std::shared_ptr<PacketSource>& source,
+    std::shared_ptr<MediaFrame>& frame) {
+  std::scoped_lock lock(lock_);
+  while (true) {
+    status_t final_result = OK;
+    if (source->HasBufferAvailable(&final_result)) {
+      return source->DequeueAccessUnit(frame);
+    }
+    if (final_result != OK) {
+      return final_result;
+    }
+
+    const status_t err = FeedNextChunk();
+    if (err == ERROR_END_OF_STREAM) {
+      parser_.SignalEOS(ERROR_END_OF_STREAM);
+    } else if (err != OK) {
+      return err;
+    }
+  }
+}
+
+status_t TSFileSource::SeekTo(int64_t time_us,
+                              MediaSource::ReadOptions::SeekMode mode) {
+  std::scoped_lock lock(lock_);
+  int64_t offset = 0;
+  const status_t err = parser_.SeekTo(time_us, mode, &offset);
+  if (err != OK) {
+    return err;
+  }
+  read_offset_ = offset;
+  readahead_end_ = offset;
+  eos_ = false;
+  return OK;
+}
+
+status_t TSFileSource::MapFile() {
+  const int fd = open(path_.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    AVE_LOG(LS_ERROR) << "Cannot open " << path_ << ": " << strerror(errno);
+    return ERROR_IO;
+  }
+
+  struct stat st = {};
+  if (fstat(fd, &st) != 0) {
+    AVE_LOG(LS_ERROR) << "Cannot stat " << path_ << ": " << strerror(errno);
+    close(fd);
+    return ERROR_IO;
+  }
+  if (st.st_size == 0) {
+    close(fd);
+    return ERROR_MALFORMED;
+  }
+
+  const size_t size = static_cast<size_t>(st.st_size);
+  void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  // The mapping keeps the file referenced.
+  close(fd);
+  if (data == MAP_FAILED) {
+    AVE_LOG(LS_ERROR) << "Cannot map " << path_ << ": " << strerror(errno);
+    return ERROR_IO;
+  }
+
+  file_ = std::span(static_cast<const uint8_t*>(data), size);
+  madvise(data, size, MADV_SEQUENTIAL);
+  return OK;
+}
+
+status_t TSFileSource::FeedNextChunk() {
+  if (eos_ || read_offset_ >= static_cast<int64_t>(file_.size())) {
+    eos_ = true;
+    return ERROR_END_OF_STREAM;
+  }
+
+  Readahead();
+  const size_t offset = static_cast<size_t>(read_offset_);
+  const auto chunk =
+      file_.subspan(offset).first(std::min(kChunkSize, file_.size() - offset));
+  read_offset_ += static_cast<int64_t>(chunk.size());
+  parser_.FeedTSBuffer(chunk);
+  return OK;
+}
+
+void TSFileSource::Readahead() {
+  const int64_t file_size = static_cast<int64_t>(file_.size());
+  const int64_t ahead = readahead_end_ - read_offset_;
+  if (readahead_end_ >= file_size ||
+      ahead >= static_cast<int64_t>(kReadaheadSize / 2)) {
+    return;
+  }
+
+  // madvise() takes page aligned addresses.
+  static const int64_t page_size = sysconf(_SC_PAGESIZE);
+  const int64_t begin =
+      std::max(readahead_end_, read_offset_) / page_size * page_size;
+  const int64_t end = std::min(
+      read_offset_ + static_cast<int64_t>(kReadaheadSize), file_size);
+  madvise(const_cast<uint8_t*>(file_.data()) + begin, end - begin,
+          MADV_WILLNEED);
+  readahead_end_ = end;
+}
+
+}  // namespace mpeg2ts
+}  // namespace media
+}  // namespace ave
@@ -0,0 +1,91 @@
+/*
+ * ts_file_source.h
+ * Copyright (C) 2025 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#ifndef MODULES_MPEG2TS_TS_FILE_SOURCE_H
+#define MODULES_MPEG2TS_TS_FILE_SOURCE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+
+#include "base/constructor_magic.h"
+#include "foundation/media_errors.h"
+#include "foundation/media_source.h"
+#include "ts_index.h"
+#include "ts_parser.h"
+
+namespace ave {
+namespace media {
+namespace mpeg2ts {
+
+// Demuxes a transport stream file on demand. Each track is a MediaSource
+// whose Read() feeds the file to the parser until the track has an access
+// unit. Seeks go through the file's TSIndex, which is loaded from its
+// sidecar or built and saved by Init(). Tracks may be read from different
+// threads.
+//
+// The file is memory mapped and fed to the parser straight from the
+// mapping. Pages ahead of the read position are requested with
+// madvise(MADV_WILLNEED), so a file in the page cache is demuxed without a
+// system call per chunk.
+class TSFileSource {
+ public:
+  explicit TSFileSource(std::string path, uint32_t parser_flags = 0);
+  ~TSFileSource();
+
+  // Opens the file, gets its index and parses until the streams are known.
+  status_t Init(const TSIndex::BuildOptions& options = {});
+
+  // Known from the index without reading the file.
+  int64_t GetDurationUs() const;
+
+  // Returns the video or audio track, or null if there is none.
+  std::shared_ptr<MediaSource> GetTrack(TSParser::SourceType type);
+
+ private:
+  class Track;
+
+  static constexpr size_t kChunkSize = 1024 * kTSPacketSize;
+  // Kept requested ahead of the read position.
+  static constexpr size_t kReadaheadSize = 8 * 1024 * 1024;
+
+  const std::string path_;
+  std::mutex lock_;
+  std::span<const uint8_t> file_;
+  int64_t read_offset_;
+  // End of the range requested with MADV_WILLNEED.
+  int64_t readahead_end_;
+  bool eos_;
+  TSParser parser_;
+  std::shared_ptr<TSIndex> index_;
+  std::shared_ptr<Track> tracks_[TSParser::NUM_SOURCE_TYPES];
+
+  status_t ReadAccessUnit(const std::shared_ptr<PacketSource>& source,
+                          std::shared_ptr<MediaFrame>& frame);
+  status_t SeekTo(int64_t time_us, MediaSource::ReadOptions::SeekMode mode);
+
+  status_t MapFile();
+
+  // Feeds the next chunk of the file. Returns ERROR_END_OF_STREAM once the
+  // whole file was fed.
+  status_t FeedNextChunk();
+
+  // Requests the pages ahead of |read_offset_| once less than half of the
+  // readahead is left.
+  void Readahead();
+
+  AVE_DISALLOW_COPY_AND_ASSIGN(TSFileSource);
+};
+
+}  // namespace mpeg2ts
+}  // namespace media
+}  // namespace ave
+
+#endif  // MODULES_MPEG2TS_TS_FILE_SOURCE_H
@@ -0,0 +1,764 @@
+/*
+ * ts_index.cc
+ * Copyright (C) 2025 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#include "ts_index.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <thread>
+
+#include "base/logging.h"
+#include "ts_parser.h"
+#include "ts_sync.h"
+
+namespace ave {
+namespace media {
+namespace mpeg2ts {
+
+namespace {
+
+constexpr size_t kNumPIDs = 8192;
+constexpr unsigned kNullPID = 0x1fff;
+constexpr uint64_t kPtsMask = (1ULL << 33) - 1;
+
+// PAT and PMT are expected within this many bytes of the start.
+constexpr size_t kProgramInfoScanSize = 4 * 1024 * 1024;
+// A chunk task reads this far past its end to classify the access unit of
+// a PES that starts near the end of the chunk.
+constexpr size_t kChunkOverlap = 1024 * 1024;
+
+constexpr char kSidecarMagic[8] = {'A', 'V', 'E', 'T', 'S', 'I', 'D', 'X'};
+constexpr uint32_t kSidecarVersion = 1;
+constexpr size_t kSidecarHeaderSize = 8 + 4 + 4 + 8 * 4;
+constexpr size_t kSidecarEntrySize = 8 * 3;
+
+int64_t TicksToUs(int64_t ticks) {
+  return ticks * 1000000 / 90000;
+}
+
+// Signed distance from |from| to |to| on the 33-bit PTS clock.
+int64_t PtsDelta(uint64_t from, uint64_t to) {
+  int64_t delta = static_cast<int64_t>((to - from) & kPtsMask);
+  if (delta >= static_cast<int64_t>(1ULL << 32)) {
+    delta -= static_cast<int64_t>(1ULL << 33);
+  }
+  return delta;
+}
+
+// How packets are laid out in the stream: |stride| bytes apart, with the
+// TS packet |sync_offset| bytes into each, after the M2TS header.
+struct PacketLayout {
+  size_t stride = kTSPacketSize;
+  size_t sync_offset = 0;
+};
+
+struct ProgramInfo {
+  unsigned pcr_pid = kNullPID;
+  // PID whose PES packets are sync point candidates.
+  unsigned sync_pid = kNullPID;
+  unsigned sync_stream_type = 0;
+  // Elementary PIDs of the program, for the first PTS and the duration.
+  std::vector<bool> is_elementary = std::vector<bool>(kNumPIDs);
+
+  bool ScansNalUnits() const {
+    return sync_stream_type == TSParser::STREAMTYPE_H264 ||
+           sync_stream_type == TSParser::STREAMTYPE_H265;
+  }
+};
+
+// Returns the payload of a TS packet, or an empty span.
+std::span<const uint8_t> GetPayload(const uint8_t* packet) {
+  const unsigned adaptation_field_control = (packet[3] >> 4) & 0x03;
+  size_t offset = 4;
+  if (adaptation_field_control & 0x02) {
+    offset += 1 + packet[4];
+  }
+  if ((adaptation_field_control & 0x01) == 0 || offset >= kTSPacketSize) {
+    return {};
+  }
+  return std::span(packet + offset, kTSPacketSize - offset);
+}
+
+// Returns the body of the PSI section starting in |payload|, without its
+// CRC, if the section fits into the packet.
+std::span<const uint8_t> GetSection(std::span<const uint8_t> payload) {
+  if (payload.empty() || payload[0] + 1u + 3u > payload.size()) {
+    return {};
+  }
+  payload = payload.subspan(payload[0] + 1);
+  const size_t section_length = ((payload[1] & 0x0f) << 8) | payload[2];
+  if (section_length < 4 || 3 + section_length > payload.size()) {
+    return {};
+  }
+  return payload.subspan(0, 3 + section_length - 4);
+}
+
+// Finds the PAT and PMTs in |data| and picks the program to index.
+bool ParseProgramInfo(std::span<const uint8_t> data,
+                      const PacketLayout& layout,
+                      ProgramInfo* info) {
+  std::vector<unsigned> pmt_pids;
+  std::vector<bool> pmt_seen;
+  for (size_t offset = 0;
+       offset + layout.sync_offset + kTSPacketSize <= data.size();
+       offset += layout.stride) {
+    const uint8_t* packet = data.data() + offset + layout.sync_offset;
+    if (packet[0] != kTSSyncByte || (packet[1] & 0x40) == 0) {
+      continue;
+    }
+    const unsigned pid = ((packet[1] & 0x1f) << 8) | packet[2];
+    const auto section = GetSection(GetPayload(packet));
+    if (section.size() < 8) {
+      continue;
+    }
+
+    if (pid == 0 && section[0] == 0x00 && pmt_pids.empty()) {
+      for (size_t i = 8; i + 4 <= section.size(); i += 4) {
+        const unsigned program_number = (section[i] << 8) | section[i + 1];
+        if (program_number != 0) {
+          pmt_pids.push_back(((section[i + 2] & 0x1f) << 8) | section[i + 3]);
+        }
+      }
+      pmt_seen.assign(pmt_pids.size(), false);
+      continue;
+    }
+
+    const auto it = std::find(pmt_pids.begin(), pmt_pids.end(), pid);
+    if (it == pmt_pids.end() || section[0] != 0x02 || section.size() < 12 ||
+        pmt_seen[it - pmt_pids.begin()]) {
+      continue;
+    }
+    pmt_seen[it - pmt_pids.begin()] = true;
+
+    ProgramInfo program;
+    program.pcr_pid = ((section[8] & 0x1f) << 8) | section[9];
+    size_t i = 12 + (((section[10] & 0x0f) << 8) | section[11]);
+    unsigned first_pid = kNullPID;
+    unsigned first_type = 0;
+    for (; i + 5 <= section.size();
+         i += 5 + (((section[i + 3] & 0x0f) << 8) | section[i + 4])) {
+      const unsigned stream_type = section[i];
+      const unsigned es_pid = ((section[i + 1] & 0x1f) << 8) | section[i + 2];
+      program.is_elementary[es_pid] = true;
+      if (first_pid == kNullPID) {
+        first_pid = es_pid;
+        first_type = stream_type;
+      }
+      if (program.sync_pid == kNullPID &&
+          (stream_type == TSParser::STREAMTYPE_H264 ||
+           stream_type == TSParser::STREAMTYPE_H265)) {
+        program.sync_pid = es_pid;
+        program.sync_stream_type = stream_type;
+      }
+    }
+    if (program.sync_pid == kNullPID) {
+      program.sync_pid = first_pid;
+      program.sync_stream_type = first_type;
+    }
+
+    // Prefer the first program with video, else the first program.
+    if (program.ScansNalUnits() ||
+        (info->sync_pid == kNullPID && program.sync_pid != kNullPID)) {
+      *info = std::move(program);
+      if (info->ScansNalUnits()) {
+        return true;
+      }
+    }
+    if (std::all_of(pmt_seen.begin(), pmt_seen.end(),
+                    [](bool seen) { return seen; })) {
+      break;
+    }
+  }
+  return info->sync_pid != kNullPID;
+}
+
+// Returns the PTS of the PES header at the start of |payload| and sets
+// |header_size|, if the header is complete and has a PTS.
+bool ParsePESTimestamp(std::span<const uint8_t> payload,
+                       uint64_t* pts,
+                       size_t* header_size) {
+  if (payload.size() < 14 || payload[0] != 0x00 || payload[1] != 0x00 ||
+      payload[2] != 0x01 || (payload[7] & 0x80) == 0) {
+    return false;
+  }
+  *header_size = std::min<size_t>(9 + payload[8], payload.size());
+  const uint8_t* p = payload.data() + 9;
+  *pts = (static_cast<uint64_t>((p[0] >> 1) & 0x07) << 30) |
+         (static_cast<uint64_t>(p[1]) << 22) |
+         (static_cast<uint64_t>(p[2] >> 1) << 15) |
+         (static_cast<uint64_t>(p[3]) << 7) | (p[4] >> 1);
+  return true;
+}
+
+// Finds the first VCL NAL unit of an access unit split over TS payloads.
+class NalUnitScanner {
+ public:
+  enum Result { kUndecided, kSync, kNotSync };
+
+  explicit NalUnitScanner(bool h265) : h265_(h265) {}
+
+  void Reset() {
+    zeros_ = 0;
+    header_next_ = false;
+  }
+
+  Result Scan(std::span<const uint8_t> data) {
+    for (uint8_t byte : data) {
+      if (header_next_) {
+        header_next_ = false;
+        const Result result = Classify(byte);
+        if (result != kUndecided) {
+          return result;
+        }
+      }
+      if (byte == 0x00) {
+        ++zeros_;
+      } else {
+        header_next_ = byte == 0x01 && zeros_ >= 2;
+        zeros_ = 0;
+      }
+    }
+    return kUndecided;
+  }
+
+ private:
+  Result Classify(uint8_t header) const {
+    if (h265_) {
+      const unsigned type = (header >> 1) & 0x3f;
+      if (type >= 16 && type <= 21) {
+        return kSync;  // IRAP
+      }
+      return type < 16 ? kNotSync : kUndecided;
+    }
+    const unsigned type = header & 0x1f;
+    if (type == 5) {
+      return kSync;  // IDR
+    }
+    return type >= 1 && type <= 4 ? kNotSync : kUndecided;
+  }
+
+  const bool h265_;
+  size_t zeros_ = 0;
+  bool header_next_ = false;
+};
+
+struct Candidate {
+  int64_t offset;
+  uint64_t pts;
+  int64_t pcr;
+};
+
+struct ChunkResult {
+  status_t status = OK;
+  std::vector<Candidate> candidates;
+  bool has_pts = false;
+  uint64_t first_pts = 0;
+  uint64_t last_pts = 0;
+  // Largest PTS in the chunk, relative to |first_pts|.
+  int64_t max_pts_delta = 0;
+  int64_t last_pcr = -1;
+};
+
+// Scans the packets starting in the first |owned_size| bytes of |data|,
+// which begins at |offset| in the stream. Bytes past |owned_size| are only
+// used to finish classifying a PES that starts in the chunk.
+void ScanChunk(std::span<const uint8_t> data,
+               size_t owned_size,
+               int64_t offset,
+               const PacketLayout& layout,
+               const ProgramInfo& info,
+               ChunkResult* result) {
+  NalUnitScanner scanner(info.sync_stream_type == TSParser::STREAMTYPE_H265);
+  bool pending = false;
+  bool pending_random_access = false;
+  Candidate candidate{};
+
+  size_t pos = 0;
+  while (pos + layout.sync_offset + kTSPacketSize <= data.size()) {
+    const bool owned = pos < owned_size;
+    if (!owned && !pending) {
+      break;
+    }
+    const size_t packet_start = pos;
+    const uint8_t* packet = data.data() + pos + layout.sync_offset;
+    if (packet[0] != kTSSyncByte) {
+      pos += FindPacketStart(packet + 1,
+                             data.size() - pos - layout.sync_offset - 1,
+                             layout.stride) +
+             1;
+      continue;
+    }
+    pos += layout.stride;
+
+    const unsigned pid = ((packet[1] & 0x1f) << 8) | packet[2];
+    const bool unit_start = (packet[1] & 0x40) != 0;
+    bool random_access = false;
+    if ((packet[3] & 0x20) && packet[4] > 0) {
+      random_access = (packet[5] & 0x40) != 0;
+      if (pid == info.pcr_pid && (packet[5] & 0x10) && packet[4] >= 7 &&
+          owned) {
+        const uint8_t* p = packet + 6;
+        const int64_t base = (static_cast<int64_t>(p[0]) << 25) |
+                             (p[1] << 17) | (p[2] << 9) | (p[3] << 1) |
+                             (p[4] >> 7);
+        const int64_t extension = ((p[4] & 0x01) << 8) | p[5];
+        result->last_pcr = base * 300 + extension;
+      }
+    }
+
+    if (pid == info.sync_pid && pending && unit_start) {
+      // The previous access unit ended without a VCL NAL unit; trust the
+      // random_access_indicator.
+      if (pending_random_access) {
+        result->candidates.push_back(candidate);
+      }
+      pending = false;
+    }
+    if (!owned && !pending) {
+      break;
+    }
+
+    const auto payload = GetPayload(packet);
+    if (payload.empty()) {
+      continue;
+    }
+
+    size_t header_size = 0;
+    uint64_t pts = 0;
+    if (unit_start && owned && info.is_elementary[pid] &&
+        ParsePESTimestamp(payload, &pts, &header_size)) {
+      if (!result->has_pts) {
+        result->has_pts = true;
+        result->first_pts = pts;
+      }
+      result->last_pts = pts;
+      result->max_pts_delta = std::max(result->max_pts_delta,
+                                       PtsDelta(result->first_pts, pts));
+
+      if (pid == info.sync_pid) {
+        candidate = {offset + static_cast<int64_t>(packet_start), pts,
+                     result->last_pcr};
+        if (!info.ScansNalUnits()) {
+          result->candidates.push_back(candidate);
+          continue;
+        }
+        pending = true;
+        pending_random_access = random_access;
+        scanner.Reset();
+      }
+    }
+
+    if (pid == info.sync_pid && pending) {
+      switch (scanner.Scan(payload.subspan(header_size))) {
+        case NalUnitScanner::kSync:
+          result->candidates.push_back(candidate);
+          pending = false;
+          break;
+        case NalUnitScanner::kNotSync:
+          pending = false;
+          break;
+        case NalUnitScanner::kUndecided:
+          break;
+      }
+    }
+  }
+}
+
+// Reads byte ranges of the stream being indexed; one per worker thread.
+class RangeReader {
+ public:
+  virtual ~RangeReader() = default;
+  // Returns up to |size| bytes at |offset|, fewer at the end of the stream.
+  virtual status_t Read(int64_t offset,
+                        size_t size,
+                        std::span<const uint8_t>* data) = 0;
+};
+
+class MemoryRangeReader : public RangeReader {
+ public:
+  explicit MemoryRangeReader(std::span<const uint8_t> data) : data_(data) {}
+
+  status_t Read(int64_t offset,
+                size_t size,
+                std::span<const uint8_t>* data) override {
+    const size_t start = std::min<size_t>(offset, data_.size());
+    *data = data_.subspan(start, std::min(size, data_.size() - start));
+    return OK;
+  }
+
+ private:
+  std::span<const uint8_t> data_;
+};
+
+class FileRangeReader : public RangeReader {
+ public:
+  explicit FileRangeReader(const std::string& path)
+      : file_(path, std::ios::binary) {}
+
+  status_t Read(int64_t offset,
+                size_t size,
+                std::span<const uint8_t>* data) override {
+    if (!file_.is_open()) {
+      return ERROR_IO;
+    }
+    buffer_.resize(size);
+    file_.clear();
+    file_.seekg(offset);
+    file_.read(reinterpret_cast<char*>(buffer_.data()), size);
+    if (file_.bad()) {
+      return ERROR_IO;
+    }
+    *data = std::span(buffer_.data(), static_cast<size_t>(file_.gcount()));
+    return OK;
+  }
+
+ private:
+  std::ifstream file_;
+  std::vector<uint8_t> buffer_;
+};
+
+status_t BuildIndex(int64_t size,
+                    const std::function<std::unique_ptr<RangeReader>()>&
+                        create_reader,
+                    const TSIndex::BuildOptions& options,
+                    std::vector<TSIndex::Entry>* entries,
+                    int64_t* duration_us,
+                    int64_t* first_pts_us) {
+  auto reader = create_reader();
+  std::span<const uint8_t> head;
+  status_t err = reader->Read(0, kProgramInfoScanSize, &head);
+  if (err != OK) {
+    return err;
+  }
+  // M2TS and Reed-Solomon streams are indexed at their own stride, with
+  // entries at the start of the M2TS header so seeks feed whole packets.
+  PacketLayout layout;
+  layout.stride = DetectPacketStride(head.data(), head.size());
+  if (layout.stride == 0) {
+    AVE_LOG(LS_WARNING) << "No packets found to index";
+    return ERROR_MALFORMED;
+  }
+  if (layout.stride == kM2TSPacketSize) {
+    layout.sync_offset = kM2TSHeaderSize;
+  }
+  size_t start = FindPacketStart(head.data(), head.size(), layout.stride);
+  if (start < head.size()) {
+    start = start >= layout.sync_offset
+                ? start - layout.sync_offset
+                : start + layout.stride - layout.sync_offset;
+  }
+  ProgramInfo info;
+  if (start >= head.size() ||
+      !ParseProgramInfo(head.subspan(start), layout, &info)) {
+    AVE_LOG(LS_WARNING) << "No program found to index";
+    return ERROR_MALFORMED;
+  }
+
+  const size_t chunk_size = std::max<size_t>(
+      options.chunk_size / layout.stride * layout.stride, layout.stride);
+  const size_t num_chunks = (size - start + chunk_size - 1) / chunk_size;
+  std::vector<ChunkResult> results(num_chunks);
+
+  size_t num_threads = options.num_threads;
+  if (num_threads == 0) {
+    num_threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  num_threads = std::min(num_threads, num_chunks);
+
+  std::atomic<size_t> next_chunk{0};
+  auto worker = [&](RangeReader* reader) {
+    for (size_t i = next_chunk++; i < num_chunks; i = next_chunk++) {
+      const int64_t chunk_offset = start + static_cast<int64_t>(i) * chunk_size;
+      std::span<const uint8_t> data;
+      results[i].status =
+          reader->Read(chunk_offset, chunk_size + kChunkOverlap, &data);
+      if (results[i].status == OK) {
+        ScanChunk(data, std::min(chunk_size, data.size()), chunk_offset,
+                  layout, info, &results[i]);
+      }
+    }
+  };
+  std::vector<std::thread> threads;
+  std::vector<std::unique_ptr<RangeReader>> readers;
+  for (size_t i = 1; i < num_threads; ++i) {
+    readers.push_back(create_reader());
+    threads.emplace_back(worker, readers.back().get());
+  }
+  worker(reader.get());
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  // Stitch the chunks together in stream order, unwrapping the 33-bit PTS
+  // and carrying the last PCR into the next chunk.
+  bool has_first_pts = false;
+  uint64_t first_pts = 0;
+  uint64_t last_pts = 0;
+  int64_t last_pts_ticks = 0;
+  int64_t max_pts_ticks = 0;
+  int64_t last_pcr = -1;
+  for (const auto& result : results) {
+    if (result.status != OK) {
+      return result.status;
+    }
+    if (result.has_pts) {
+      int64_t chunk_ticks = 0;
+      if (!has_first_pts) {
+        has_first_pts = true;
+        first_pts = result.first_pts;
+      } else {
+        chunk_ticks = last_pts_ticks + PtsDelta(last_pts, result.first_pts);
+      }
+      max_pts_ticks =
+          std::max(max_pts_ticks, chunk_ticks + result.max_pts_delta);
+      last_pts = result.last_pts;
+      last_pts_ticks =
+          chunk_ticks + PtsDelta(result.first_pts, result.last_pts);
+
+      for (const auto& candidate : result.candidates) {
+        const int64_t ticks =
+            chunk_ticks + PtsDelta(result.first_pts, candidate.pts);
+        const int64_t time_us = TicksToUs(first_pts + ticks) -
+                                TicksToUs(static_cast<int64_t>(first_pts));
+        if (!entries->empty() &&
+            (time_us <= entries->back().time_us ||
+             (!info.ScansNalUnits() &&
+              time_us - entries->back().time_us <
+                  TSIndex::kAudioSyncIntervalUs))) {
+          continue;
+        }
+        entries->push_back({candidate.offset, time_us,
+                            candidate.pcr >= 0 ? candidate.pcr : last_pcr});
+      }
+    }
+    if (result.last_pcr >= 0) {
+      last_pcr = result.last_pcr;
+    }
+  }
+
+  *first_pts_us = TicksToUs(static_cast<int64_t>(first_pts));
+  *duration_us = TicksToUs(first_pts + max_pts_ticks) - *first_pts_us;
+  return OK;
+}
+
+void PutLE(uint64_t value, size_t size, std::vector<uint8_t>* out) {
+  for (size_t i = 0; i < size; ++i) {
+    out->push_back(static_cast<uint8_t>(value >> (8 * i)));
+  }
+}
+
+uint64_t GetLE(const uint8_t* data, size_t size) {
+  uint64_t value = 0;
+  for (size_t i = 0; i < size; ++i) {
+    value |= static_cast<uint64_t>(data[i]) << (8 * i);
+  }
+  return value;
+}
+
+}  // namespace
+
+TSIndex::TSIndex() = default;
+
+TSIndex::~TSIndex() = default;
+
+status_t TSIndex::Build(const std::string& path,
+                        const BuildOptions& options,
+                        std::shared_ptr<TSIndex>* index) {
+  std::error_code ec;
+  const auto file_size = std::filesystem::file_size(path, ec);
+  if (ec) {
+    AVE_LOG(LS_ERROR) << "Cannot stat " << path << ": " << ec.message();
+    return ERROR_IO;
+  }
+
+  auto result = std::make_shared<TSIndex>();
+  result->file_size_ = static_cast<int64_t>(file_size);
+  const status_t err = BuildIndex(
+      result->file_size_,
+      [&path] { return std::make_unique<FileRangeReader>(path); }, options,
+      &result->entries_, &result->duration_us_, &result->first_pts_us_);
+  if (err != OK) {
+    return err;
+  }
+  *index = std::move(result);
+  return OK;
+}
+
+status_t TSIndex::Build(std::span<const uint8_t> data,
+                        const BuildOptions& options,
+                        std::shared_ptr<TSIndex>* index) {
+  auto result = std::make_shared<TSIndex>();
+  result->file_size_ = static_cast<int64_t>(data.size());
+  const status_t err = BuildIndex(
+      result->file_size_,
+      [data] { return std::make_unique<MemoryRangeReader>(data); }, options,
+      &result->entries_, &result->duration_us_, &result->first_pts_us_);
+  if (err != OK) {
+    return err;
+  }
+  *index = std::move(result);
+  return OK;
+}
+
+std::string TSIndex::SidecarPath(const std::string& path) {
+  return path + ".aveidx";
+}
+
+status_t TSIndex::Save(const std::string& sidecar_path) const {
+  std::vector<uint8_t> data;
+  data.reserve(kSidecarHeaderSize + entries_.size() * kSidecarEntrySize);
+  data.insert(data.end(), std::begin(kSidecarMagic), std::end(kSidecarMagic));
+  PutLE(kSidecarVersion, 4, &data);
+  PutLE(0, 4, &data);  // reserved
+  PutLE(file_size_, 8, &data);
+  PutLE(duration_us_, 8, &data);
+  PutLE(first_pts_us_, 8, &data);
+  PutLE(entries_.size(), 8, &data);
+  for (const auto& entry : entries_) {
+    PutLE(entry.offset, 8, &data);
+    PutLE(entry.time_us, 8, &data);
+    PutLE(entry.pcr, 8, &data);
+  }
+
+  // Written aside and renamed, so readers never see a partial sidecar.
+  const std::string temp_path = sidecar_path + ".tmp";
+  {
+    std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(data.data()), data.size());
+    if (!file) {
+      return ERROR_IO;
+    }
+  }
+  std::error_code ec;
+  std::filesystem::rename(temp_path, sidecar_path, ec);
+  return ec ? ERROR_IO : OK;
+}
+
+status_t TSIndex::Load(const std::string& sidecar_path,
+                       int64_t file_size,
+                       std::shared_ptr<TSIndex>* index) {
+  std::ifstream file(sidecar_path, std::ios::binary);
+  if (!file) {
+    return ERROR_IO;
+  }
+  std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)),
+                            std::istreambuf_iterator<char>());
+
+  if (data.size() < kSidecarHeaderSize ||
+      memcmp(data.data(), kSidecarMagic, sizeof(kSidecarMagic)) != 0 ||
+      GetLE(data.data() + 8, 4) != kSidecarVersion) {
+    return ERROR_MALFORMED;
+  }
+  auto result = std::make_shared<TSIndex>();
+  result->file_size_ = static_cast<int64_t>(GetLE(data.data() + 16, 8));
+  result->duration_us_ = static_cast<int64_t>(GetLE(data.data() + 24, 8));
+  result->first_pts_us_ = static_cast<int64_t>(GetLE(data.data() + 32, 8));
+  const uint64_t num_entries = GetLE(data.data() + 40, 8);
+  if (result->file_size_ != file_size ||
+      num_entries != (data.size() - kSidecarHeaderSize) / kSidecarEntrySize ||
+      (data.size() - kSidecarHeaderSize) % kSidecarEntrySize != 0) {
+    return ERROR_MALFORMED;
+  }
+
+  result->entries_.resize(num_entries);
+  const uint8_t* p = data.data() + kSidecarHeaderSize;
+  for (auto& entry : result->entries_) {
+    entry.offset = static_cast<int64_t>(GetLE(p, 8));
+    entry.time_us = static_cast<int64_t>(GetLE(p + 8, 8));
+    entry.pcr = static_cast<int64_t>(GetLE(p + 16, 8));
+    p += kSidecarEntrySize;
+  }
+  *index = std::move(result);
+  return OK;
+}
+
+namespace {
+
+status_t LoadOrBuildIndex(const std::string& path,
+                          int64_t file_size,
+                          const std::function<status_t()>& build,
+                          std::shared_ptr<TSIndex>* index) {
+  const std::string sidecar_path = TSIndex::SidecarPath(path);
+  if (TSIndex::Load(sidecar_path, file_size, index) == OK) {
+    return OK;
+  }
+
+  const status_t err = build();
+  if (err != OK) {
+    return err;
+  }
+  if ((*index)->Save(sidecar_path) != OK) {
+    AVE_LOG(LS_WARNING) << "Cannot write index sidecar " << sidecar_path;
+  }
+  return OK;
+}
+
+}  // namespace
+
+status_t TSIndex::LoadOrBuild(const std::string& path,
+                              const BuildOptions& options,
+                              std::shared_ptr<TSIndex>* index) {
+  std::error_code ec;
+  const auto file_size = std::filesystem::file_size(path, ec);
+  if (ec) {
+    return ERROR_IO;
+  }
+  return LoadOrBuildIndex(
+      path, static_cast<int64_t>(file_size),
+      [&] { return Build(path, options, index); }, index);
+}
+
+status_t TSIndex::LoadOrBuild(const std::string& path,
+                              std::span<const uint8_t> data,
+                              const BuildOptions& options,
+                              std::shared_ptr<TSIndex>* index) {
+  return LoadOrBuildIndex(
+      path, static_cast<int64_t>(data.size()),
+      [&] { return Build(data, options, index); }, index);
+}
+
+const TSIndex::Entry* TSIndex::FindSyncPoint(
+    int64_t time_us,
+    MediaSource::ReadOptions::SeekMode mode) const {
+  if (entries_.empty()) {
+    return nullptr;
+  }
+
+  // First entry after |time_us|.
+  const auto next = std::upper_bound(
+      entries_.begin(), entries_.end(), time_us,
+      [](int64_t time_us, const Entry& entry) {
+        return time_us < entry.time_us;
+      });
+  const Entry* previous = next == entries_.begin() ? nullptr : &*(next - 1);
+  const Entry* at_or_after =
+      previous != nullptr && previous->time_us == time_us
+          ? previous
+          : (next == entries_.end() ? nullptr : &*next);
+
+  switch (mode) {
+    case MediaSource::ReadOptions::SEEK_PREVIOUS_SYNC:
+      return previous != nullptr ? previous : &entries_.front();
+    case MediaSource::ReadOptions::SEEK_NEXT_SYNC:
+      return at_or_after != nullptr ? at_or_after : &entries_.back();
+    default:
+      if (previous == nullptr || at_or_after == nullptr) {
+        return previous != nullptr ? previous : at_or_after;
+      }
+      return time_us - previous->time_us <= at_or_after->time_us - time_us
+                 ? previous
+                 : at_or_after;
+  }
+}
+
+}  // namespace mpeg2ts
+}  // namespace media
+}  // namespace ave
@@ -0,0 +1,105 @@
+/*
+ * ts_index.h
+ * Copyright (C) 2025 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#ifndef MODULES_MPEG2TS_TS_INDEX_H
+#define MODULES_MPEG2TS_TS_INDEX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "foundation/media_errors.h"
+#include "foundation/media_source.h"
+
+namespace ave {
+namespace media {
+namespace mpeg2ts {
+
+// Random access points of a transport stream file, found by one scan of the
+// file and kept in a small binary sidecar next to it.
+//
+// The first program with video is indexed (the first program if none has
+// video). Sync points are the PES packets starting H.264 IDR or H.265 IRAP
+// access units; audio-only programs get one sync point per
+// kAudioSyncIntervalUs. Times are relative to the first PTS of the program,
+// matching TSParser without TS_TIMESTAMPS_ARE_ABSOLUTE.
+class TSIndex {
+ public:
+  struct Entry {
+    // Offset of the packet that starts the PES, including its M2TS header.
+    int64_t offset;
+    int64_t time_us;
+    // Last PCR (27 MHz) before |offset|, or -1 if none was seen.
+    int64_t pcr;
+  };
+
+  struct BuildOptions {
+    // 0 uses one thread per core.
+    size_t num_threads = 0;
+    // The file is scanned in chunks of this size, one per task.
+    size_t chunk_size = 4 * 1024 * 1024;
+  };
+
+  static constexpr int64_t kAudioSyncIntervalUs = 500000;
+
+  TSIndex();
+  ~TSIndex();
+
+  // Scans a file or an in-memory stream.
+  static status_t Build(const std::string& path,
+                        const BuildOptions& options,
+                        std::shared_ptr<TSIndex>* index);
+  static status_t Build(std::span<const uint8_t> data,
+                        const BuildOptions& options,
+                        std::shared_ptr<TSIndex>* index);
+
+  // Sidecar I/O. Load() fails with ERROR_MALFORMED if the sidecar is
+  // corrupt or was built for a file of a different size.
+  static std::string SidecarPath(const std::string& path);
+  status_t Save(const std::string& sidecar_path) const;
+  static status_t Load(const std::string& sidecar_path,
+                       int64_t file_size,
+                       std::shared_ptr<TSIndex>* index);
+
+  // Loads the sidecar of |path|, or builds the index and saves it.
+  static status_t LoadOrBuild(const std::string& path,
+                              const BuildOptions& options,
+                              std::shared_ptr<TSIndex>* index);
+  // Same, but builds from |data|, the mapped contents of |path|.
+  static status_t LoadOrBuild(const std::string& path,
+                              std::span<const uint8_t> data,
+                              const BuildOptions& options,
+                              std::shared_ptr<TSIndex>* index);
+
+  // Returns the sync point for a seek to |time_us|, or null if there is
+  // none: the last one at or before it for SEEK_PREVIOUS_SYNC, the first
+  // one at or after it for SEEK_NEXT_SYNC and the nearer of the two
+  // otherwise. O(log n).
+  const Entry* FindSyncPoint(int64_t time_us,
+                             MediaSource::ReadOptions::SeekMode mode) const;
+
+  const std::vector<Entry>& entries() const { return entries_; }
+  int64_t file_size() const { return file_size_; }
+  int64_t duration_us() const { return duration_us_; }
+  // Absolute time of the first PTS, as TSParser::GetFirstPTSTimeUs().
+  int64_t first_pts_us() const { return first_pts_us_; }
+
+ private:
+  int64_t file_size_ = 0;
+  int64_t duration_us_ = 0;
+  int64_t first_pts_us_ = 0;
+  std::vector<Entry> entries_;
+};
+
+}  // namespace mpeg2ts
+}  // namespace media
+}  // namespace ave
+
+#endif  // MODULES_MPEG2TS_TS_INDEX_H
@@ -10,7 +10,15 @@
 
 #include "ts_parser.h"
 
+#include <algorithm>
+#include <condition_variable>
 #include <cstring>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <utility>
+#include <vector>
 
 #include "base/ave_config.h"
 #include "base/logging.h"
@@ -22,15 +30,17 @@
 #include "foundation/media_meta.h"
 #include "foundation/message.h"
 #include "packet_source.h"
+#include "ring_queue.h"
+#include "ts_index.h"
+#include "ts_sync.h"
 
 namespace ave {
 namespace media {
 namespace mpeg2ts {
 
-static const size_t kTSPacketSize = 188;
-
 namespace {
 
+constexpr unsigned kNullPID = 0x1fff;
 constexpr uint8_t kDescriptorIso639Language = 0x0A;
 constexpr uint8_t kAudioTypeUndefined = 0x00;
 constexpr uint8_t kAudioTypeVisualImpairedCommentary = 0x03;
@@ -62,70 +72,184 @@ uint8_t ParseIso639AudioType(const uint8_t* data, size_t size) {
   return kAudioTypeUndefined;
 }
 
-}  // namespace
+// Parses the PES header at the start of |data|. Returns E_AGAIN while the
+// header is incomplete, otherwise sets |header_size| and, when present, the
+// 90kHz |pts|.
+status_t ParsePESHeader(const uint8_t* data,
+                        size_t size,
+                        size_t* header_size,
+                        std::optional<uint64_t>* pts) {
+  if (size >= 3 && (data[0] != 0x00 || data[1] != 0x00 || data[2] != 0x01)) {
+    AVE_LOG(LS_VERBOSE) << "Not a valid PES start code";
+    return ERROR_MALFORMED;
+  }
+  if (size < 9) {
+    return E_AGAIN;
+  }
 
-// Internal classes
-class TSParser::PSISection {
- public:
-  PSISection() : skip_bytes_(0) {}
+  // data[3] is stream_id, data[4..5] PES_packet_length.
+  if ((data[6] >> 6) != 2) {
+    return ERROR_MALFORMED;
+  }
 
-  status_t Append(const void* data, size_t size) {
-    if (!buffer_) {
-      buffer_ = std::make_shared<Buffer>(size);
-      memcpy(buffer_->data(), data, size);
-      buffer_->setRange(0, size);
-    } else {
-      size_t new_size = buffer_->size() + size;
-      if (new_size > buffer_->capacity()) {
-        auto new_buffer = std::make_shared<Buffer>(new_size);
-        memcpy(new_buffer->data(), buffer_->data(), buffer_->size());
-        buffer_ = new_buffer;
-      }
-      memcpy(buffer_->data() + buffer_->size(), data, size);
-      buffer_->setRange(0, new_size);
-    }
-    return OK;
+  const unsigned pts_dts_flags = data[7] >> 6;
+  const size_t pes_header_data_length = data[8];
+  if ((pts_dts_flags == 2 && pes_header_data_length < 5) ||
+      (pts_dts_flags == 3 && pes_header_data_length < 10)) {
+    return ERROR_MALFORMED;
   }
 
-  void SetSkipBytes(uint8_t skip) { skip_bytes_ = skip; }
+  *header_size = 9 + pes_header_data_length;
+  if (size < *header_size) {
+    return E_AGAIN;
+  }
+
+  pts->reset();
+  if (pts_dts_flags == 2 || pts_dts_flags == 3) {
+    const uint8_t* p = data + 9;
+    *pts = (static_cast<uint64_t>((p[0] >> 1) & 0x07) << 30) |
+           (static_cast<uint64_t>(p[1]) << 22) |
+           (static_cast<uint64_t>(p[2] >> 1) << 15) |
+           (static_cast<uint64_t>(p[3]) << 7) | (p[4] >> 1);
+  }
+  return OK;
+}
+
+// An operation on the ESQueue or PacketSource of a stream. The feeding
+// thread records them in order; they run inline or on the stream's worker.
+enum class ESOp : uint8_t {
+  // Appends |size| bytes starting a PES payload stamped with |time_us|.
+  APPEND,
+  // Appends |size| bytes continuing the PES payload.
+  APPEND_CONTINUATION,
+  // Drops the last |size| payload bytes.
+  DROP,
+  // Builds the access units of the completed PES.
+  DRAIN,
+  DISCONTINUITY,
+  SEEK,
+  EOS,
+};
+
+struct ESCommand {
+  ESOp op;
+  size_t size = 0;
+  int64_t time_us = -1;
+  DiscontinuityType discontinuity_type = DiscontinuityType::NONE;
+  std::shared_ptr<Message> extra;
+  status_t final_result = OK;
+};
+
+// ES work handed to a worker in one go: commands and the payload bytes of
+// the APPEND ones, in order.
+struct ESBatch {
+  std::vector<ESCommand> commands;
+  std::vector<uint8_t> data;
+  // Set once a command can produce output.
+  bool ready = false;
 
   void Clear() {
-    if (buffer_) {
-      buffer_->setRange(0, 0);
-    }
+    commands.clear();
+    data.clear();
+    ready = false;
   }
+};
 
-  bool IsComplete() const {
-    if (!buffer_ || buffer_->size() < 3) {
-      return false;
-    }
+// Payload batched for a worker before it is handed over even though no PES
+// completed yet.
+constexpr size_t kMaxESBatchBytes = 64 * 1024;
+
+}  // namespace
+
+// Internal classes
+
+// Runs the ES work of the streams of its programs on its own thread, one
+// batch at a time in submission order.
+class TSParser::ESWorker {
+ public:
+  ESWorker() : busy_(false), stopping_(false), thread_([this] { Run(); }) {}
 
-    unsigned section_length =
-        (((buffer_->data()[1] & 0x0f) << 8) | buffer_->data()[2]);
-    return buffer_->size() >= section_length + 3;
+  // Runs the batches already submitted, then stops.
+  ~ESWorker() {
+    {
+      std::scoped_lock lock(lock_);
+      stopping_ = true;
+    }
+    condition_.notify_one();
+    thread_.join();
   }
 
-  bool IsEmpty() const { return !buffer_ || buffer_->size() == 0; }
+  // Returns an empty batch, reusing one the worker is done with.
+  std::unique_ptr<ESBatch> AcquireBatch() {
+    std::scoped_lock lock(lock_);
+    if (free_batches_.empty()) {
+      return std::make_unique<ESBatch>();
+    }
+    auto batch = std::move(free_batches_.back());
+    free_batches_.pop_back();
+    return batch;
+  }
 
-  const uint8_t* Data() const { return buffer_ ? buffer_->data() : nullptr; }
+  // Waits while kMaxQueuedBatches are queued, which bounds how far the
+  // feeding thread runs ahead.
+  void Submit(Stream* stream, std::unique_ptr<ESBatch> batch) {
+    std::unique_lock<std::mutex> lock(lock_);
+    idle_condition_.wait(
+        lock, [this] { return jobs_.size() < kMaxQueuedBatches; });
+    jobs_.push_back(Job{stream, std::move(batch)});
+    condition_.notify_one();
+  }
 
-  size_t Size() const { return buffer_ ? buffer_->size() : 0; }
+  // Waits until every submitted batch ran.
+  void Wait() {
+    std::unique_lock<std::mutex> lock(lock_);
+    idle_condition_.wait(lock, [this] { return jobs_.empty() && !busy_; });
+  }
 
  private:
-  std::shared_ptr<Buffer> buffer_;
-  uint8_t skip_bytes_;
+  struct Job {
+    Stream* stream = nullptr;
+    std::unique_ptr<ESBatch> batch;
+  };
+
+  static constexpr size_t kMaxQueuedBatches = 64;
+
+  void Run();
+
+  std::mutex lock_;
+  // Signals the worker that a job arrived or it should stop.
+  std::condition_variable condition_;
+  // Signals the feeding thread that a job was taken or finished.
+  std::condition_variable idle_condition_;
+  RingQueue<Job> jobs_;
+  std::vector<std::unique_ptr<ESBatch>> free_batches_;
+  bool busy_;
+  bool stopping_;
+  std::thread thread_;
+
+  AVE_DISALLOW_COPY_AND_ASSIGN(ESWorker);
 };
 
 class TSParser::Stream {
  public:
-  Stream(TSParser* parser, unsigned pid, unsigned stream_type)
+  Stream(TSParser* parser,
+         ESWorker* worker,
+         unsigned pid,
+         unsigned stream_type)
       : parser_(parser),
+        worker_(worker),
         elementary_pid_(pid),
         stream_type_(stream_type),
         audio_type_(kAudioTypeUndefined),
         expected_continuity_counter_(-1),
         payload_started_(false),
-        eos_reached_(false) {
+        pes_header_parsed_(false),
+        pes_time_us_(-1),
+        pes_payload_size_(0),
+        eos_reached_(false),
+        arrival_clock_recovery_(true),
+        anchor_time_us_(-1),
+        anchor_arrival_us_(-1) {
     // Create appropriate ES queue based on stream type
     ESQueue::Mode mode = ESQueue::Mode::INVALID;
 
@@ -183,6 +307,12 @@ class TSParser::Stream {
 
   void SetAudioType(uint8_t audio_type) { audio_type_ = audio_type; }
 
+  // Set while the program has not carried a PCR: PES packets without a PTS
+  // are then timed from the M2TS arrival clock instead.
+  void SetArrivalClockRecovery(bool enabled) {
+    arrival_clock_recovery_ = enabled;
+  }
+
   bool IsVideo() const {
     return stream_type_ == STREAMTYPE_H264 || stream_type_ == STREAMTYPE_H265 ||
            stream_type_ == STREAMTYPE_MPEG1_VIDEO ||
@@ -200,89 +330,135 @@ class TSParser::Stream {
 
   status_t Parse(unsigned continuity_counter,
                  unsigned payload_unit_start_indicator,
-                 BitReader* br,
+                 const uint8_t* data,
+                 size_t payload_size,
                  TSParser::SyncEvent* event) {
     if (expected_continuity_counter_ >= 0 &&
         (unsigned)expected_continuity_counter_ != continuity_counter) {
       AVE_LOG(LS_WARNING) << "Discontinuity on stream PID " << elementary_pid_;
-      payload_started_ = false;
-      if (pes_buffer_) {
-        pes_buffer_->setRange(0, 0);
-      }
+      DropPES();
       expected_continuity_counter_ = -1;
     }
 
     expected_continuity_counter_ = (continuity_counter + 1) & 0x0f;
 
     if (payload_unit_start_indicator) {
-      // A PES normally spans several TS packets. Do not pass individual TS
-      // payloads to ESQueue: continuation payloads have neither a PES header
-      // nor a timestamp, so doing so corrupts elementary-stream AU boundaries
-      // (especially AAC). This mirrors ATSParser::Stream::parse in AOSP.
+      // A PES normally spans several TS packets. Its payload is appended to
+      // ESQueue as it arrives but stays one timestamp range, and access
+      // units are only drained once the PES is complete: continuation
+      // payloads have neither a PES header nor a timestamp, so splitting
+      // them corrupts elementary-stream AU boundaries (especially AAC).
+      // This mirrors ATSParser::Stream::parse in AOSP.
       if (payload_started_) {
-        const status_t err = Flush(event);
-        if (err != OK) {
-          AVE_LOG(LS_WARNING) << "Discarding malformed PES on stream PID "
-                              << elementary_pid_ << ", err=" << err;
-        }
+        FinishPES(event);
       }
+      ResetPES();
       payload_started_ = true;
     }
 
-    if (!payload_started_) {
+    if (!payload_started_ || payload_size == 0 || !queue_) {
       return OK;
     }
 
-    size_t payload_size = br->numBitsLeft() / 8;
-    if (payload_size == 0) {
+    if (pes_header_parsed_) {
+      AppendPESPayload(data, payload_size);
       return OK;
     }
 
-    if (!pes_buffer_) {
-      pes_buffer_ = std::make_shared<Buffer>(payload_size);
-      pes_buffer_->setRange(0, 0);
+    // Only a PES header split across TS packets is copied aside.
+    const uint8_t* header = data;
+    size_t header_available = payload_size;
+    if (!pes_header_.empty()) {
+      pes_header_.insert(pes_header_.end(), data, data + payload_size);
+      header = pes_header_.data();
+      header_available = pes_header_.size();
     }
 
-    const size_t buffered_size = pes_buffer_->size();
-    const size_t required_size = buffered_size + payload_size;
-    if (required_size > pes_buffer_->capacity()) {
-      pes_buffer_->ensureCapacity(required_size, true);
+    size_t header_size = 0;
+    std::optional<uint64_t> pts;
+    const status_t err =
+        ParsePESHeader(header, header_available, &header_size, &pts);
+    if (err == E_AGAIN) {
+      if (pes_header_.empty()) {
+        pes_header_.assign(data, data + payload_size);
+      }
+      return OK;
+    }
+    if (err != OK) {
+      AVE_LOG(LS_WARNING) << "Discarding malformed PES on stream PID "
+                          << elementary_pid_ << ", err=" << err;
+      DropPES();
+      return OK;
     }
-    memcpy(pes_buffer_->data() + buffered_size, br->data(), payload_size);
-    pes_buffer_->setRange(0, required_size);
+
+    pes_header_parsed_ = true;
+    if (pts) {
+      pes_time_us_ = ConvertPTSToTimeUs(*pts);
+      anchor_time_us_ = pes_time_us_;
+      anchor_arrival_us_ = parser_->GetArrivalTimeUs();
+    } else {
+      pes_time_us_ = RecoverTimeUs();
+    }
+    if (header_size < header_available) {
+      AppendPESPayload(header + header_size, header_available - header_size);
+    }
+    pes_header_.clear();
 
     return OK;
   }
 
   void SignalDiscontinuity(DiscontinuityType type,
                            std::shared_ptr<Message> extra) {
-    payload_started_ = false;
+    DropPES();
     expected_continuity_counter_ = -1;
-    if (pes_buffer_) {
-      pes_buffer_->setRange(0, 0);
-    }
+    anchor_time_us_ = -1;
+    PostES({.op = ESOp::DISCONTINUITY,
+            .discontinuity_type = type,
+            .extra = std::move(extra)},
+           nullptr, nullptr);
+  }
 
-    if (source_) {
-      source_->QueueDiscontinuity(type, extra, false);
-    }
+  // Drops everything buffered ahead of a seek; the format is kept.
+  void SignalSeek() {
+    DropPES();
+    anchor_time_us_ = -1;
+    expected_continuity_counter_ = -1;
+    eos_reached_ = false;
+    PostES({.op = ESOp::SEEK}, nullptr, nullptr);
   }
 
   void SignalEOS(status_t final_result) {
     if (queue_) {
-      Flush(nullptr);
-      queue_->SignalEOS();
-      DrainAccessUnits(true, nullptr);
+      FinishPES(nullptr);
+      ResetPES();
     }
+    PostES({.op = ESOp::EOS, .final_result = final_result}, nullptr, nullptr);
+    eos_reached_ = true;
+  }
 
-    if (source_) {
-      source_->SignalEOS(final_result);
-    }
+  bool IsESBatchReady() const {
+    return batch_->ready || batch_->data.size() >= kMaxESBatchBytes;
+  }
 
-    eos_reached_ = true;
+  void SubmitESBatch() { worker_->Submit(this, std::move(batch_)); }
+
+  // Runs on the worker.
+  void RunESBatch(const ESBatch& batch) {
+    const uint8_t* data = batch.data.data();
+    for (const auto& command : batch.commands) {
+      RunES(command, data, nullptr);
+      if (command.op == ESOp::APPEND ||
+          command.op == ESOp::APPEND_CONTINUATION) {
+        data += command.size;
+      }
+    }
   }
 
  private:
   TSParser* parser_;
+  // Runs the ES work when set; only the feeding thread touches the PES
+  // state below, and only the worker touches |queue_|.
+  ESWorker* worker_;
   unsigned elementary_pid_;
   unsigned stream_type_;
   uint8_t audio_type_;
@@ -290,135 +466,158 @@ class TSParser::Stream {
 
   std::shared_ptr<PacketSource> source_;
   bool payload_started_;
+  // State of the PES being received; its payload lives in queue_.
+  bool pes_header_parsed_;
+  std::vector<uint8_t> pes_header_;
+  int64_t pes_time_us_;
+  size_t pes_payload_size_;
   bool eos_reached_;
+  bool arrival_clock_recovery_;
+  // Time and arrival time of the last PES with a PTS.
+  int64_t anchor_time_us_;
+  int64_t anchor_arrival_us_;
   std::unique_ptr<ESQueue> queue_;
-  std::shared_ptr<Buffer> pes_buffer_;
-
-  status_t ParsePES(BitReader* br, TSParser::SyncEvent* event) {
-    if (br->numBitsLeft() < 3 * 8) {
-      return ERROR_MALFORMED;
+  // ES work not submitted to |worker_| yet.
+  std::unique_ptr<ESBatch> batch_;
+
+  // Time of a PES without a PTS: the last PTS moved on by the arrival time
+  // passed since, or -1.
+  int64_t RecoverTimeUs() const {
+    const int64_t arrival_us = parser_->GetArrivalTimeUs();
+    if (!arrival_clock_recovery_ || anchor_time_us_ < 0 ||
+        anchor_arrival_us_ < 0 || arrival_us < 0) {
+      return -1;
     }
+    return anchor_time_us_ + (arrival_us - anchor_arrival_us_);
+  }
 
-    uint32_t packet_start_code_prefix = br->getBits(24);
-    if (packet_start_code_prefix != 1) {
-      AVE_LOG(LS_VERBOSE) << "Not a valid PES start code";
-      return ERROR_MALFORMED;
-    }
-
-    if (br->numBitsLeft() < (8 + 16 + 8 + 8) * 8) {
-      return ERROR_MALFORMED;
-    }
-
-    br->skipBits(8);  // stream_id
-    unsigned pes_packet_length = br->getBits(16);
-    (void)pes_packet_length;
-
-    if (br->numBitsLeft() < 16) {
-      return ERROR_MALFORMED;
-    }
+  void ResetPES() {
+    pes_header_parsed_ = false;
+    pes_header_.clear();
+    pes_time_us_ = -1;
+    pes_payload_size_ = 0;
+  }
 
-    uint32_t marker_bits = br->getBits(2);
-    if (marker_bits != 2) {
-      return ERROR_MALFORMED;
+  // Forgets the PES being received, including payload already queued.
+  void DropPES() {
+    if (queue_ && pes_payload_size_ > 0) {
+      PostES({.op = ESOp::DROP, .size = pes_payload_size_}, nullptr, nullptr);
     }
+    ResetPES();
+    payload_started_ = false;
+  }
 
-    br->skipBits(2);  // PES_scrambling_control
-    br->skipBits(1);  // PES_priority
-    br->skipBits(1);  // data_alignment_indicator
-    br->skipBits(1);  // copyright
-    br->skipBits(1);  // original_or_copy
-
-    unsigned pts_dts_flags = br->getBits(2);
-    br->skipBits(6);  // other flags
-
-    unsigned pes_header_data_length = br->getBits(8);
-
-    uint64_t pts = 0;
-    if (pts_dts_flags == 2 || pts_dts_flags == 3) {
-      if (br->numBitsLeft() < 40) {
-        return ERROR_MALFORMED;
-      }
-
-      br->skipBits(4);  // '0010' or '0011'
-      uint64_t pts_32_30 = br->getBits(3);
-      br->skipBits(1);  // marker_bit
-      uint64_t pts_29_15 = br->getBits(15);
-      br->skipBits(1);  // marker_bit
-      uint64_t pts_14_0 = br->getBits(15);
-      br->skipBits(1);  // marker_bit
-
-      pts = (pts_32_30 << 30) | (pts_29_15 << 15) | pts_14_0;
-
-      if (pts_dts_flags == 3) {
-        if (br->numBitsLeft() < 40) {
-          return ERROR_MALFORMED;
-        }
-        // Parse DTS similarly
-        br->skipBits(40);
-      }
-    }
+  void AppendPESPayload(const uint8_t* data, size_t size) {
+    PostES({.op = pes_payload_size_ == 0 ? ESOp::APPEND
+                                         : ESOp::APPEND_CONTINUATION,
+            .size = size,
+            .time_us = pes_time_us_},
+           data, nullptr);
+    pes_payload_size_ += size;
+  }
 
-    // Skip remaining PES header
-    size_t remaining_header = pes_header_data_length;
-    if (pts_dts_flags == 2) {
-      remaining_header -= 5;
-    } else if (pts_dts_flags == 3) {
-      remaining_header -= 10;
+  // Runs |command| now, or batches it for the worker. |data| holds the
+  // payload of APPEND commands; |event| is only filled in inline.
+  void PostES(ESCommand command,
+              const uint8_t* data,
+              TSParser::SyncEvent* event) {
+    if (worker_ == nullptr) {
+      RunES(command, data, event);
+      return;
     }
 
-    if (br->numBitsLeft() < remaining_header * 8) {
-      return ERROR_MALFORMED;
+    if (!batch_) {
+      batch_ = worker_->AcquireBatch();
+      parser_->pending_streams_.push_back(this);
     }
-    br->skipBits(remaining_header * 8);
-
-    // Now we have the payload
-    size_t payload_size = br->numBitsLeft() / 8;
-    if (payload_size == 0) {
-      return OK;
+    if (command.op == ESOp::APPEND ||
+        command.op == ESOp::APPEND_CONTINUATION) {
+      batch_->data.insert(batch_->data.end(), data, data + command.size);
+    } else if (command.op != ESOp::DROP) {
+      batch_->ready = true;
     }
+    batch_->commands.push_back(std::move(command));
+  }
 
-    const uint8_t* data_ptr = br->data();
-
-    if (queue_) {
-      int64_t time_us = -1;
-      if (pts_dts_flags == 2 || pts_dts_flags == 3) {
-        // Convert 90kHz PTS to microseconds
-        time_us = (pts * 1000000LL) / 90000;
-        if (parser_ != nullptr &&
-            (parser_->flags_ & TS_TIMESTAMPS_ARE_ABSOLUTE) == 0) {
-          if (!parser_->time_offset_valid_) {
-            parser_->absolute_time_anchor_us_ = time_us;
-            parser_->time_offset_us_ = -time_us;
-            parser_->time_offset_valid_ = true;
-          }
-          time_us += parser_->time_offset_us_;
-          if (time_us < 0) {
-            time_us = 0;
+  void RunES(const ESCommand& command,
+             const uint8_t* data,
+             TSParser::SyncEvent* event) {
+    switch (command.op) {
+      case ESOp::APPEND:
+        queue_->AppendData(data, command.size, command.time_us);
+        break;
+      case ESOp::APPEND_CONTINUATION:
+        queue_->AppendPESContinuation(data, command.size);
+        break;
+      case ESOp::DROP:
+        queue_->DropTrailingData(command.size);
+        break;
+      case ESOp::DRAIN:
+        DrainAccessUnits(false, event);
+        break;
+      case ESOp::DISCONTINUITY:
+        if (source_) {
+          source_->QueueDiscontinuity(command.discontinuity_type,
+                                      command.extra, false);
+        }
+        break;
+      case ESOp::SEEK:
+        if (queue_) {
+          queue_->Clear(false);
+        }
+        if (source_) {
+          auto format = source_->GetFormat();
+          source_->Clear();
+          if (format) {
+            source_->SetFormat(format);
           }
         }
-        AVE_LOG_IF(LS_INFO,
-                   base::AveConfig::GetInstance().demuxer_logs_enabled())
-            << "TS PES: pid=" << elementary_pid_ << " raw_pts=" << pts
-            << " time_us=" << time_us << " flags=" << pts_dts_flags;
-      }
-
-      queue_->AppendData(data_ptr, payload_size, time_us);
+        break;
+      case ESOp::EOS:
+        if (queue_) {
+          queue_->SignalEOS();
+          DrainAccessUnits(true, nullptr);
+        }
+        if (source_) {
+          source_->SignalEOS(command.final_result);
+        }
+        break;
+    }
+  }
 
-      DrainAccessUnits(false, event);
+  void FinishPES(TSParser::SyncEvent* event) {
+    if (!pes_header_parsed_) {
+      if (!pes_header_.empty()) {
+        AVE_LOG(LS_WARNING) << "Discarding truncated PES header on stream PID "
+                            << elementary_pid_;
+      }
+      return;
     }
 
-    return OK;
+    if (pes_payload_size_ > 0) {
+      PostES({.op = ESOp::DRAIN}, nullptr, event);
+    }
   }
 
-  status_t Flush(TSParser::SyncEvent* event) {
-    if (!pes_buffer_ || pes_buffer_->size() == 0) {
-      return OK;
+  int64_t ConvertPTSToTimeUs(uint64_t pts) {
+    // Convert 90kHz PTS to microseconds
+    int64_t time_us = (pts * 1000000LL) / 90000;
+    if (parser_ != nullptr &&
+        (parser_->flags_ & TS_TIMESTAMPS_ARE_ABSOLUTE) == 0) {
+      if (!parser_->time_offset_valid_) {
+        parser_->absolute_time_anchor_us_ = time_us;
+        parser_->time_offset_us_ = -time_us;
+        parser_->time_offset_valid_ = true;
+      }
+      time_us += parser_->time_offset_us_;
+      if (time_us < 0) {
+        time_us = 0;
+      }
     }
-
-    BitReader br(pes_buffer_->data(), pes_buffer_->size());
-    const status_t err = ParsePES(&br, event);
-    pes_buffer_->setRange(0, 0);
-    return err;
+    AVE_LOG_IF(LS_INFO, base::AveConfig::GetInstance().demuxer_logs_enabled())
+        << "TS PES: pid=" << elementary_pid_ << " raw_pts=" << pts
+        << " time_us=" << time_us;
+    return time_us;
   }
 
   void DrainAccessUnits(bool flush, TSParser::SyncEvent* event) {
@@ -449,55 +648,81 @@ class TSParser::Stream {
   }
 };
 
-class TSParser::Program {
- public:
-  Program(TSParser* parser, unsigned program_map_pid)
-      : parser_(parser), program_map_pid_(program_map_pid) {}
-
-  bool ParsePSISection(unsigned pid,
-                       unsigned payload_unit_start_indicator,
-                       BitReader* br,
-                       status_t* err) {
-    *err = OK;
-
-    if (pid == program_map_pid_) {
-      if (payload_unit_start_indicator) {
-        if (br->numBitsLeft() < 8) {
-          *err = ERROR_MALFORMED;
-          return true;
-        }
-        unsigned skip = br->getBits(8);
-        if (br->numBitsLeft() < skip * 8) {
-          *err = ERROR_MALFORMED;
-          return true;
-        }
-        br->skipBits(skip * 8);
-      }
-      *err = ParseProgramMap(br);
-      return true;
+void TSParser::ESWorker::Run() {
+  std::unique_lock<std::mutex> lock(lock_);
+  while (true) {
+    condition_.wait(lock, [this] { return stopping_ || !jobs_.empty(); });
+    if (jobs_.empty()) {
+      return;
     }
 
-    return false;
+    Job job = std::move(jobs_.front());
+    jobs_.pop_front();
+    busy_ = true;
+    idle_condition_.notify_all();
+
+    lock.unlock();
+    job.stream->RunESBatch(*job.batch);
+    job.batch->Clear();
+    lock.lock();
+
+    busy_ = false;
+    free_batches_.push_back(std::move(job.batch));
+    idle_condition_.notify_all();
   }
+}
 
-  bool ParsePID(unsigned pid,
-                unsigned continuity_counter,
-                unsigned payload_unit_start_indicator,
-                unsigned transport_scrambling_control,
-                unsigned random_access_indicator,
-                BitReader* br,
-                status_t* err,
-                TSParser::SyncEvent* event) {
-    *err = OK;
+class TSParser::Program {
+ public:
+  Program(TSParser* parser,
+          ESWorker* worker,
+          unsigned program_number,
+          unsigned program_map_pid)
+      : parser_(parser),
+        worker_(worker),
+        program_number_(program_number),
+        program_map_pid_(program_map_pid),
+        pcr_pid_(kNullPID),
+        has_pcr_(false) {}
+
+  unsigned program_number() const { return program_number_; }
+  unsigned pcr_pid() const { return pcr_pid_; }
+
+  // The program carries a PCR, its streams stop recovering timestamps from
+  // the arrival clock.
+  void OnPCR() {
+    if (has_pcr_) {
+      return;
+    }
+    has_pcr_ = true;
+    for (auto& pair : streams_) {
+      pair.second->SetArrivalClockRecovery(false);
+    }
+  }
 
-    auto it = streams_.find(pid);
-    if (it == streams_.end()) {
-      return false;
+  status_t ParsePSISection(unsigned payload_unit_start_indicator,
+                           const uint8_t* data,
+                           size_t size) {
+    BitReader br(data, size);
+    if (payload_unit_start_indicator) {
+      if (br.numBitsLeft() < 8) {
+        return ERROR_MALFORMED;
+      }
+      unsigned skip = br.getBits(8);
+      if (br.numBitsLeft() < skip * 8) {
+        return ERROR_MALFORMED;
+      }
+      br.skipBits(skip * 8);
     }
+    return ParseProgramMap(&br);
+  }
 
-    *err = it->second->Parse(continuity_counter, payload_unit_start_indicator,
-                             br, event);
-    return true;
+  // Points the entries of this program's PMT and elementary PIDs at it.
+  void AddPIDHandlers(std::vector<PIDHandler>* pid_table) {
+    for (auto& pair : streams_) {
+      (*pid_table)[pair.first] = {this, pair.second.get()};
+    }
+    (*pid_table)[program_map_pid_] = {this, nullptr};
   }
 
   void SignalDiscontinuity(DiscontinuityType type,
@@ -507,6 +732,12 @@ class TSParser::Program {
     }
   }
 
+  void SignalSeek() {
+    for (auto& pair : streams_) {
+      pair.second->SignalSeek();
+    }
+  }
+
   void SignalEOS(status_t final_result) {
     for (auto& pair : streams_) {
       pair.second->SignalEOS(final_result);
@@ -562,7 +793,11 @@ class TSParser::Program {
 
  private:
   TSParser* parser_;
+  ESWorker* worker_;
+  unsigned program_number_;
   unsigned program_map_pid_;
+  unsigned pcr_pid_;
+  bool has_pcr_;
   std::map<unsigned, std::shared_ptr<Stream>> streams_;
 
   status_t ParseProgramMap(BitReader* br) {
@@ -586,8 +821,8 @@ class TSParser::Program {
     br->skipBits(8);   // section_number
     br->skipBits(8);   // last_section_number
 
-    br->skipBits(3);   // reserved
-    br->skipBits(13);  // PCR_PID
+    br->skipBits(3);  // reserved
+    pcr_pid_ = br->getBits(13);
 
     br->skipBits(4);  // reserved
     unsigned program_info_length = br->getBits(12);
@@ -619,10 +854,12 @@ class TSParser::Program {
       // Create stream if not exists
       auto it = streams_.find(elementary_pid);
       if (it == streams_.end()) {
-        auto stream =
-            std::make_shared<Stream>(parser_, elementary_pid, stream_type);
+        auto stream = std::make_shared<Stream>(parser_, worker_, elementary_pid,
+                                               stream_type);
         stream->SetAudioType(audio_type);
+        stream->SetArrivalClockRecovery(!has_pcr_);
         streams_[elementary_pid] = stream;
+        parser_->pid_table_dirty_ = true;
         AVE_LOG(LS_INFO) << "Found stream: PID=" << elementary_pid
                          << " type=" << stream_type
                          << " audio_type=" << static_cast<int>(audio_type);
@@ -658,18 +895,28 @@ void TSParser::SyncEvent::Reset() {
 
 TSParser::TSParser(uint32_t flags)
     : flags_(flags),
+      pid_table_(kNumPIDs),
+      pid_table_dirty_(false),
       absolute_time_anchor_us_(0),
       time_offset_valid_(false),
       time_offset_us_(0),
       last_recovered_pts_(0),
       num_ts_packets_parsed_(0),
+      partial_packet_size_(0),
+      packet_stride_(0),
+      arrival_time_valid_(false),
+      last_arrival_time_stamp_(0),
+      arrival_time_(0),
       num_pcrs_(0) {
   pcr_[0] = pcr_[1] = 0;
   pcr_bytes_[0] = pcr_bytes_[1] = 0;
   system_time_us_[0] = system_time_us_[1] = 0;
 }
 
-TSParser::~TSParser() {}
+TSParser::~TSParser() {
+  // Queued work refers to the streams of |programs_|.
+  workers_.clear();
+}
 
 status_t TSParser::FeedTSPacket(const void* data,
                                 size_t size,
@@ -679,44 +926,146 @@ status_t TSParser::FeedTSPacket(const void* data,
     return ERROR_MALFORMED;
   }
 
-  BitReader br(static_cast<const uint8_t*>(data), kTSPacketSize);
-  return ParseTS(&br, event);
+  const status_t err = ParseTS(static_cast<const uint8_t*>(data), event);
+  if (!pending_streams_.empty()) {
+    SubmitESWork(false);
+  }
+  return err;
 }
 
-status_t TSParser::ParseTS(BitReader* br, SyncEvent* event) {
-  if (br->getBits(8) != 0x47) {
-    AVE_LOG(LS_ERROR) << "TS sync byte not found";
-    return ERROR_MALFORMED;
+status_t TSParser::FeedTSBuffer(std::span<const uint8_t> data,
+                                SyncEvent* event) {
+  const uint8_t* ptr = data.data();
+  size_t size = data.size();
+
+  if (packet_stride_ == 0) {
+    // Feeds too small to show three packets are held back until the stride
+    // is known; parsing them as 188-byte packets would throw away the
+    // start of an M2TS or RS stream.
+    constexpr size_t kStrideDetectionSize = 8 * kMaxPacketStride;
+    const bool buffered = !stride_detection_buffer_.empty();
+    if (buffered) {
+      stride_detection_buffer_.insert(stride_detection_buffer_.end(), ptr,
+                                      ptr + size);
+    }
+    const std::span<const uint8_t> pending =
+        buffered ? std::span<const uint8_t>(stride_detection_buffer_) : data;
+    packet_stride_ = DetectPacketStride(pending.data(), pending.size());
+    if (packet_stride_ == 0) {
+      if (pending.size() < kStrideDetectionSize) {
+        if (!buffered) {
+          stride_detection_buffer_.assign(ptr, ptr + size);
+        }
+        return OK;
+      }
+      packet_stride_ = kTSPacketSize;
+    }
+    AVE_LOG(LS_INFO) << "TS packet size " << packet_stride_;
+    if (buffered) {
+      std::vector<uint8_t> detection_data;
+      detection_data.swap(stride_detection_buffer_);
+      return FeedTSBuffer(detection_data, event);
+    }
+  }
+  const size_t stride = packet_stride_;
+  // The TS packet follows the M2TS header, and the parity follows it.
+  const size_t sync_offset = stride == kM2TSPacketSize ? kM2TSHeaderSize : 0;
+
+  status_t result = OK;
+  auto parse_packet = [&](const uint8_t* packet) {
+    if (stride == kM2TSPacketSize) {
+      UpdateArrivalTime(packet);
+    }
+    const status_t err = ParseTS(packet + sync_offset, event);
+    ++feed_stats_.num_packets;
+    if (err != OK) {
+      ++feed_stats_.num_malformed_packets;
+      result = err;
+    }
+  };
+
+  if (partial_packet_size_ > 0) {
+    const size_t copy = std::min(stride - partial_packet_size_, size);
+    memcpy(partial_packet_ + partial_packet_size_, ptr, copy);
+    partial_packet_size_ += copy;
+    ptr += copy;
+    size -= copy;
+    if (partial_packet_size_ < stride) {
+      return OK;
+    }
+    partial_packet_size_ = 0;
+    parse_packet(partial_packet_);
   }
 
-  if (br->numBitsLeft() < 3 + 1 + 1 + 13 + 2 + 2 + 4) {
-    return ERROR_MALFORMED;
+  while (size > 0) {
+    if (size > sync_offset && ptr[sync_offset] != kTSSyncByte) {
+      const size_t skip =
+          FindPacketStart(ptr + sync_offset, size - sync_offset, stride);
+      ++feed_stats_.num_resyncs;
+      feed_stats_.num_skipped_bytes += skip;
+      AVE_LOG(LS_WARNING) << "TS sync lost, skipped " << skip << " bytes";
+      ptr += skip;
+      size -= skip;
+      continue;
+    }
+
+    const size_t num_packets =
+        size > sync_offset
+            ? CountSyncedPackets(ptr + sync_offset, size / stride, stride)
+            : 0;
+    if (num_packets == 0) {
+      // Less than a packet left, keep it for the next call.
+      memcpy(partial_packet_, ptr, size);
+      partial_packet_size_ = size;
+      break;
+    }
+
+    for (size_t i = 0; i < num_packets; ++i) {
+      parse_packet(ptr + i * stride);
+    }
+    ptr += num_packets * stride;
+    size -= num_packets * stride;
   }
 
-  br->skipBits(1);  // transport_error_indicator
-  unsigned payload_unit_start_indicator = br->getBits(1);
-  br->skipBits(1);  // transport_priority
+  if (!pending_streams_.empty()) {
+    SubmitESWork(false);
+  }
+  return result;
+}
 
-  unsigned pid = br->getBits(13);
+status_t TSParser::ParseTS(const uint8_t* packet, SyncEvent* event) {
+  if (packet[0] != kTSSyncByte) {
+    AVE_LOG(LS_ERROR) << "TS sync byte not found";
+    return ERROR_MALFORMED;
+  }
 
-  unsigned transport_scrambling_control = br->getBits(2);
-  unsigned adaptation_field_control = br->getBits(2);
-  unsigned continuity_counter = br->getBits(4);
+  // transport_error_indicator and transport_priority are ignored.
+  const unsigned payload_unit_start_indicator = (packet[1] >> 6) & 0x01;
+  const unsigned pid = ((packet[1] & 0x1f) << 8) | packet[2];
+  const unsigned transport_scrambling_control = packet[3] >> 6;
+  const unsigned adaptation_field_control = (packet[3] >> 4) & 0x03;
+  const unsigned continuity_counter = packet[3] & 0x0f;
 
+  size_t offset = 4;
   unsigned random_access_indicator = 0;
   if (adaptation_field_control == 2 || adaptation_field_control == 3) {
-    status_t err = ParseAdaptationField(br, pid, &random_access_indicator);
+    size_t adaptation_field_size = 0;
+    status_t err = ParseAdaptationField(
+        packet + offset, kTSPacketSize - offset, pid, &random_access_indicator,
+        &adaptation_field_size);
     if (err != OK) {
       return err;
     }
+    offset += adaptation_field_size;
   }
 
   status_t err = OK;
 
   if (adaptation_field_control == 1 || adaptation_field_control == 3) {
-    err =
-        ParsePID(br, pid, continuity_counter, payload_unit_start_indicator,
-                 transport_scrambling_control, random_access_indicator, event);
+    err = ParsePID(packet + offset, kTSPacketSize - offset, pid,
+                   continuity_counter, payload_unit_start_indicator,
+                   transport_scrambling_control, random_access_indicator,
+                   event);
   }
 
   ++num_ts_packets_parsed_;
@@ -724,7 +1073,8 @@ status_t TSParser::ParseTS(BitReader* br, SyncEvent* event) {
   return err;
 }
 
-status_t TSParser::ParsePID(BitReader* br,
+status_t TSParser::ParsePID(const uint8_t* data,
+                            size_t size,
                             unsigned pid,
                             unsigned continuity_counter,
                             unsigned payload_unit_start_indicator,
@@ -733,29 +1083,37 @@ status_t TSParser::ParsePID(BitReader* br,
                             SyncEvent* event) {
   if (pid == 0) {
     // PAT
+    BitReader br(data, size);
     if (payload_unit_start_indicator) {
-      unsigned skip = br->getBits(8);
-      br->skipBits(skip * 8);
+      unsigned skip = br.getBits(8);
+      br.skipBits(skip * 8);
+    }
+    ParseProgramAssociationTable(&br);
+    if (pid_table_dirty_) {
+      RebuildPIDTable();
     }
-    ParseProgramAssociationTable(br);
     return OK;
   }
 
-  // Check if this is a PMT or stream PID
-  status_t err;
-  for (auto& program : programs_) {
-    if (program->ParsePSISection(pid, payload_unit_start_indicator, br, &err)) {
-      return err;
-    }
+  const PIDHandler& handler = pid_table_[pid];
+  if (handler.program == nullptr) {
+    // Unknown PID, or one of a program that is filtered out.
+    return OK;
+  }
 
-    if (program->ParsePID(pid, continuity_counter, payload_unit_start_indicator,
-                          transport_scrambling_control, random_access_indicator,
-                          br, &err, event)) {
-      return err;
+  if (handler.stream == nullptr) {
+    // PMT
+    const status_t err =
+        handler.program->ParsePSISection(payload_unit_start_indicator, data,
+                                         size);
+    if (pid_table_dirty_) {
+      RebuildPIDTable();
     }
+    return err;
   }
 
-  return OK;
+  return handler.stream->Parse(continuity_counter, payload_unit_start_indicator,
+                               data, size, event);
 }
 
 void TSParser::ParseProgramAssociationTable(BitReader* br) {
@@ -786,18 +1144,20 @@ void TSParser::ParseProgramAssociationTable(BitReader* br) {
     unsigned program_map_pid = br->getBits(13);
 
     if (program_number != 0) {
-      // Check if we already have this program
-      bool found = false;
-      for (auto& program : programs_) {
-        if (program->HasSource(VIDEO) || program->HasSource(AUDIO)) {
-          found = true;
-          break;
-        }
-      }
-
-      if (!found) {
-        auto program = std::make_shared<Program>(this, program_map_pid);
-        programs_.push_back(program);
+      // The PAT is repeated; only add programs not seen before.
+      auto it = std::find_if(programs_.begin(), programs_.end(),
+                             [program_number](const auto& program) {
+                               return program->program_number() ==
+                                      program_number;
+                             });
+      if (it == programs_.end()) {
+        ESWorker* worker =
+            workers_.empty()
+                ? nullptr
+                : workers_[programs_.size() % workers_.size()].get();
+        programs_.push_back(std::make_shared<Program>(
+            this, worker, program_number, program_map_pid));
+        pid_table_dirty_ = true;
         AVE_LOG(LS_INFO) << "Found program " << program_number
                          << " with PMT PID " << program_map_pid;
       }
@@ -807,52 +1167,71 @@ void TSParser::ParseProgramAssociationTable(BitReader* br) {
   }
 }
 
-status_t TSParser::ParseAdaptationField(BitReader* br,
+status_t TSParser::ParseAdaptationField(const uint8_t* data,
+                                        size_t size,
                                         unsigned pid,
-                                        unsigned* random_access_indicator) {
+                                        unsigned* random_access_indicator,
+                                        size_t* adaptation_field_size) {
   *random_access_indicator = 0;
 
-  if (br->numBitsLeft() < 8) {
+  if (size < 1) {
     return ERROR_MALFORMED;
   }
 
-  unsigned adaptation_field_length = br->getBits(8);
+  const size_t adaptation_field_length = data[0];
+  if (adaptation_field_length + 1 > size) {
+    return ERROR_MALFORMED;
+  }
 
   if (adaptation_field_length > 0) {
-    if (br->numBitsLeft() < 8) {
-      return ERROR_MALFORMED;
-    }
-
-    br->skipBits(1);  // discontinuity_indicator
-    *random_access_indicator = br->getBits(1);
-    br->skipBits(6);  // other flags
-
-    // Skip rest of adaptation field
-    size_t remaining = adaptation_field_length - 1;
-    if (br->numBitsLeft() < remaining * 8) {
-      return ERROR_MALFORMED;
+    // discontinuity_indicator, random_access_indicator, other flags.
+    *random_access_indicator = (data[1] >> 6) & 0x01;
+    const bool pcr_flag = (data[1] & 0x10) != 0;
+    if (pcr_flag && adaptation_field_length >= 7) {
+      const uint8_t* p = data + 2;
+      const uint64_t base = (static_cast<uint64_t>(p[0]) << 25) |
+                            (p[1] << 17) | (p[2] << 9) | (p[3] << 1) |
+                            (p[4] >> 7);
+      const uint64_t extension = ((p[4] & 0x01) << 8) | p[5];
+      UpdatePCR(pid, base * 300 + extension,
+                num_ts_packets_parsed_ * kTSPacketSize);
     }
-    br->skipBits(remaining * 8);
   }
 
+  *adaptation_field_size = 1 + adaptation_field_length;
   return OK;
 }
 
 void TSParser::SignalDiscontinuity(DiscontinuityType type,
                                    std::shared_ptr<Message> extra) {
+  // Bytes carried over by FeedTSBuffer() belong to the old position.
+  partial_packet_size_ = 0;
+  stride_detection_buffer_.clear();
   for (auto& program : programs_) {
     program->SignalDiscontinuity(type, extra);
   }
+  WaitForWorkers();
 }
 
 void TSParser::SignalEOS(status_t final_result) {
+  if (!stride_detection_buffer_.empty()) {
+    // The whole stream was too short to tell, take it as 188-byte packets.
+    packet_stride_ = kTSPacketSize;
+    std::vector<uint8_t> buffered;
+    buffered.swap(stride_detection_buffer_);
+    FeedTSBuffer(buffered);
+  }
   for (auto& program : programs_) {
     program->SignalEOS(final_result);
   }
+  WaitForWorkers();
 }
 
 std::shared_ptr<PacketSource> TSParser::GetSource(SourceType type) {
   for (auto& program : programs_) {
+    if (!IsProgramSelected(program->program_number())) {
+      continue;
+    }
     auto source = program->GetSource(type);
     if (source) {
       return source;
@@ -863,13 +1242,122 @@ std::shared_ptr<PacketSource> TSParser::GetSource(SourceType type) {
 
 bool TSParser::HasSource(SourceType type) const {
   for (const auto& program : programs_) {
-    if (program->HasSource(type)) {
+    if (IsProgramSelected(program->program_number()) &&
+        program->HasSource(type)) {
       return true;
     }
   }
   return false;
 }
 
+void TSParser::SetProgramFilter(std::vector<unsigned> program_numbers) {
+  program_filter_ = std::move(program_numbers);
+  RebuildPIDTable();
+}
+
+status_t TSParser::SetNumWorkers(size_t num_workers) {
+  if (!programs_.empty()) {
+    return INVALID_OPERATION;
+  }
+  workers_.clear();
+  for (size_t i = 0; i < num_workers; ++i) {
+    workers_.push_back(std::make_unique<ESWorker>());
+  }
+  return OK;
+}
+
+void TSParser::SubmitESWork(bool all) {
+  size_t num_kept = 0;
+  for (Stream* stream : pending_streams_) {
+    if (all || stream->IsESBatchReady()) {
+      stream->SubmitESBatch();
+    } else {
+      pending_streams_[num_kept++] = stream;
+    }
+  }
+  pending_streams_.resize(num_kept);
+}
+
+void TSParser::WaitForWorkers() {
+  if (workers_.empty()) {
+    return;
+  }
+  SubmitESWork(true);
+  for (auto& worker : workers_) {
+    worker->Wait();
+  }
+}
+
+bool TSParser::IsProgramSelected(unsigned program_number) const {
+  return program_filter_.empty() ||
+         std::find(program_filter_.begin(), program_filter_.end(),
+                   program_number) != program_filter_.end();
+}
+
+void TSParser::RebuildPIDTable() {
+  std::fill(pid_table_.begin(), pid_table_.end(), PIDHandler());
+  for (auto& program : programs_) {
+    if (IsProgramSelected(program->program_number())) {
+      program->AddPIDHandlers(&pid_table_);
+    }
+  }
+  pid_table_dirty_ = false;
+}
+
+const TSParser::FeedStats& TSParser::GetFeedStats() const {
+  return feed_stats_;
+}
+
+size_t TSParser::GetPacketStride() const {
+  return packet_stride_;
+}
+
+int64_t TSParser::GetArrivalTimeUs() const {
+  return arrival_time_valid_ ? arrival_time_ / 27 : -1;
+}
+
+void TSParser::SetIndex(std::shared_ptr<const TSIndex> index) {
+  index_ = std::move(index);
+}
+
+int64_t TSParser::GetDurationUs() const {
+  return index_ ? index_->duration_us() : -1;
+}
+
+status_t TSParser::SeekTo(int64_t time_us,
+                          MediaSource::ReadOptions::SeekMode mode,
+                          int64_t* offset,
+                          int64_t* sync_time_us) {
+  if (!index_) {
+    return ERROR_UNSUPPORTED;
+  }
+  const TSIndex::Entry* entry = index_->FindSyncPoint(time_us, mode);
+  if (entry == nullptr) {
+    return ERROR_OUT_OF_RANGE;
+  }
+
+  // Index times are relative to the first PTS of the stream. Anchor there
+  // even if parsing starts at the sync point.
+  if ((flags_ & TS_TIMESTAMPS_ARE_ABSOLUTE) == 0 && !time_offset_valid_) {
+    absolute_time_anchor_us_ = index_->first_pts_us();
+    time_offset_us_ = -absolute_time_anchor_us_;
+    time_offset_valid_ = true;
+  }
+
+  partial_packet_size_ = 0;
+  stride_detection_buffer_.clear();
+  for (auto& program : programs_) {
+    program->SignalSeek();
+  }
+  WaitForWorkers();
+
+  *offset = entry->offset;
+  if (sync_time_us != nullptr) {
+    *sync_time_us = entry->time_us;
+  }
+  return OK;
+}
+
 bool TSParser::PTSTimeDeltaEstablished() {
   return time_offset_valid_;
 }
@@ -878,10 +1366,37 @@ int64_t TSParser::GetFirstPTSTimeUs() {
   return time_offset_valid_ ? absolute_time_anchor_us_ : 0;
 }
 
+void TSParser::UpdateArrivalTime(const uint8_t* header) {
+  // copy_permission_indicator (2 bits), arrival_time_stamp (30 bits).
+  const uint32_t stamp = (static_cast<uint32_t>(header[0] & 0x3f) << 24) |
+                         (static_cast<uint32_t>(header[1]) << 16) |
+                         (static_cast<uint32_t>(header[2]) << 8) | header[3];
+  if (arrival_time_valid_) {
+    arrival_time_ += (stamp - last_arrival_time_stamp_) & 0x3fffffff;
+  } else {
+    arrival_time_valid_ = true;
+  }
+  last_arrival_time_stamp_ = stamp;
+}
+
 void TSParser::UpdatePCR(unsigned pid,
                          uint64_t pcr,
                          uint64_t byte_offset_from_start) {
-  // PCR handling - simplified
+  for (auto& program : programs_) {
+    if (program->pcr_pid() == pid) {
+      program->OnPCR();
+    }
+  }
+
+  // The last two PCRs and where they were seen.
+  if (num_pcrs_ == 2) {
+    pcr_[0] = pcr_[1];
+    pcr_bytes_[0] = pcr_bytes_[1];
+    num_pcrs_ = 1;
+  }
+  pcr_[num_pcrs_] = pcr;
+  pcr_bytes_[num_pcrs_] = byte_offset_from_start;
+  ++num_pcrs_;
 }
 
 }  // namespace mpeg2ts
@@ -12,14 +12,15 @@
 #define MODULES_MPEG2TS_TS_PARSER_H
 
 #include <cstdint>
-#include <map>
 #include <memory>
+#include <span>
 #include <vector>
 
 #include "base/constructor_magic.h"
 #include "foundation/bit_reader.h"
 #include "foundation/media_errors.h"
 #include "packet_source.h"
+#include "ts_sync.h"
 
 namespace ave {
 namespace media {
@@ -30,6 +31,7 @@ namespace mpeg2ts {
 
 class ESQueue;
 class PacketSource;
+class TSIndex;
 
 class TSParser {
  public:
@@ -72,6 +74,15 @@ class TSParser {
     SourceType type_;
   };
 
+  // Counters kept by FeedTSBuffer().
+  struct FeedStats {
+    uint64_t num_packets = 0;
+    uint64_t num_malformed_packets = 0;
+    // Number of times sync was lost, and the bytes dropped to regain it.
+    uint64_t num_resyncs = 0;
+    uint64_t num_skipped_bytes = 0;
+  };
+
   explicit TSParser(uint32_t flags = 0);
   virtual ~TSParser();
 
@@ -84,6 +95,44 @@ class TSParser {
                         size_t size,
                         SyncEvent* event = nullptr);
 
+  // Feed any number of bytes, e.g. a UDP datagram or a chunk of a file. A
+  // trailing partial packet is kept and completed by the next call. After
+  // corruption the parser skips ahead to the next position with three sync
+  // bytes in a row. Parsing continues past malformed packets; the error of
+  // the last one is returned. |event| is handled as in FeedTSPacket().
+  //
+  // The packet size is detected from the first data fed: 188-byte TS,
+  // 192-byte M2TS or 204-byte packets with Reed-Solomon parity. The M2TS
+  // header and the parity are skipped in place. Feeds are buffered until
+  // enough data arrived to tell, at most 1632 bytes; SignalEOS() parses a
+  // shorter stream as 188-byte packets.
+  status_t FeedTSBuffer(std::span<const uint8_t> data,
+                        SyncEvent* event = nullptr);
+
+  const FeedStats& GetFeedStats() const;
+
+  // Returns the packet size FeedTSBuffer() detected, or 0 before it knows.
+  size_t GetPacketStride() const;
+
+  // Returns the arrival time of the last M2TS packet fed, in microseconds
+  // since the first one, or -1 for other streams. The 27 MHz arrival time
+  // stamps are unwrapped; until a program's PCR PID carries a PCR, its PES
+  // packets without a PTS are timed from this clock.
+  int64_t GetArrivalTimeUs() const;
+
+  // Only parse the programs with these program_numbers; packets on the PIDs
+  // of other programs are dropped without being looked at. An empty list,
+  // the default, selects every program.
+  void SetProgramFilter(std::vector<unsigned> program_numbers);
+
+  // Moves ES framing and access unit building to |num_workers| threads.
+  // Each program is handled by one worker, so the access units of a stream
+  // keep their order. PSI sections, continuity counters and PES headers are
+  // still parsed on the feeding thread. Must be called before the first
+  // program is found; returns INVALID_OPERATION otherwise. SyncEvents are
+  // not reported for elementary streams once workers are used.
+  status_t SetNumWorkers(size_t num_workers);
+
   void SignalDiscontinuity(DiscontinuityType type,
                            std::shared_ptr<Message> extra);
 
@@ -92,6 +141,22 @@ class TSParser {
   std::shared_ptr<PacketSource> GetSource(SourceType type);
   bool HasSource(SourceType type) const;
 
+  // Lets SeekTo() and GetDurationUs() use |index|, which must have been
+  // built for the stream being fed.
+  void SetIndex(std::shared_ptr<const TSIndex> index);
+
+  // Returns the duration from the index, or -1 without one.
+  int64_t GetDurationUs() const;
+
+  // Finds the sync point for |time_us| in the index and drops all buffered
+  // data, keeping the stream formats. Feeding must resume at |offset|;
+  // |sync_time_us| is the time of the sync point. Returns ERROR_UNSUPPORTED
+  // without an index.
+  status_t SeekTo(int64_t time_us,
+                  MediaSource::ReadOptions::SeekMode mode,
+                  int64_t* offset,
+                  int64_t* sync_time_us = nullptr);
+
   bool PTSTimeDeltaEstablished();
 
   int64_t GetFirstPTSTimeUs();
@@ -119,7 +184,7 @@ class TSParser {
  private:
   class Program;
   class Stream;
-  class PSISection;
+  class ESWorker;
 
   struct StreamInfo {
     unsigned type;
@@ -127,11 +192,28 @@ class TSParser {
     unsigned pid;
   };
 
+  static constexpr size_t kNumPIDs = 8192;
+
+  // The owner of a PID: a PMT if |stream| is null, an elementary stream
+  // otherwise. Unused and filtered out PIDs have no |program|.
+  struct PIDHandler {
+    Program* program = nullptr;
+    Stream* stream = nullptr;
+  };
+
   uint32_t flags_;
   std::vector<std::shared_ptr<Program>> programs_;
 
-  // Keyed by PID
-  std::map<unsigned, std::shared_ptr<PSISection>> psi_sections_;
+  // Indexed by PID. Rebuilt when the PAT or a PMT adds programs or streams,
+  // so packets are dispatched without searching the programs.
+  std::vector<PIDHandler> pid_table_;
+  bool pid_table_dirty_;
+  std::vector<unsigned> program_filter_;
+  std::shared_ptr<const TSIndex> index_;
+
+  std::vector<std::unique_ptr<ESWorker>> workers_;
+  // Streams holding ES work not handed to their worker yet.
+  std::vector<Stream*> pending_streams_;
 
   int64_t absolute_time_anchor_us_;
 
@@ -141,11 +223,37 @@ class TSParser {
 
   size_t num_ts_packets_parsed_;
 
+  // Partial packet carried between FeedTSBuffer() calls, including the
+  // M2TS header or parity of its stride.
+  uint8_t partial_packet_[kMaxPacketStride];
+  size_t partial_packet_size_;
+  size_t packet_stride_;
+  // Data fed before the packet size could be detected.
+  std::vector<uint8_t> stride_detection_buffer_;
+  FeedStats feed_stats_;
+
+  // Arrival clock of M2TS packets in 27 MHz ticks.
+  bool arrival_time_valid_;
+  uint32_t last_arrival_time_stamp_;
+  int64_t arrival_time_;
+
+  bool IsProgramSelected(unsigned program_number) const;
+  void RebuildPIDTable();
+
+  // Hands the pending ES work to the workers. Unless |all| is set, work
+  // that cannot produce an access unit yet is kept to batch it further.
+  void SubmitESWork(bool all);
+  // Submits all pending ES work and waits until the workers are idle.
+  void WaitForWorkers();
+
   void ParseProgramAssociationTable(BitReader* br);
   void ParseProgramMap(BitReader* br);
   void ParsePES(BitReader* br, SyncEvent* event);
 
-  status_t ParsePID(BitReader* br,
+  // The packet header and adaptation field are read directly from the bytes;
+  // a BitReader is only built for PSI sections.
+  status_t ParsePID(const uint8_t* data,
+                    size_t size,
                     unsigned pid,
                     unsigned continuity_counter,
                     unsigned payload_unit_start_indicator,
@@ -153,11 +261,17 @@ class TSParser {
                     unsigned random_access_indicator,
                     SyncEvent* event);
 
-  status_t ParseAdaptationField(BitReader* br,
+  status_t ParseAdaptationField(const uint8_t* data,
+                                size_t size,
                                 unsigned pid,
-                                unsigned* random_access_indicator);
+                                unsigned* random_access_indicator,
+                                size_t* adaptation_field_size);
+
+  // |packet| holds kTSPacketSize bytes.
+  status_t ParseTS(const uint8_t* packet, SyncEvent* event);
 
-  status_t ParseTS(BitReader* br, SyncEvent* event);
+  // |header| is the TP_extra_header of an M2TS packet.
+  void UpdateArrivalTime(const uint8_t* header);
 
   void UpdatePCR(unsigned pid, uint64_t pcr, uint64_t byte_offset_from_start);
 
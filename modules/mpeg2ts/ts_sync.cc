@@ -0,0 +1,119 @@
+/*
+ * ts_sync.cc
+ * Copyright (C) 2025 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#include "ts_sync.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
+namespace ave {
+namespace media {
+namespace mpeg2ts {
+
+size_t FindSyncByte(const uint8_t* data, size_t size) {
+  size_t i = 0;
+#if defined(__SSE2__)
+  const __m128i sync = _mm_set1_epi8(static_cast<char>(kTSSyncByte));
+  for (; i + 16 <= size; i += 16) {
+    const __m128i bytes =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+    const int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(bytes, sync));
+    if (mask != 0) {
+      return i + __builtin_ctz(mask);
+    }
+  }
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+  const uint8x16_t sync = vdupq_n_u8(kTSSyncByte);
+  for (; i + 16 <= size; i += 16) {
+    const uint8x16_t eq = vceqq_u8(vld1q_u8(data + i), sync);
+    // Narrow each 0xff/0x00 byte to a nibble so the mask fits in 64 bits.
+    const uint64_t mask = vget_lane_u64(
+        vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(eq), 4)), 0);
+    if (mask != 0) {
+      return i + (__builtin_ctzll(mask) >> 2);
+    }
+  }
+#endif
+  const void* found = memchr(data + i, kTSSyncByte, size - i);
+  return found != nullptr ? static_cast<const uint8_t*>(found) - data : size;
+}
+
+size_t CountSyncedPackets(const uint8_t* data,
+                          size_t num_packets,
+                          size_t stride) {
+  size_t n = 0;
+  // The sync bytes are too far apart for a vector load, so check eight of
+  // them per iteration with a single branch instead.
+  for (; n + 8 <= num_packets; n += 8) {
+    const uint8_t* p = data + n * stride;
+    const uint8_t diff =
+        (p[0] ^ kTSSyncByte) | (p[stride] ^ kTSSyncByte) |
+        (p[2 * stride] ^ kTSSyncByte) | (p[3 * stride] ^ kTSSyncByte) |
+        (p[4 * stride] ^ kTSSyncByte) | (p[5 * stride] ^ kTSSyncByte) |
+        (p[6 * stride] ^ kTSSyncByte) | (p[7 * stride] ^ kTSSyncByte);
+    if (diff != 0) {
+      break;
+    }
+  }
+  while (n < num_packets && data[n * stride] == kTSSyncByte) {
+    ++n;
+  }
+  return n;
+}
+
+size_t FindPacketStart(const uint8_t* data, size_t size, size_t stride) {
+  size_t offset = 0;
+  while (offset < size) {
+    offset += FindSyncByte(data + offset, size - offset);
+    if (offset == size) {
+      break;
+    }
+    if ((offset + stride >= size || data[offset + stride] == kTSSyncByte) &&
+        (offset + 2 * stride >= size ||
+         data[offset + 2 * stride] == kTSSyncByte)) {
+      return offset;
+    }
+    ++offset;
+  }
+  return size;
+}
+
+size_t DetectPacketStride(const uint8_t* data, size_t size) {
+  constexpr size_t kStrides[] = {kTSPacketSize, kM2TSPacketSize,
+                                 kRSPacketSize};
+  constexpr size_t kMaxCheckedPackets = 8;
+  constexpr size_t kMinCheckedPackets = 3;
+
+  size_t offset = 0;
+  while (offset < size) {
+    offset += FindSyncByte(data + offset, size - offset);
+    if (offset == size) {
+      break;
+    }
+    for (const size_t stride : kStrides) {
+      const size_t num_packets =
+          std::min(kMaxCheckedPackets, (size - offset - 1) / stride + 1);
+      if (num_packets >= kMinCheckedPackets &&
+          CountSyncedPackets(data + offset, num_packets, stride) ==
+              num_packets) {
+        return stride;
+      }
+    }
+    ++offset;
+  }
+  return 0;
+}
+
+}  // namespace mpeg2ts
+}  // namespace media
+}  // namespace ave
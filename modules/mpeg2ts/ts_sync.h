@@ -0,0 +1,56 @@
+/*
+ * ts_sync.h
+ * Copyright (C) 2025 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#ifndef MODULES_MPEG2TS_TS_SYNC_H
+#define MODULES_MPEG2TS_TS_SYNC_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace ave {
+namespace media {
+namespace mpeg2ts {
+
+constexpr size_t kTSPacketSize = 188;
+constexpr uint8_t kTSSyncByte = 0x47;
+
+// BDAV MPEG-2 TS (M2TS) packets carry a 4-byte TP_extra_header with a
+// 30-bit arrival time stamp ahead of the TS packet.
+constexpr size_t kM2TSPacketSize = 192;
+constexpr size_t kM2TSHeaderSize = 4;
+// Packets followed by 16 bytes of Reed-Solomon parity.
+constexpr size_t kRSPacketSize = 204;
+constexpr size_t kMaxPacketStride = kRSPacketSize;
+
+// Returns the index of the first sync byte in |data|, or |size| if there is
+// none. Scans 16 bytes per step with SSE2 or NEON when available.
+size_t FindSyncByte(const uint8_t* data, size_t size);
+
+// Returns how many of the |num_packets| packets at |data|, |stride| bytes
+// apart, start with a sync byte before the first one that does not.
+size_t CountSyncedPackets(const uint8_t* data,
+                          size_t num_packets,
+                          size_t stride = kTSPacketSize);
+
+// Returns the offset of the first position in |data| that looks like the
+// start of a packet: a sync byte followed by sync bytes one and two
+// |stride|s later, as far as |data| reaches. Returns |size| if none.
+size_t FindPacketStart(const uint8_t* data,
+                       size_t size,
+                       size_t stride = kTSPacketSize);
+
+// Returns which of kTSPacketSize, kM2TSPacketSize and kRSPacketSize the
+// packets in |data| are spaced by, judged from up to eight sync bytes after
+// the first one. Returns 0 if |data| holds fewer than three packets of a
+// stride or none matches.
+size_t DetectPacketStride(const uint8_t* data, size_t size);
+
+}  // namespace mpeg2ts
+}  // namespace media
+}  // namespace ave
+
+#endif  // MODULES_MPEG2TS_TS_SYNC_H
@@ -0,0 +1,441 @@
+/*
+ * ts_writer.cc
+ * Copyright (C) 2025 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#include "ts_writer.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <limits>
+
+#include "base/checks.h"
+#include "base/logging.h"
+#include "ts_parser.h"
+#include "ts_sync.h"
+
+namespace ave {
+namespace media {
+namespace mpeg2ts {
+
+namespace {
+
+constexpr size_t kTSPayloadSize = kTSPacketSize - 4;
+constexpr unsigned kPATPid = 0x0000;
+constexpr uint64_t kTimestampMask = (1ULL << 33) - 1;
+constexpr int64_t kUnset = std::numeric_limits<int64_t>::min();
+
+// Access unit delimiters with primary_pic_type / pic_type "any".
+constexpr uint8_t kH264AUD[] = {0x00, 0x00, 0x00, 0x01, 0x09, 0xf0};
+constexpr uint8_t kH265AUD[] = {0x00, 0x00, 0x00, 0x01, 0x46, 0x01, 0x50};
+
+// CRC-32/MPEG-2 for PSI sections.
+uint32_t Crc32Mpeg(std::span<const uint8_t> data) {
+  static const auto kTable = [] {
+    std::array<uint32_t, 256> table{};
+    for (uint32_t i = 0; i < 256; ++i) {
+      uint32_t crc = i << 24;
+      for (int bit = 0; bit < 8; ++bit) {
+        crc = (crc & 0x80000000) ? (crc << 1) ^ 0x04c11db7 : crc << 1;
+      }
+      table[i] = crc;
+    }
+    return table;
+  }();
+
+  uint32_t crc = 0xffffffff;
+  for (uint8_t byte : data) {
+    crc = (crc << 8) ^ kTable[(crc >> 24) ^ byte];
+  }
+  return crc;
+}
+
+uint64_t UsToTicks(int64_t time_us) {
+  // Rounded so that TSParser's truncating conversion gets |time_us| back.
+  return static_cast<uint64_t>((time_us * 9 + 50) / 100) & kTimestampMask;
+}
+
+// Writes a 33-bit PTS or DTS with its 4-bit |prefix| and marker bits.
+void WriteTimestamp(uint8_t prefix, uint64_t ticks, uint8_t* out) {
+  out[0] = static_cast<uint8_t>((prefix << 4) | ((ticks >> 29) & 0x0e) | 1);
+  out[1] = static_cast<uint8_t>(ticks >> 22);
+  out[2] = static_cast<uint8_t>(((ticks >> 14) & 0xfe) | 1);
+  out[3] = static_cast<uint8_t>(ticks >> 7);
+  out[4] = static_cast<uint8_t>(((ticks << 1) & 0xfe) | 1);
+}
+
+// Returns the type of the first NAL unit of an Annex-B access unit, or -1
+// if |data| does not start with a start code.
+int FirstNalUnitType(std::span<const uint8_t> data, bool h265) {
+  size_t offset = 0;
+  while (offset < data.size() && offset < 3 && data[offset] == 0x00) {
+    ++offset;
+  }
+  if (offset < 2 || offset + 1 >= data.size() || data[offset] != 0x01) {
+    return -1;
+  }
+  const uint8_t header = data[offset + 1];
+  return h265 ? (header >> 1) & 0x3f : header & 0x1f;
+}
+
+// Reads the PES header, prefix and access unit as one byte sequence.
+class PayloadReader {
+ public:
+  PayloadReader(std::span<const uint8_t> header,
+                std::span<const uint8_t> prefix,
+                std::span<const uint8_t> data)
+      : parts_{header, prefix, data} {}
+
+  size_t remaining() const {
+    return parts_[0].size() + parts_[1].size() + parts_[2].size();
+  }
+
+  void Read(uint8_t* out, size_t size) {
+    for (auto& part : parts_) {
+      const size_t chunk = std::min(size, part.size());
+      if (chunk == 0) {
+        continue;
+      }
+      memcpy(out, part.data(), chunk);
+      part = part.subspan(chunk);
+      out += chunk;
+      size -= chunk;
+    }
+    AVE_DCHECK_EQ(size, 0u);
+  }
+
+ private:
+  std::span<const uint8_t> parts_[3];
+};
+
+}  // namespace
+
+TSWriter::TSWriter() : TSWriter(Options()) {}
+
+TSWriter::TSWriter(const Options& options)
+    : options_(options),
+      pcr_stream_index_(0),
+      started_(false),
+      pat_continuity_counter_(0),
+      pmt_continuity_counter_(0),
+      last_psi_us_(kUnset),
+      last_pcr_us_(kUnset) {
+  options_.packets_per_block = std::max<size_t>(options_.packets_per_block, 1);
+  block_pool_.reserve(options_.num_preallocated_blocks);
+  for (size_t i = 0; i < options_.num_preallocated_blocks; ++i) {
+    auto block =
+        std::make_shared<Buffer>(kTSPacketSize * options_.packets_per_block);
+    block->setRange(0, 0);
+    block_pool_.push_back(block);
+  }
+}
+
+TSWriter::~TSWriter() = default;
+
+status_t TSWriter::AddStream(unsigned stream_type, size_t* stream_index) {
+  if (started_) {
+    return INVALID_OPERATION;
+  }
+  if (streams_.size() >= kMaxStreams) {
+    return BAD_VALUE;
+  }
+
+  size_t num_video = 0;
+  size_t num_audio = 0;
+  for (const auto& stream : streams_) {
+    if (stream.stream_id >= 0xe0) {
+      ++num_video;
+    } else if (stream.stream_id >= 0xc0) {
+      ++num_audio;
+    }
+  }
+
+  Stream stream;
+  stream.pid = options_.first_elementary_pid + streams_.size();
+  stream.stream_type = stream_type;
+  stream.continuity_counter = 0;
+  stream.is_video = false;
+  switch (stream_type) {
+    case TSParser::STREAMTYPE_H264:
+    case TSParser::STREAMTYPE_H265:
+      if (num_video >= 16) {
+        return BAD_VALUE;
+      }
+      stream.stream_id = static_cast<uint8_t>(0xe0 + num_video);
+      stream.is_video = true;
+      break;
+    case TSParser::STREAMTYPE_MPEG2_AUDIO_ADTS:
+      stream.stream_id = static_cast<uint8_t>(0xc0 + num_audio);
+      break;
+    case TSParser::STREAMTYPE_AC3:
+      stream.stream_id = 0xbd;  // private_stream_1
+      break;
+    default:
+      AVE_LOG(LS_WARNING) << "Unsupported stream type: " << stream_type;
+      return ERROR_UNSUPPORTED;
+  }
+
+  *stream_index = streams_.size();
+  streams_.push_back(stream);
+  return OK;
+}
+
+status_t TSWriter::WriteAccessUnit(size_t stream_index,
+                                   std::span<const uint8_t> data,
+                                   int64_t pts_us,
+                                   int64_t dts_us,
+                                   bool is_key_frame) {
+  if (stream_index >= streams_.size() || data.empty() || pts_us < 0) {
+    return BAD_VALUE;
+  }
+  if (dts_us < 0) {
+    dts_us = pts_us;
+  }
+
+  if (!started_) {
+    Start();
+  }
+
+  Stream* stream = &streams_[stream_index];
+  std::span<const uint8_t> prefix;
+  if (stream->is_video) {
+    const bool h265 = stream->stream_type == TSParser::STREAMTYPE_H265;
+    const int nal_unit_type = FirstNalUnitType(data, h265);
+    if (nal_unit_type < 0) {
+      AVE_LOG(LS_WARNING) << "Video access unit is not Annex-B";
+      return ERROR_MALFORMED;
+    }
+    if (h265 && nal_unit_type != 35) {
+      prefix = kH265AUD;
+    } else if (!h265 && nal_unit_type != 9) {
+      prefix = kH264AUD;
+    }
+  }
+
+  const bool is_pcr_stream = stream_index == pcr_stream_index_;
+  if (last_psi_us_ == kUnset ||
+      dts_us - last_psi_us_ >= options_.psi_interval_us ||
+      (is_pcr_stream && stream->is_video && is_key_frame)) {
+    WriteTables();
+    last_psi_us_ = dts_us;
+  }
+
+  bool write_pcr = false;
+  if (is_pcr_stream && (last_pcr_us_ == kUnset ||
+                        dts_us - last_pcr_us_ >= options_.pcr_interval_us)) {
+    write_pcr = true;
+    last_pcr_us_ = dts_us;
+  }
+
+  WritePES(stream, prefix, data, pts_us, dts_us,
+           stream->is_video && is_key_frame, write_pcr);
+  return OK;
+}
+
+void TSWriter::Flush() {
+  if (block_ && block_->size() > 0) {
+    ready_blocks_.push_back(std::move(block_));
+  }
+  block_.reset();
+}
+
+void TSWriter::TakeBlocks(std::vector<std::shared_ptr<Buffer>>* blocks) {
+  for (auto& block : ready_blocks_) {
+    blocks->push_back(std::move(block));
+  }
+  ready_blocks_.clear();
+}
+
+void TSWriter::Start() {
+  started_ = true;
+  for (size_t i = 0; i < streams_.size(); ++i) {
+    if (streams_[i].is_video) {
+      pcr_stream_index_ = i;
+      return;
+    }
+  }
+  pcr_stream_index_ = 0;
+}
+
+void TSWriter::WriteTables() {
+  const uint8_t program_hi = static_cast<uint8_t>(options_.program_number >> 8);
+  const uint8_t program_lo = static_cast<uint8_t>(options_.program_number);
+
+  const uint8_t pat[] = {
+      0x00, 0xb0, 13, 0x00, 0x01, 0xc1, 0x00, 0x00, program_hi, program_lo,
+      static_cast<uint8_t>(0xe0 | ((options_.pmt_pid >> 8) & 0x1f)),
+      static_cast<uint8_t>(options_.pmt_pid)};
+  WriteSection(kPATPid, &pat_continuity_counter_, pat);
+
+  const unsigned pcr_pid =
+      streams_.empty() ? 0x1fff : streams_[pcr_stream_index_].pid;
+  uint8_t pmt[12 + 5 * kMaxStreams];
+  size_t size = 0;
+  pmt[size++] = 0x02;
+  pmt[size++] = 0xb0;
+  pmt[size++] = static_cast<uint8_t>(9 + 5 * streams_.size() + 4);
+  pmt[size++] = program_hi;
+  pmt[size++] = program_lo;
+  pmt[size++] = 0xc1;
+  pmt[size++] = 0x00;
+  pmt[size++] = 0x00;
+  pmt[size++] = static_cast<uint8_t>(0xe0 | ((pcr_pid >> 8) & 0x1f));
+  pmt[size++] = static_cast<uint8_t>(pcr_pid);
+  pmt[size++] = 0xf0;  // program_info_length = 0
+  pmt[size++] = 0x00;
+  for (const auto& stream : streams_) {
+    pmt[size++] = static_cast<uint8_t>(stream.stream_type);
+    pmt[size++] = static_cast<uint8_t>(0xe0 | ((stream.pid >> 8) & 0x1f));
+    pmt[size++] = static_cast<uint8_t>(stream.pid);
+    pmt[size++] = 0xf0;  // ES_info_length = 0
+    pmt[size++] = 0x00;
+  }
+  WriteSection(options_.pmt_pid, &pmt_continuity_counter_,
+               std::span(pmt, size));
+}
+
+void TSWriter::WriteSection(unsigned pid,
+                            uint8_t* continuity_counter,
+                            std::span<const uint8_t> section) {
+  AVE_DCHECK_LE(section.size() + 5, kTSPayloadSize);
+
+  uint8_t* packet = NextPacket();
+  packet[0] = kTSSyncByte;
+  packet[1] = static_cast<uint8_t>(0x40 | ((pid >> 8) & 0x1f));
+  packet[2] = static_cast<uint8_t>(pid);
+  packet[3] = static_cast<uint8_t>(0x10 | *continuity_counter);
+  *continuity_counter = (*continuity_counter + 1) & 0x0f;
+
+  uint8_t* payload = packet + 4;
+  *payload++ = 0x00;  // pointer_field
+  memcpy(payload, section.data(), section.size());
+  const uint32_t crc = Crc32Mpeg(section);
+  payload += section.size();
+  for (int shift = 24; shift >= 0; shift -= 8) {
+    *payload++ = static_cast<uint8_t>(crc >> shift);
+  }
+  // Section data is padded with 0xff rather than an adaptation field.
+  memset(payload, 0xff, packet + kTSPacketSize - payload);
+}
+
+void TSWriter::WritePES(Stream* stream,
+                        std::span<const uint8_t> prefix,
+                        std::span<const uint8_t> data,
+                        int64_t pts_us,
+                        int64_t dts_us,
+                        bool random_access,
+                        bool write_pcr) {
+  const bool write_dts = dts_us != pts_us;
+  uint8_t header[19];
+  size_t header_size = 0;
+  header[header_size++] = 0x00;
+  header[header_size++] = 0x00;
+  header[header_size++] = 0x01;
+  header[header_size++] = stream->stream_id;
+  const size_t pes_packet_length =
+      3 + (write_dts ? 10 : 5) + prefix.size() + data.size();
+  // Video PES packets are unbounded, as are audio ones too long to count.
+  const uint16_t length_field =
+      !stream->is_video && pes_packet_length <= 0xffff
+          ? static_cast<uint16_t>(pes_packet_length)
+          : 0;
+  header[header_size++] = static_cast<uint8_t>(length_field >> 8);
+  header[header_size++] = static_cast<uint8_t>(length_field);
+  header[header_size++] = 0x84;  // marker bits, data_alignment_indicator
+  header[header_size++] = write_dts ? 0xc0 : 0x80;
+  header[header_size++] = write_dts ? 10 : 5;
+  WriteTimestamp(write_dts ? 0x03 : 0x02, UsToTicks(pts_us),
+                 header + header_size);
+  header_size += 5;
+  if (write_dts) {
+    WriteTimestamp(0x01, UsToTicks(dts_us), header + header_size);
+    header_size += 5;
+  }
+
+  PayloadReader reader(std::span(header, header_size), prefix, data);
+  bool first = true;
+  while (reader.remaining() > 0) {
+    uint8_t* packet = NextPacket();
+    packet[0] = kTSSyncByte;
+    packet[1] = static_cast<uint8_t>((first ? 0x40 : 0x00) |
+                                     ((stream->pid >> 8) & 0x1f));
+    packet[2] = static_cast<uint8_t>(stream->pid);
+
+    uint8_t adaptation_flags = 0;
+    size_t adaptation_field_size = 0;
+    if (first && (random_access || write_pcr)) {
+      adaptation_flags = (random_access ? 0x40 : 0) | (write_pcr ? 0x10 : 0);
+      adaptation_field_size = 2 + (write_pcr ? 6 : 0);
+    }
+    const size_t payload_size = std::min(
+        reader.remaining(), kTSPayloadSize - adaptation_field_size);
+    // The adaptation field grows to stuff the packet when the remaining
+    // payload does not fill it.
+    adaptation_field_size = kTSPayloadSize - payload_size;
+
+    packet[3] = static_cast<uint8_t>((adaptation_field_size > 0 ? 0x30 : 0x10) |
+                                     stream->continuity_counter);
+    stream->continuity_counter = (stream->continuity_counter + 1) & 0x0f;
+
+    uint8_t* out = packet + 4;
+    if (adaptation_field_size > 0) {
+      uint8_t* end = out + adaptation_field_size;
+      *out++ = static_cast<uint8_t>(adaptation_field_size - 1);
+      if (adaptation_field_size > 1) {
+        *out++ = adaptation_flags;
+        if (adaptation_flags & 0x10) {
+          const int64_t pcr_us = dts_us - options_.pcr_delay_us;
+          const uint64_t pcr_base = UsToTicks(std::max<int64_t>(pcr_us, 0));
+          out[0] = static_cast<uint8_t>(pcr_base >> 25);
+          out[1] = static_cast<uint8_t>(pcr_base >> 17);
+          out[2] = static_cast<uint8_t>(pcr_base >> 9);
+          out[3] = static_cast<uint8_t>(pcr_base >> 1);
+          out[4] = static_cast<uint8_t>(((pcr_base & 1) << 7) | 0x7e);
+          out[5] = 0x00;  // program_clock_reference_extension
+          out += 6;
+        }
+        memset(out, 0xff, end - out);
+      }
+      out = end;
+    }
+    reader.Read(out, payload_size);
+    first = false;
+  }
+}
+
+uint8_t* TSWriter::NextPacket() {
+  if (!block_) {
+    block_ = AcquireBlock();
+  }
+  uint8_t* packet = block_->data() + block_->size();
+  block_->setRange(0, block_->size() + kTSPacketSize);
+  if (block_->size() + kTSPacketSize > block_->capacity()) {
+    ready_blocks_.push_back(std::move(block_));
+    block_.reset();
+  }
+  return packet;
+}
+
+std::shared_ptr<Buffer> TSWriter::AcquireBlock() {
+  // Blocks that are neither current, pending nor held by the caller are
+  // only referenced by the pool.
+  for (const auto& block : block_pool_) {
+    if (block.use_count() == 1) {
+      block->setRange(0, 0);
+      return block;
+    }
+  }
+
+  auto block =
+      std::make_shared<Buffer>(kTSPacketSize * options_.packets_per_block);
+  block->setRange(0, 0);
+  block_pool_.push_back(block);
+  return block;
+}
+
+}  // namespace mpeg2ts
+}  // namespace media
+}  // namespace ave
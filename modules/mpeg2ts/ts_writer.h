@@ -0,0 +1,126 @@
+/*
+ * ts_writer.h
+ * Copyright (C) 2025 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#ifndef MODULES_MPEG2TS_TS_WRITER_H
+#define MODULES_MPEG2TS_TS_WRITER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include "base/constructor_magic.h"
+#include "foundation/buffer.h"
+#include "foundation/media_errors.h"
+
+namespace ave {
+namespace media {
+namespace mpeg2ts {
+
+// Multiplexes the elementary streams of one program into an MPEG-2
+// transport stream: PAT/PMT, PES packetization, PCR, continuity counters
+// and adaptation field stuffing.
+//
+// Output is packed into preallocated blocks of |packets_per_block| TS
+// packets, so a block maps onto one iovec for writev() or one datagram for
+// sendmmsg(). A block is reused once the caller drops its reference.
+// Not thread safe.
+class TSWriter {
+ public:
+  struct Options {
+    unsigned program_number = 1;
+    unsigned pmt_pid = 0x1000;
+    // Streams take consecutive PIDs starting here.
+    unsigned first_elementary_pid = 0x100;
+    // 7 packets fill a 1316-byte UDP datagram.
+    size_t packets_per_block = 7;
+    size_t num_preallocated_blocks = 8;
+    // PAT/PMT are repeated at this interval and before video key frames.
+    int64_t psi_interval_us = 100000;
+    int64_t pcr_interval_us = 40000;
+    // How far the PCR runs behind the DTS of the PCR stream.
+    int64_t pcr_delay_us = 100000;
+  };
+
+  // A PMT section must fit into one packet.
+  static constexpr size_t kMaxStreams = 32;
+
+  TSWriter();
+  explicit TSWriter(const Options& options);
+  ~TSWriter();
+
+  // Adds a stream of TSParser::STREAMTYPE_H264, STREAMTYPE_H265,
+  // STREAMTYPE_MPEG2_AUDIO_ADTS or STREAMTYPE_AC3. All streams must be
+  // added before the first access unit is written. The first video stream,
+  // or the first stream if there is none, carries the PCR.
+  status_t AddStream(unsigned stream_type, size_t* stream_index);
+
+  // Writes one access unit as a PES packet. Video must be Annex-B; an
+  // access unit delimiter is inserted when the access unit lacks one. AAC
+  // must carry ADTS headers. A negative |dts_us| means it equals |pts_us|.
+  status_t WriteAccessUnit(size_t stream_index,
+                           std::span<const uint8_t> data,
+                           int64_t pts_us,
+                           int64_t dts_us,
+                           bool is_key_frame);
+
+  // Completes the partially filled block, if any.
+  void Flush();
+
+  // Appends the completed blocks to |blocks| in output order. Every block
+  // holds a whole number of packets.
+  void TakeBlocks(std::vector<std::shared_ptr<Buffer>>* blocks);
+
+ private:
+  struct Stream {
+    unsigned pid;
+    unsigned stream_type;
+    uint8_t stream_id;
+    uint8_t continuity_counter;
+    bool is_video;
+  };
+
+  Options options_;
+  std::vector<Stream> streams_;
+  size_t pcr_stream_index_;
+  bool started_;
+  uint8_t pat_continuity_counter_;
+  uint8_t pmt_continuity_counter_;
+  int64_t last_psi_us_;
+  int64_t last_pcr_us_;
+
+  std::shared_ptr<Buffer> block_;
+  std::vector<std::shared_ptr<Buffer>> ready_blocks_;
+  std::vector<std::shared_ptr<Buffer>> block_pool_;
+
+  void Start();
+  void WriteTables();
+  void WriteSection(unsigned pid,
+                    uint8_t* continuity_counter,
+                    std::span<const uint8_t> section);
+  void WritePES(Stream* stream,
+                std::span<const uint8_t> prefix,
+                std::span<const uint8_t> data,
+                int64_t pts_us,
+                int64_t dts_us,
+                bool random_access,
+                bool write_pcr);
+
+  // Returns the next packet of the current block, completing the block
+  // when this fills it.
+  uint8_t* NextPacket();
+  std::shared_ptr<Buffer> AcquireBlock();
+
+  AVE_DISALLOW_COPY_AND_ASSIGN(TSWriter);
+};
+
+}  // namespace mpeg2ts
+}  // namespace media
+}  // namespace ave
+
+#endif  // MODULES_MPEG2TS_TS_WRITER_H
@@ -264,6 +264,40 @@ VectorObuInfo ParseObus(
   return obu_infos;
 }
 
+// Feeds the OBU elements of a single rtp payload that are not fragmented to
+// |parser|. Fragments are skipped: sequence and frame headers are small and
+// practically always fit in one packet.
+void ParseCompleteObus(std::span<const uint8_t> rtp_payload,
+                       Av1BitstreamParser* parser) {
+  base::ByteBufferReader payload(rtp_payload);
+  uint8_t aggregation_header = 0;
+  if (!payload.ReadUInt8(&aggregation_header)) {
+    return;
+  }
+  const int32_t num_expected_obus = RtpNumObus(aggregation_header);
+  for (int32_t obu_index = 1; payload.Length() > 0; ++obu_index) {
+    uint64_t element_size = 0;
+    if (obu_index != num_expected_obus) {
+      if (!payload.ReadUVarint(&element_size) ||
+          element_size > payload.Length()) {
+        return;
+      }
+    } else {
+      element_size = payload.Length();
+    }
+    const bool first_is_fragment =
+        obu_index == 1 && RtpStartsWithFragment(aggregation_header);
+    const bool last_is_fragment = element_size == payload.Length() &&
+                                  RtpEndsWithFragment(aggregation_header);
+    if (element_size > 0 && !first_is_fragment && !last_is_fragment) {
+      parser->ParseObu(std::span<const uint8_t>(
+          reinterpret_cast<const uint8_t*>(payload.Data()),
+          static_cast<size_t>(element_size)));
+    }
+    payload.Consume(static_cast<size_t>(element_size));
+  }
+}
+
 // Calculates sizes for the Obu, i.e. base on ObuInfo::data field calculates
 // all other fields in the ObuInfo structure.
 // Returns false if obu found to be misformed.
@@ -372,6 +406,11 @@ VideoRtpDepacketizerAv1::Parse(base::CopyOnWriteBuffer rtp_payload) {
   }
   std::optional<ParsedRtpPayload> parsed(std::in_place);
 
+  obu_parser_.ClearTemporalUnitFlags();
+  ParseCompleteObus(std::span<const uint8_t>(rtp_payload.cdata(),
+                                             rtp_payload.size()),
+                    &obu_parser_);
+
   // To assemble frame, all of the rtp payload is required, including
   // aggregation header.
   parsed->video_payload = std::move(rtp_payload);
@@ -388,9 +427,29 @@ VideoRtpDepacketizerAv1::Parse(base::CopyOnWriteBuffer rtp_payload) {
       !RtpEndsWithFragment(aggregation_header);
 
   parsed->video_header.frame_type =
-      RtpStartsNewCodedVideoSequence(aggregation_header)
+      RtpStartsNewCodedVideoSequence(aggregation_header) ||
+              obu_parser_.IsKeyFrame()
           ? VideoFrameType::kVideoFrameKey
           : VideoFrameType::kVideoFrameDelta;
+
+  const Av1ObuParser::SequenceHeader* sequence_header =
+      obu_parser_.GetSequenceHeader();
+  if (sequence_header &&
+      parsed->video_header.frame_type == VideoFrameType::kVideoFrameKey) {
+    // The key frame header carries the frame size when it was complete in
+    // this packet, the sequence maximum only stands in otherwise.
+    const auto& frame_header = obu_parser_.GetLastFrameHeader();
+    const bool has_frame_size = obu_parser_.IsKeyFrame() && frame_header &&
+                                frame_header->frame_width > 0;
+    parsed->video_header.width = static_cast<uint16_t>(
+        has_frame_size ? frame_header->frame_width
+                       : sequence_header->max_frame_width);
+    parsed->video_header.height = static_cast<uint16_t>(
+        has_frame_size ? frame_header->frame_height
+                       : sequence_header->max_frame_height);
+    parsed->video_header.color_space =
+        Av1ObuParser::GetColorSpace(*sequence_header);
+  }
   return parsed;
 }
 
@@ -17,6 +17,7 @@
 #include <span>
 #include "base/copy_on_write_buffer.h"
 
+#include "media/foundation/av1/av1_obu_parser.h"
 #include "media/modules/rtp_rtcp/src/video/video_rtp_depacketizer.h"
 
 namespace ave {
@@ -35,6 +36,11 @@ class VideoRtpDepacketizerAv1 : public VideoRtpDepacketizer {
 
   std::optional<ParsedRtpPayload> Parse(
       base::CopyOnWriteBuffer rtp_payload) override;
+
+ private:
+  // Tracks the sequence header across packets so complete frame header OBUs
+  // can be inspected for frame_type and dimensions without a decoder.
+  Av1BitstreamParser obu_parser_;
 };
 
 }  // namespace rtp_rtcp
@@ -61,7 +61,8 @@ bool ParseApStartOffsets(const uint8_t* nalu_ptr,
 // Aggregation Packet (AP) strcture
 // https://datatracker.ietf.org/doc/html/rfc7798#section-4.4.2
 std::optional<VideoRtpDepacketizer::ParsedRtpPayload> ProcessApOrSingleNalu(
-    base::CopyOnWriteBuffer rtp_payload) {
+    base::CopyOnWriteBuffer rtp_payload,
+    ParameterSetCache<H265SpsParser::SpsState>* sps_cache) {
   if (rtp_payload.size() < kH265PayloadHeaderSizeBytes) {
     AVE_LOG(LS_ERROR) << "RTP payload truncated.";
     return std::nullopt;
@@ -133,8 +134,10 @@ std::optional<VideoRtpDepacketizer::ParsedRtpPayload> ProcessApOrSingleNalu(
             VideoFrameType::kVideoFrameKey;
         break;
       case H265::NaluType::kSps: {
-        std::optional<H265SpsParser::SpsState> sps =
-            H265SpsParser::ParseSps(nalu_data);
+        const H265SpsParser::SpsState* sps = sps_cache->GetOrParse(
+            nalu_data, [](std::span<const uint8_t> data) {
+              return H265SpsParser::ParseSps(data);
+            });
 
         if (sps) {
           // TODO(bugs.webrtc.org/13485): Implement the size calculation taking
@@ -270,7 +273,7 @@ VideoRtpDepacketizerH265::Parse(base::CopyOnWriteBuffer rtp_payload) {
     AVE_LOG(LS_ERROR) << "Not support type:" << nal_type;
     return std::nullopt;
   }  // Single NAL unit packet or Aggregated packets (AP).
-  return ProcessApOrSingleNalu(std::move(rtp_payload));
+  return ProcessApOrSingleNalu(std::move(rtp_payload), &sps_cache_);
 }
 
 }  // namespace rtp_rtcp
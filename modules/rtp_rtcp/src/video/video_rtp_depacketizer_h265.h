@@ -11,6 +11,8 @@
 #include <optional>
 
 #include "base/copy_on_write_buffer.h"
+#include "media/foundation/h265/h265_sps_parser.h"
+#include "media/foundation/parameter_set_cache.h"
 #include "media/modules/rtp_rtcp/src/video/video_rtp_depacketizer.h"
 
 namespace ave {
@@ -23,6 +25,10 @@ class VideoRtpDepacketizerH265 : public VideoRtpDepacketizer {
 
   std::optional<ParsedRtpPayload> Parse(
       base::CopyOnWriteBuffer rtp_payload) override;
+
+ private:
+  // SPS are resent with every key frame; only parse the ones not seen yet.
+  ParameterSetCache<H265SpsParser::SpsState> sps_cache_;
 };
 
 }  // namespace rtp_rtcp
@@ -18,7 +18,9 @@
 #include <span>
 #include "base/checks.h"
 #include "base/logging.h"
+#include "media/foundation/media_meta.h"
 #include "media/foundation/video_codec_type.h"
+#include "media/foundation/vp8/vp8_header_parser.h"
 #include "media/modules/rtp_rtcp/src/rtp/rtp_video_header.h"
 
 // VP8 payload descriptor
@@ -192,13 +194,15 @@ int32_t VideoRtpDepacketizerVp8::ParseRtpPayload(
   if (video_header->is_first_packet_in_frame && (*vp8_payload & 0x01) == 0) {
     video_header->frame_type = VideoFrameType::kVideoFrameKey;
 
-    if (vp8_payload_size < 10) {
-      // For an I-frame we should always have the uncompressed VP8 header
-      // in the beginning of the partition.
+    // For an I-frame we should always have the uncompressed VP8 header
+    // in the beginning of the partition.
+    std::optional<VP8::FrameHeader> frame_header = VP8::ParseFrameHeader(
+        rtp_payload.subspan(static_cast<size_t>(descriptor_size)));
+    if (!frame_header) {
       return kFailedToParse;
     }
-    video_header->width = ((vp8_payload[7] << 8) + vp8_payload[6]) & 0x3FFF;
-    video_header->height = ((vp8_payload[9] << 8) + vp8_payload[8]) & 0x3FFF;
+    video_header->width = frame_header->width;
+    video_header->height = frame_header->height;
   } else {
     video_header->frame_type = VideoFrameType::kVideoFrameDelta;
 
@@ -209,6 +213,18 @@ int32_t VideoRtpDepacketizerVp8::ParseRtpPayload(
   return descriptor_size;
 }
 
+bool VideoRtpDepacketizerVp8::ParseFrameInfo(std::span<const uint8_t> frame,
+                                             MediaMeta* meta) {
+  std::optional<VP8::FrameHeader> frame_header = VP8::ParseFrameHeader(frame);
+  if (!frame_header) {
+    return false;
+  }
+  VP8::FillMediaMeta(*frame_header, meta);
+  meta->SetPictureType(frame_header->key_frame ? PictureType::I
+                                               : PictureType::P);
+  return true;
+}
+
 }  // namespace rtp_rtcp
 }  // namespace media
 }  // namespace ave
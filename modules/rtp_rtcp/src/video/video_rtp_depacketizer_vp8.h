@@ -21,6 +21,9 @@
 
 namespace ave {
 namespace media {
+
+class MediaMeta;
+
 namespace rtp_rtcp {
 
 class VideoRtpDepacketizerVp8 : public VideoRtpDepacketizer {
@@ -35,6 +38,11 @@ class VideoRtpDepacketizerVp8 : public VideoRtpDepacketizer {
   static int32_t ParseRtpPayload(std::span<const uint8_t> rtp_payload,
                                  RTPVideoHeader* video_header);
 
+  // Describes an assembled vp8 frame without decoding it: dimensions and
+  // color description on key frames, picture type always. Returns false if
+  // the frame header is invalid and the frame should be dropped.
+  static bool ParseFrameInfo(std::span<const uint8_t> frame, MediaMeta* meta);
+
   std::optional<ParsedRtpPayload> Parse(
       base::CopyOnWriteBuffer rtp_payload) override;
 };
@@ -16,8 +16,10 @@
 #include "base/checks.h"
 #include "base/logging.h"
 #include "media/foundation/common_constants.h"
+#include "media/foundation/media_meta.h"
 #include "media/foundation/video_codec_constants.h"
 #include "media/foundation/vp9/vp9_globals.h"
+#include "media/foundation/vp9/vp9_uncompressed_header_parser.h"
 #include "media/modules/rtp_rtcp/src/rtp/rtp_packet_to_send.h"
 
 namespace ave {
@@ -226,7 +228,51 @@ int32_t VideoRtpDepacketizerVp9::ParseRtpPayload(
   }
   // vp9 descriptor is byte aligned.
   AVE_DCHECK_EQ(num_remaining_bits % 8, 0);
-  return rtp_payload.size() - num_remaining_bits / 8;
+  const size_t offset = rtp_payload.size() - num_remaining_bits / 8;
+
+  // The uncompressed header starts the first packet of every layer frame.
+  // It describes the frame even when no scalability structure is sent.
+  if (b_bit) {
+    std::optional<VP9::UncompressedHeader> frame_header =
+        VP9::ParseUncompressedHeader(rtp_payload.subspan(offset));
+    if (frame_header) {
+      if (video_header->width == 0 && frame_header->frame_width > 0) {
+        video_header->width = frame_header->frame_width;
+        video_header->height = frame_header->frame_height;
+      }
+      if (frame_header->has_color_config) {
+        video_header->color_space = VP9::GetColorSpace(*frame_header);
+      }
+    }
+  }
+  return offset;
+}
+
+bool VideoRtpDepacketizerVp9::ParseFrameInfo(std::span<const uint8_t> frame,
+                                             MediaMeta* meta,
+                                             bool* droppable) {
+  bool parsed = false;
+  bool key_frame = false;
+  bool updates_references = false;
+  for (std::span<const uint8_t> sub_frame : VP9::ParseSuperframe(frame)) {
+    std::optional<VP9::UncompressedHeader> frame_header =
+        VP9::ParseUncompressedHeader(sub_frame);
+    if (!frame_header) {
+      return false;
+    }
+    parsed = true;
+    key_frame |= frame_header->key_frame;
+    updates_references |= frame_header->refresh_frame_flags != 0;
+    VP9::FillMediaMeta(*frame_header, meta);
+  }
+  if (!parsed) {
+    return false;
+  }
+  meta->SetPictureType(key_frame ? PictureType::I : PictureType::P);
+  if (droppable) {
+    *droppable = !updates_references;
+  }
+  return true;
 }
 }  // namespace rtp_rtcp
 }  // namespace media
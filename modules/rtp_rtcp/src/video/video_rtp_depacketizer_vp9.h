@@ -18,6 +18,9 @@
 
 namespace ave {
 namespace media {
+
+class MediaMeta;
+
 namespace rtp_rtcp {
 
 class VideoRtpDepacketizerVp9 : public VideoRtpDepacketizer {
@@ -32,6 +35,14 @@ class VideoRtpDepacketizerVp9 : public VideoRtpDepacketizer {
   static int32_t ParseRtpPayload(std::span<const uint8_t> rtp_payload,
                                  RTPVideoHeader* video_header);
 
+  // Describes an assembled vp9 frame or superframe without decoding it.
+  // Fills |meta| from the uncompressed headers and returns false if one of
+  // them is invalid. |droppable| (optional) is set when no frame refreshes a
+  // reference buffer, i.e. dropping it does not break later frames.
+  static bool ParseFrameInfo(std::span<const uint8_t> frame,
+                             MediaMeta* meta,
+                             bool* droppable = nullptr);
+
   std::optional<ParsedRtpPayload> Parse(
       base::CopyOnWriteBuffer rtp_payload) override;
 };
@@ -0,0 +1,103 @@
+/*
+ * video_rtp_depacketizer_av1_unittest.cc
+ * Copyright (C) 2025 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#include "media/modules/rtp_rtcp/src/video/video_rtp_depacketizer_av1.h"
+
+#include <vector>
+
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace ave {
+namespace media {
+namespace rtp_rtcp {
+
+namespace {
+
+// Aggregation header bits, RTP payload format for AV1 section 4.4.
+constexpr uint8_t kStartsWithFragment = 0x80;  // Z
+constexpr uint8_t kEndsWithFragment = 0x40;    // Y
+constexpr uint8_t kNewCodedVideoSequence = 0x08;  // N
+constexpr uint8_t kTwoObus = 0x20;                // W = 2
+constexpr uint8_t kOneObu = 0x10;                 // W = 1
+
+// OBU headers without obu_size, as carried over RTP.
+constexpr uint8_t kSequenceHeaderObu = 1 << 3;
+constexpr uint8_t kFrameHeaderObu = 3 << 3;
+
+// 640x480 8 bit 4:2:0 sequence header, level 3.0.
+const std::vector<uint8_t> kSequenceHeader = {
+    0x00, 0x00, 0x00, 0x24, 0xc4, 0xff, 0xdf, 0x00, 0x00, 0x02};
+// KEY_FRAME, show_frame, frame_size_override_flag with 320x240.
+const std::vector<uint8_t> kKeyFrameHeader = {0x15, 0x3f, 0x77, 0xa0};
+// INTER_FRAME, show_frame, no size override.
+const std::vector<uint8_t> kInterFrameHeader = {0x31, 0xc0, 0x60};
+
+// A packet with the sequence header followed by a frame header OBU. The
+// last OBU element has no length field.
+base::CopyOnWriteBuffer MakeKeyFramePacket(uint8_t aggregation_header) {
+  std::vector<uint8_t> packet = {static_cast<uint8_t>(aggregation_header |
+                                                      kTwoObus)};
+  packet.push_back(static_cast<uint8_t>(1 + kSequenceHeader.size()));
+  packet.push_back(kSequenceHeaderObu);
+  packet.insert(packet.end(), kSequenceHeader.begin(), kSequenceHeader.end());
+  packet.push_back(kFrameHeaderObu);
+  packet.insert(packet.end(), kKeyFrameHeader.begin(), kKeyFrameHeader.end());
+  return base::CopyOnWriteBuffer(packet.data(), packet.size());
+}
+
+base::CopyOnWriteBuffer MakeInterFramePacket() {
+  std::vector<uint8_t> packet = {kOneObu, kFrameHeaderObu};
+  packet.insert(packet.end(), kInterFrameHeader.begin(),
+                kInterFrameHeader.end());
+  return base::CopyOnWriteBuffer(packet.data(), packet.size());
+}
+
+}  // namespace
+
+TEST(VideoRtpDepacketizerAv1Test, DetectsKeyFrameWithoutNewSequenceBit) {
+  VideoRtpDepacketizerAv1 depacketizer;
+  auto parsed = depacketizer.Parse(MakeKeyFramePacket(0));
+  ASSERT_TRUE(parsed.has_value());
+  EXPECT_EQ(VideoFrameType::kVideoFrameKey, parsed->video_header.frame_type);
+  // The frame size, not the sequence maximum.
+  EXPECT_EQ(320, parsed->video_header.width);
+  EXPECT_EQ(240, parsed->video_header.height);
+  EXPECT_TRUE(parsed->video_header.color_space.has_value());
+
+  parsed = depacketizer.Parse(MakeInterFramePacket());
+  ASSERT_TRUE(parsed.has_value());
+  EXPECT_EQ(VideoFrameType::kVideoFrameDelta, parsed->video_header.frame_type);
+  EXPECT_EQ(0, parsed->video_header.width);
+  EXPECT_EQ(0, parsed->video_header.height);
+}
+
+TEST(VideoRtpDepacketizerAv1Test, FragmentedKeyFrameHeaderUsesMaximumSize) {
+  VideoRtpDepacketizerAv1 depacketizer;
+  ASSERT_TRUE(depacketizer.Parse(MakeKeyFramePacket(0)).has_value());
+
+  // The frame header OBU continues in the next packet, only the N bit says
+  // this is a key frame. The earlier key frame's size must not leak in.
+  auto parsed =
+      depacketizer.Parse(MakeKeyFramePacket(kNewCodedVideoSequence |
+                                            kEndsWithFragment));
+  ASSERT_TRUE(parsed.has_value());
+  EXPECT_EQ(VideoFrameType::kVideoFrameKey, parsed->video_header.frame_type);
+  EXPECT_EQ(640, parsed->video_header.width);
+  EXPECT_EQ(480, parsed->video_header.height);
+}
+
+TEST(VideoRtpDepacketizerAv1Test, NewSequenceCannotStartWithFragment) {
+  VideoRtpDepacketizerAv1 depacketizer;
+  EXPECT_FALSE(depacketizer
+                   .Parse(MakeKeyFramePacket(kNewCodedVideoSequence |
+                                             kStartsWithFragment))
+                   .has_value());
+}
+
+}  // namespace rtp_rtcp
+}  // namespace media
+}  // namespace ave
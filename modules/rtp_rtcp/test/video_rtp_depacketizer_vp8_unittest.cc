@@ -0,0 +1,77 @@
+/*
+ * video_rtp_depacketizer_vp8_unittest.cc
+ * Copyright (C) 2025 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#include "media/modules/rtp_rtcp/src/video/video_rtp_depacketizer_vp8.h"
+
+#include <vector>
+
+#include "media/foundation/media_meta.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace ave {
+namespace media {
+namespace rtp_rtcp {
+
+namespace {
+
+// Shown version 0 key frame, 640x480, first_part_size 0x123.
+std::vector<uint8_t> MakeKeyFrame() {
+  const uint32_t tag = (0x123 << 5) | (1 << 4);
+  return {static_cast<uint8_t>(tag),
+          static_cast<uint8_t>(tag >> 8),
+          static_cast<uint8_t>(tag >> 16),
+          0x9d,
+          0x01,
+          0x2a,
+          0x80,
+          0x02,
+          0xe0,
+          0x01};
+}
+
+}  // namespace
+
+TEST(VideoRtpDepacketizerVp8Test, KeyFrameSizeFromFrameHeader) {
+  // Payload descriptor with only the S bit, partition 0.
+  std::vector<uint8_t> payload = {0x10};
+  const std::vector<uint8_t> frame = MakeKeyFrame();
+  payload.insert(payload.end(), frame.begin(), frame.end());
+
+  RTPVideoHeader video_header;
+  EXPECT_EQ(1, VideoRtpDepacketizerVp8::ParseRtpPayload(payload,
+                                                        &video_header));
+  EXPECT_EQ(VideoFrameType::kVideoFrameKey, video_header.frame_type);
+  EXPECT_EQ(640, video_header.width);
+  EXPECT_EQ(480, video_header.height);
+
+  // A key frame with a broken start code is not accepted.
+  payload[6] = 0x2b;
+  EXPECT_EQ(0, VideoRtpDepacketizerVp8::ParseRtpPayload(payload,
+                                                        &video_header));
+}
+
+TEST(VideoRtpDepacketizerVp8Test, ParseFrameInfo) {
+  MediaMeta meta =
+      MediaMeta::Create(MediaType::VIDEO, MediaMeta::FormatType::kSample);
+  ASSERT_TRUE(VideoRtpDepacketizerVp8::ParseFrameInfo(MakeKeyFrame(), &meta));
+  EXPECT_EQ(PictureType::I, meta.picture_type());
+  EXPECT_EQ(640, meta.width());
+  EXPECT_EQ(480, meta.height());
+  EXPECT_EQ(AVE_PIX_FMT_YUV420P, meta.pixel_format());
+
+  // Inter frames only carry the frame tag.
+  const uint8_t inter_frame[] = {0x01, 0x00, 0x00};
+  ASSERT_TRUE(VideoRtpDepacketizerVp8::ParseFrameInfo(inter_frame, &meta));
+  EXPECT_EQ(PictureType::P, meta.picture_type());
+
+  const uint8_t truncated[] = {0x00, 0x00};
+  EXPECT_FALSE(VideoRtpDepacketizerVp8::ParseFrameInfo(truncated, &meta));
+}
+
+}  // namespace rtp_rtcp
+}  // namespace media
+}  // namespace ave
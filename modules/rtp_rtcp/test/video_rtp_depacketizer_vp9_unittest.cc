@@ -0,0 +1,142 @@
+/*
+ * video_rtp_depacketizer_vp9_unittest.cc
+ * Copyright (C) 2025 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#include "media/modules/rtp_rtcp/src/video/video_rtp_depacketizer_vp9.h"
+
+#include <vector>
+
+#include "media/foundation/media_meta.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace ave {
+namespace media {
+namespace rtp_rtcp {
+
+namespace {
+
+class BitWriter {
+ public:
+  void Write(uint32_t value, int bits) {
+    for (int i = bits - 1; i >= 0; --i) {
+      if (bit_pos_ == 0) {
+        bytes_.push_back(0);
+      }
+      bytes_.back() |= ((value >> i) & 1) << (7 - bit_pos_);
+      bit_pos_ = (bit_pos_ + 1) % 8;
+    }
+  }
+  std::vector<uint8_t> bytes() const { return bytes_; }
+
+ private:
+  std::vector<uint8_t> bytes_;
+  int bit_pos_ = 0;
+};
+
+// Profile 0 key frame, 1280x720, BT.709.
+std::vector<uint8_t> MakeKeyFrame() {
+  BitWriter w;
+  w.Write(2, 2);          // frame_marker
+  w.Write(0, 2);          // profile
+  w.Write(0, 1);          // show_existing_frame
+  w.Write(0, 1);          // frame_type (KEY_FRAME)
+  w.Write(1, 1);          // show_frame
+  w.Write(0, 1);          // error_resilient_mode
+  w.Write(0x498342, 24);  // frame_sync_code
+  w.Write(2, 3);          // color_space: CS_BT_709
+  w.Write(0, 1);          // color_range
+  w.Write(1279, 16);      // frame_width_minus_1
+  w.Write(719, 16);       // frame_height_minus_1
+  w.Write(0, 1);          // render_and_frame_size_different
+  w.Write(0, 8);          // start of the rest of the header
+  return w.bytes();
+}
+
+// Profile 0 shown inter frame sized from LAST, refreshing
+// |refresh_frame_flags|.
+std::vector<uint8_t> MakeInterFrame(uint8_t refresh_frame_flags) {
+  BitWriter w;
+  w.Write(2, 2);  // frame_marker
+  w.Write(0, 2);  // profile
+  w.Write(0, 1);  // show_existing_frame
+  w.Write(1, 1);  // frame_type (NON_KEY_FRAME)
+  w.Write(1, 1);  // show_frame
+  w.Write(0, 1);  // error_resilient_mode
+  w.Write(0, 2);  // reset_frame_context
+  w.Write(refresh_frame_flags, 8);
+  for (int i = 0; i < 3; ++i) {
+    w.Write(i, 3);  // ref_frame_idx
+    w.Write(0, 1);  // ref_frame_sign_bias
+  }
+  w.Write(1, 1);  // found_ref
+  w.Write(0, 1);  // render_and_frame_size_different
+  w.Write(0, 8);
+  return w.bytes();
+}
+
+// Two frames with a superframe index using one byte per size.
+std::vector<uint8_t> MakeSuperframe(const std::vector<uint8_t>& first,
+                                    const std::vector<uint8_t>& second) {
+  std::vector<uint8_t> data = first;
+  data.insert(data.end(), second.begin(), second.end());
+  const uint8_t marker = 0xc1;  // 0b110'00'001: one byte sizes, two frames
+  data.push_back(marker);
+  data.push_back(static_cast<uint8_t>(first.size()));
+  data.push_back(static_cast<uint8_t>(second.size()));
+  data.push_back(marker);
+  return data;
+}
+
+}  // namespace
+
+TEST(VideoRtpDepacketizerVp9Test, SizeFromUncompressedHeader) {
+  // Payload descriptor with B and E set, no scalability structure.
+  std::vector<uint8_t> payload = {0x0c};
+  const std::vector<uint8_t> frame = MakeKeyFrame();
+  payload.insert(payload.end(), frame.begin(), frame.end());
+
+  RTPVideoHeader video_header;
+  EXPECT_EQ(1, VideoRtpDepacketizerVp9::ParseRtpPayload(payload,
+                                                        &video_header));
+  EXPECT_EQ(VideoFrameType::kVideoFrameKey, video_header.frame_type);
+  EXPECT_EQ(1280, video_header.width);
+  EXPECT_EQ(720, video_header.height);
+  EXPECT_TRUE(video_header.color_space.has_value());
+}
+
+TEST(VideoRtpDepacketizerVp9Test, ParseFrameInfo) {
+  MediaMeta meta =
+      MediaMeta::Create(MediaType::VIDEO, MediaMeta::FormatType::kSample);
+  bool droppable = true;
+  ASSERT_TRUE(
+      VideoRtpDepacketizerVp9::ParseFrameInfo(MakeKeyFrame(), &meta,
+                                              &droppable));
+  EXPECT_EQ(PictureType::I, meta.picture_type());
+  EXPECT_EQ(1280, meta.width());
+  EXPECT_EQ(720, meta.height());
+  EXPECT_EQ(AVE_PIX_FMT_YUV420P, meta.pixel_format());
+  EXPECT_FALSE(droppable);
+
+  ASSERT_TRUE(VideoRtpDepacketizerVp9::ParseFrameInfo(MakeInterFrame(0),
+                                                      &meta, &droppable));
+  EXPECT_EQ(PictureType::P, meta.picture_type());
+  EXPECT_TRUE(droppable);
+
+  // One frame of the superframe refreshes a buffer, so it has to be kept.
+  ASSERT_TRUE(VideoRtpDepacketizerVp9::ParseFrameInfo(
+      MakeSuperframe(MakeInterFrame(0), MakeInterFrame(0x01)), &meta,
+      &droppable));
+  EXPECT_FALSE(droppable);
+
+  std::vector<uint8_t> bad_sync_code = MakeKeyFrame();
+  bad_sync_code[2] ^= 0xff;
+  EXPECT_FALSE(
+      VideoRtpDepacketizerVp9::ParseFrameInfo(bad_sync_code, &meta));
+}
+
+}  // namespace rtp_rtcp
+}  // namespace media
+}  // namespace ave